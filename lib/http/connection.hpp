@@ -49,6 +49,12 @@ private:
   /// Perform an asynchronous read operation.
   void do_read();
 
+  /// Read the rest of the request body, until it is `length` bytes long.
+  void do_read_body(std::size_t length);
+
+  /// Hand the complete request to the handler.
+  void handle_request();
+
   /// Perform an asynchronous write operation.
   void do_write();
 
@@ -72,6 +78,9 @@ private:
 
   /// The reply to be sent back to the client.
   reply reply_;
+
+  /// Largest request body accepted.
+  static const std::size_t max_body_size = 64 * 1024 * 1024;
 };
 
 typedef std::shared_ptr<connection> connection_ptr;
@@ -31,6 +31,7 @@ const std::string bad_request = "HTTP/1.0 400 Bad Request\r\n";
 const std::string unauthorized = "HTTP/1.0 401 Unauthorized\r\n";
 const std::string forbidden = "HTTP/1.0 403 Forbidden\r\n";
 const std::string not_found = "HTTP/1.0 404 Not Found\r\n";
+const std::string method_not_allowed = "HTTP/1.0 405 Method Not Allowed\r\n";
 const std::string internal_server_error =
     "HTTP/1.0 500 Internal Server Error\r\n";
 const std::string not_implemented = "HTTP/1.0 501 Not Implemented\r\n";
@@ -66,6 +67,8 @@ to_buffer(reply::status_type status)
         return asio::buffer(forbidden);
     case reply::not_found:
         return asio::buffer(not_found);
+    case reply::method_not_allowed:
+        return asio::buffer(method_not_allowed);
     case reply::internal_server_error:
         return asio::buffer(internal_server_error);
     case reply::not_implemented:
@@ -155,6 +158,11 @@ const char not_found[] = "<html>"
                          "<head><title>Not Found</title></head>"
                          "<body><h1>404 Not Found</h1></body>"
                          "</html>";
+const char method_not_allowed[] =
+    "<html>"
+    "<head><title>Method Not Allowed</title></head>"
+    "<body><h1>405 Method Not Allowed</h1></body>"
+    "</html>";
 const char internal_server_error[] =
     "<html>"
     "<head><title>Internal Server Error</title></head>"
@@ -203,6 +211,8 @@ to_string(reply::status_type status)
         return forbidden;
     case reply::not_found:
         return not_found;
+    case reply::method_not_allowed:
+        return method_not_allowed;
     case reply::internal_server_error:
         return internal_server_error;
     case reply::not_implemented:
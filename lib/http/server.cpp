@@ -57,6 +57,13 @@ server::addRoute(const std::string& routeName, routeHandler callback)
     mRoutes[routeName] = callback;
 }
 
+void
+server::addAsyncRoute(const std::string& routeName,
+                      asyncRouteHandler callback)
+{
+    mAsyncRoutes[routeName] = callback;
+}
+
 void
 server::do_accept()
 {
@@ -85,22 +92,20 @@ server::~server()
     connection_manager_.stop_all();
 }
 
-void
-server::handle_request(const request& req, reply& rep)
+bool
+server::split_request(const request& req, std::string& command,
+                      std::string& params)
 {
     // Decode url to path.
     std::string request_path;
     if (!url_decode(req.uri, request_path))
     {
-        rep = reply::stock_reply(reply::bad_request);
-        return;
+        return false;
     }
 
     if (request_path.size() && request_path[0] == '/')
         request_path = request_path.substr(1);
 
-    std::string command;
-    std::string params;
     auto pos = request_path.find('?');
     if (pos == std::string::npos)
         command = request_path;
@@ -109,17 +114,69 @@ server::handle_request(const request& req, reply& rep)
         command = request_path.substr(0, pos);
         params = request_path.substr(pos);
     }
+    return true;
+}
+
+void
+server::set_json_content(reply& rep, const std::string& content)
+{
+    rep.content = content;
+    rep.status = reply::ok;
+    rep.headers.resize(2);
+    rep.headers[0].name = "Content-Length";
+    rep.headers[0].value = std::to_string(rep.content.size());
+    rep.headers[1].name = "Content-Type";
+    rep.headers[1].value = "application/json";
+}
+
+void
+server::handle_request(const request& req, reply& rep,
+                       std::function<void()> done)
+{
+    std::string command;
+    std::string params;
+    if (split_request(req, command, params))
+    {
+        auto it = mAsyncRoutes.find(command);
+        if (it != mAsyncRoutes.end() && req.method == "POST")
+        {
+            it->second(params, req.body,
+                       [&rep, done](const std::string& content)
+                       {
+                           set_json_content(rep, content);
+                           done();
+                       });
+            return;
+        }
+    }
+    handle_request(req, rep);
+    done();
+}
+
+void
+server::handle_request(const request& req, reply& rep)
+{
+    std::string command;
+    std::string params;
+    if (!split_request(req, command, params))
+    {
+        rep = reply::stock_reply(reply::bad_request);
+        return;
+    }
+
+    if (mAsyncRoutes.find(command) != mAsyncRoutes.end())
+    {
+        // asynchronous routes only take POST requests, see above
+        rep = reply::stock_reply(reply::method_not_allowed);
+        rep.headers.push_back({"Allow", "POST"});
+        return;
+    }
 
     if (mRoutes.find(command) != mRoutes.end())
     {
-        mRoutes[command](params, rep.content);
-
-        rep.status = reply::ok;
-        rep.headers.resize(2);
-        rep.headers[0].name = "Content-Length";
-        rep.headers[0].value = std::to_string(rep.content.size());
-        rep.headers[1].name = "Content-Type";
-        rep.headers[1].value = "application/json";
+        std::string content;
+        mRoutes[command](params, content);
+        set_json_content(rep, content);
     }
     else
     {
@@ -30,6 +30,13 @@ class server
 
 public:
     typedef std::function<void(const std::string&, std::string&)> routeHandler;
+    /// Handler of a route replying later: it gets the parameters and the body
+    /// of the request, and calls the given function with the content of the
+    /// reply once it is ready, on the thread of the io_service.
+    /// These routes only accept POST requests, others get a 405 reply.
+    typedef std::function<void(const std::string&, const std::string&,
+                               std::function<void(const std::string&)>)>
+        asyncRouteHandler;
     server(const server&) = delete;
     server& operator=(const server&) = delete;
 
@@ -42,9 +49,15 @@ public:
     ~server();
 
     void addRoute(const std::string& routeName, routeHandler callback);
+    void addAsyncRoute(const std::string& routeName,
+                       asyncRouteHandler callback);
     void add404(routeHandler callback);
 
     void handle_request(const request& req, reply& rep);
+    /// Same as above, also for asynchronous routes: `done` is called once
+    /// `rep` is filled in.
+    void handle_request(const request& req, reply& rep,
+                        std::function<void()> done);
 
     static void parseParams(const std::string& params, std::map<std::string, std::string>& retMap);
 
@@ -56,6 +69,12 @@ private:
     /// invalid.
     static bool url_decode(const std::string& in, std::string& out);
 
+    /// Split the URI of `req` into a command and its parameters.
+    static bool split_request(const request& req, std::string& command,
+                              std::string& params);
+
+    static void set_json_content(reply& rep, const std::string& content);
+
     /// The io_service used to perform asynchronous operations.
     asio::io_service& io_service_;
 
@@ -72,6 +91,7 @@ private:
     asio::ip::tcp::socket socket_;
 
     std::map<std::string, routeHandler> mRoutes;
+    std::map<std::string, asyncRouteHandler> mAsyncRoutes;
 };
 
 } // namespace server
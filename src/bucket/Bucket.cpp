@@ -8,6 +8,7 @@
 // else.
 #include "util/asio.h"
 #include "bucket/BucketApplicator.h"
+#include "bucket/BucketIndex.h"
 #include "bucket/BucketManager.h"
 #include "bucket/BucketList.h"
 #include "bucket/LedgerCmp.h"
@@ -33,6 +34,8 @@
 #include "medida/medida.h"
 #include "lib/util/format.h"
 #include <cassert>
+#include <cstring>
+#include <fstream>
 #include <future>
 
 namespace stellar
@@ -70,6 +73,7 @@ Bucket::~Bucket()
     {
         CLOG(TRACE, "Bucket") << "Bucket::~Bucket removing file: " << mFilename;
         std::remove(mFilename.c_str());
+        std::remove(BucketIndex::getFilename(mFilename).c_str());
     }
 }
 
@@ -95,6 +99,260 @@ Bucket::setRetain(bool r)
     mRetain = r;
 }
 
+// Size of the blocks in which bucket files are read and written.
+static size_t const BUCKET_BLOCK_SIZE = 1 << 20;
+
+namespace
+{
+
+/**
+ * Reads the records of a bucket file in large blocks, exposing each one as it
+ * is in the file: the 4-byte record mark followed by the XDR of a BucketEntry.
+ * The current record stays valid until the reader is advanced.
+ */
+class RecordReader
+{
+    std::ifstream mIn;
+    std::vector<char> mBuf;
+    // start of the current record and end of the data read, in mBuf
+    size_t mBegin{0};
+    size_t mEnd{0};
+    // size of the current record, 0 once the file is exhausted
+    size_t mSize{0};
+
+    // makes sure that the `n` bytes following mBegin are in mBuf
+    bool
+    fill(size_t n)
+    {
+        if (mEnd - mBegin >= n)
+        {
+            return true;
+        }
+        if (mBegin != 0)
+        {
+            std::memmove(mBuf.data(), mBuf.data() + mBegin, mEnd - mBegin);
+            mEnd -= mBegin;
+            mBegin = 0;
+        }
+        if (mBuf.size() < n)
+        {
+            mBuf.resize(n);
+        }
+        while (mEnd < n && mIn)
+        {
+            mIn.read(mBuf.data() + mEnd, mBuf.size() - mEnd);
+            mEnd += static_cast<size_t>(mIn.gcount());
+        }
+        return mEnd >= n;
+    }
+
+  public:
+    explicit RecordReader(std::string const& filename)
+    {
+        if (!filename.empty())
+        {
+            mIn.open(filename, std::ifstream::binary);
+            if (!mIn)
+            {
+                std::string msg("failed to open XDR file: ");
+                throw std::runtime_error(msg + filename);
+            }
+            mBuf.resize(BUCKET_BLOCK_SIZE);
+            advance();
+        }
+    }
+
+    operator bool() const
+    {
+        return mSize != 0;
+    }
+
+    // the record, mark included
+    ByteSlice
+    record() const
+    {
+        return ByteSlice(mBuf.data() + mBegin, mSize);
+    }
+
+    // the encoded BucketEntry
+    ByteSlice
+    entry() const
+    {
+        return ByteSlice(mBuf.data() + mBegin + 4, mSize - 4);
+    }
+
+    void
+    advance()
+    {
+        mBegin += mSize;
+        mSize = 0;
+        if (!fill(4))
+        {
+            if (mEnd != mBegin)
+            {
+                throw xdr::xdr_runtime_error("malformed XDR file");
+            }
+            return;
+        }
+
+        // 4 bytes of size, big-endian, with XDR 'continuation' bit cleared
+        // (high bit of high byte).
+        auto p = reinterpret_cast<unsigned char const*>(mBuf.data() + mBegin);
+        uint32_t sz = (static_cast<uint32_t>(p[0] & 0x7f) << 24) |
+                      (static_cast<uint32_t>(p[1]) << 16) |
+                      (static_cast<uint32_t>(p[2]) << 8) |
+                      static_cast<uint32_t>(p[3]);
+        if (!fill(4 + static_cast<size_t>(sz)))
+        {
+            throw xdr::xdr_runtime_error("malformed XDR file");
+        }
+        mSize = 4 + static_cast<size_t>(sz);
+    }
+};
+
+bool
+isDeadRecord(ByteSlice const& entry)
+{
+    // the BucketEntryType leads the entry, big-endian
+    return entry.size() >= 4 && entry[0] == 0 && entry[1] == 0 &&
+           entry[2] == 0 && entry[3] == DEADENTRY;
+}
+
+/**
+ * Writes records to a new bucket file in large blocks, copying them as they
+ * are and hashing them. As the OutputIterator, it holds back the last record
+ * it was given, which is dropped if the next one has the same identity.
+ */
+class RecordWriter
+{
+    std::string mFilename;
+    std::ofstream mOut;
+    std::vector<char> mBuf;
+    // end of the data in mBuf, and start of the held back record if any
+    size_t mEnd{0};
+    size_t mPending{0};
+    bool mHasPending{false};
+    std::unique_ptr<SHA256> mHasher;
+    BucketIndex::Builder mIndex;
+    size_t mBytesPut{0};
+    size_t mObjectsPut{0};
+    bool mKeepDeadEntries;
+
+    // the held back record is kept
+    void
+    commitPending()
+    {
+        ByteSlice pending(mBuf.data() + mPending + 4, mEnd - mPending - 4);
+        mIndex.add(pending, mBytesPut + mPending);
+        ++mObjectsPut;
+        mHasPending = false;
+    }
+
+    // writes and hashes what precedes the held back record
+    void
+    flush()
+    {
+        size_t n = mHasPending ? mPending : mEnd;
+        if (n == 0)
+        {
+            return;
+        }
+        if (!mOut.write(mBuf.data(), n))
+        {
+            std::string msg("failed to write XDR file: ");
+            throw std::runtime_error(msg + mFilename);
+        }
+        mHasher->add(ByteSlice(mBuf.data(), n));
+        mBytesPut += n;
+        std::memmove(mBuf.data(), mBuf.data() + n, mEnd - n);
+        mEnd -= n;
+        mPending = 0;
+    }
+
+  public:
+    RecordWriter(std::string const& tmpDir, bool keepDeadEntries)
+        : mFilename(randomBucketName(tmpDir))
+        , mBuf(BUCKET_BLOCK_SIZE)
+        , mHasher(SHA256::create())
+        , mKeepDeadEntries(keepDeadEntries)
+    {
+        CLOG(TRACE, "Bucket")
+            << "Bucket::RecordWriter opening file to write: " << mFilename;
+        mOut.open(mFilename, std::ofstream::binary | std::ofstream::trunc);
+        if (!mOut)
+        {
+            std::string msg("failed to open XDR file: ");
+            throw std::runtime_error(msg + mFilename);
+        }
+    }
+
+    void
+    put(RecordReader const& in)
+    {
+        auto record = in.record();
+        auto entry = in.entry();
+        if (!mKeepDeadEntries && isDeadRecord(entry))
+        {
+            return;
+        }
+
+        if (mHasPending)
+        {
+            ByteSlice pending(mBuf.data() + mPending + 4, mEnd - mPending - 4);
+            int c = BucketRecordIdCmp::compare(pending, entry);
+            // entries must come in order
+            assert(c <= 0);
+            if (c < 0)
+            {
+                commitPending();
+            }
+            else
+            {
+                // same identity, replaced
+                mEnd = mPending;
+                mHasPending = false;
+            }
+        }
+
+        if (mBuf.size() - mEnd < record.size())
+        {
+            flush();
+            if (mBuf.size() - mEnd < record.size())
+            {
+                mBuf.resize(mEnd + record.size());
+            }
+        }
+        std::memcpy(mBuf.data() + mEnd, record.data(), record.size());
+        mPending = mEnd;
+        mEnd += record.size();
+        mHasPending = true;
+    }
+
+    std::shared_ptr<Bucket>
+    getBucket(BucketManager& bucketManager)
+    {
+        if (mHasPending)
+        {
+            commitPending();
+        }
+        flush();
+
+        mOut.close();
+        if (mObjectsPut == 0 || mBytesPut == 0)
+        {
+            assert(mObjectsPut == 0);
+            assert(mBytesPut == 0);
+            CLOG(DEBUG, "Bucket") << "Deleting empty bucket file " << mFilename;
+            std::remove(mFilename.c_str());
+            return std::make_shared<Bucket>();
+        }
+        return bucketManager.adoptFileAsBucket(mFilename, mHasher->finish(),
+                                               mObjectsPut, mBytesPut,
+                                               mIndex.finish(mBytesPut));
+    }
+};
+}
+
 /**
  * Helper class that reads from the file underlying a bucket, keeping the bucket
  * alive for the duration of its existence.
@@ -106,14 +364,17 @@ class Bucket::InputIterator
     // Validity and current-value of the iterator is funneled into a pointer. If
     // non-null, it points to mEntry.
     BucketEntry const* mEntryPtr;
-    XDRInputFileStream mIn;
+    RecordReader mIn;
     BucketEntry mEntry;
 
     void
     loadEntry()
     {
-        if (mIn.readOne(mEntry))
+        if (mIn)
         {
+            auto entry = mIn.entry();
+            xdr::xdr_get g(entry.begin(), entry.end());
+            xdr::xdr_argpack_archive(g, mEntry);
             mEntryPtr = &mEntry;
         }
         else
@@ -134,33 +395,24 @@ class Bucket::InputIterator
     }
 
     InputIterator(std::shared_ptr<Bucket const> bucket)
-        : mBucket(bucket), mEntryPtr(nullptr)
+        : mBucket(bucket), mEntryPtr(nullptr), mIn(bucket->mFilename)
     {
         if (!mBucket->mFilename.empty())
         {
             CLOG(TRACE, "Bucket")
                 << "Bucket::InputIterator opening file to read: "
                 << mBucket->mFilename;
-            mIn.open(mBucket->mFilename);
-            loadEntry();
         }
-    }
-
-    ~InputIterator()
-    {
-        mIn.close();
+        loadEntry();
     }
 
     InputIterator& operator++()
     {
         if (mIn)
         {
-            loadEntry();
-        }
-        else
-        {
-            mEntryPtr = nullptr;
+            mIn.advance();
         }
+        loadEntry();
         return *this;
     }
 };
@@ -252,17 +504,108 @@ class Bucket::OutputIterator
 bool
 Bucket::containsBucketIdentity(BucketEntry const& id) const
 {
-    BucketEntryIdCmp cmp;
-    Bucket::InputIterator iter(shared_from_this());
-    while (iter)
+    auto key = id.type() == LIVEENTRY ? LedgerEntryKey(id.liveEntry())
+                                      : id.deadEntry();
+    return getEntry(key) != nullptr;
+}
+
+std::shared_ptr<BucketIndex const>
+Bucket::getIndex() const
+{
+    std::lock_guard<std::mutex> lock(mIndexMutex);
+    if (mIndex)
+    {
+        return mIndex;
+    }
+
+    std::string indexFilename = BucketIndex::getFilename(mFilename);
+    uint64_t fileSize = 0;
+    if (!mFilename.empty())
     {
-        if (!(cmp(*iter, id) || cmp(id, *iter)))
+        std::ifstream in(mFilename, std::ifstream::ate | std::ifstream::binary);
+        fileSize = static_cast<uint64_t>(in.tellg());
+        mIndex = BucketIndex::load(indexFilename, fileSize);
+        if (mIndex)
         {
-            return true;
+            return mIndex;
         }
-        ++iter;
     }
-    return false;
+
+    CLOG(DEBUG, "Bucket") << "Indexing bucket file " << mFilename;
+    BucketIndex::Builder builder;
+    uint64_t offset = 0;
+    for (RecordReader in(mFilename); in; in.advance())
+    {
+        builder.add(in.entry(), offset);
+        offset += in.record().size();
+    }
+    mIndex = builder.finish(offset);
+
+    if (!mFilename.empty())
+    {
+        try
+        {
+            mIndex->save(indexFilename);
+        }
+        catch (std::runtime_error& e)
+        {
+            CLOG(WARNING, "Bucket") << "Could not save bucket index: "
+                                    << e.what();
+        }
+    }
+    return mIndex;
+}
+
+std::shared_ptr<BucketEntry>
+Bucket::getEntry(LedgerKey const& key) const
+{
+    if (mFilename.empty())
+    {
+        return nullptr;
+    }
+
+    auto encoded = xdr::xdr_to_opaque(key);
+    uint64_t begin, end;
+    if (!getIndex()->find(encoded, begin, end))
+    {
+        return nullptr;
+    }
+
+    std::vector<char> page(end - begin);
+    std::ifstream in(mFilename, std::ifstream::binary);
+    if (!in.seekg(begin) || !in.read(page.data(), page.size()))
+    {
+        throw std::runtime_error("failed to read bucket file: " + mFilename);
+    }
+
+    size_t pos = 0;
+    while (page.size() - pos >= 4)
+    {
+        auto p = reinterpret_cast<unsigned char const*>(page.data() + pos);
+        size_t sz = (static_cast<size_t>(p[0] & 0x7f) << 24) |
+                    (static_cast<size_t>(p[1]) << 16) |
+                    (static_cast<size_t>(p[2]) << 8) | static_cast<size_t>(p[3]);
+        if (page.size() - pos - 4 < sz)
+        {
+            break;
+        }
+        ByteSlice entry(p + 4, sz);
+        int c = BucketRecordIdCmp::compareKeys(
+            BucketRecordIdCmp::getKey(entry), encoded);
+        if (c == 0)
+        {
+            auto res = std::make_shared<BucketEntry>();
+            xdr::xdr_get g(entry.begin(), entry.end());
+            xdr::xdr_argpack_archive(g, *res);
+            return res;
+        }
+        if (c > 0)
+        {
+            break;
+        }
+        pos += 4 + sz;
+    }
+    return nullptr;
 }
 
 std::pair<size_t, size_t>
@@ -340,34 +683,31 @@ Bucket::fresh(BucketManager& bucketManager,
     return Bucket::merge(bucketManager, liveBucket, deadBucket);
 }
 
-inline void
-maybe_put(BucketEntryIdCmp const& cmp, Bucket::OutputIterator& out,
-          Bucket::InputIterator& in,
-          std::vector<Bucket::InputIterator>& shadowIterators)
+static void
+maybePut(RecordWriter& out, RecordReader const& in,
+         std::vector<std::unique_ptr<RecordReader>>& shadows)
 {
-    for (auto& si : shadowIterators)
+    for (auto& si : shadows)
     {
-        // Advance the shadowIterator while it's less than the candidate
-        while (si && cmp(*si, *in))
+        // Advance the shadow while it's less than the candidate
+        int c = -1;
+        while (*si && (c = BucketRecordIdCmp::compare(si->entry(),
+                                                      in.entry())) < 0)
         {
-            ++si;
+            si->advance();
         }
         // We have stepped si forward to the point that either si is exhausted,
-        // or else *si >= *in; we now check the opposite direction to see if we
-        // have equality.
-        if (si && !cmp(*in, *si))
-        {
-            // If so, then *in is shadowed in at least one level and we will
-            // not be doing a 'put'; we return early. There is no need to
-            // advance
-            // the other iterators, they will advance as and if necessary in
-            // future
-            // calls to maybe_put.
+        // or else *si >= *in; if they are equal, then *in is shadowed in at
+        // least one level and we will not be doing a 'put'. There is no need
+        // to advance the other shadows, they will advance as and if necessary
+        // in future calls to maybePut.
+        if (*si && c == 0)
+        {
             return;
         }
     }
     // Nothing shadowed.
-    out.put(*in);
+    out.put(in);
 }
 
 std::shared_ptr<Bucket>
@@ -380,52 +720,62 @@ Bucket::merge(BucketManager& bucketManager,
     // This is the key operation in the scheme: merging two (read-only)
     // buckets together into a new 3rd bucket, while calculating its hash,
     // in a single pass.
+    //
+    // Entries are neither decoded nor re-encoded: records are compared on the
+    // XDR of their keys and copied as they are to the output, which therefore
+    // hashes the same as if they were.
 
     assert(oldBucket);
     assert(newBucket);
 
-    Bucket::InputIterator oi(oldBucket);
-    Bucket::InputIterator ni(newBucket);
+    RecordReader oi(oldBucket->getFilename());
+    RecordReader ni(newBucket->getFilename());
 
-    std::vector<Bucket::InputIterator> shadowIterators(shadows.begin(),
-                                                       shadows.end());
+    std::vector<std::unique_ptr<RecordReader>> shadowReaders;
+    for (auto const& s : shadows)
+    {
+        shadowReaders.emplace_back(make_unique<RecordReader>(s->getFilename()));
+    }
 
     auto timer = bucketManager.getMergeTimer().TimeScope();
-    Bucket::OutputIterator out(bucketManager.getTmpDir(), keepDeadEntries);
+    RecordWriter out(bucketManager.getTmpDir(), keepDeadEntries);
 
-    BucketEntryIdCmp cmp;
     while (oi || ni)
     {
+        int c;
         if (!ni)
         {
             // Out of new entries, take old entries.
-            maybe_put(cmp, out, oi, shadowIterators);
-            ++oi;
+            c = -1;
         }
         else if (!oi)
         {
             // Out of old entries, take new entries.
-            maybe_put(cmp, out, ni, shadowIterators);
-            ++ni;
+            c = 1;
         }
-        else if (cmp(*oi, *ni))
+        else
+        {
+            c = BucketRecordIdCmp::compare(oi.entry(), ni.entry());
+        }
+
+        if (c < 0)
         {
             // Next old-entry has smaller key, take it.
-            maybe_put(cmp, out, oi, shadowIterators);
-            ++oi;
+            maybePut(out, oi, shadowReaders);
+            oi.advance();
         }
-        else if (cmp(*ni, *oi))
+        else if (c > 0)
         {
             // Next new-entry has smaller key, take it.
-            maybe_put(cmp, out, ni, shadowIterators);
-            ++ni;
+            maybePut(out, ni, shadowReaders);
+            ni.advance();
         }
         else
         {
             // Old and new are for the same key, take new.
-            maybe_put(cmp, out, ni, shadowIterators);
-            ++oi;
-            ++ni;
+            maybePut(out, ni, shadowReaders);
+            oi.advance();
+            ni.advance();
         }
     }
     return out.getBucket(bucketManager);
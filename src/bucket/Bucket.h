@@ -5,6 +5,8 @@
 // of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
 
 #include "overlay/StellarXDR.h"
+#include <memory>
+#include <mutex>
 #include <string>
 #include "util/NonCopyable.h"
 
@@ -27,6 +29,7 @@ namespace stellar
  * merged in sorted order, and all elements are hashed while being added.
  */
 
+class BucketIndex;
 class BucketManager;
 class BucketList;
 class Database;
@@ -39,13 +42,17 @@ class Bucket : public std::enable_shared_from_this<Bucket>,
     Hash const mHash;
     bool mRetain{false};
 
+    // loaded or built on first use
+    mutable std::mutex mIndexMutex;
+    mutable std::shared_ptr<BucketIndex const> mIndex;
+
   public:
-    // Helper class that reads through the entries in a bucket, used internally
-    // during merging.
+    // Helper class that reads through the entries in a bucket, decoding them.
+    // Merging reads the encoded entries instead.
     class InputIterator;
 
     // Helper class that writes new elements to a file and returns a bucket
-    // when finished, used internally during merging.
+    // when finished, used internally to create fresh buckets.
     class OutputIterator;
 
     // Create an empty bucket. The empty bucket has hash '000000...' and its
@@ -76,6 +83,14 @@ class Bucket : public std::enable_shared_from_this<Bucket>,
     // BucketEntry exists in the bucket. For testing.
     bool containsBucketIdentity(BucketEntry const& id) const;
 
+    // Returns the index of the bucket, loading it from the file next to the
+    // bucket file, or building it -- and storing it there -- if there is none.
+    std::shared_ptr<BucketIndex const> getIndex() const;
+
+    // Returns the entry of the bucket for `key`, which can be a DEADENTRY, or
+    // nullptr if there is none. Reads at most one page of the bucket file.
+    std::shared_ptr<BucketEntry> getEntry(LedgerKey const& key) const;
+
     // Return the count of live and dead BucketEntries in the bucket. For
     // testing.
     std::pair<size_t, size_t> countLiveAndDeadEntries() const;
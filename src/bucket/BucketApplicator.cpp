@@ -51,7 +51,6 @@ BucketApplicator::advance()
         }
     }
     sqlTx.commit();
-    mDb.clearPreparedStatementCache();
 
     if (!mIn || (mSize & 0xfff) == 0xfff)
     {
@@ -0,0 +1,185 @@
+// Copyright 2017 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "bucket/BucketBulkLoader.h"
+#include "database/Database.h"
+#include "ledger/AccountFrame.h"
+#include "ledger/DataFrame.h"
+#include "ledger/LedgerDelta.h"
+#include "ledger/OfferFrame.h"
+#include "ledger/ReversedPaymentFrame.h"
+#include "ledger/TrustFrame.h"
+#include "lib/util/format.h"
+#include "main/Application.h"
+#include "medida/meter.h"
+#include "medida/metrics_registry.h"
+#include "util/Logging.h"
+
+namespace stellar
+{
+
+size_t const BucketBulkLoader::BATCH_SIZE = 0x2000;
+
+namespace
+{
+size_t const LOG_INTERVAL = 0x40000;
+}
+
+BucketBulkLoader::BucketBulkLoader(
+    Application& app, std::vector<std::shared_ptr<Bucket const>> buckets)
+    : mDb(app.getDatabase())
+    , mBuckets(std::move(buckets))
+    , mNextBucket(0)
+    , mStarted(false)
+    , mDone(false)
+    , mRead(0)
+    , mLoaded(0)
+    , mReadMeter(
+          app.getMetrics().NewMeter({"bucket", "bulk-load", "read"}, "entry"))
+    , mLoadMeter(
+          app.getMetrics().NewMeter({"bucket", "bulk-load", "write"}, "entry"))
+{
+}
+
+BucketBulkLoader::operator bool() const
+{
+    return !mDone;
+}
+
+void
+BucketBulkLoader::start()
+{
+    CLOG(INFO, "Bucket") << "Bulk-load: emptying the ledger entry tables";
+
+    mDb.clearPreparedStatementCache();
+    {
+        soci::transaction sqlTx(mDb.getSession());
+        AccountFrame::dropAll(mDb, false);
+        TrustFrame::dropAll(mDb);
+        OfferFrame::dropAll(mDb, false);
+        DataFrame::dropAll(mDb);
+        ReversedPaymentFrame::dropAll(mDb);
+        sqlTx.commit();
+    }
+    mDb.getEntryCache().clear();
+
+    mStarted = true;
+    mStartTime = std::chrono::steady_clock::now();
+}
+
+void
+BucketBulkLoader::finish()
+{
+    CLOG(INFO, "Bucket") << "Bulk-load: loaded " << mLoaded
+                         << " entries out of " << mRead
+                         << ", creating indexes";
+    {
+        soci::transaction sqlTx(mDb.getSession());
+        AccountFrame::createIndexes(mDb);
+        OfferFrame::createIndexes(mDb);
+        sqlTx.commit();
+    }
+    mSeen.clear();
+    mDone = true;
+}
+
+bool
+BucketBulkLoader::openNextBucket()
+{
+    mIn.close();
+    while (mNextBucket < mBuckets.size())
+    {
+        auto const& bucket = mBuckets[mNextBucket++];
+        if (!bucket->getFilename().empty())
+        {
+            mIn.open(bucket->getFilename());
+            return true;
+        }
+    }
+    return false;
+}
+
+void
+BucketBulkLoader::advance()
+{
+    if (mDone)
+    {
+        return;
+    }
+    if (!mStarted)
+    {
+        start();
+    }
+
+    bool exhausted = false;
+    size_t const readBefore = mRead;
+    size_t n = 0;
+    {
+        soci::transaction sqlTx(mDb.getSession());
+        LedgerHeader lh;
+        LedgerDelta delta(lh, mDb, false);
+        delta.setWriteBack(true);
+
+        BucketEntry entry;
+        while (mRead - readBefore < BATCH_SIZE)
+        {
+            if (!mIn || !mIn.readOne(entry))
+            {
+                if (!openNextBucket())
+                {
+                    exhausted = true;
+                    break;
+                }
+                continue;
+            }
+            ++mRead;
+
+            bool live = entry.type() == LIVEENTRY;
+            if (!mSeen.insert(live ? LedgerEntryKey(entry.liveEntry())
+                                   : entry.deadEntry())
+                     .second ||
+                !live)
+            {
+                // shadowed by a newer version, or deleted
+                continue;
+            }
+            EntryFrame::FromXDR(entry.liveEntry())->storeAdd(delta, mDb);
+            ++n;
+        }
+
+        delta.flushPending();
+        delta.commit();
+        sqlTx.commit();
+    }
+
+    mReadMeter.Mark(mRead - readBefore);
+    mLoadMeter.Mark(n);
+    mLoaded += n;
+    if (exhausted || (mRead / LOG_INTERVAL) != (readBefore / LOG_INTERVAL))
+    {
+        CLOG(INFO, "Bucket") << "Bulk-load: " << getStatus();
+    }
+
+    if (exhausted)
+    {
+        finish();
+    }
+}
+
+std::string
+BucketBulkLoader::getStatus() const
+{
+    double seconds = 0;
+    if (mStarted)
+    {
+        seconds = std::chrono::duration<double>(
+                      std::chrono::steady_clock::now() - mStartTime)
+                      .count();
+    }
+    auto rate = seconds > 0 ? static_cast<size_t>(mLoaded / seconds) : 0;
+    return fmt::format("bucket {:d}/{:d}, {:d} entries read, {:d} loaded "
+                       "({:d} entries/s)",
+                       mNextBucket, mBuckets.size(), mRead, mLoaded, rate);
+}
+}
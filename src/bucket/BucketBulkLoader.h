@@ -0,0 +1,96 @@
+#pragma once
+
+// Copyright 2017 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "bucket/Bucket.h"
+#include "database/EntryCache.h"
+#include "util/NonCopyable.h"
+#include "util/XDRStream.h"
+#include <chrono>
+#include <memory>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+namespace medida
+{
+class Meter;
+}
+
+namespace stellar
+{
+
+class Application;
+class Database;
+
+/**
+ * Rebuilds the ledger entry tables from a whole bucket list. Catchup uses it
+ * instead of BucketApplicator when CATCHUP_BULK_LOAD is set.
+ *
+ * BucketApplicator applies the buckets oldest first, looking each entry up
+ * before inserting or updating it, so an entry is written once per bucket
+ * holding it. The loader empties the tables and reads the buckets newest
+ * first instead: the first version of a key it comes across, live or dead,
+ * is the current one and later ones are skipped. Every entry it writes is
+ * then a new row, inserted without any lookup: accounts and trust lines with
+ * multi-row statements (see LedgerDelta::setWriteBack), the other entries
+ * with one prepared statement each. Each call to advance() reads up to
+ * BATCH_SIZE entries and loads them in a single SQL transaction. The
+ * secondary indexes are dropped with the tables and only created once
+ * everything is loaded.
+ *
+ * The keys seen are kept in memory until the end, so the loader needs room
+ * for all the keys of the ledger.
+ */
+class BucketBulkLoader : NonMovableOrCopyable
+{
+  public:
+    static size_t const BATCH_SIZE;
+
+    // `buckets` newest first: level 0 curr, level 0 snap, level 1 curr...
+    BucketBulkLoader(Application& app,
+                     std::vector<std::shared_ptr<Bucket const>> buckets);
+
+    // false once everything is loaded
+    operator bool() const;
+    void advance();
+
+    size_t
+    getReadCount() const
+    {
+        return mRead;
+    }
+
+    size_t
+    getLoadedCount() const
+    {
+        return mLoaded;
+    }
+
+    // progress and throughput, for the status of the catchup
+    std::string getStatus() const;
+
+  private:
+    Database& mDb;
+    std::vector<std::shared_ptr<Bucket const>> mBuckets;
+    size_t mNextBucket;
+    XDRInputFileStream mIn;
+    bool mStarted;
+    bool mDone;
+
+    std::unordered_set<LedgerKey, LedgerKeyHash, LedgerKeyEqual> mSeen;
+    size_t mRead;
+    size_t mLoaded;
+    std::chrono::steady_clock::time_point mStartTime;
+
+    medida::Meter& mReadMeter;
+    medida::Meter& mLoadMeter;
+
+    void start();
+    void finish();
+    // false when there is no bucket left
+    bool openNextBucket();
+};
+}
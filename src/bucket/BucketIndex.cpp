@@ -0,0 +1,212 @@
+// Copyright 2017 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "bucket/BucketIndex.h"
+#include "bucket/LedgerCmp.h"
+#include "crypto/Hex.h"
+#include "crypto/Random.h"
+#include "util/Fs.h"
+#include "util/Logging.h"
+
+#include <cereal/archives/portable_binary.hpp>
+#include <cereal/types/string.hpp>
+#include <cereal/types/vector.hpp>
+
+#include <algorithm>
+#include <fstream>
+
+namespace stellar
+{
+
+size_t const BucketIndex::PAGE_SIZE;
+
+// bumped when the format of index files changes
+static uint32_t const INDEX_VERSION = 1;
+
+// the bloom filters have about 1% of false positives
+static size_t const BLOOM_BITS_PER_KEY = 10;
+static size_t const BLOOM_HASHES = 7;
+
+// FNV-1a, which is enough for keys that mostly hold public keys
+static uint64_t
+hashKey(ByteSlice const& key)
+{
+    uint64_t h = 14695981039346656037ULL;
+    for (auto b : key)
+    {
+        h ^= b;
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+// the bits of `hash` in a filter of `nBits` bits
+template <typename F>
+static void
+forEachBit(uint64_t hash, uint64_t nBits, F f)
+{
+    uint32_t h1 = static_cast<uint32_t>(hash);
+    uint32_t h2 = static_cast<uint32_t>(hash >> 32);
+    for (uint32_t i = 0; i < BLOOM_HASHES; ++i)
+    {
+        f((h1 + static_cast<uint64_t>(i) * h2) % nBits);
+    }
+}
+
+BucketIndex::Builder::Builder() : mIndex(std::make_shared<BucketIndex>())
+{
+    mIndex->mBloomOffsets.push_back(0);
+}
+
+void
+BucketIndex::Builder::finishPage()
+{
+    if (mPageHashes.empty())
+    {
+        return;
+    }
+    auto& bloom = mIndex->mBloom;
+    size_t nWords = (mPageHashes.size() * BLOOM_BITS_PER_KEY + 63) / 64;
+    size_t first = bloom.size();
+    bloom.resize(first + nWords, 0);
+    for (auto h : mPageHashes)
+    {
+        forEachBit(h, nWords * 64, [&](uint64_t bit)
+                   {
+                       bloom[first + bit / 64] |= uint64_t(1) << (bit % 64);
+                   });
+    }
+    mIndex->mBloomOffsets.push_back(bloom.size());
+    mPageHashes.clear();
+}
+
+void
+BucketIndex::Builder::add(ByteSlice const& entry, uint64_t offset)
+{
+    auto key = BucketRecordIdCmp::getKey(entry);
+    auto& offsets = mIndex->mPageOffsets;
+    if (offsets.empty() || offset - offsets.back() >= PAGE_SIZE)
+    {
+        finishPage();
+        offsets.push_back(offset);
+        mIndex->mPageKeys.emplace_back(
+            reinterpret_cast<char const*>(key.data()), key.size());
+    }
+    mPageHashes.push_back(hashKey(key));
+}
+
+std::shared_ptr<BucketIndex>
+BucketIndex::Builder::finish(uint64_t fileSize)
+{
+    finishPage();
+    mIndex->mFileSize = fileSize;
+    auto index = mIndex;
+    mIndex.reset();
+    return index;
+}
+
+std::string
+BucketIndex::getFilename(std::string const& bucketFilename)
+{
+    return bucketFilename + ".index";
+}
+
+std::shared_ptr<BucketIndex>
+BucketIndex::load(std::string const& filename, uint64_t fileSize)
+{
+    if (!fs::exists(filename))
+    {
+        return nullptr;
+    }
+    try
+    {
+        std::ifstream in(filename, std::ifstream::binary);
+        cereal::PortableBinaryInputArchive ar(in);
+        uint32_t version;
+        ar(version);
+        if (version != INDEX_VERSION)
+        {
+            return nullptr;
+        }
+        auto index = std::make_shared<BucketIndex>();
+        ar(*index);
+        if (index->mFileSize != fileSize ||
+            index->mPageKeys.size() != index->mPageOffsets.size() ||
+            index->mBloomOffsets.size() != index->mPageOffsets.size() + 1 ||
+            index->mBloomOffsets.back() != index->mBloom.size())
+        {
+            return nullptr;
+        }
+        return index;
+    }
+    catch (std::exception& e)
+    {
+        CLOG(WARNING, "Bucket") << "Ignoring bucket index " << filename
+                                << ": " << e.what();
+        return nullptr;
+    }
+}
+
+void
+BucketIndex::save(std::string const& filename) const
+{
+    // written aside and renamed, so that a partial index is never loaded
+    std::string tmp = filename + "." + binToHex(randomBytes(4)) + ".tmp";
+    {
+        std::ofstream out(tmp, std::ofstream::binary | std::ofstream::trunc);
+        if (!out)
+        {
+            throw std::runtime_error("failed to open bucket index: " + tmp);
+        }
+        cereal::PortableBinaryOutputArchive ar(out);
+        ar(INDEX_VERSION);
+        ar(*this);
+        if (!out)
+        {
+            throw std::runtime_error("failed to write bucket index: " + tmp);
+        }
+    }
+    if (rename(tmp.c_str(), filename.c_str()) != 0)
+    {
+        std::remove(tmp.c_str());
+        throw std::runtime_error("failed to rename bucket index: " + tmp);
+    }
+}
+
+bool
+BucketIndex::find(ByteSlice const& key, uint64_t& begin, uint64_t& end) const
+{
+    // first page whose first key is greater than `key`
+    auto it = std::upper_bound(mPageKeys.begin(), mPageKeys.end(), key,
+                               [](ByteSlice const& k, std::string const& page)
+                               {
+                                   return BucketRecordIdCmp::compareKeys(
+                                              k, page) < 0;
+                               });
+    if (it == mPageKeys.begin())
+    {
+        return false;
+    }
+    size_t page = (it - mPageKeys.begin()) - 1;
+
+    size_t first = mBloomOffsets[page];
+    uint64_t nBits = (mBloomOffsets[page + 1] - first) * 64;
+    bool present = true;
+    forEachBit(hashKey(key), nBits, [&](uint64_t bit)
+               {
+                   if (!(mBloom[first + bit / 64] & (uint64_t(1) << (bit % 64))))
+                   {
+                       present = false;
+                   }
+               });
+    if (!present)
+    {
+        return false;
+    }
+
+    begin = mPageOffsets[page];
+    end = page + 1 < mPageOffsets.size() ? mPageOffsets[page + 1] : mFileSize;
+    return true;
+}
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+// Copyright 2017 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "crypto/ByteSlice.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace stellar
+{
+
+/**
+ * Index of the keys of a bucket file, to find an entry without reading the
+ * whole file.
+ *
+ * The file is cut into pages of about PAGE_SIZE bytes, on record boundaries.
+ * The index holds the offset and the first key of each page, so that the only
+ * page that can hold a key is found by a binary search, and a small bloom
+ * filter of the keys of each page, so that the page is not read when it surely
+ * does not hold the key.
+ *
+ * The index of a bucket is built while the bucket is merged, and stored next
+ * to the bucket file, in getFilename(bucketFilename).
+ */
+class BucketIndex
+{
+  public:
+    static size_t const PAGE_SIZE = 16 * 1024;
+
+    // Builds the index of a bucket file while the file is written.
+    class Builder
+    {
+        std::shared_ptr<BucketIndex> mIndex;
+        // hashes of the keys of the last page
+        std::vector<uint64_t> mPageHashes;
+
+        void finishPage();
+
+      public:
+        Builder();
+
+        // `entry` is the XDR of the BucketEntry of the record at `offset` in
+        // the file; records are added in order
+        void add(ByteSlice const& entry, uint64_t offset);
+
+        std::shared_ptr<BucketIndex> finish(uint64_t fileSize);
+    };
+
+    static std::string getFilename(std::string const& bucketFilename);
+
+    // nullptr if there is no index in `filename` for a bucket file of
+    // `fileSize` bytes
+    static std::shared_ptr<BucketIndex> load(std::string const& filename,
+                                             uint64_t fileSize);
+    void save(std::string const& filename) const;
+
+    // Finds the range of the bucket file, [begin, end), that holds the entry
+    // with the encoded LedgerKey `key` if there is one. Returns false if there
+    // is surely none.
+    bool find(ByteSlice const& key, uint64_t& begin, uint64_t& end) const;
+
+    size_t
+    getPageCount() const
+    {
+        return mPageOffsets.size();
+    }
+
+    template <class Archive>
+    void
+    serialize(Archive& ar)
+    {
+        ar(mFileSize, mPageOffsets, mPageKeys, mBloomOffsets, mBloom);
+    }
+
+  private:
+    uint64_t mFileSize{0};
+    std::vector<uint64_t> mPageOffsets;
+    std::vector<std::string> mPageKeys;
+    // the filter of page i is in the words [mBloomOffsets[i],
+    // mBloomOffsets[i + 1]) of mBloom
+    std::vector<uint64_t> mBloomOffsets;
+    std::vector<uint64_t> mBloom;
+};
+}
@@ -136,7 +136,8 @@ BucketLevel::prepare(Application& app, uint32_t currLedger,
     }
 
     bool keepDeadEntries = mLevel < BucketList::kNumLevels - 1;
-    mNextCurr = FutureBucket(app, curr, snap, shadows, keepDeadEntries);
+    mNextCurr =
+        FutureBucket(app, curr, snap, shadows, keepDeadEntries, mLevel);
     assert(mNextCurr.isMerging());
 }
 
@@ -306,7 +307,7 @@ BucketList::restartMerges(Application& app, uint32_t currLedger)
         auto& next = level.getNext();
         if (next.hasHashes() && !next.isLive())
         {
-            next.makeLive(app);
+            next.makeLive(app, i);
             if (next.isMerging())
             {
                 CLOG(INFO, "Bucket") << "Restarted merge on BucketList level "
@@ -15,7 +15,9 @@ namespace stellar
 {
 
 class Application;
+class BucketIndex;
 class BucketList;
+class BucketMergeExecutor;
 struct LedgerHeader;
 struct HistoryArchiveState;
 
@@ -56,20 +58,26 @@ class BucketManager : NonMovableOrCopyable
 
     virtual medida::Timer& getMergeTimer() = 0;
 
+    // The threads on which the merges of the BucketList run.
+    virtual BucketMergeExecutor& getMergeExecutor() = 0;
+
     // Get a reference to a persistent bucket (in the BucketManager's bucket
     // directory), from the BucketManager's shared bucket-set.
     //
     // Concretely: if `hash` names an existing bucket -- either in-memory or on
     // disk -- delete `filename` and return an object for the existing bucket;
     // otherwise move `filename` to the bucket directory, stored under `hash`,
-    // and return a new bucket pointing to that.
+    // and return a new bucket pointing to that. The `index` of the file, if
+    // any, is stored next to it.
     //
     // This method is mostly-threadsafe -- assuming you don't destruct the
     // BucketManager mid-call -- and is intended to be called from both main and
     // worker threads. Very carefully.
     virtual std::shared_ptr<Bucket>
     adoptFileAsBucket(std::string const& filename, uint256 const& hash,
-                      size_t nObjects = 0, size_t nBytes = 0) = 0;
+                      size_t nObjects = 0, size_t nBytes = 0,
+                      std::shared_ptr<BucketIndex const> const& index =
+                          nullptr) = 0;
 
     // Return a bucket by hash if we have it, else return nullptr.
     virtual std::shared_ptr<Bucket> getBucketByHash(uint256 const& hash) = 0;
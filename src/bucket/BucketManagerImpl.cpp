@@ -6,7 +6,9 @@
 #include "overlay/StellarXDR.h"
 #include "main/Application.h"
 #include "main/Config.h"
+#include "bucket/BucketIndex.h"
 #include "bucket/BucketList.h"
+#include "bucket/BucketMergeExecutor.h"
 #include "history/HistoryManager.h"
 #include "util/Fs.h"
 #include "util/make_unique.h"
@@ -64,7 +66,8 @@ BucketManagerImpl::BucketManagerImpl(Application& app)
     , mBucketSnapMerge(app.getMetrics().NewTimer({"bucket", "snap", "merge"}))
     , mSharedBucketsSize(
           app.getMetrics().NewCounter({"bucket", "memory", "shared"}))
-
+    , mMergeExecutor(make_unique<BucketMergeExecutor>(
+          app.getMetrics(), app.getConfig().BUCKET_MERGE_THREADS))
 {
 }
 
@@ -144,10 +147,16 @@ BucketManagerImpl::getMergeTimer()
     return mBucketSnapMerge;
 }
 
+BucketMergeExecutor&
+BucketManagerImpl::getMergeExecutor()
+{
+    return *mMergeExecutor;
+}
+
 std::shared_ptr<Bucket>
-BucketManagerImpl::adoptFileAsBucket(std::string const& filename,
-                                     uint256 const& hash, size_t nObjects,
-                                     size_t nBytes)
+BucketManagerImpl::adoptFileAsBucket(
+    std::string const& filename, uint256 const& hash, size_t nObjects,
+    size_t nBytes, std::shared_ptr<BucketIndex const> const& index)
 {
     std::lock_guard<std::recursive_mutex> lock(mBucketMutex);
     // Check to see if we have an existing bucket (either in-memory or on-disk)
@@ -157,6 +166,14 @@ BucketManagerImpl::adoptFileAsBucket(std::string const& filename,
         CLOG(DEBUG, "Bucket") << "Deleting bucket file " << filename
                               << " that is redundant with existing bucket";
         std::remove(filename.c_str());
+        if (index && !b->getFilename().empty())
+        {
+            auto indexFilename = BucketIndex::getFilename(b->getFilename());
+            if (!fs::exists(indexFilename))
+            {
+                index->save(indexFilename);
+            }
+        }
     }
     else
     {
@@ -171,6 +188,10 @@ BucketManagerImpl::adoptFileAsBucket(std::string const& filename,
             err += strerror(errno);
             throw std::runtime_error(err);
         }
+        if (index)
+        {
+            index->save(BucketIndex::getFilename(canonicalName));
+        }
 
         b = std::make_shared<Bucket>(canonicalName, hash);
         {
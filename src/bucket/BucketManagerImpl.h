@@ -27,6 +27,7 @@ class TmpDir;
 class Application;
 class Bucket;
 class BucketList;
+class BucketMergeExecutor;
 struct HistoryArchiveState;
 
 class BucketManagerImpl : public BucketManager
@@ -44,6 +45,8 @@ class BucketManagerImpl : public BucketManager
     medida::Timer& mBucketAddBatch;
     medida::Timer& mBucketSnapMerge;
     medida::Counter& mSharedBucketsSize;
+    // last, so that no merge is running once the rest is destroyed
+    std::unique_ptr<BucketMergeExecutor> mMergeExecutor;
 
   protected:
     void calculateSkipValues(LedgerHeader& currentHeader);
@@ -57,10 +60,11 @@ class BucketManagerImpl : public BucketManager
     std::string const& getBucketDir() override;
     BucketList& getBucketList() override;
     medida::Timer& getMergeTimer() override;
-    std::shared_ptr<Bucket> adoptFileAsBucket(std::string const& filename,
-                                              uint256 const& hash,
-                                              size_t nObjects,
-                                              size_t nBytes) override;
+    BucketMergeExecutor& getMergeExecutor() override;
+    std::shared_ptr<Bucket>
+    adoptFileAsBucket(std::string const& filename, uint256 const& hash,
+                      size_t nObjects, size_t nBytes,
+                      std::shared_ptr<BucketIndex const> const& index) override;
     std::shared_ptr<Bucket> getBucketByHash(uint256 const& hash) override;
 
     void forgetUnreferencedBuckets() override;
@@ -0,0 +1,158 @@
+// Copyright 2017 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "bucket/BucketMergeExecutor.h"
+#include "bucket/BucketList.h"
+#include "lib/util/format.h"
+#include "util/Logging.h"
+#include "medida/counter.h"
+#include "medida/metrics_registry.h"
+#include "medida/timer.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace stellar
+{
+
+size_t const BucketMergeExecutor::FIRST_DEEP_LEVEL;
+
+BucketMergeExecutor::BucketMergeExecutor(medida::MetricsRegistry& metrics,
+                                         size_t nThreads)
+    : mNextSeq(0)
+    , mRunning(0)
+    , mRunningDeep(0)
+    , mMaxRunningDeep(std::max<size_t>(1, nThreads - 1))
+    , mStopping(false)
+{
+    assert(nThreads > 0);
+    for (size_t i = 0; i < BucketList::kNumLevels; ++i)
+    {
+        auto level = fmt::format("level-{:d}", i);
+        mMetrics.push_back(LevelMetrics{
+            metrics.NewCounter({"bucket", level, "merge-queued"}),
+            metrics.NewTimer({"bucket", level, "merge-wait"}),
+            metrics.NewTimer({"bucket", level, "merge"})});
+    }
+    for (size_t i = 0; i < nThreads; ++i)
+    {
+        mThreads.emplace_back([this]()
+                              {
+                                  runThread();
+                              });
+    }
+}
+
+BucketMergeExecutor::~BucketMergeExecutor()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStopping = true;
+        if (!mQueue.empty())
+        {
+            CLOG(DEBUG, "Bucket") << "Dropping " << mQueue.size()
+                                  << " queued merges";
+        }
+    }
+    mCond.notify_all();
+    for (auto& t : mThreads)
+    {
+        t.join();
+    }
+    for (auto const& q : mQueue)
+    {
+        getMetrics(q.first.first).mQueued.dec();
+    }
+}
+
+BucketMergeExecutor::LevelMetrics&
+BucketMergeExecutor::getMetrics(size_t level)
+{
+    return mMetrics[std::min(level, mMetrics.size() - 1)];
+}
+
+void
+BucketMergeExecutor::post(size_t level, Job job)
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mQueue.emplace(std::make_pair(level, mNextSeq++),
+                       QueuedJob{std::move(job),
+                                 std::chrono::steady_clock::now()});
+        getMetrics(level).mQueued.inc();
+    }
+    mCond.notify_all();
+}
+
+void
+BucketMergeExecutor::waitForIdle()
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+    mCond.wait(lock, [this]()
+               {
+                   return mQueue.empty() && mRunning == 0;
+               });
+}
+
+BucketMergeExecutor::Queue::iterator
+BucketMergeExecutor::nextJob()
+{
+    auto i = mQueue.begin();
+    if (i != mQueue.end() && i->first.first >= FIRST_DEEP_LEVEL &&
+        mRunningDeep >= mMaxRunningDeep)
+    {
+        // everything queued is deep
+        return mQueue.end();
+    }
+    return i;
+}
+
+void
+BucketMergeExecutor::runThread()
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+    for (;;)
+    {
+        auto i = mQueue.end();
+        mCond.wait(lock, [this, &i]()
+                   {
+                       return mStopping || (i = nextJob()) != mQueue.end();
+                   });
+        if (mStopping)
+        {
+            return;
+        }
+
+        size_t level = i->first.first;
+        bool deep = level >= FIRST_DEEP_LEVEL;
+        auto job = std::move(i->second);
+        mQueue.erase(i);
+        ++mRunning;
+        if (deep)
+        {
+            ++mRunningDeep;
+        }
+        lock.unlock();
+
+        auto& metrics = getMetrics(level);
+        metrics.mQueued.dec();
+        metrics.mWait.Update(std::chrono::steady_clock::now() -
+                             job.mQueuedAt);
+        {
+            auto timer = metrics.mMerge.TimeScope();
+            job.mJob();
+        }
+        // releases the buckets held by the job before it is reported done
+        job.mJob = nullptr;
+
+        lock.lock();
+        --mRunning;
+        if (deep)
+        {
+            --mRunningDeep;
+        }
+        mCond.notify_all();
+    }
+}
+}
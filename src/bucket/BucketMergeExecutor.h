@@ -0,0 +1,95 @@
+#pragma once
+
+// Copyright 2017 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "util/NonCopyable.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace medida
+{
+class MetricsRegistry;
+class Counter;
+class Timer;
+}
+
+namespace stellar
+{
+
+/**
+ * Runs the merges of the BucketList on threads of its own, rather than on the
+ * worker threads shared with the rest of the application.
+ *
+ * Queued merges are started lowest level first, as the lower levels are the
+ * ones whose merges are resolved the soonest -- level 0 on the next ledger --
+ * and in order within a level. Merges of the levels from FIRST_DEEP_LEVEL on,
+ * which can take minutes, never occupy all the threads: one is always left for
+ * the levels above, so that closing a ledger does not wait for a deep merge.
+ * This takes at least two threads, which is what BUCKET_MERGE_THREADS allows;
+ * with a single one, a deep merge still runs only when no lower one is queued,
+ * but then holds up the merges queued after it.
+ *
+ * As each merge only holds a few blocks of each of its buckets in memory, the
+ * number of threads also bounds the memory used by merging, even when every
+ * level restarts its merge at once after a restart or a catchup.
+ */
+class BucketMergeExecutor : NonMovableOrCopyable
+{
+  public:
+    typedef std::function<void()> Job;
+
+    static size_t const FIRST_DEEP_LEVEL = 4;
+
+    BucketMergeExecutor(medida::MetricsRegistry& metrics, size_t nThreads);
+    // merges still queued are dropped, running ones are waited for
+    ~BucketMergeExecutor();
+
+    // queues `job`, a merge into `level` of the BucketList; thread-safe
+    void post(size_t level, Job job);
+
+    // waits until no merge is queued or running. For testing.
+    void waitForIdle();
+
+  private:
+    struct QueuedJob
+    {
+        Job mJob;
+        std::chrono::steady_clock::time_point mQueuedAt;
+    };
+
+    // ordered by level, then by order of arrival
+    typedef std::map<std::pair<size_t, uint64_t>, QueuedJob> Queue;
+
+    struct LevelMetrics
+    {
+        medida::Counter& mQueued;
+        medida::Timer& mWait;
+        medida::Timer& mMerge;
+    };
+
+    std::mutex mMutex;
+    std::condition_variable mCond;
+    Queue mQueue;
+    uint64_t mNextSeq;
+    size_t mRunning;
+    size_t mRunningDeep;
+    size_t const mMaxRunningDeep;
+    bool mStopping;
+    std::vector<LevelMetrics> mMetrics;
+    std::vector<std::thread> mThreads;
+
+    LevelMetrics& getMetrics(size_t level);
+    Queue::iterator nextJob();
+    void runThread();
+};
+}
@@ -8,16 +8,20 @@
 #include "util/asio.h"
 
 #include "bucket/Bucket.h"
+#include "bucket/BucketIndex.h"
 #include "bucket/BucketList.h"
 #include "bucket/BucketManager.h"
 #include "bucket/LedgerCmp.h"
 #include "bucket/BucketManagerImpl.h"
+#include "bucket/BucketMergeExecutor.h"
 #include "database/Database.h"
 #include "crypto/Hex.h"
+#include "crypto/SHA.h"
 #include "ledger/LedgerManager.h"
 #include "herder/LedgerCloseData.h"
 #include "lib/catch.hpp"
 #include "main/Application.h"
+#include "main/Config.h"
 #include "main/test.h"
 #include "ledger/LedgerTestUtils.h"
 #include "util/Fs.h"
@@ -26,11 +30,15 @@
 #include "util/TmpDir.h"
 #include "util/types.h"
 #include "xdrpp/autocheck.h"
+#include "xdrpp/marshal.h"
 #include "medida/metrics_registry.h"
 #include "medida/timer.h"
 #include "medida/meter.h"
 #include <algorithm>
+#include <atomic>
+#include <fstream>
 #include <future>
+#include <map>
 
 using namespace stellar;
 
@@ -535,6 +543,344 @@ TEST_CASE("merging bucket entries", "[bucket]")
     }
 }
 
+// gives `e` the owner of `other`, an entry of the same type
+static void
+setSameOwner(LedgerEntry& e, LedgerEntry const& other)
+{
+    switch (e.data.type())
+    {
+    case ACCOUNT:
+        e.data.account().accountID = other.data.account().accountID;
+        break;
+    case TRUSTLINE:
+        e.data.trustLine().accountID = other.data.trustLine().accountID;
+        break;
+    case OFFER:
+        e.data.offer().sellerID = other.data.offer().sellerID;
+        break;
+    case DATA:
+        e.data.data().accountID = other.data.data().accountID;
+        break;
+    default:
+        break;
+    }
+}
+
+static BucketEntry
+liveBucketEntry(LedgerEntry const& e)
+{
+    BucketEntry be;
+    be.type(LIVEENTRY);
+    be.liveEntry() = e;
+    return be;
+}
+
+static BucketEntry
+deadBucketEntry(LedgerKey const& k)
+{
+    BucketEntry be;
+    be.type(DEADENTRY);
+    be.deadEntry() = k;
+    return be;
+}
+
+// hash of a bucket file holding `entries`, as written by XDROutputFileStream
+static Hash
+hashBucketEntries(std::vector<BucketEntry> const& entries)
+{
+    auto hasher = SHA256::create();
+    for (auto const& e : entries)
+    {
+        auto body = xdr::xdr_to_opaque(e);
+        uint32_t sz = static_cast<uint32_t>(body.size());
+        unsigned char mark[4] = {
+            static_cast<unsigned char>(((sz >> 24) & 0xFF) | 0x80),
+            static_cast<unsigned char>((sz >> 16) & 0xFF),
+            static_cast<unsigned char>((sz >> 8) & 0xFF),
+            static_cast<unsigned char>(sz & 0xFF)};
+        hasher->add(ByteSlice(mark, 4));
+        hasher->add(body);
+    }
+    return hasher->finish();
+}
+
+TEST_CASE("bucket record comparator", "[bucket]")
+{
+    std::vector<BucketEntry> entries;
+    LedgerEntry prev = LedgerTestUtils::generateValidLedgerEntry(10);
+    for (size_t i = 0; i < 100; ++i)
+    {
+        auto e = LedgerTestUtils::generateValidLedgerEntry(10);
+        entries.push_back(liveBucketEntry(e));
+        entries.push_back(deadBucketEntry(LedgerEntryKey(e)));
+
+        // entries of the same type differing only after their owner
+        if (e.data.type() == prev.data.type())
+        {
+            setSameOwner(e, prev);
+        }
+        entries.push_back(liveBucketEntry(e));
+        prev = e;
+    }
+
+    std::vector<xdr::opaque_vec<>> encoded;
+    for (auto const& e : entries)
+    {
+        encoded.push_back(xdr::xdr_to_opaque(e));
+    }
+
+    BucketEntryIdCmp cmp;
+    for (size_t i = 0; i < entries.size(); ++i)
+    {
+        for (size_t j = 0; j < entries.size(); ++j)
+        {
+            int c = BucketRecordIdCmp::compare(encoded[i], encoded[j]);
+            REQUIRE((c < 0) == cmp(entries[i], entries[j]));
+            REQUIRE((c > 0) == cmp(entries[j], entries[i]));
+        }
+    }
+
+    auto truncated = encoded[0];
+    truncated.resize(10);
+    REQUIRE_THROWS_AS(BucketRecordIdCmp::compare(truncated, encoded[1]),
+                      std::runtime_error);
+}
+
+TEST_CASE("merged bucket hash", "[bucket]")
+{
+    VirtualClock clock;
+    Config const& cfg = getTestConfig();
+    Application::pointer app = Application::create(clock, cfg);
+    auto& bm = app->getBucketManager();
+
+    autocheck::generator<bool> flip;
+    std::map<LedgerKey, BucketEntry, LedgerEntryIdCmp> expected;
+
+    std::vector<LedgerEntry> oldLive(200);
+    for (auto& e : oldLive)
+    {
+        e = LedgerTestUtils::generateValidLedgerEntry(10);
+        expected[LedgerEntryKey(e)] = liveBucketEntry(e);
+    }
+
+    std::vector<LedgerEntry> newLive;
+    std::vector<LedgerKey> newDead;
+    for (auto e : oldLive)
+    {
+        if (flip())
+        {
+            e.lastModifiedLedgerSeq++;
+            newLive.push_back(e);
+            expected[LedgerEntryKey(e)] = liveBucketEntry(e);
+        }
+        else if (flip())
+        {
+            newDead.push_back(LedgerEntryKey(e));
+            expected[newDead.back()] = deadBucketEntry(newDead.back());
+        }
+    }
+    for (size_t i = 0; i < 100; ++i)
+    {
+        newLive.push_back(LedgerTestUtils::generateValidLedgerEntry(10));
+        expected[LedgerEntryKey(newLive.back())] =
+            liveBucketEntry(newLive.back());
+    }
+
+    auto b1 = Bucket::fresh(bm, oldLive, {});
+    auto b2 = Bucket::fresh(bm, newLive, newDead);
+
+    SECTION("without shadows")
+    {
+        std::vector<BucketEntry> entries;
+        for (auto const& kv : expected)
+        {
+            entries.push_back(kv.second);
+        }
+        auto b3 = Bucket::merge(bm, b1, b2);
+        CHECK(countEntries(b3) == entries.size());
+        CHECK(b3->getHash() == hashBucketEntries(entries));
+    }
+
+    SECTION("with shadows, without dead entries")
+    {
+        std::vector<LedgerEntry> shadowed;
+        for (auto const& kv : expected)
+        {
+            if (kv.second.type() == LIVEENTRY && flip())
+            {
+                shadowed.push_back(kv.second.liveEntry());
+            }
+        }
+        auto shadow = Bucket::fresh(bm, shadowed, {});
+
+        std::vector<BucketEntry> entries;
+        for (auto const& kv : expected)
+        {
+            if (kv.second.type() == LIVEENTRY &&
+                !shadow->containsBucketIdentity(kv.second))
+            {
+                entries.push_back(kv.second);
+            }
+        }
+        auto b3 = Bucket::merge(bm, b1, b2, {shadow}, false);
+        CHECK(countEntries(b3) == entries.size());
+        CHECK(b3->getHash() == hashBucketEntries(entries));
+    }
+}
+
+TEST_CASE("bucket index", "[bucket]")
+{
+    VirtualClock clock;
+    Config const& cfg = getTestConfig();
+    Application::pointer app = Application::create(clock, cfg);
+    auto& bm = app->getBucketManager();
+
+    std::vector<LedgerEntry> live(1000);
+    std::vector<LedgerKey> dead(100);
+    std::vector<LedgerKey> absent(100);
+    for (auto& e : live)
+    {
+        e = LedgerTestUtils::generateValidLedgerEntry(10);
+    }
+    for (auto& k : dead)
+    {
+        k = LedgerEntryKey(LedgerTestUtils::generateValidLedgerEntry(10));
+    }
+    for (auto& k : absent)
+    {
+        k = LedgerEntryKey(LedgerTestUtils::generateValidLedgerEntry(10));
+    }
+    auto b = Bucket::fresh(bm, live, dead);
+    auto indexFilename = BucketIndex::getFilename(b->getFilename());
+
+    auto checkLookups = [&]()
+    {
+        for (auto const& e : live)
+        {
+            auto found = b->getEntry(LedgerEntryKey(e));
+            REQUIRE(found);
+            REQUIRE(found->type() == LIVEENTRY);
+            REQUIRE(found->liveEntry() == e);
+        }
+        for (auto const& k : dead)
+        {
+            auto found = b->getEntry(k);
+            REQUIRE(found);
+            REQUIRE(found->type() == DEADENTRY);
+            REQUIRE(found->deadEntry() == k);
+        }
+        for (auto const& k : absent)
+        {
+            REQUIRE(!b->getEntry(k));
+        }
+    };
+
+    SECTION("index built while merging")
+    {
+        REQUIRE(fs::exists(indexFilename));
+        checkLookups();
+        REQUIRE(b->getIndex()->getPageCount() > 1);
+    }
+
+    SECTION("index rebuilt when missing")
+    {
+        std::remove(indexFilename.c_str());
+        checkLookups();
+        REQUIRE(fs::exists(indexFilename));
+    }
+
+    SECTION("empty bucket")
+    {
+        auto empty = std::make_shared<Bucket>();
+        REQUIRE(!empty->getEntry(LedgerEntryKey(live.front())));
+    }
+}
+
+TEST_CASE("bucket merge executor", "[bucket]")
+{
+    VirtualClock clock;
+    Config const& cfg = getTestConfig();
+    Application::pointer app = Application::create(clock, cfg);
+
+    std::promise<void> gate;
+    std::shared_future<void> opened = gate.get_future().share();
+    auto blocked = [opened]()
+    {
+        opened.wait();
+    };
+
+    SECTION("lower levels first")
+    {
+        BucketMergeExecutor executor(app->getMetrics(), 1);
+        std::mutex mutex;
+        std::vector<size_t> order;
+        executor.post(5, blocked);
+        for (size_t level : {3, 1, 7, 2, 1})
+        {
+            executor.post(level, [&mutex, &order, level]()
+                          {
+                              std::lock_guard<std::mutex> lock(mutex);
+                              order.push_back(level);
+                          });
+        }
+        gate.set_value();
+        executor.waitForIdle();
+        REQUIRE(order == std::vector<size_t>({1, 1, 2, 3, 7}));
+    }
+
+    SECTION("deep merges leave a thread to the other levels")
+    {
+        BucketMergeExecutor executor(app->getMetrics(), 2);
+        std::atomic<bool> secondDeepStarted(false);
+        std::promise<bool> shallowDone;
+        executor.post(BucketMergeExecutor::FIRST_DEEP_LEVEL, blocked);
+        executor.post(BucketMergeExecutor::FIRST_DEEP_LEVEL + 1,
+                      [&secondDeepStarted]()
+                      {
+                          secondDeepStarted = true;
+                      });
+        executor.post(0, [&secondDeepStarted, &shallowDone]()
+                      {
+                          shallowDone.set_value(secondDeepStarted);
+                      });
+        REQUIRE(!shallowDone.get_future().get());
+        gate.set_value();
+        executor.waitForIdle();
+        REQUIRE(secondDeepStarted);
+    }
+}
+
+TEST_CASE("bucket merge threads config", "[bucket]")
+{
+    TmpDirManager tdm("cfgtmp");
+    TmpDir dir = tdm.tmpDir("config");
+    auto loadError = [&dir](int64_t threads)
+    {
+        std::string filename = dir.getName() + "/stellar-core.cfg";
+        {
+            std::ofstream out(filename);
+            out << "BUCKET_MERGE_THREADS=" << threads << "\n";
+        }
+        Config cfg;
+        try
+        {
+            cfg.load(filename);
+        }
+        catch (std::invalid_argument& e)
+        {
+            return std::string(e.what());
+        }
+        return std::string();
+    };
+
+    // a single thread could be taken by a deep merge, holding up the merges
+    // of the levels above for the whole merge
+    REQUIRE(loadError(0) == "invalid BUCKET_MERGE_THREADS");
+    REQUIRE(loadError(1) == "invalid BUCKET_MERGE_THREADS");
+    // the file has no quorum set, loading it fails after the merge threads
+    REQUIRE(loadError(2) != "invalid BUCKET_MERGE_THREADS");
+}
+
 static void
 clearFutures(Application::pointer app, BucketList& bl)
 {
@@ -545,6 +891,10 @@ clearFutures(Application::pointer app, BucketList& bl)
         bl.getLevel(i).getNext().clear();
     }
 
+    // Then wait for the merges, which might still be running (holding a
+    // shared_ptr<Bucket>).
+    app->getBucketManager().getMergeExecutor().waitForIdle();
+
     // Then go through all the _worker threads_ and mop up any work they
     // might still be doing (that might be "dropping a shared_ptr<Bucket>").
 
@@ -10,6 +10,7 @@
 #include "bucket/FutureBucket.h"
 #include "bucket/Bucket.h"
 #include "bucket/BucketManager.h"
+#include "bucket/BucketMergeExecutor.h"
 #include "crypto/Hex.h"
 #include "main/Application.h"
 #include "util/Logging.h"
@@ -23,7 +24,7 @@ FutureBucket::FutureBucket(Application& app,
                            std::shared_ptr<Bucket> const& curr,
                            std::shared_ptr<Bucket> const& snap,
                            std::vector<std::shared_ptr<Bucket>> const& shadows,
-                           bool keepDeadEntries)
+                           bool keepDeadEntries, size_t level)
     : mState(FB_LIVE_INPUTS)
     , mInputCurrBucket(curr)
     , mInputSnapBucket(snap)
@@ -41,7 +42,7 @@ FutureBucket::FutureBucket(Application& app,
     {
         mInputShadowBucketHashes.push_back(binToHex(b->getHash()));
     }
-    startMerge(app);
+    startMerge(app, level);
 }
 
 void
@@ -250,7 +251,7 @@ FutureBucket::getOutputHash() const
 }
 
 void
-FutureBucket::startMerge(Application& app)
+FutureBucket::startMerge(Application& app, size_t level)
 {
     // NB: startMerge starts with FutureBucket in a half-valid state; the inputs
     // are live but the merge is not yet running. So you can't call checkState()
@@ -300,12 +301,12 @@ FutureBucket::startMerge(Application& app)
         });
 
     mOutputBucket = task->get_future().share();
-    app.getWorkerIOService().post(bind(&task_t::operator(), task));
+    bm.getMergeExecutor().post(level, bind(&task_t::operator(), task));
     checkState();
 }
 
 void
-FutureBucket::makeLive(Application& app)
+FutureBucket::makeLive(Application& app, size_t level)
 {
     checkState();
     assert(!isLive());
@@ -331,7 +332,7 @@ FutureBucket::makeLive(Application& app)
             mInputShadowBuckets.push_back(b);
         }
         mState = FB_LIVE_INPUTS;
-        startMerge(app);
+        startMerge(app, level);
         assert(isLive());
     }
 }
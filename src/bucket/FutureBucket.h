@@ -74,7 +74,7 @@ class FutureBucket
 
     void checkHashesMatch() const;
     void checkState() const;
-    void startMerge(Application& app);
+    void startMerge(Application& app, size_t level);
 
     void clearInputs();
     void clearOutput();
@@ -84,7 +84,7 @@ class FutureBucket
     FutureBucket(Application& app, std::shared_ptr<Bucket> const& curr,
                  std::shared_ptr<Bucket> const& snap,
                  std::vector<std::shared_ptr<Bucket>> const& shadows,
-                 bool keepDeadEntries);
+                 bool keepDeadEntries, size_t level);
 
     FutureBucket(std::shared_ptr<Bucket> output);
 
@@ -117,8 +117,9 @@ class FutureBucket
     // Precondition: isLive(); waits-for and resolves to merged bucket.
     std::shared_ptr<Bucket> resolve();
 
-    // Precondition: !isLive(); transitions from FB_HASH_FOO to FB_LIVE_FOO
-    void makeLive(Application& app);
+    // Precondition: !isLive(); transitions from FB_HASH_FOO to FB_LIVE_FOO,
+    // restarting the merge into `level` of the BucketList if there is one.
+    void makeLive(Application& app, size_t level);
 
     // Return all hashes referenced by this future.
     std::vector<std::string> getHashes() const;
@@ -0,0 +1,279 @@
+// Copyright 2017 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "bucket/LedgerCmp.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace stellar
+{
+
+namespace
+{
+
+// Reads the fields of an encoded BucketEntry, in order.
+class KeyReader
+{
+    unsigned char const* mPos;
+    unsigned char const* mEnd;
+
+  public:
+    explicit KeyReader(ByteSlice const& entry)
+        : mPos(entry.begin()), mEnd(entry.end())
+    {
+    }
+
+    unsigned char const*
+    position() const
+    {
+        return mPos;
+    }
+
+    unsigned char const*
+    take(size_t n)
+    {
+        if (static_cast<size_t>(mEnd - mPos) < n)
+        {
+            throw std::runtime_error("malformed bucket entry");
+        }
+        auto p = mPos;
+        mPos += n;
+        return p;
+    }
+
+    uint32_t
+    getUint32()
+    {
+        auto p = take(4);
+        return (static_cast<uint32_t>(p[0]) << 24) |
+               (static_cast<uint32_t>(p[1]) << 16) |
+               (static_cast<uint32_t>(p[2]) << 8) | static_cast<uint32_t>(p[3]);
+    }
+
+    int32_t
+    getInt32()
+    {
+        return static_cast<int32_t>(getUint32());
+    }
+
+    uint64_t
+    getUint64()
+    {
+        uint64_t hi = getUint32();
+        return (hi << 32) | getUint32();
+    }
+
+    int64_t
+    getInt64()
+    {
+        return static_cast<int64_t>(getUint64());
+    }
+};
+
+template <typename T>
+int
+compareValues(T a, T b)
+{
+    return a < b ? -1 : (b < a ? 1 : 0);
+}
+
+// skips what precedes the encoded LedgerKey in the entry
+void
+skipToKey(KeyReader& r)
+{
+    switch (r.getInt32())
+    {
+    case LIVEENTRY:
+        // lastModifiedLedgerSeq
+        r.take(4);
+        break;
+    case DEADENTRY:
+        break;
+    default:
+        throw std::runtime_error("malformed bucket entry");
+    }
+}
+
+void
+skipAccountID(KeyReader& r)
+{
+    if (r.getInt32() != KEY_TYPE_ED25519)
+    {
+        throw std::runtime_error("malformed bucket entry");
+    }
+    r.take(32);
+}
+
+void
+skipKey(KeyReader& r)
+{
+    switch (r.getInt32())
+    {
+    case ACCOUNT:
+        skipAccountID(r);
+        return;
+    case TRUSTLINE:
+        skipAccountID(r);
+        switch (r.getInt32())
+        {
+        case ASSET_TYPE_NATIVE:
+            return;
+        case ASSET_TYPE_CREDIT_ALPHANUM4:
+            r.take(4);
+            skipAccountID(r);
+            return;
+        case ASSET_TYPE_CREDIT_ALPHANUM12:
+            r.take(12);
+            skipAccountID(r);
+            return;
+        }
+        break;
+    case OFFER:
+        skipAccountID(r);
+        r.take(8);
+        return;
+    case DATA:
+    {
+        skipAccountID(r);
+        // padded to a multiple of 4 bytes
+        size_t sz = r.getUint32();
+        r.take((sz + 3) & ~static_cast<size_t>(3));
+        return;
+    }
+    case REVERSED_PAYMENT:
+        r.take(8);
+        return;
+    }
+    throw std::runtime_error("malformed bucket entry");
+}
+
+int
+compareAccountID(KeyReader& a, KeyReader& b)
+{
+    auto aty = a.getInt32();
+    auto bty = b.getInt32();
+    if (aty != bty)
+    {
+        return compareValues(aty, bty);
+    }
+    if (aty != KEY_TYPE_ED25519)
+    {
+        throw std::runtime_error("malformed bucket entry");
+    }
+    return std::memcmp(a.take(32), b.take(32), 32);
+}
+
+int
+compareAsset(KeyReader& a, KeyReader& b)
+{
+    auto aty = a.getInt32();
+    auto bty = b.getInt32();
+    if (aty != bty)
+    {
+        return compareValues(aty, bty);
+    }
+
+    size_t codeSize;
+    switch (aty)
+    {
+    case ASSET_TYPE_NATIVE:
+        return 0;
+    case ASSET_TYPE_CREDIT_ALPHANUM4:
+        codeSize = 4;
+        break;
+    case ASSET_TYPE_CREDIT_ALPHANUM12:
+        codeSize = 12;
+        break;
+    default:
+        throw std::runtime_error("malformed bucket entry");
+    }
+    int c = std::memcmp(a.take(codeSize), b.take(codeSize), codeSize);
+    if (c != 0)
+    {
+        return c;
+    }
+    return compareAccountID(a, b);
+}
+
+// same order as std::string, which the decoded strings are compared as
+int
+compareString(KeyReader& a, KeyReader& b)
+{
+    auto asz = a.getUint32();
+    auto bsz = b.getUint32();
+    auto ap = a.take(asz);
+    auto bp = b.take(bsz);
+    int c = std::memcmp(ap, bp, std::min(asz, bsz));
+    if (c != 0)
+    {
+        return c;
+    }
+    return compareValues(asz, bsz);
+}
+
+// compares the LedgerKeys that `a` and `b` are at
+int
+compareKey(KeyReader& a, KeyReader& b)
+{
+    auto aty = a.getInt32();
+    auto bty = b.getInt32();
+    if (aty != bty)
+    {
+        return compareValues(aty, bty);
+    }
+
+    int c;
+    switch (aty)
+    {
+    case ACCOUNT:
+        return compareAccountID(a, b);
+
+    case TRUSTLINE:
+        c = compareAccountID(a, b);
+        return c != 0 ? c : compareAsset(a, b);
+
+    case OFFER:
+        c = compareAccountID(a, b);
+        return c != 0 ? c : compareValues(a.getUint64(), b.getUint64());
+
+    case DATA:
+        c = compareAccountID(a, b);
+        return c != 0 ? c : compareString(a, b);
+
+    case REVERSED_PAYMENT:
+        return compareValues(a.getInt64(), b.getInt64());
+    }
+    throw std::runtime_error("malformed bucket entry");
+}
+}
+
+int
+BucketRecordIdCmp::compare(ByteSlice const& a, ByteSlice const& b)
+{
+    KeyReader ar(a);
+    KeyReader br(b);
+    skipToKey(ar);
+    skipToKey(br);
+    return compareKey(ar, br);
+}
+
+int
+BucketRecordIdCmp::compareKeys(ByteSlice const& a, ByteSlice const& b)
+{
+    KeyReader ar(a);
+    KeyReader br(b);
+    return compareKey(ar, br);
+}
+
+ByteSlice
+BucketRecordIdCmp::getKey(ByteSlice const& entry)
+{
+    KeyReader r(entry);
+    skipToKey(r);
+    auto begin = r.position();
+    skipKey(r);
+    return ByteSlice(begin, r.position() - begin);
+}
+}
@@ -5,6 +5,7 @@
 // of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
 
 #include "overlay/StellarXDR.h"
+#include "crypto/ByteSlice.h"
 #include "ledger/EntryFrame.h"
 
 namespace stellar
@@ -139,4 +140,30 @@ struct BucketEntryIdCmp
         }
     }
 };
+
+/**
+ * Compare two BucketEntries for identity, as BucketEntryIdCmp does, in their
+ * XDR encoding -- the body of a record of a bucket file -- rather than
+ * decoded. Only the key of each entry is read, and only up to the first
+ * difference; throws std::runtime_error if an entry is truncated or malformed.
+ */
+struct BucketRecordIdCmp
+{
+    // negative, zero or positive, as the identity of `a` is less than, equal
+    // to or greater than the one of `b`
+    static int compare(ByteSlice const& a, ByteSlice const& b);
+
+    // the same, for two encoded LedgerKeys
+    static int compareKeys(ByteSlice const& a, ByteSlice const& b);
+
+    // the XDR of the LedgerKey of an encoded BucketEntry, which is a part of
+    // it: the key fields come first in each type of LedgerEntry
+    static ByteSlice getKey(ByteSlice const& entry);
+
+    bool
+    operator()(ByteSlice const& a, ByteSlice const& b) const
+    {
+        return compare(a, b) < 0;
+    }
+};
 }
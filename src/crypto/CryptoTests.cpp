@@ -2,6 +2,7 @@
 // under the Apache License, Version 2.0. See the COPYING file at the root
 // of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
 
+#include "util/asio.h"
 #include "main/test.h"
 #include "util/Logging.h"
 #include "lib/catch.hpp"
@@ -15,6 +16,7 @@
 #include <sodium.h>
 #include <map>
 #include <regex>
+#include <thread>
 
 using namespace stellar;
 
@@ -152,6 +154,98 @@ TEST_CASE("sign tests", "[crypto]")
     CHECK(!PubKeyUtils::verifySig(pk, sig, msg));
 }
 
+TEST_CASE("batch verify", "[crypto]")
+{
+    std::vector<PubKeyUtils::SignatureCheck> checks;
+    for (int i = 0; i < 20; i++)
+    {
+        auto sk = SecretKey::random();
+        Hash h = HashUtils::random();
+        auto sig = sk.sign(h);
+        if (i % 2)
+        {
+            sig[4] ^= 1;
+        }
+        checks.push_back(
+            PubKeyUtils::SignatureCheck{sk.getPublicKey(), sig, h});
+    }
+
+    auto checkCached = [&checks]()
+    {
+        uint64_t hits, misses, ignores;
+        PubKeyUtils::flushVerifySigCacheCounts(hits, misses, ignores);
+        for (size_t i = 0; i < checks.size(); i++)
+        {
+            auto const& c = checks[i];
+            CHECK(PubKeyUtils::verifySig(c.mKey, c.mSignature, c.mHash) ==
+                  (i % 2 == 0));
+        }
+        PubKeyUtils::flushVerifySigCacheCounts(hits, misses, ignores);
+        CHECK(hits == checks.size());
+        CHECK(misses == 0);
+    };
+
+    PubKeyUtils::clearVerifySigCache();
+    asio::io_service workers;
+
+    SECTION("sync, without running workers")
+    {
+        // the calling thread verifies whatever the workers don't
+        PubKeyUtils::verifySigs(checks, workers);
+        checkCached();
+    }
+    SECTION("async")
+    {
+        auto done = PubKeyUtils::verifySigsAsync(checks, workers);
+        std::thread worker([&workers]()
+                           {
+                               workers.run();
+                           });
+        done.wait();
+        worker.join();
+        checkCached();
+    }
+}
+
+TEST_CASE("verify cache size", "[crypto]")
+{
+    std::vector<PubKeyUtils::SignatureCheck> checks;
+    for (int i = 0; i < 200; i++)
+    {
+        auto sk = SecretKey::random();
+        Hash h = HashUtils::random();
+        checks.push_back(
+            PubKeyUtils::SignatureCheck{sk.getPublicKey(), sk.sign(h), h});
+    }
+
+    // one result per shard
+    PubKeyUtils::setVerifySigCacheSize(1);
+    uint64_t hits, misses, ignores;
+    PubKeyUtils::flushVerifySigCacheCounts(hits, misses, ignores);
+    for (int pass = 0; pass < 2; pass++)
+    {
+        for (auto const& c : checks)
+        {
+            CHECK(PubKeyUtils::verifySig(c.mKey, c.mSignature, c.mHash));
+        }
+    }
+    PubKeyUtils::flushVerifySigCacheCounts(hits, misses, ignores);
+    CHECK(hits + misses == 2 * checks.size());
+    CHECK(misses >= 2 * checks.size() - 16);
+
+    PubKeyUtils::setVerifySigCacheSize(getTestConfig().SIGNATURE_CACHE_SIZE);
+    asio::io_service workers;
+    PubKeyUtils::verifySigs(checks, workers);
+    PubKeyUtils::flushVerifySigCacheCounts(hits, misses, ignores);
+    for (auto const& c : checks)
+    {
+        CHECK(PubKeyUtils::verifySig(c.mKey, c.mSignature, c.mHash));
+    }
+    PubKeyUtils::flushVerifySigCacheCounts(hits, misses, ignores);
+    CHECK(hits == checks.size());
+    CHECK(misses == 0);
+}
+
 struct SignVerifyTestcase
 {
     SecretKey key;
@@ -324,6 +418,31 @@ TEST_CASE("StrKey tests", "[crypto]")
     REQUIRE(detectionRate > 98.0);
 }
 
+TEST_CASE("StrKey cache", "[crypto]")
+{
+    auto pk = SecretKey::random().getPublicKey();
+    uint64_t hits, misses;
+    PubKeyUtils::flushStrKeyCacheCounts(hits, misses);
+
+    auto strKey = PubKeyUtils::toStrKey(pk);
+    REQUIRE(PubKeyUtils::toStrKey(pk) == strKey);
+    REQUIRE(PubKeyUtils::fromStrKey(strKey) == pk);
+    REQUIRE(PubKeyUtils::fromStrKey(strKey) == pk);
+    PubKeyUtils::flushStrKeyCacheCounts(hits, misses);
+    REQUIRE(hits == 2);
+    REQUIRE(misses == 2);
+
+    // failures are not cached
+    auto bad = strKey;
+    bad[10] = bad[10] == 'A' ? 'B' : 'A';
+    REQUIRE_THROWS_AS(PubKeyUtils::fromStrKey(bad), std::invalid_argument);
+    REQUIRE_THROWS_AS(PubKeyUtils::fromStrKey(bad), std::invalid_argument);
+    REQUIRE_THROWS_AS(PubKeyUtils::fromStrKey(""), std::invalid_argument);
+    PubKeyUtils::flushStrKeyCacheCounts(hits, misses);
+    REQUIRE(hits == 0);
+    REQUIRE(misses == 2);
+}
+
 TEST_CASE("base64 tests", "[crypto]")
 {
     autocheck::generator<std::vector<uint8_t>> input;
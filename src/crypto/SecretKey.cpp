@@ -2,16 +2,19 @@
 // under the Apache License, Version 2.0. See the COPYING file at the root
 // of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
 
+#include "util/asio.h"
 #include "crypto/SecretKey.h"
 #include "crypto/StrKey.h"
 #include "crypto/Hex.h"
-#include "crypto/SHA.h"
 #include <sodium.h>
 #include <type_traits>
 #include <memory>
 #include "util/make_unique.h"
 #include "util/HashOfHash.h"
+#include <algorithm>
+#include <atomic>
 #include <mutex>
+#include <thread>
 #include "main/Config.h"
 #include "util/lrucache.hpp"
 
@@ -24,13 +27,28 @@ namespace stellar
 // to the state of the process; caching its results centrally
 // makes all signature-verification in the program faster and
 // has no effect on correctness.
+//
+// It is split in shards, picked by the last byte of the cache key, each with
+// its own lock: verifySig is called concurrently from the worker threads.
+//
+// The cache key is a BLAKE2b hash of the key, the signature and the message:
+// it has to be collision resistant, as a collision with a valid signature
+// would make an invalid one pass, but is computed on every call, hit or not,
+// and BLAKE2b is several times faster than SHA-256 on these small inputs.
+
+static size_t const VERIFY_SIG_CACHE_SHARDS = 16;
+
+struct VerifySigCacheShard
+{
+    std::mutex mMutex;
+    size_t mMaxSize{0xffff / VERIFY_SIG_CACHE_SHARDS};
+    cache::lru_cache<Hash, bool> mCache{mMaxSize};
+    uint64_t mHit{0};
+    uint64_t mMiss{0};
+};
 
-static std::mutex gVerifySigCacheMutex;
-static cache::lru_cache<Hash, bool> gVerifySigCache(0xffff);
-static std::unique_ptr<SHA256> gHasher = SHA256::create();
-static uint64_t gVerifyCacheHit = 0;
-static uint64_t gVerifyCacheMiss = 0;
-static uint64_t gVerifyCacheIgnore = 0;
+static VerifySigCacheShard gVerifySigCache[VERIFY_SIG_CACHE_SHARDS];
+static std::atomic<uint64_t> gVerifyCacheIgnore{0};
 
 static bool
 shouldCacheVerifySig(PublicKey const& key, Signature const& signature,
@@ -43,13 +61,48 @@ static Hash
 verifySigCacheKey(PublicKey const& key, Signature const& signature,
                   ByteSlice const& bin)
 {
-    gHasher->reset();
-    gHasher->add(key.ed25519());
-    gHasher->add(signature);
-    gHasher->add(bin);
-    return gHasher->finish();
+    Hash res;
+    crypto_generichash_state state;
+    crypto_generichash_init(&state, nullptr, 0, res.size());
+    crypto_generichash_update(&state, key.ed25519().data(),
+                              key.ed25519().size());
+    crypto_generichash_update(&state, signature.data(), signature.size());
+    crypto_generichash_update(&state, bin.data(), bin.size());
+    crypto_generichash_final(&state, res.data(), res.size());
+    return res;
+}
+
+static VerifySigCacheShard&
+verifySigCacheShard(Hash const& cacheKey)
+{
+    // std::hash<Hash> uses the first bytes
+    return gVerifySigCache[cacheKey.back() % VERIFY_SIG_CACHE_SHARDS];
 }
 
+// Process-wide cache of the StrKey encodings of public keys, both ways.
+//
+// Account ids are bound to and read from SQL as StrKeys, so the same keys
+// are encoded and decoded (base32 and CRC16) on every load and store. The
+// cache is split in shards like the verification cache: the encodings are
+// picked by the last byte of the key, the decodings by the last character
+// of the StrKey. Keys that fail to decode are not cached.
+
+static size_t const STRKEY_CACHE_SHARDS = 16;
+static size_t const STRKEY_CACHE_SIZE = 0xffff;
+
+struct StrKeyCacheShard
+{
+    std::mutex mMutex;
+    cache::lru_cache<uint256, std::string> mEncoded{STRKEY_CACHE_SIZE /
+                                                    STRKEY_CACHE_SHARDS};
+    cache::lru_cache<std::string, uint256> mDecoded{STRKEY_CACHE_SIZE /
+                                                    STRKEY_CACHE_SHARDS};
+    uint64_t mHit{0};
+    uint64_t mMiss{0};
+};
+
+static StrKeyCacheShard gStrKeyCache[STRKEY_CACHE_SHARDS];
+
 SecretKey::SecretKey() : mKeyType(KEY_TYPE_ED25519)
 {
     static_assert(crypto_sign_PUBLICKEYBYTES == sizeof(uint256),
@@ -192,21 +245,44 @@ SecretKey::fromStrKeySeed(std::string const& strKeySeed)
 void
 PubKeyUtils::clearVerifySigCache()
 {
-    std::lock_guard<std::mutex> guard(gVerifySigCacheMutex);
-    gVerifySigCache.clear();
+    for (auto& shard : gVerifySigCache)
+    {
+        std::lock_guard<std::mutex> guard(shard.mMutex);
+        shard.mCache.clear();
+    }
+}
+
+void
+PubKeyUtils::setVerifySigCacheSize(size_t maxSize)
+{
+    size_t shardSize =
+        std::max<size_t>(1, maxSize / VERIFY_SIG_CACHE_SHARDS);
+    for (auto& shard : gVerifySigCache)
+    {
+        std::lock_guard<std::mutex> guard(shard.mMutex);
+        if (shard.mMaxSize != shardSize)
+        {
+            shard.mMaxSize = shardSize;
+            shard.mCache = cache::lru_cache<Hash, bool>(shardSize);
+        }
+    }
 }
 
 void
 PubKeyUtils::flushVerifySigCacheCounts(uint64_t& hits, uint64_t& misses,
                                        uint64_t& ignores)
 {
-    std::lock_guard<std::mutex> guard(gVerifySigCacheMutex);
-    hits = gVerifyCacheHit;
-    misses = gVerifyCacheMiss;
-    ignores = gVerifyCacheIgnore;
-    gVerifyCacheHit = 0;
-    gVerifyCacheMiss = 0;
-    gVerifyCacheIgnore = 0;
+    hits = 0;
+    misses = 0;
+    for (auto& shard : gVerifySigCache)
+    {
+        std::lock_guard<std::mutex> guard(shard.mMutex);
+        hits += shard.mHit;
+        misses += shard.mMiss;
+        shard.mHit = 0;
+        shard.mMiss = 0;
+    }
+    ignores = gVerifyCacheIgnore.exchange(0);
 }
 
 bool
@@ -219,13 +295,14 @@ PubKeyUtils::verifySig(PublicKey const& key, Signature const& signature,
     if (shouldCache)
     {
         cacheKey = verifySigCacheKey(key, signature, bin);
-        std::lock_guard<std::mutex> guard(gVerifySigCacheMutex);
-        if (gVerifySigCache.exists(cacheKey))
+        auto& shard = verifySigCacheShard(cacheKey);
+        std::lock_guard<std::mutex> guard(shard.mMutex);
+        if (shard.mCache.exists(cacheKey))
         {
-            ++gVerifyCacheHit;
-            return gVerifySigCache.get(cacheKey);
+            ++shard.mHit;
+            return shard.mCache.get(cacheKey);
         }
-        ++gVerifyCacheMiss;
+        ++shard.mMiss;
     }
     else
     {
@@ -237,12 +314,84 @@ PubKeyUtils::verifySig(PublicKey const& key, Signature const& signature,
                                      key.ed25519().data()) == 0);
     if (shouldCache)
     {
-        std::lock_guard<std::mutex> guard(gVerifySigCacheMutex);
-        gVerifySigCache.put(cacheKey, ok);
+        auto& shard = verifySigCacheShard(cacheKey);
+        std::lock_guard<std::mutex> guard(shard.mMutex);
+        shard.mCache.put(cacheKey, ok);
     }
     return ok;
 }
 
+namespace
+{
+// checks are handed out one at a time, to whichever thread asks first: a
+// worker busy with something else doesn't hold up the batch
+struct SignatureBatch
+{
+    std::vector<PubKeyUtils::SignatureCheck> mChecks;
+    std::atomic<size_t> mNext{0};
+    std::atomic<size_t> mVerified{0};
+    std::promise<void> mDone;
+
+    void
+    run()
+    {
+        size_t i;
+        while ((i = mNext++) < mChecks.size())
+        {
+            auto const& c = mChecks[i];
+            PubKeyUtils::verifySig(c.mKey, c.mSignature, c.mHash);
+            if (++mVerified == mChecks.size())
+            {
+                mDone.set_value();
+            }
+        }
+    }
+};
+
+std::shared_ptr<SignatureBatch>
+startSignatureBatch(std::vector<PubKeyUtils::SignatureCheck> checks,
+                    asio::io_service& workers, size_t otherThreads)
+{
+    auto batch = std::make_shared<SignatureBatch>();
+    batch->mChecks = std::move(checks);
+    if (batch->mChecks.empty())
+    {
+        batch->mDone.set_value();
+        return batch;
+    }
+
+    size_t nTasks = std::max<size_t>(1, std::thread::hardware_concurrency());
+    nTasks = std::min(nTasks, batch->mChecks.size());
+    nTasks = nTasks > otherThreads ? nTasks - otherThreads : 0;
+    for (size_t t = 0; t < nTasks; t++)
+    {
+        workers.post([batch]()
+                     {
+                         batch->run();
+                     });
+    }
+    return batch;
+}
+}
+
+void
+PubKeyUtils::verifySigs(std::vector<SignatureCheck> checks,
+                        asio::io_service& workers)
+{
+    auto batch = startSignatureBatch(std::move(checks), workers, 1);
+    auto done = batch->mDone.get_future();
+    batch->run();
+    done.wait();
+}
+
+std::shared_future<void>
+PubKeyUtils::verifySigsAsync(std::vector<SignatureCheck> checks,
+                             asio::io_service& workers)
+{
+    auto batch = startSignatureBatch(std::move(checks), workers, 0);
+    return batch->mDone.get_future().share();
+}
+
 std::string
 PubKeyUtils::toShortString(PublicKey const& pk)
 {
@@ -252,13 +401,45 @@ PubKeyUtils::toShortString(PublicKey const& pk)
 std::string
 PubKeyUtils::toStrKey(PublicKey const& pk)
 {
-    return strKey::toStrKey(strKey::STRKEY_PUBKEY_ED25519, pk.ed25519());
+    auto const& key = pk.ed25519();
+    auto& shard = gStrKeyCache[key.back() % STRKEY_CACHE_SHARDS];
+    {
+        std::lock_guard<std::mutex> guard(shard.mMutex);
+        if (shard.mEncoded.exists(key))
+        {
+            ++shard.mHit;
+            return shard.mEncoded.get(key);
+        }
+        ++shard.mMiss;
+    }
+
+    auto res = strKey::toStrKey(strKey::STRKEY_PUBKEY_ED25519, key);
+    std::lock_guard<std::mutex> guard(shard.mMutex);
+    shard.mEncoded.put(key, res);
+    return res;
 }
 
 PublicKey
 PubKeyUtils::fromStrKey(std::string const& s)
 {
     PublicKey pk;
+    if (s.empty())
+    {
+        throw std::invalid_argument("bad public key");
+    }
+    auto& shard =
+        gStrKeyCache[static_cast<uint8_t>(s.back()) % STRKEY_CACHE_SHARDS];
+    {
+        std::lock_guard<std::mutex> guard(shard.mMutex);
+        if (shard.mDecoded.exists(s))
+        {
+            ++shard.mHit;
+            pk.ed25519() = shard.mDecoded.get(s);
+            return pk;
+        }
+        ++shard.mMiss;
+    }
+
     uint8_t ver;
     std::vector<uint8_t> k;
     if (!strKey::fromStrKey(s, ver, k) ||
@@ -269,9 +450,27 @@ PubKeyUtils::fromStrKey(std::string const& s)
         throw std::invalid_argument("bad public key");
     }
     std::copy(k.begin(), k.end(), pk.ed25519().begin());
+
+    std::lock_guard<std::mutex> guard(shard.mMutex);
+    shard.mDecoded.put(s, pk.ed25519());
     return pk;
 }
 
+void
+PubKeyUtils::flushStrKeyCacheCounts(uint64_t& hits, uint64_t& misses)
+{
+    hits = 0;
+    misses = 0;
+    for (auto& shard : gStrKeyCache)
+    {
+        std::lock_guard<std::mutex> guard(shard.mMutex);
+        hits += shard.mHit;
+        misses += shard.mMiss;
+        shard.mHit = 0;
+        shard.mMiss = 0;
+    }
+}
+
 SignatureHint
 PubKeyUtils::getHint(PublicKey const& pk)
 {
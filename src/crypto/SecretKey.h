@@ -8,6 +8,13 @@
 #include <ostream>
 #include <functional>
 #include <array>
+#include <future>
+#include <vector>
+
+namespace asio
+{
+class io_service;
+}
 
 namespace stellar
 {
@@ -71,16 +78,41 @@ namespace PubKeyUtils
 bool verifySig(PublicKey const& key, Signature const& signature,
                ByteSlice const& bin);
 
+// A signature to verify, of `mHash` under `mKey`.
+struct SignatureCheck
+{
+    PublicKey mKey;
+    Signature mSignature;
+    Hash mHash;
+};
+
+// Verify all of `checks`, on the calling thread and in parallel on `workers`,
+// returning once they are all verified. The results go to the verification
+// cache: the subsequent verifySig calls for them are hits.
+void verifySigs(std::vector<SignatureCheck> checks, asio::io_service& workers);
+
+// Same as verifySigs, but only on `workers`: the returned future becomes
+// ready once every check is verified.
+std::shared_future<void> verifySigsAsync(std::vector<SignatureCheck> checks,
+                                         asio::io_service& workers);
+
 void clearVerifySigCache();
+// Sets the number of results kept by the verification cache, clearing it if
+// the size changes. The cache is shared by every Application of the process.
+void setVerifySigCacheSize(size_t maxSize);
 void flushVerifySigCacheCounts(uint64_t& hits, uint64_t& misses,
                                uint64_t& ignores);
 
 std::string toShortString(PublicKey const& pk);
 
+// The StrKey conversions go through a bounded cache of recent keys, shared
+// by every Application of the process.
 std::string toStrKey(PublicKey const& pk);
 
 PublicKey fromStrKey(std::string const& s);
 
+void flushStrKeyCacheCounts(uint64_t& hits, uint64_t& misses);
+
 // returns hint from key
 SignatureHint getHint(PublicKey const& pk);
 // returns true if the hint matches the key
@@ -12,6 +12,7 @@
 #include "util/GlobalChecks.h"
 #include "util/Timer.h"
 #include "crypto/Hex.h"
+#include "crypto/SecretKey.h"
 
 #include "ledger/AccountFrame.h"
 #include "ledger/OfferFrame.h"
@@ -25,11 +26,14 @@
 #include "transactions/TransactionFrame.h"
 #include "bucket/BucketManager.h"
 #include "herder/Herder.h"
+#include "history/HistoryWriter.h"
 
 #include "medida/metrics_registry.h"
 #include "medida/timer.h"
 #include "medida/counter.h"
 
+#include "soci-sqlite3.h"
+
 #include <stdexcept>
 #include <vector>
 #include <sstream>
@@ -52,7 +56,38 @@ using namespace std;
 
 bool Database::gDriversRegistered = false;
 
-static unsigned long const SCHEMA_VERSION = 3;
+static unsigned long const SCHEMA_VERSION = 6;
+
+// The ledger entry tables, with their account id columns first, see
+// Database::convertAccountIDsToBinary.
+struct AccountIDTable
+{
+    std::string mName;
+    std::vector<std::string> mIDColumns;
+    std::vector<std::string> mOtherColumns;
+};
+
+static std::vector<AccountIDTable> const kAccountIDTables = {
+    {"accounts",
+     {"accountid", "inflationdest"},
+     {"balance", "seqnum", "numsubentries", "homedomain", "accounttype",
+      "thresholds", "flags", "lastmodified"}},
+    {"signers", {"accountid", "publickey"}, {"weight", "signertype"}},
+    {"trustlines",
+     {"accountid", "issuer"},
+     {"assettype", "assetcode", "tlimit", "balance", "flags", "lastmodified"}},
+    {"offers",
+     {"sellerid", "sellingissuer", "buyingissuer"},
+     {"offerid", "sellingassettype", "sellingassetcode", "buyingassettype",
+      "buyingassetcode", "amount", "pricen", "priced", "price", "flags",
+      "lastmodified"}},
+    {"accountdata", {"accountid"}, {"dataname", "datavalue"}}};
+
+static char const*
+binaryColumnType(Database& db)
+{
+    return db.isSqlite() ? "BLOB" : "BYTEA";
+}
 
 static void
 setSerializable(soci::session& sess)
@@ -78,9 +113,22 @@ Database::Database(Application& app)
     : mApp(app)
     , mQueryMeter(
           app.getMetrics().NewMeter({"database", "query", "exec"}, "query"))
+    , mStatements(app.getConfig().PREPARED_STATEMENT_CACHE_SIZE)
+    , mMaxStatements(app.getConfig().PREPARED_STATEMENT_CACHE_SIZE)
+    , mStatementPrepares(app.getMetrics().NewMeter(
+          {"database", "statement", "prepare"}, "statement"))
+    , mStatementHits(app.getMetrics().NewMeter(
+          {"database", "statement", "hit"}, "statement"))
+    , mStatementEvictions(app.getMetrics().NewMeter(
+          {"database", "statement", "evict"}, "statement"))
     , mStatementsSize(
           app.getMetrics().NewCounter({"database", "memory", "statements"}))
-    , mEntryCache(4096)
+    , mEntryCache(app.getConfig().ENTRY_CACHE_SIZE, app.getMetrics())
+    , mReversedPaymentIndex(app.getMetrics())
+    , mOrderBook(app.getMetrics())
+    , mAccountIDFormatKnown(false)
+    , mBinaryAccountIDs(false)
+    , mBatchTransactionOpen(false)
     , mExcludedQueryTime(0)
     , mExcludedTotalTime(0)
     , mLastIdleQueryTime(0)
@@ -117,6 +165,21 @@ Database::applySchemaUpgrade(unsigned long vers)
         DataFrame::dropAll(*this);
         break;
 
+    case 4:
+        TransactionFrame::upgradeHistoryToBinary(*this);
+        break;
+
+    case 5:
+        HistoryWriter::dropAll(*this);
+        break;
+
+    case 6:
+        if (mApp.getConfig().BINARY_ACCOUNT_IDS && !hasBinaryAccountIDs())
+        {
+            convertAccountIDsToBinary();
+        }
+        break;
+
     default:
         throw std::runtime_error("Unknown DB schema version");
         break;
@@ -143,6 +206,123 @@ Database::upgradeToCurrentSchema()
         putSchemaVersion(vers);
     }
     assert(vers == SCHEMA_VERSION);
+
+    if (hasBinaryAccountIDs() != mApp.getConfig().BINARY_ACCOUNT_IDS)
+    {
+        throw std::runtime_error(
+            hasBinaryAccountIDs()
+                ? "The database stores binary account ids, set "
+                  "BINARY_ACCOUNT_IDS=true"
+                : "The database stores account ids as StrKeys, "
+                  "BINARY_ACCOUNT_IDS=true needs --newdb");
+    }
+}
+
+void
+Database::convertAccountIDsToBinary()
+{
+    CLOG(INFO, "Database") << "Converting account ids to binary";
+    soci::transaction tx(mSession);
+
+    // the StrKey tables are set aside and replaced by binary ones
+    for (auto const& t : kAccountIDTables)
+    {
+        mSession << "CREATE TEMP TABLE " + t.mName +
+                        "_strkey AS SELECT * FROM " + t.mName;
+    }
+    mAccountIDFormatKnown = true;
+    mBinaryAccountIDs = true;
+    mApp.getPersistentState().setState(PersistentState::kAccountIDFormat,
+                                       "binary");
+    AccountFrame::dropAll(*this);
+    OfferFrame::dropAll(*this);
+    TrustFrame::dropAll(*this);
+    DataFrame::dropAll(*this);
+
+    // each StrKey is decoded once, into a table that the copies join
+    mSession << std::string("CREATE TEMP TABLE strkeys ("
+                            "strkey VARCHAR(56) PRIMARY KEY, id ") +
+                    binaryColumnType(*this) + " NOT NULL)";
+    {
+        std::string all;
+        for (auto const& t : kAccountIDTables)
+        {
+            for (auto const& c : t.mIDColumns)
+            {
+                all += all.empty() ? "" : " UNION ";
+                all += "SELECT " + c + " FROM " + t.mName + "_strkey WHERE " +
+                       c + " IS NOT NULL";
+            }
+        }
+
+        std::string strKey;
+        AccountIDColumn id(*this);
+        soci::statement sel = (mSession.prepare << all, soci::into(strKey));
+        soci::statement ins =
+            (mSession.prepare << "INSERT INTO strkeys (strkey, id) "
+                                 "VALUES (:s, :id)",
+             soci::use(strKey), id.use());
+        sel.execute(true);
+        while (sel.got_data())
+        {
+            id.set(PubKeyUtils::fromStrKey(strKey));
+            ins.execute(true);
+            sel.fetch();
+        }
+    }
+
+    for (auto const& t : kAccountIDTables)
+    {
+        std::string columns, values, joins;
+        for (size_t i = 0; i < t.mIDColumns.size(); i++)
+        {
+            auto const& c = t.mIDColumns[i];
+            auto k = "k" + std::to_string(i);
+            columns += (i == 0 ? "" : ", ") + c;
+            values += (i == 0 ? "" : ", ") + k + ".id";
+            joins += " LEFT JOIN strkeys " + k + " ON " + k + ".strkey = s." +
+                     c;
+        }
+        for (auto const& c : t.mOtherColumns)
+        {
+            columns += ", " + c;
+            values += ", s." + c;
+        }
+        mSession << "INSERT INTO " + t.mName + " (" + columns + ") SELECT " +
+                        values + " FROM " + t.mName + "_strkey s" + joins;
+        mSession << "DROP TABLE " + t.mName + "_strkey";
+    }
+    mSession << "DROP TABLE strkeys";
+    tx.commit();
+}
+
+bool
+Database::hasBinaryAccountIDs()
+{
+    if (!mAccountIDFormatKnown)
+    {
+        mBinaryAccountIDs = mApp.getPersistentState().getState(
+                                PersistentState::kAccountIDFormat) == "binary";
+        mAccountIDFormatKnown = true;
+    }
+    return mBinaryAccountIDs;
+}
+
+std::string
+Database::withAccountIDType(std::string const& createStatement)
+{
+    if (!hasBinaryAccountIDs())
+    {
+        return createStatement;
+    }
+    std::string const strKeyType = "VARCHAR(56)";
+    std::string res = createStatement;
+    for (auto pos = res.find(strKeyType); pos != std::string::npos;
+         pos = res.find(strKeyType, pos))
+    {
+        res.replace(pos, strKeyType.size(), binaryColumnType(*this));
+    }
+    return res;
 }
 
 void
@@ -221,7 +401,7 @@ Database::getUpdateTimer(std::string const& entityName)
 void
 Database::setCurrentTransactionReadOnly()
 {
-    if (!isSqlite())
+    if (!isSqlite() && !mBatchTransactionOpen)
     {
         auto prep = getPreparedStatement("SET TRANSACTION READ ONLY");
         auto& st = prep.statement();
@@ -230,6 +410,12 @@ Database::setCurrentTransactionReadOnly()
     }
 }
 
+void
+Database::setBatchTransactionOpen(bool open)
+{
+    mBatchTransactionOpen = open;
+}
+
 bool
 Database::isSqlite() const
 {
@@ -245,12 +431,9 @@ Database::canUsePool() const
 void
 Database::clearPreparedStatementCache()
 {
-    // Flush all prepared statements; in sqlite they represent open cursors
-    // and will conflict with any DROP TABLE commands issued below
-    for (auto st : mStatements)
-    {
-        st.second->clean_up(true);
-    }
+    // Flush all prepared statements; statements not borrowed at the moment
+    // are closed right away, so that they don't get in the way of any
+    // DROP TABLE commands issued below
     mStatements.clear();
     mStatementsSize.set_count(mStatements.size());
 }
@@ -259,6 +442,10 @@ void
 Database::initialize()
 {
     clearPreparedStatementCache();
+    // the tables start with StrKeys, the upgrade to schema version 6
+    // converts them if BINARY_ACCOUNT_IDS is set
+    mAccountIDFormatKnown = true;
+    mBinaryAccountIDs = false;
     // normally you do not want to touch this section as
     // schema updates are done in applySchemaUpgrade
 
@@ -316,12 +503,24 @@ Database::getPool()
     return *mPool;
 }
 
-cache::lru_cache<std::string, std::shared_ptr<LedgerEntry const>>&
+EntryCache&
 Database::getEntryCache()
 {
     return mEntryCache;
 }
 
+ReversedPaymentIndex&
+Database::getReversedPaymentIndex()
+{
+    return mReversedPaymentIndex;
+}
+
+OrderBook&
+Database::getOrderBook()
+{
+    return mOrderBook;
+}
+
 class SQLLogContext : NonCopyable
 {
     std::string mName;
@@ -358,25 +557,231 @@ class SQLLogContext : NonCopyable
     }
 };
 
+// An sqlite statement that was not stepped to completion holds on to its
+// cursor, and to a read transaction, until it is reset; soci only resets it
+// when the statement is executed again. There is no public soci call that
+// resets a statement without executing or finalizing it, so this reaches
+// into the sqlite3 backend of the bundled soci: it resets the statement and
+// marks it ready, as sqlite3_statement_backend::execute does first thing.
+// Does nothing for the other backends.
+static void
+resetSqliteStatement(soci::statement& st)
+{
+    auto be =
+        dynamic_cast<soci::sqlite3_statement_backend*>(st.get_backend());
+    if (be && be->stmt_)
+    {
+        sqlite_api::sqlite3_reset(be->stmt_);
+        be->databaseReady_ = true;
+    }
+}
+
+StatementContext::~StatementContext()
+{
+    if (mStmt)
+    {
+        mStmt->clean_up(false);
+        // the statement may stay cached for a long time
+        resetSqliteStatement(*mStmt);
+    }
+}
+
 StatementContext
 Database::getPreparedStatement(std::string const& query)
 {
-    auto i = mStatements.find(query);
     std::shared_ptr<soci::statement> p;
-    if (i == mStatements.end())
+    if (mStatements.exists(query))
+    {
+        mStatementHits.Mark();
+        p = mStatements.get(query);
+    }
+    else
     {
+        mStatementPrepares.Mark();
         p = std::make_shared<soci::statement>(mSession);
         p->alloc();
         p->prepare(query);
-        mStatements.insert(std::make_pair(query, p));
-        mStatementsSize.set_count(mStatements.size());
+        if (mMaxStatements != 0)
+        {
+            // statements still borrowed stay open until they are returned
+            if (mStatements.size() == mMaxStatements)
+            {
+                mStatementEvictions.Mark();
+            }
+            mStatements.put(query, p);
+            mStatementsSize.set_count(mStatements.size());
+        }
+    }
+    StatementContext sc(p);
+    return sc;
+}
+
+BinaryColumn::BinaryColumn(Database& db, soci::session& sess)
+{
+    if (db.isSqlite())
+    {
+        mBlob = make_unique<soci::blob>(sess);
+    }
+}
+
+void
+BinaryColumn::set(ByteSlice const& bytes)
+{
+    if (mBlob)
+    {
+        mBlob->trim(0);
+        if (bytes.size() != 0)
+        {
+            mBlob->write(0, reinterpret_cast<char const*>(bytes.data()),
+                         bytes.size());
+        }
     }
     else
     {
-        p = i->second;
+        mHex = "\\x";
+        mHex += binToHex(bytes);
     }
-    StatementContext sc(p);
-    return sc;
+}
+
+void
+BinaryColumn::get(std::vector<uint8_t>& bytes)
+{
+    if (mBlob)
+    {
+        bytes.resize(mBlob->get_len());
+        if (!bytes.empty())
+        {
+            mBlob->read(0, reinterpret_cast<char*>(bytes.data()),
+                        bytes.size());
+        }
+    }
+    else
+    {
+        if (mHex.compare(0, 2, "\\x") != 0)
+        {
+            throw std::runtime_error("unexpected bytea format");
+        }
+        bytes = hexToBin(mHex.substr(2));
+    }
+}
+
+soci::details::use_type_ptr
+BinaryColumn::use()
+{
+    if (mBlob)
+    {
+        return soci::use(*mBlob);
+    }
+    return soci::use(mHex);
+}
+
+soci::details::into_type_ptr
+BinaryColumn::into()
+{
+    if (mBlob)
+    {
+        return soci::into(*mBlob);
+    }
+    return soci::into(mHex);
+}
+
+AccountIDColumn::AccountIDColumn(Database& db)
+    : mBinary(db.hasBinaryAccountIDs())
+{
+    if (mBinary && db.isSqlite())
+    {
+        mBlob = make_unique<soci::blob>(db.getSession());
+    }
+}
+
+void
+AccountIDColumn::set(PublicKey const& key)
+{
+    if (!mBinary)
+    {
+        mText = PubKeyUtils::toStrKey(key);
+    }
+    else if (mBlob)
+    {
+        mBlob->trim(0);
+        mBlob->write(0, reinterpret_cast<char const*>(key.ed25519().data()),
+                     key.ed25519().size());
+    }
+    else
+    {
+        mText = "\\x";
+        mText += binToHex(key.ed25519());
+    }
+}
+
+PublicKey
+AccountIDColumn::get()
+{
+    if (!mBinary)
+    {
+        return PubKeyUtils::fromStrKey(mText);
+    }
+
+    PublicKey key;
+    key.type(KEY_TYPE_ED25519);
+    if (mBlob)
+    {
+        if (mBlob->get_len() != key.ed25519().size())
+        {
+            throw std::runtime_error("unexpected account id size");
+        }
+        mBlob->read(0, reinterpret_cast<char*>(key.ed25519().data()),
+                    key.ed25519().size());
+    }
+    else
+    {
+        if (mText.compare(0, 2, "\\x") != 0)
+        {
+            throw std::runtime_error("unexpected bytea format");
+        }
+        key.ed25519() = hexToBin256(mText.substr(2));
+    }
+    return key;
+}
+
+soci::details::use_type_ptr
+AccountIDColumn::use(std::string const& name)
+{
+    if (mBlob)
+    {
+        return soci::use(*mBlob, name);
+    }
+    return soci::use(mText, name);
+}
+
+soci::details::use_type_ptr
+AccountIDColumn::use(soci::indicator& ind, std::string const& name)
+{
+    if (mBlob)
+    {
+        return soci::use(*mBlob, ind, name);
+    }
+    return soci::use(mText, ind, name);
+}
+
+soci::details::into_type_ptr
+AccountIDColumn::into()
+{
+    if (mBlob)
+    {
+        return soci::into(*mBlob);
+    }
+    return soci::into(mText);
+}
+
+soci::details::into_type_ptr
+AccountIDColumn::into(soci::indicator& ind)
+{
+    if (mBlob)
+    {
+        return soci::into(*mBlob, ind);
+    }
+    return soci::into(mText, ind);
 }
 
 std::shared_ptr<SQLLogContext>
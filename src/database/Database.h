@@ -8,9 +8,13 @@
 #include <set>
 #include <soci.h>
 #include "overlay/StellarXDR.h"
+#include "crypto/ByteSlice.h"
 #include "medida/timer_context.h"
 #include "util/NonCopyable.h"
 #include "util/lrucache.hpp"
+#include "database/EntryCache.h"
+#include "database/OrderBook.h"
+#include "database/ReversedPaymentIndex.h"
 #include "util/Timer.h"
 
 namespace medida
@@ -44,13 +48,7 @@ class StatementContext : NonCopyable
         mStmt = other.mStmt;
         other.mStmt.reset();
     }
-    ~StatementContext()
-    {
-        if (mStmt)
-        {
-            mStmt->clean_up(false);
-        }
-    }
+    ~StatementContext();
     soci::statement&
     statement()
     {
@@ -89,11 +87,26 @@ class Database : NonMovableOrCopyable
     soci::session mSession;
     std::unique_ptr<soci::connection_pool> mPool;
 
-    std::map<std::string, std::shared_ptr<soci::statement>> mStatements;
+    // prepared statements, keyed by query, see getPreparedStatement
+    cache::lru_cache<std::string, std::shared_ptr<soci::statement>>
+        mStatements;
+    size_t const mMaxStatements;
+    medida::Meter& mStatementPrepares;
+    medida::Meter& mStatementHits;
+    medida::Meter& mStatementEvictions;
     medida::Counter& mStatementsSize;
 
-    cache::lru_cache<std::string, std::shared_ptr<LedgerEntry const>>
-        mEntryCache;
+    EntryCache mEntryCache;
+    ReversedPaymentIndex mReversedPaymentIndex;
+    OrderBook mOrderBook;
+
+    // format of the account ids in the ledger entry tables, read from the
+    // persistent state when first needed, see hasBinaryAccountIDs
+    bool mAccountIDFormatKnown;
+    bool mBinaryAccountIDs;
+
+    // see setBatchTransactionOpen
+    bool mBatchTransactionOpen;
 
     // Helpers for maintaining the total query time and calculating
     // idle percentage.
@@ -106,6 +119,7 @@ class Database : NonMovableOrCopyable
     static bool gDriversRegistered;
     static void registerDrivers();
     void applySchemaUpgrade(unsigned long vers);
+    void convertAccountIDsToBinary();
 
   public:
     // Instantiate object and connect to app.getConfig().DATABASE;
@@ -140,10 +154,13 @@ class Database : NonMovableOrCopyable
     // statement handle for the provided query. The prepared statement handle
     // is ceated if necessary before borrowing, and reset (unbound from data)
     // when the statement context is destroyed.
+    // Handles stay open across transactions: the least recently used ones
+    // are closed once there are more than
+    // Config::PREPARED_STATEMENT_CACHE_SIZE of them.
     StatementContext getPreparedStatement(std::string const& query);
 
     // Purge all cached prepared statements, closing their handles with the
-    // database.
+    // database. Only needed before schema changes.
     void clearPreparedStatementCache();
 
     // Return metric-gathering timers for various families of SQL operation.
@@ -159,9 +176,24 @@ class Database : NonMovableOrCopyable
     // only as long as the current SQL transaction.
     void setCurrentTransactionReadOnly();
 
+    // Record that a transaction of the main connection stays open across
+    // events (see ApplyLedgerChainWork): the transactions begun meanwhile
+    // are savepoints within it, and marking one of them read-only would mark
+    // the whole batch, so setCurrentTransactionReadOnly does nothing.
+    void setBatchTransactionOpen(bool open);
+
     // Return true if the Database target is SQLite, otherwise false.
     bool isSqlite() const;
 
+    // Return true if the ledger entry tables store account ids, signers and
+    // issuers as the 32 bytes of their keys rather than as StrKeys, see
+    // Config::BINARY_ACCOUNT_IDS and AccountIDColumn.
+    bool hasBinaryAccountIDs();
+
+    // Return `createStatement` with the VARCHAR(56) account id columns it
+    // declares in the type they are stored as.
+    std::string withAccountIDType(std::string const& createStatement);
+
     // Return true if a connection pool is available for worker threads
     // to read from the database through, otherwise false.
     bool canUsePool() const;
@@ -192,9 +224,64 @@ class Database : NonMovableOrCopyable
     // Access the LedgerEntry cache. Note: clients are responsible for
     // invalidating entries in this cache as they perform statements
     // against the database. It's kept here only for ease of access.
-    typedef cache::lru_cache<std::string, std::shared_ptr<LedgerEntry const>>
-        EntryCache;
     EntryCache& getEntryCache();
+
+    // Access the index of the reversed payment ids, see
+    // ReversedPaymentFrame::exists.
+    ReversedPaymentIndex& getReversedPaymentIndex();
+
+    // Access the in-memory books of offers, see OfferFrame::loadBestOffers.
+    OrderBook& getOrderBook();
+};
+
+/**
+ * Holds the value of a binary column (BLOB on SQLite, BYTEA on PostgreSQL)
+ * exchanged with a statement. SOCI blobs are PostgreSQL large objects rather
+ * than BYTEA values, so on PostgreSQL the bytes go through the bytea hex
+ * format ("\x0a1b...") instead; on SQLite they are bound as they are.
+ */
+class BinaryColumn : NonMovableOrCopyable
+{
+    std::unique_ptr<soci::blob> mBlob;
+    std::string mHex;
+
+  public:
+    BinaryColumn(Database& db, soci::session& sess);
+
+    // sets the value to bind, before executing the statement
+    void set(ByteSlice const& bytes);
+    // gets the value fetched last
+    void get(std::vector<uint8_t>& bytes);
+
+    soci::details::use_type_ptr use();
+    soci::details::into_type_ptr into();
+};
+
+/**
+ * Holds an account id, signer or issuer exchanged with a statement on the
+ * main session, in the format of the database: a StrKey, or the 32 bytes of
+ * the key in a binary column, see Database::hasBinaryAccountIDs.
+ */
+class AccountIDColumn : NonMovableOrCopyable
+{
+    bool mBinary;
+    std::unique_ptr<soci::blob> mBlob;
+    // the StrKey, or the bytea hex format on PostgreSQL
+    std::string mText;
+
+  public:
+    explicit AccountIDColumn(Database& db);
+
+    // sets the value to bind, before executing the statement
+    void set(PublicKey const& key);
+    // gets the value fetched last
+    PublicKey get();
+
+    soci::details::use_type_ptr use(std::string const& name = std::string());
+    soci::details::use_type_ptr use(soci::indicator& ind,
+                                    std::string const& name = std::string());
+    soci::details::into_type_ptr into();
+    soci::details::into_type_ptr into(soci::indicator& ind);
 };
 
 class DBTimeExcluder : NonCopyable
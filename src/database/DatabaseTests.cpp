@@ -4,14 +4,31 @@
 
 #include "util/asio.h"
 #include "database/Database.h"
+#include "database/EntryCache.h"
+#include "database/OrderBook.h"
+#include "database/ReversedPaymentIndex.h"
+#include "ledger/AccountFrame.h"
+#include "ledger/EntryFrame.h"
+#include "ledger/LedgerDelta.h"
+#include "ledger/LedgerManager.h"
+#include "ledger/LedgerTestUtils.h"
+#include "ledger/OfferFrame.h"
+#include "ledger/ReversedPaymentFrame.h"
 #include "main/Application.h"
 #include "main/Config.h"
 #include "main/test.h"
+#include "transactions/TransactionFrame.h"
 #include "crypto/Hex.h"
+#include "crypto/SHA.h"
+#include "crypto/SecretKey.h"
 #include "util/Logging.h"
 #include "util/Timer.h"
 #include "util/TmpDir.h"
+#include "util/basen.h"
 #include "lib/catch.hpp"
+#include "medida/meter.h"
+#include "medida/metrics_registry.h"
+#include <algorithm>
 #include <random>
 
 using namespace stellar;
@@ -339,3 +356,491 @@ TEST_CASE("schema test", "[db]")
     auto av = db.getAppSchemaVersion();
     REQUIRE(dbv == av);
 }
+
+TEST_CASE("entry cache", "[db][entrycache]")
+{
+    medida::MetricsRegistry metrics;
+    EntryCache cache(2, metrics);
+
+    std::vector<LedgerEntry> entries;
+    std::vector<LedgerKey> keys;
+    while (entries.size() < 3)
+    {
+        auto e = LedgerTestUtils::generateValidLedgerEntry(3);
+        auto k = LedgerEntryKey(e);
+        if (std::find_if(keys.begin(), keys.end(), [&](LedgerKey const& o)
+                         {
+                             return LedgerKeyEqual()(k, o);
+                         }) == keys.end())
+        {
+            entries.push_back(e);
+            keys.push_back(k);
+        }
+    }
+
+    auto key0 = keys[0];
+    REQUIRE(LedgerKeyHash()(key0) == LedgerKeyHash()(keys[0]));
+
+    EntryCache::EntryPtr p;
+    REQUIRE(!cache.get(keys[0], p));
+    cache.put(keys[0], std::make_shared<LedgerEntry const>(entries[0]));
+    cache.put(keys[1], nullptr);
+    REQUIRE(cache.size() == 2);
+
+    REQUIRE(cache.get(keys[0], p));
+    REQUIRE(p);
+    REQUIRE(LedgerKeyEqual()(LedgerEntryKey(*p), keys[0]));
+    // absent entries are cached too
+    REQUIRE(cache.get(keys[1], p));
+    REQUIRE(!p);
+
+    // keys[0] is now the least recently used
+    REQUIRE(cache.get(keys[1], p));
+    cache.put(keys[2], std::make_shared<LedgerEntry const>(entries[2]));
+    REQUIRE(cache.size() == 2);
+    REQUIRE(!cache.exists(keys[0]));
+    REQUIRE(cache.exists(keys[1]));
+    REQUIRE(cache.exists(keys[2]));
+
+    cache.erase(keys[1]);
+    REQUIRE(!cache.exists(keys[1]));
+    REQUIRE(cache.size() == 1);
+
+    auto& hit = metrics.NewMeter({"database", "entry-cache", "hit"}, "entry");
+    auto& miss = metrics.NewMeter({"database", "entry-cache", "miss"}, "entry");
+    auto& evict =
+        metrics.NewMeter({"database", "entry-cache", "evict"}, "entry");
+    REQUIRE(hit.count() == 3);
+    REQUIRE(miss.count() == 1);
+    REQUIRE(evict.count() == 1);
+}
+
+TEST_CASE("reversed payment index", "[db][reversedpayment]")
+{
+    SECTION("runs")
+    {
+        medida::MetricsRegistry metrics;
+        ReversedPaymentIndex index(metrics);
+
+        // cold until loaded
+        index.insert(1);
+        REQUIRE(index.lookup(1) == ReversedPaymentIndex::UNKNOWN);
+
+        index.load({5, 3, 3});
+        REQUIRE(index.size() == 2);
+        REQUIRE(index.lookup(3) == ReversedPaymentIndex::PRESENT);
+        REQUIRE(index.lookup(1) == ReversedPaymentIndex::ABSENT);
+
+        // enough to be merged a few times
+        for (int64 id = 100; id < 10100; id += 2)
+        {
+            index.insert(id);
+        }
+        REQUIRE(index.size() == 5002);
+        for (int64 id = 99; id < 10100; id++)
+        {
+            REQUIRE(index.lookup(id) == (id % 2 == 0
+                                             ? ReversedPaymentIndex::PRESENT
+                                             : ReversedPaymentIndex::ABSENT));
+        }
+
+        index.erase(3);
+        index.forget(200);
+        index.forget(201);
+        REQUIRE(index.lookup(3) == ReversedPaymentIndex::ABSENT);
+        REQUIRE(index.lookup(200) == ReversedPaymentIndex::UNKNOWN);
+        REQUIRE(index.lookup(201) == ReversedPaymentIndex::UNKNOWN);
+        index.insert(201);
+        REQUIRE(index.lookup(201) == ReversedPaymentIndex::PRESENT);
+        REQUIRE(index.size() == 5001);
+    }
+
+    SECTION("in sync with the database")
+    {
+        VirtualClock clock;
+        Application::pointer app =
+            Application::create(clock, getTestConfig());
+        app->start();
+        auto& db = app->getDatabase();
+        auto& index = db.getReversedPaymentIndex();
+        REQUIRE(index.isLoaded());
+
+        auto keyOf = [](int64 id)
+        {
+            LedgerKey key;
+            key.type(REVERSED_PAYMENT);
+            key.reversedPayment().rID = id;
+            return key;
+        };
+        auto add = [&](LedgerDelta& delta, int64 id)
+        {
+            ReversedPaymentFrame rp;
+            rp.getReversedPayment().rID = id;
+            rp.storeAdd(delta, db);
+        };
+
+        LedgerDelta delta(app->getLedgerManager().getCurrentLedgerHeader(),
+                          db);
+        add(delta, 1);
+        {
+            LedgerDelta inner(delta);
+            add(inner, 2);
+            inner.commit();
+        }
+        {
+            soci::transaction sqlTx(db.getSession());
+            LedgerDelta inner(delta);
+            add(inner, 3);
+            REQUIRE(ReversedPaymentFrame::exists(db, keyOf(3)));
+        }
+        // rolled back: the database is queried again
+        REQUIRE(index.lookup(3) == ReversedPaymentIndex::UNKNOWN);
+        REQUIRE(!ReversedPaymentFrame::exists(db, keyOf(3)));
+        REQUIRE(index.lookup(3) == ReversedPaymentIndex::ABSENT);
+
+        ReversedPaymentFrame::storeDelete(delta, db, keyOf(1));
+        REQUIRE(!ReversedPaymentFrame::exists(db, keyOf(1)));
+        REQUIRE(ReversedPaymentFrame::exists(db, keyOf(2)));
+        delta.commit();
+
+        ReversedPaymentFrame::loadIndex(db);
+        REQUIRE(index.size() == 1);
+        REQUIRE(index.lookup(1) == ReversedPaymentIndex::ABSENT);
+        REQUIRE(index.lookup(2) == ReversedPaymentIndex::PRESENT);
+    }
+}
+
+TEST_CASE("order book", "[db][offer]")
+{
+    Asset cad, eur;
+    cad.type(ASSET_TYPE_CREDIT_ALPHANUM4);
+    strToAssetCode(cad.alphaNum4().assetCode, "CAD");
+    cad.alphaNum4().issuer = SecretKey::random().getPublicKey();
+    eur.type(ASSET_TYPE_CREDIT_ALPHANUM4);
+    strToAssetCode(eur.alphaNum4().assetCode, "EUR");
+    eur.alphaNum4().issuer = SecretKey::random().getPublicKey();
+    auto seller = SecretKey::random().getPublicKey();
+
+    auto makeOffer = [&](uint64 id, int32_t n, int32_t d)
+    {
+        LedgerEntry le;
+        le.lastModifiedLedgerSeq = 1;
+        le.data.type(OFFER);
+        auto& oe = le.data.offer();
+        oe.sellerID = seller;
+        oe.offerID = id;
+        oe.selling = cad;
+        oe.buying = eur;
+        oe.amount = 100;
+        oe.price.n = n;
+        oe.price.d = d;
+        return le;
+    };
+    auto ids = [](std::vector<OrderBook::EntryPtr> const& offers)
+    {
+        std::vector<uint64> res;
+        for (auto const& of : offers)
+        {
+            res.emplace_back(of->data.offer().offerID);
+        }
+        return res;
+    };
+
+    SECTION("books")
+    {
+        medida::MetricsRegistry metrics;
+        OrderBook book(metrics);
+        std::vector<OrderBook::EntryPtr> offers;
+
+        // nothing loaded, nothing recorded
+        book.put(makeOffer(1, 2, 1));
+        REQUIRE(!book.contains(1));
+        REQUIRE(!book.getBestOffers(cad, eur, 5, 0, offers));
+
+        book.load(cad, eur,
+                  {std::make_shared<LedgerEntry const>(makeOffer(1, 2, 1)),
+                   std::make_shared<LedgerEntry const>(makeOffer(2, 1, 1)),
+                   std::make_shared<LedgerEntry const>(makeOffer(3, 4, 2))});
+        REQUIRE(book.isLoaded(cad, eur));
+        REQUIRE(!book.isLoaded(eur, cad));
+        REQUIRE(book.size() == 3);
+
+        // by price, then by id
+        REQUIRE(book.getBestOffers(cad, eur, 5, 0, offers));
+        REQUIRE(ids(offers) == std::vector<uint64>({2, 1, 3}));
+        offers.clear();
+        REQUIRE(book.getBestOffers(cad, eur, 1, 1, offers));
+        REQUIRE(ids(offers) == std::vector<uint64>({1}));
+
+        book.put(makeOffer(2, 3, 1));
+        book.put(makeOffer(4, 1, 2));
+        book.erase(1);
+        offers.clear();
+        REQUIRE(book.getBestOffers(cad, eur, 5, 0, offers));
+        REQUIRE(ids(offers) == std::vector<uint64>({4, 3, 2}));
+        REQUIRE(!book.contains(1));
+
+        // moved to a pair not loaded
+        auto moved = makeOffer(4, 1, 2);
+        moved.data.offer().buying.type(ASSET_TYPE_NATIVE);
+        book.put(moved);
+        REQUIRE(!book.contains(4));
+        REQUIRE(book.size() == 2);
+
+        book.forget(3);
+        REQUIRE(!book.isLoaded(cad, eur));
+        REQUIRE(!book.contains(2));
+        REQUIRE(book.size() == 0);
+    }
+
+    SECTION("in sync with the database")
+    {
+        VirtualClock clock;
+        Application::pointer app =
+            Application::create(clock, getTestConfig());
+        app->start();
+        auto& db = app->getDatabase();
+        auto& book = db.getOrderBook();
+
+        auto best = [&]()
+        {
+            std::vector<OfferFrame::pointer> offers;
+            OfferFrame::loadBestOffers(10, 0, cad, eur, offers, db);
+            std::vector<uint64> res;
+            for (auto const& of : offers)
+            {
+                res.emplace_back(of->getOfferID());
+            }
+            return res;
+        };
+        auto add = [&](LedgerDelta& delta, uint64 id, int32_t n, int32_t d)
+        {
+            OfferFrame offer(makeOffer(id, n, d));
+            offer.storeAdd(delta, db);
+        };
+
+        LedgerDelta delta(app->getLedgerManager().getCurrentLedgerHeader(),
+                          db);
+        add(delta, 1, 2, 1);
+        REQUIRE(!book.isLoaded(cad, eur));
+        REQUIRE(best() == std::vector<uint64>({1}));
+        REQUIRE(book.isLoaded(cad, eur));
+
+        {
+            LedgerDelta inner(delta);
+            add(inner, 2, 1, 1);
+            inner.commit();
+        }
+        {
+            soci::transaction sqlTx(db.getSession());
+            LedgerDelta inner(delta);
+            add(inner, 3, 1, 2);
+            REQUIRE(best() == std::vector<uint64>({3, 2, 1}));
+        }
+        // rolled back: the book is loaded again
+        REQUIRE(!book.isLoaded(cad, eur));
+        REQUIRE(best() == std::vector<uint64>({2, 1}));
+
+        OfferFrame::storeDelete(delta, db, LedgerEntryKey(makeOffer(2, 1, 1)));
+        REQUIRE(best() == std::vector<uint64>({1}));
+        REQUIRE_NOTHROW(OfferFrame::checkOrderBook(cad, eur, db));
+        delta.commit();
+
+        OfferFrame::loadOrderBook(db);
+        REQUIRE(book.isLoaded(cad, eur));
+        REQUIRE(book.size() == 1);
+        REQUIRE(book.contains(1));
+    }
+}
+
+TEST_CASE("prepared statement cache", "[db]")
+{
+    Config cfg = getTestConfig();
+    cfg.PREPARED_STATEMENT_CACHE_SIZE = 2;
+    VirtualClock clock;
+    Application::pointer app = Application::create(clock, cfg);
+    auto& db = app->getDatabase();
+    auto& session = db.getSession();
+
+    session << "DROP TABLE IF EXISTS test";
+    session << "CREATE TABLE test (x INTEGER)";
+    session << "INSERT INTO test (x) VALUES (1)";
+    session << "INSERT INTO test (x) VALUES (2)";
+
+    auto& metrics = app->getMetrics();
+    auto& prepares =
+        metrics.NewMeter({"database", "statement", "prepare"}, "statement");
+    auto& hits =
+        metrics.NewMeter({"database", "statement", "hit"}, "statement");
+    auto& evictions =
+        metrics.NewMeter({"database", "statement", "evict"}, "statement");
+    auto prepares0 = prepares.count();
+    auto hits0 = hits.count();
+    auto evictions0 = evictions.count();
+
+    auto select = [&](std::string const& query)
+    {
+        int x = 0;
+        auto prep = db.getPreparedStatement(query);
+        auto& st = prep.statement();
+        st.exchange(soci::into(x));
+        st.define_and_bind();
+        st.execute(true);
+        REQUIRE(st.got_data());
+        return x;
+    };
+
+    // statements survive transactions
+    for (int i = 0; i < 3; i++)
+    {
+        soci::transaction tx(session);
+        REQUIRE(select("SELECT x FROM test ORDER BY x") == 1);
+        tx.commit();
+    }
+    REQUIRE(prepares.count() - prepares0 == 1);
+    REQUIRE(hits.count() - hits0 == 2);
+
+    REQUIRE(select("SELECT x FROM test ORDER BY x DESC") == 2);
+    REQUIRE(select("SELECT count(*) FROM test") == 2);
+    REQUIRE(evictions.count() - evictions0 == 1);
+    REQUIRE(prepares.count() - prepares0 == 3);
+
+    // the cached statements were only partially stepped through, this
+    // shouldn't hold the table
+    session << "DROP TABLE test";
+}
+
+TEST_CASE("txhistory upgrade to binary", "[db]")
+{
+    Config const& cfg = getTestConfig();
+    VirtualClock clock;
+    Application::pointer app = Application::create(clock, cfg);
+    auto& db = app->getDatabase();
+    auto& session = db.getSession();
+
+    // recreate the tables as they were before the upgrade
+    TransactionFrame::dropAll(db);
+
+    TransactionResultPair result;
+    result.transactionHash = sha256("tx");
+    result.result.feeCharged = 100;
+    result.result.result.code(txSUCCESS);
+    std::string result64 = bn::encode_b64(xdr::xdr_to_opaque(result));
+
+    LedgerEntryChanges changes(1);
+    changes[0].type(LEDGER_ENTRY_STATE);
+    changes[0].state() = LedgerTestUtils::generateValidLedgerEntry();
+    std::string changes64 = bn::encode_b64(xdr::xdr_to_opaque(changes));
+
+    std::string txid(64, 'a');
+    std::string body64 = bn::encode_b64(std::string("body"));
+    session << "INSERT INTO txhistory "
+               "(txid, ledgerseq, txindex, txbody, txresult, txmeta) VALUES "
+               "(:id, 5, 1, :txb, :txres, :meta)",
+        soci::use(txid), soci::use(body64), soci::use(result64),
+        soci::use(body64);
+    session << "INSERT INTO txfeehistory "
+               "(txid, ledgerseq, txindex, txchanges) VALUES "
+               "(:id, 5, 1, :txchanges)",
+        soci::use(txid), soci::use(changes64);
+
+    TransactionFrame::upgradeHistoryToBinary(db);
+
+    auto results = TransactionFrame::getTransactionHistoryResults(db, 5);
+    REQUIRE(results.results.size() == 1);
+    REQUIRE(xdr::xdr_to_opaque(results.results[0]) ==
+            xdr::xdr_to_opaque(result));
+
+    auto fees = TransactionFrame::getTransactionFeeMeta(db, 5);
+    REQUIRE(fees.size() == 1);
+    REQUIRE(xdr::xdr_to_opaque(fees[0]) == xdr::xdr_to_opaque(changes));
+
+    // new rows go in as binary and come back unchanged
+    BinaryColumn body(db, session);
+    std::vector<uint8_t> raw{0, 1, 0, 0xff};
+    body.set(raw);
+    session << "UPDATE txhistory SET txbody = :txb", body.use();
+
+    std::vector<uint8_t> read;
+    session << "SELECT txbody FROM txhistory", body.into();
+    body.get(read);
+    REQUIRE(read == raw);
+}
+
+TEST_CASE("account ids upgrade to binary", "[db]")
+{
+    Config cfg(getTestConfig());
+    cfg.BINARY_ACCOUNT_IDS = true;
+    VirtualClock clock;
+    Application::pointer app = Application::create(clock, cfg);
+    auto& db = app->getDatabase();
+    REQUIRE(!db.hasBinaryAccountIDs());
+
+    // entries stored as StrKeys, before the schema upgrades run; some of the
+    // accounts tie on their inflation votes
+    std::vector<EntryFrame::pointer> entries;
+    {
+        LedgerDelta delta(app->getLedgerManager().getCurrentLedgerHeader(),
+                          db);
+        int voters = 0;
+        while (entries.size() < 100)
+        {
+            auto le = EntryFrame::FromXDR(
+                LedgerTestUtils::generateValidLedgerEntry(3));
+            auto type = le->mEntry.data.type();
+            if ((type != ACCOUNT && type != TRUSTLINE && type != OFFER) ||
+                EntryFrame::exists(db, le->getKey()))
+            {
+                continue;
+            }
+            if (type == ACCOUNT && voters++ < 10)
+            {
+                auto& account = le->mEntry.data.account();
+                account.balance = 1000000000;
+                account.inflationDest.activate() =
+                    SecretKey::random().getPublicKey();
+            }
+            le->storeAdd(delta, db);
+            entries.push_back(le);
+        }
+        delta.commit();
+    }
+
+    auto winners = [&]()
+    {
+        std::vector<std::string> res;
+        AccountFrame::processForInflation(
+            [&res](AccountFrame::InflationVotes const& votes)
+            {
+                res.push_back(PubKeyUtils::toStrKey(votes.mInflationDest));
+                return true;
+            },
+            5, db);
+        return res;
+    };
+    auto strKeyWinners = winners();
+    REQUIRE(strKeyWinners.size() == 5);
+
+    app->start();
+    REQUIRE(db.hasBinaryAccountIDs());
+    db.getEntryCache().clear();
+
+    for (auto const& e : entries)
+    {
+        auto loaded = EntryFrame::storeLoad(e->getKey(), db);
+        REQUIRE(loaded);
+        REQUIRE(xdr::xdr_to_opaque(loaded->mEntry) ==
+                xdr::xdr_to_opaque(e->mEntry));
+    }
+    REQUIRE_NOTHROW(AccountFrame::checkDB(db));
+    REQUIRE(winners() == strKeyWinners);
+
+    // the raw keys take 32 bytes
+    size_t idLength = 0;
+    db.getSession() << (db.isSqlite()
+                            ? "SELECT length(accountid) FROM accounts LIMIT 1"
+                            : "SELECT octet_length(accountid) FROM accounts "
+                              "LIMIT 1"),
+        soci::into(idLength);
+    REQUIRE(idLength == 32);
+}
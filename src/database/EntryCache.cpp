@@ -0,0 +1,225 @@
+// Copyright 2017 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "database/EntryCache.h"
+#include "crypto/SecretKey.h"
+#include "medida/counter.h"
+#include "medida/meter.h"
+#include "medida/metrics_registry.h"
+
+namespace stellar
+{
+
+using xdr::operator==;
+
+namespace
+{
+void
+hashCombine(size_t& seed, size_t v)
+{
+    seed ^= v + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+}
+
+template <typename T>
+size_t
+hashBytes(T const& bytes)
+{
+    size_t res = 0;
+    for (auto b : bytes)
+    {
+        res = (res << 8) ^ (res >> (sizeof(size_t) * 8 - 8)) ^ b;
+    }
+    return res;
+}
+
+size_t
+hashAsset(Asset const& asset)
+{
+    size_t res = asset.type();
+    switch (asset.type())
+    {
+    case ASSET_TYPE_CREDIT_ALPHANUM4:
+        hashCombine(res, hashBytes(asset.alphaNum4().assetCode));
+        hashCombine(res,
+                    std::hash<PublicKey>()(asset.alphaNum4().issuer));
+        break;
+    case ASSET_TYPE_CREDIT_ALPHANUM12:
+        hashCombine(res, hashBytes(asset.alphaNum12().assetCode));
+        hashCombine(res,
+                    std::hash<PublicKey>()(asset.alphaNum12().issuer));
+        break;
+    default:
+        break;
+    }
+    return res;
+}
+}
+
+size_t
+LedgerKeyHash::operator()(LedgerKey const& key) const noexcept
+{
+    size_t res = key.type();
+    switch (key.type())
+    {
+    case ACCOUNT:
+        hashCombine(res, std::hash<PublicKey>()(key.account().accountID));
+        break;
+    case TRUSTLINE:
+        hashCombine(res, std::hash<PublicKey>()(key.trustLine().accountID));
+        hashCombine(res, hashAsset(key.trustLine().asset));
+        break;
+    case OFFER:
+        hashCombine(res, std::hash<PublicKey>()(key.offer().sellerID));
+        hashCombine(res, std::hash<uint64>()(key.offer().offerID));
+        break;
+    case DATA:
+        hashCombine(res, std::hash<PublicKey>()(key.data().accountID));
+        hashCombine(res, std::hash<std::string>()(key.data().dataName));
+        break;
+    case REVERSED_PAYMENT:
+        hashCombine(res, std::hash<int64>()(key.reversedPayment().rID));
+        break;
+    }
+    return res;
+}
+
+bool
+LedgerKeyEqual::operator()(LedgerKey const& a, LedgerKey const& b) const
+{
+    return a == b;
+}
+
+EntryCache::EntryCache(size_t maxSize, medida::MetricsRegistry& metrics)
+    : mMaxSize(maxSize)
+    , mHit(metrics.NewMeter({"database", "entry-cache", "hit"}, "entry"))
+    , mMiss(metrics.NewMeter({"database", "entry-cache", "miss"}, "entry"))
+    , mEvict(metrics.NewMeter({"database", "entry-cache", "evict"}, "entry"))
+    , mSize(metrics.NewCounter({"database", "entry-cache", "size"}))
+    , mDirtySize(metrics.NewCounter({"database", "entry-cache", "dirty"}))
+{
+    mIndex.reserve(maxSize + 1);
+}
+
+bool
+EntryCache::get(LedgerKey const& key, EntryPtr& entry)
+{
+    if (!mDirty.empty() && getDirty(key, entry))
+    {
+        mHit.Mark();
+        return true;
+    }
+
+    auto it = mIndex.find(key);
+    if (it == mIndex.end())
+    {
+        mMiss.Mark();
+        return false;
+    }
+    mHit.Mark();
+    mItems.splice(mItems.begin(), mItems, it->second);
+    entry = it->second->second;
+    return true;
+}
+
+bool
+EntryCache::exists(LedgerKey const& key) const
+{
+    return mIndex.find(key) != mIndex.end() ||
+           mDirty.find(key) != mDirty.end();
+}
+
+void
+EntryCache::put(LedgerKey const& key, EntryPtr const& entry)
+{
+    auto it = mIndex.find(key);
+    if (it != mIndex.end())
+    {
+        it->second->second = entry;
+        mItems.splice(mItems.begin(), mItems, it->second);
+        return;
+    }
+
+    mItems.emplace_front(key, entry);
+    mIndex.emplace(mItems.front().first, mItems.begin());
+
+    if (mIndex.size() > mMaxSize)
+    {
+        mIndex.erase(mItems.back().first);
+        mItems.pop_back();
+        mEvict.Mark();
+    }
+    mSize.set_count(mIndex.size());
+}
+
+void
+EntryCache::erase(LedgerKey const& key)
+{
+    auto it = mIndex.find(key);
+    if (it != mIndex.end())
+    {
+        mItems.erase(it->second);
+        mIndex.erase(it);
+        mSize.set_count(mIndex.size());
+    }
+}
+
+void
+EntryCache::clear()
+{
+    mIndex.clear();
+    mItems.clear();
+    mSize.set_count(0);
+}
+
+size_t
+EntryCache::size() const
+{
+    return mIndex.size();
+}
+
+void
+EntryCache::putDirty(LedgerKey const& key, EntryPtr const& entry)
+{
+    // the LRU part holds the value from the database, now stale
+    erase(key);
+    mDirty[key] = entry;
+    mDirtySize.set_count(mDirty.size());
+}
+
+bool
+EntryCache::getDirty(LedgerKey const& key, EntryPtr& entry) const
+{
+    auto it = mDirty.find(key);
+    if (it == mDirty.end())
+    {
+        return false;
+    }
+    entry = it->second;
+    return true;
+}
+
+void
+EntryCache::eraseDirty(LedgerKey const& key)
+{
+    mDirty.erase(key);
+    mDirtySize.set_count(mDirty.size());
+}
+
+EntryCache::DirtyMap const&
+EntryCache::getDirtyEntries() const
+{
+    return mDirty;
+}
+
+void
+EntryCache::markClean()
+{
+    for (auto const& d : mDirty)
+    {
+        put(d.first, d.second);
+    }
+    mDirty.clear();
+    mDirtySize.set_count(0);
+}
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+// Copyright 2017 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "overlay/StellarXDR.h"
+#include "util/NonCopyable.h"
+#include <list>
+#include <memory>
+#include <unordered_map>
+
+namespace medida
+{
+class MetricsRegistry;
+class Meter;
+class Counter;
+}
+
+namespace stellar
+{
+
+// Hash of a LedgerKey computed directly from its fields, without
+// serializing it.
+struct LedgerKeyHash
+{
+    size_t operator()(LedgerKey const& key) const noexcept;
+};
+
+struct LedgerKeyEqual
+{
+    bool operator()(LedgerKey const& a, LedgerKey const& b) const;
+};
+
+/**
+ * LRU cache of ledger entries as found in the database, keyed by LedgerKey.
+ * A null entry records that the key is known not to be in the database.
+ *
+ * On top of the LRU part, the cache holds "dirty" entries: entries written
+ * during ledger close that are not in the database yet (see
+ * LedgerDelta::setWriteBack). Dirty entries shadow the LRU part, are never
+ * evicted and stay until markClean or eraseDirty.
+ *
+ * Lookups don't allocate; insertions allocate one list node and one map
+ * node.
+ */
+class EntryCache : NonMovableOrCopyable
+{
+  public:
+    typedef std::shared_ptr<LedgerEntry const> EntryPtr;
+
+    EntryCache(size_t maxSize, medida::MetricsRegistry& metrics);
+
+    // looks `key` up, marking it as most recently used; returns false on a
+    // miss, otherwise sets `entry` to the cached value
+    bool get(LedgerKey const& key, EntryPtr& entry);
+
+    // returns true if `key` is cached, without touching its position or the
+    // hit/miss metrics
+    bool exists(LedgerKey const& key) const;
+
+    // put and erase only affect the LRU part
+    void put(LedgerKey const& key, EntryPtr const& entry);
+    void erase(LedgerKey const& key);
+    void clear();
+
+    size_t size() const;
+
+    typedef std::unordered_map<LedgerKey, EntryPtr, LedgerKeyHash,
+                               LedgerKeyEqual>
+        DirtyMap;
+
+    // records `entry` (nullptr for a deleted entry) as the current value of
+    // `key`, not written to the database yet
+    void putDirty(LedgerKey const& key, EntryPtr const& entry);
+    // returns false if `key` is not dirty, otherwise sets `entry`
+    bool getDirty(LedgerKey const& key, EntryPtr& entry) const;
+    void eraseDirty(LedgerKey const& key);
+    DirtyMap const& getDirtyEntries() const;
+    // to be called once the dirty entries are written to the database:
+    // moves them to the LRU part
+    void markClean();
+
+  private:
+    typedef std::pair<LedgerKey, EntryPtr> Item;
+    typedef std::list<Item> ItemList;
+
+    size_t const mMaxSize;
+    ItemList mItems;
+    std::unordered_map<LedgerKey, ItemList::iterator, LedgerKeyHash,
+                       LedgerKeyEqual>
+        mIndex;
+    DirtyMap mDirty;
+
+    medida::Meter& mHit;
+    medida::Meter& mMiss;
+    medida::Meter& mEvict;
+    medida::Counter& mSize;
+    medida::Counter& mDirtySize;
+};
+}
@@ -0,0 +1,204 @@
+// Copyright 2017 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "database/OrderBook.h"
+#include "medida/counter.h"
+#include "medida/meter.h"
+#include "medida/metrics_registry.h"
+#include <iterator>
+
+namespace stellar
+{
+using xdr::operator<;
+
+namespace
+{
+// the value of the price column
+double
+offerPrice(OfferEntry const& offer)
+{
+    return double(offer.price.n) / double(offer.price.d);
+}
+}
+
+bool
+OrderBook::AssetPairLess::operator()(AssetPair const& a,
+                                     AssetPair const& b) const
+{
+    if (a.first < b.first)
+    {
+        return true;
+    }
+    if (b.first < a.first)
+    {
+        return false;
+    }
+    return a.second < b.second;
+}
+
+OrderBook::OrderBook(medida::MetricsRegistry& metrics)
+    : mHit(metrics.NewMeter({"database", "order-book", "hit"}, "lookup"))
+    , mMiss(metrics.NewMeter({"database", "order-book", "miss"}, "lookup"))
+    , mBooksSize(metrics.NewCounter({"database", "order-book", "books"}))
+    , mOffersSize(metrics.NewCounter({"database", "order-book", "offers"}))
+{
+}
+
+bool
+OrderBook::isLoaded(Asset const& selling, Asset const& buying) const
+{
+    return mBooks.find(AssetPair(selling, buying)) != mBooks.end();
+}
+
+void
+OrderBook::load(Asset const& selling, Asset const& buying,
+                std::vector<EntryPtr> const& offers)
+{
+    auto it = mBooks.find(AssetPair(selling, buying));
+    if (it != mBooks.end())
+    {
+        unload(it);
+    }
+    auto& book = mBooks[AssetPair(selling, buying)];
+    for (auto const& offer : offers)
+    {
+        insert(book, offer);
+    }
+    updateMetrics();
+}
+
+void
+OrderBook::load(std::vector<EntryPtr> const& offers)
+{
+    mBooks.clear();
+    mOffers.clear();
+    for (auto const& offer : offers)
+    {
+        auto const& oe = offer->data.offer();
+        insert(mBooks[AssetPair(oe.selling, oe.buying)], offer);
+    }
+    updateMetrics();
+}
+
+bool
+OrderBook::getBestOffers(Asset const& selling, Asset const& buying,
+                         size_t numOffers, size_t offset,
+                         std::vector<EntryPtr>& offers) const
+{
+    auto it = mBooks.find(AssetPair(selling, buying));
+    if (it == mBooks.end())
+    {
+        mMiss.Mark();
+        return false;
+    }
+    mHit.Mark();
+
+    auto const& book = it->second;
+    if (offset >= book.size())
+    {
+        return true;
+    }
+    auto offer = book.begin();
+    std::advance(offer, offset);
+    for (; offer != book.end() && numOffers != 0; ++offer, --numOffers)
+    {
+        offers.emplace_back(offer->second);
+    }
+    return true;
+}
+
+bool
+OrderBook::contains(uint64 offerID) const
+{
+    return mOffers.find(offerID) != mOffers.end();
+}
+
+void
+OrderBook::put(LedgerEntry const& offer)
+{
+    auto const& oe = offer.data.offer();
+    erase(oe.offerID);
+    auto it = mBooks.find(AssetPair(oe.selling, oe.buying));
+    if (it != mBooks.end())
+    {
+        insert(it->second, std::make_shared<LedgerEntry const>(offer));
+        updateMetrics();
+    }
+}
+
+void
+OrderBook::erase(uint64 offerID)
+{
+    auto it = mOffers.find(offerID);
+    if (it != mOffers.end())
+    {
+        it->second.first->erase(it->second.second);
+        mOffers.erase(it);
+        updateMetrics();
+    }
+}
+
+void
+OrderBook::forget(uint64 offerID)
+{
+    auto it = mOffers.find(offerID);
+    if (it != mOffers.end())
+    {
+        // keeps the entry alive while its book is unloaded
+        auto offer = it->second.second->second;
+        forget(offer->data.offer());
+    }
+}
+
+void
+OrderBook::forget(OfferEntry const& offer)
+{
+    auto it = mBooks.find(AssetPair(offer.selling, offer.buying));
+    if (it != mBooks.end())
+    {
+        unload(it);
+        updateMetrics();
+    }
+}
+
+void
+OrderBook::clear()
+{
+    mBooks.clear();
+    mOffers.clear();
+    updateMetrics();
+}
+
+size_t
+OrderBook::size() const
+{
+    return mOffers.size();
+}
+
+void
+OrderBook::insert(Book& book, EntryPtr const& offer)
+{
+    auto const& oe = offer->data.offer();
+    auto res =
+        book.emplace(std::make_pair(offerPrice(oe), oe.offerID), offer);
+    mOffers[oe.offerID] = std::make_pair(&book, res.first);
+}
+
+void
+OrderBook::unload(BookMap::iterator it)
+{
+    for (auto const& offer : it->second)
+    {
+        mOffers.erase(offer.first.second);
+    }
+    mBooks.erase(it);
+}
+
+void
+OrderBook::updateMetrics()
+{
+    mBooksSize.set_count(mBooks.size());
+    mOffersSize.set_count(mOffers.size());
+}
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+// Copyright 2017 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "overlay/StellarXDR.h"
+#include "util/NonCopyable.h"
+#include <map>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace medida
+{
+class MetricsRegistry;
+class Meter;
+class Counter;
+}
+
+namespace stellar
+{
+
+/**
+ * In-memory copy of the offers table, in front of OfferFrame::loadBestOffers:
+ * crossing offers reads the next offers of a book from memory instead of
+ * querying the database for every page of them.
+ *
+ * There is one book per (selling, buying) asset pair, its offers ordered as
+ * the query orders them: by price (n/d as a double, like the price column),
+ * then by offer id, older offers first.
+ *
+ * Books are loaded a pair at a time, by OfferFrame::loadBestOffers the first
+ * time the pair is crossed, or all at once when the application starts. A
+ * loaded book follows the inserts, updates and deletes of OfferFrame; the
+ * pairs not loaded are left alone. Like the reversed payment index, the book
+ * can't tell whether a rolled back change is still in the database, so
+ * LedgerDelta::rollback forgets the books of the offers it touched: they are
+ * loaded again the next time they are crossed.
+ */
+class OrderBook : NonMovableOrCopyable
+{
+  public:
+    typedef std::shared_ptr<LedgerEntry const> EntryPtr;
+
+    // (selling, buying)
+    typedef std::pair<Asset, Asset> AssetPair;
+    struct AssetPairLess
+    {
+        bool operator()(AssetPair const& a, AssetPair const& b) const;
+    };
+
+    explicit OrderBook(medida::MetricsRegistry& metrics);
+
+    bool isLoaded(Asset const& selling, Asset const& buying) const;
+
+    // replaces the book of a pair by `offers`, all the offers of the pair
+    void load(Asset const& selling, Asset const& buying,
+              std::vector<EntryPtr> const& offers);
+    // replaces the content of the order book by `offers`, all the offers of
+    // the table: every pair with an offer is loaded
+    void load(std::vector<EntryPtr> const& offers);
+
+    // appends to `offers` up to `numOffers` offers of the book of a pair,
+    // best first, skipping the `offset` first ones; false if the book isn't
+    // loaded
+    bool getBestOffers(Asset const& selling, Asset const& buying,
+                       size_t numOffers, size_t offset,
+                       std::vector<EntryPtr>& offers) const;
+
+    // true if the offer is in one of the loaded books
+    bool contains(uint64 offerID) const;
+
+    // record what is known of an offer; no-ops for the pairs not loaded
+    void put(LedgerEntry const& offer);
+    void erase(uint64 offerID);
+
+    // unloads the book holding the offer, if any
+    void forget(uint64 offerID);
+    // unloads the book of the pair of `offer`
+    void forget(OfferEntry const& offer);
+    // unloads every book
+    void clear();
+
+    // number of offers in memory
+    size_t size() const;
+
+  private:
+    // offers of a pair by (price, offer id)
+    typedef std::map<std::pair<double, uint64>, EntryPtr> Book;
+    typedef std::map<AssetPair, Book, AssetPairLess> BookMap;
+
+    BookMap mBooks;
+    // book and position of every offer of the loaded books
+    std::unordered_map<uint64, std::pair<Book*, Book::iterator>> mOffers;
+
+    medida::Meter& mHit;
+    medida::Meter& mMiss;
+    medida::Counter& mBooksSize;
+    medida::Counter& mOffersSize;
+
+    void insert(Book& book, EntryPtr const& offer);
+    void unload(BookMap::iterator it);
+    void updateMetrics();
+};
+}
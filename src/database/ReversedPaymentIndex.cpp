@@ -0,0 +1,161 @@
+// Copyright 2017 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "database/ReversedPaymentIndex.h"
+#include "medida/counter.h"
+#include "medida/meter.h"
+#include "medida/metrics_registry.h"
+#include <algorithm>
+
+namespace stellar
+{
+
+size_t const ReversedPaymentIndex::MIN_MERGE_SIZE = 1024;
+size_t const ReversedPaymentIndex::MERGE_RATIO = 16;
+
+ReversedPaymentIndex::ReversedPaymentIndex(medida::MetricsRegistry& metrics)
+    : mLoaded(false)
+    , mPresent(metrics.NewMeter(
+          {"database", "reversed-payment-index", "present"}, "lookup"))
+    , mAbsent(metrics.NewMeter(
+          {"database", "reversed-payment-index", "absent"}, "lookup"))
+    , mUnknown(metrics.NewMeter(
+          {"database", "reversed-payment-index", "unknown"}, "lookup"))
+    , mSize(metrics.NewCounter({"database", "reversed-payment-index", "size"}))
+    , mMemory(
+          metrics.NewCounter({"database", "reversed-payment-index", "bytes"}))
+{
+}
+
+bool
+ReversedPaymentIndex::isLoaded() const
+{
+    return mLoaded;
+}
+
+void
+ReversedPaymentIndex::load(std::vector<int64> ids)
+{
+    std::sort(ids.begin(), ids.end());
+    ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+    ids.shrink_to_fit();
+    mIds = std::move(ids);
+    mInserted.clear();
+    mForgotten.clear();
+    mLoaded = true;
+    updateMetrics();
+}
+
+void
+ReversedPaymentIndex::clear()
+{
+    load(std::vector<int64>());
+}
+
+ReversedPaymentIndex::Lookup
+ReversedPaymentIndex::lookup(int64 id) const
+{
+    if (!mLoaded || (!mForgotten.empty() && mForgotten.count(id) != 0))
+    {
+        mUnknown.Mark();
+        return UNKNOWN;
+    }
+    if (std::binary_search(mInserted.begin(), mInserted.end(), id) ||
+        std::binary_search(mIds.begin(), mIds.end(), id))
+    {
+        mPresent.Mark();
+        return PRESENT;
+    }
+    mAbsent.Mark();
+    return ABSENT;
+}
+
+void
+ReversedPaymentIndex::insert(int64 id)
+{
+    if (!mLoaded)
+    {
+        return;
+    }
+    mForgotten.erase(id);
+
+    if (std::binary_search(mIds.begin(), mIds.end(), id))
+    {
+        return;
+    }
+    auto it = std::lower_bound(mInserted.begin(), mInserted.end(), id);
+    if (it != mInserted.end() && *it == id)
+    {
+        return;
+    }
+    mInserted.insert(it, id);
+
+    if (mInserted.size() > std::max(MIN_MERGE_SIZE, mIds.size() / MERGE_RATIO))
+    {
+        auto middle = mIds.size();
+        mIds.insert(mIds.end(), mInserted.begin(), mInserted.end());
+        std::inplace_merge(mIds.begin(), mIds.begin() + middle, mIds.end());
+        mInserted.clear();
+    }
+    updateMetrics();
+}
+
+void
+ReversedPaymentIndex::erase(int64 id)
+{
+    if (!mLoaded)
+    {
+        return;
+    }
+    mForgotten.erase(id);
+    eraseFromRuns(id);
+    updateMetrics();
+}
+
+void
+ReversedPaymentIndex::forget(int64 id)
+{
+    if (!mLoaded)
+    {
+        return;
+    }
+    eraseFromRuns(id);
+    mForgotten.insert(id);
+    updateMetrics();
+}
+
+size_t
+ReversedPaymentIndex::size() const
+{
+    return mIds.size() + mInserted.size();
+}
+
+bool
+ReversedPaymentIndex::eraseFromRuns(int64 id)
+{
+    auto it = std::lower_bound(mInserted.begin(), mInserted.end(), id);
+    if (it != mInserted.end() && *it == id)
+    {
+        mInserted.erase(it);
+        return true;
+    }
+    it = std::lower_bound(mIds.begin(), mIds.end(), id);
+    if (it != mIds.end() && *it == id)
+    {
+        mIds.erase(it);
+        return true;
+    }
+    return false;
+}
+
+void
+ReversedPaymentIndex::updateMetrics()
+{
+    mSize.set_count(size());
+    // the forgotten ids are few, their nodes are not accounted for
+    mMemory.set_count((mIds.capacity() + mInserted.capacity() +
+                       mForgotten.size()) *
+                      sizeof(int64));
+}
+}
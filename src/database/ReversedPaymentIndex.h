@@ -0,0 +1,87 @@
+#pragma once
+
+// Copyright 2017 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "overlay/StellarXDR.h"
+#include "util/NonCopyable.h"
+#include <unordered_set>
+#include <vector>
+
+namespace medida
+{
+class MetricsRegistry;
+class Meter;
+class Counter;
+}
+
+namespace stellar
+{
+
+/**
+ * In-memory set of the ids of the reversed_payment table, in front of
+ * ReversedPaymentFrame::exists: finding out whether a payment was already
+ * reversed is a binary search rather than a query.
+ *
+ * The ids are kept in two sorted arrays, 8 bytes per id: a large one, filled
+ * by load(), and a small one taking the insertions, merged into the large one
+ * once it grows beyond a fraction of it.
+ *
+ * The index is cold until load() or clear(): every lookup is then UNKNOWN
+ * and callers query the database. Once loaded, it follows the inserts and
+ * deletes of ReversedPaymentFrame. Like the entry cache, it can't tell
+ * whether a rolled back change is still in the database (tests roll back
+ * deltas whose statements were committed), so the ids of the rolled back
+ * entries are forgotten instead: they are UNKNOWN until the database is
+ * queried for them.
+ */
+class ReversedPaymentIndex : NonMovableOrCopyable
+{
+  public:
+    enum Lookup
+    {
+        ABSENT,
+        PRESENT,
+        UNKNOWN
+    };
+
+    explicit ReversedPaymentIndex(medida::MetricsRegistry& metrics);
+
+    bool isLoaded() const;
+
+    // replaces the content of the index by `ids`, all the ids of the table
+    void load(std::vector<int64> ids);
+    // the table is empty
+    void clear();
+
+    Lookup lookup(int64 id) const;
+
+    // record what is known of `id`; no-ops while the index is cold
+    void insert(int64 id);
+    void erase(int64 id);
+    void forget(int64 id);
+
+    size_t size() const;
+
+  private:
+    // insertions merged into mIds once there are more than
+    // max(MIN_MERGE_SIZE, mIds.size() / MERGE_RATIO) of them
+    static size_t const MIN_MERGE_SIZE;
+    static size_t const MERGE_RATIO;
+
+    bool mLoaded;
+    std::vector<int64> mIds;
+    std::vector<int64> mInserted;
+    std::unordered_set<int64> mForgotten;
+
+    medida::Meter& mPresent;
+    medida::Meter& mAbsent;
+    medida::Meter& mUnknown;
+    medida::Counter& mSize;
+    medida::Counter& mMemory;
+
+    bool eraseFromRuns(int64 id);
+    void updateMetrics();
+};
+}
@@ -126,6 +126,13 @@ class Herder
     virtual void dumpQuorumInfo(Json::Value& ret, NodeID const& id,
                                 bool summary, uint64 index = 0) = 0;
 
+    // writes the SCP messages externalizing `ledgerSeq` and the quorum sets
+    // they refer to, through `sess`, within a transaction of the caller;
+    // replaces any previous messages of that ledger
+    static void storeSCPHistory(Database& db, soci::session& sess,
+                                uint32_t ledgerSeq,
+                                xdr::xvector<SCPEnvelope> const& envelopes,
+                                xdr::xvector<SCPQuorumSet> const& qSets);
     static size_t copySCPHistoryToStream(Database& db, soci::session& sess,
                                          uint32_t ledgerSeq,
                                          uint32_t ledgerCount,
@@ -7,6 +7,8 @@
 #include "crypto/SHA.h"
 #include "herder/TxSetFrame.h"
 #include "herder/LedgerCloseData.h"
+#include "history/HistoryManager.h"
+#include "history/HistoryWriter.h"
 #include "ledger/LedgerManager.h"
 #include "main/Application.h"
 #include "main/Config.h"
@@ -27,6 +29,7 @@
 #include "util/XDRStream.h"
 
 #include <ctime>
+#include <unordered_set>
 
 using namespace std;
 using namespace soci;
@@ -1684,103 +1687,99 @@ HerderImpl::saveSCPHistory(uint64 index)
     auto envs = mSCP.getExternalizingState(seq);
     if (!envs.empty())
     {
-        std::unordered_map<Hash, SCPQuorumSetPtr> usedQSets;
+        std::unordered_set<Hash> usedQSets;
+        xdr::xvector<SCPEnvelope> envelopes;
+        xdr::xvector<SCPQuorumSet> qSets;
+        for (auto const& e : envs)
+        {
+            envelopes.emplace_back(e);
+            auto const& qHash =
+                Slot::getCompanionQuorumSetHashFromStatement(e.statement);
+            if (usedQSets.insert(qHash).second)
+            {
+                qSets.emplace_back(*getQSet(qHash));
+            }
+        }
 
         auto& db = mApp.getDatabase();
+        auto& historyWriter = mApp.getHistoryManager().getHistoryWriter();
 
         soci::transaction txscope(db.getSession());
-
+        if (historyWriter.isPipelined())
         {
-            auto prepClean = db.getPreparedStatement(
-                "DELETE FROM scphistory WHERE ledgerseq =:l");
-
-            auto& st = prepClean.statement();
-            st.exchange(use(seq));
-            st.define_and_bind();
-            {
-                auto timer = db.getDeleteTimer("scphistory");
-                st.execute(true);
-            }
+            historyWriter.journalSCPHistory(seq, envelopes, qSets);
+            txscope.commit();
+            historyWriter.submit();
         }
-        for (auto const& e : envs)
+        else
         {
-            auto const& qHash =
-                Slot::getCompanionQuorumSetHashFromStatement(e.statement);
-            usedQSets.insert(std::make_pair(qHash, getQSet(qHash)));
-
-            std::string nodeIDStrKey =
-                PubKeyUtils::toStrKey(e.statement.nodeID);
-
-            auto envelopeBytes(xdr::xdr_to_opaque(e));
-
-            std::string envelopeEncoded;
-            envelopeEncoded = bn::encode_b64(envelopeBytes);
+            storeSCPHistory(db, db.getSession(), seq, envelopes, qSets);
+            txscope.commit();
+        }
+    }
+}
 
-            auto prepEnv =
-                db.getPreparedStatement("INSERT INTO scphistory "
-                                        "(nodeid, ledgerseq, envelope) VALUES "
-                                        "(:n, :l, :e)");
+void
+Herder::storeSCPHistory(Database& db, soci::session& sess, uint32_t ledgerSeq,
+                        xdr::xvector<SCPEnvelope> const& envelopes,
+                        xdr::xvector<SCPQuorumSet> const& qSets)
+{
+    {
+        auto timer = db.getDeleteTimer("scphistory");
+        sess << "DELETE FROM scphistory WHERE ledgerseq = :l",
+            use(ledgerSeq);
+    }
 
-            auto& st = prepEnv.statement();
-            st.exchange(use(nodeIDStrKey));
-            st.exchange(use(seq));
-            st.exchange(use(envelopeEncoded));
-            st.define_and_bind();
-            {
-                auto timer = db.getInsertTimer("scphistory");
-                st.execute(true);
-            }
-            if (st.get_affected_rows() != 1)
-            {
-                throw std::runtime_error("Could not update data in SQL");
-            }
+    std::string nodeIDStrKey, envelopeEncoded;
+    soci::statement st =
+        (sess.prepare << "INSERT INTO scphistory "
+                         "(nodeid, ledgerseq, envelope) VALUES "
+                         "(:n, :l, :e)",
+         use(nodeIDStrKey), use(ledgerSeq), use(envelopeEncoded));
+    for (auto const& e : envelopes)
+    {
+        nodeIDStrKey = PubKeyUtils::toStrKey(e.statement.nodeID);
+        envelopeEncoded = bn::encode_b64(xdr::xdr_to_opaque(e));
+        {
+            auto timer = db.getInsertTimer("scphistory");
+            st.execute(true);
         }
-
-        for (auto const& p : usedQSets)
+        if (st.get_affected_rows() != 1)
         {
-            std::string qSetH = binToHex(p.first);
-
-            auto prepUpQSet = db.getPreparedStatement(
-                "UPDATE scpquorums SET "
-                "lastledgerseq = :l WHERE qsethash = :h");
+            throw std::runtime_error("Could not update data in SQL");
+        }
+    }
 
-            auto& stUp = prepUpQSet.statement();
-            stUp.exchange(use(seq));
-            stUp.exchange(use(qSetH));
-            stUp.define_and_bind();
+    std::string qSetH, qSetEncoded;
+    soci::statement stUp =
+        (sess.prepare << "UPDATE scpquorums SET "
+                         "lastledgerseq = :l WHERE qsethash = :h",
+         use(ledgerSeq), use(qSetH));
+    soci::statement stIns =
+        (sess.prepare << "INSERT INTO scpquorums "
+                         "(qsethash, lastledgerseq, qset) VALUES "
+                         "(:h, :l, :v)",
+         use(qSetH), use(ledgerSeq), use(qSetEncoded));
+    for (auto const& q : qSets)
+    {
+        auto qSetBytes(xdr::xdr_to_opaque(q));
+        qSetH = binToHex(sha256(qSetBytes));
+        {
+            auto timer = db.getInsertTimer("scpquorums");
+            stUp.execute(true);
+        }
+        if (stUp.get_affected_rows() != 1)
+        {
+            qSetEncoded = bn::encode_b64(qSetBytes);
             {
                 auto timer = db.getInsertTimer("scpquorums");
-                stUp.execute(true);
+                stIns.execute(true);
             }
-            if (stUp.get_affected_rows() != 1)
+            if (stIns.get_affected_rows() != 1)
             {
-                auto qSetBytes(xdr::xdr_to_opaque(*p.second));
-
-                std::string qSetEncoded;
-                qSetEncoded = bn::encode_b64(qSetBytes);
-
-                auto prepInsQSet = db.getPreparedStatement(
-                    "INSERT INTO scpquorums "
-                    "(qsethash, lastledgerseq, qset) VALUES "
-                    "(:h, :l, :v);");
-
-                auto& stIns = prepInsQSet.statement();
-                stIns.exchange(use(qSetH));
-                stIns.exchange(use(seq));
-                stIns.exchange(use(qSetEncoded));
-                stIns.define_and_bind();
-                {
-                    auto timer = db.getInsertTimer("scpquorums");
-                    stIns.execute(true);
-                }
-                if (stIns.get_affected_rows() != 1)
-                {
-                    throw std::runtime_error("Could not update data in SQL");
-                }
+                throw std::runtime_error("Could not update data in SQL");
             }
         }
-
-        txscope.commit();
     }
 }
 
@@ -15,12 +15,18 @@
 #include "database/Database.h"
 #include "ledger/LedgerManager.h"
 #include "main/CommandHandler.h"
+#include "main/TxSubmitQueue.h"
 #include "ledger/LedgerHeaderFrame.h"
 #include "simulation/Simulation.h"
 #include "overlay/OverlayManager.h"
 
+#include "lib/json/json.h"
+#include "util/basen.h"
 #include "xdrpp/marshal.h"
 
+#include <array>
+#include <functional>
+
 using namespace stellar;
 using namespace stellar::txtest;
 
@@ -481,6 +487,340 @@ TEST_CASE("surge", "[herder]")
     }
 }
 
+TEST_CASE("surge pricing benchmarking", "[herder][bench][hide]")
+{
+    Config cfg(getTestConfig());
+    cfg.DESIRED_MAX_TX_PER_LEDGER = 1000;
+
+    VirtualClock clock;
+    Application::pointer app = Application::create(clock, cfg);
+
+    Hash const& networkID = app->getNetworkID();
+    app->start();
+
+    auto& lm = app->getLedgerManager();
+    lm.getCurrentLedgerHeader().maxTxSetSize = cfg.DESIRED_MAX_TX_PER_LEDGER;
+
+    SecretKey dest = getAccount("dest");
+
+    for (size_t n : {10000, 100000})
+    {
+        // 10 transactions per account, with fees spread over 100 levels
+        std::vector<TransactionFramePtr> txs;
+        SecretKey source;
+        for (size_t i = 0; i < n; i++)
+        {
+            if (i % 10 == 0)
+            {
+                source = SecretKey::random();
+            }
+            auto tx = createPaymentTx(networkID, source, dest, i % 10 + 1, 10);
+            tx->getEnvelope().tx.fee *= 1 + (i / 10) % 100;
+            txs.push_back(tx);
+        }
+
+        LOG(INFO) << "Building tx sets of " << n << " pending transactions";
+        auto txSet = std::make_shared<TxSetFrame>(
+            lm.getLastClosedLedgerHeader().hash);
+        for (auto const& tx : txs)
+        {
+            txSet->add(tx);
+        }
+        {
+            TIMED_SCOPE(timerBlkObj, "surge pricing");
+            txSet->sortForHash();
+            txSet->surgePricingFilter(lm);
+        }
+        REQUIRE(txSet->mTransactions.size() == lm.getMaxTxSetSize());
+        {
+            TIMED_SCOPE(timerBlkObj, "sort for apply");
+            txSet->sortForApply();
+        }
+    }
+}
+
+namespace
+{
+void
+appendRecord(std::string& body, TransactionEnvelope const& envelope)
+{
+    auto bin = xdr::xdr_to_opaque(envelope);
+    uint32_t sz = static_cast<uint32_t>(bin.size());
+    body.push_back(static_cast<char>((sz >> 24) & 0xFF) | '\x80');
+    body.push_back(static_cast<char>((sz >> 16) & 0xFF));
+    body.push_back(static_cast<char>((sz >> 8) & 0xFF));
+    body.push_back(static_cast<char>(sz & 0xFF));
+    body.append(bin.begin(), bin.end());
+}
+
+Json::Value
+submitBulk(Application& app, TxSubmitQueue& queue, std::string const& body)
+{
+    std::string reply;
+    queue.submit(body, [&](std::string const& r)
+                 {
+                     reply = r;
+                 });
+    while (reply.empty())
+    {
+        app.getClock().crank(false);
+    }
+    Json::Value res;
+    REQUIRE(Json::Reader().parse(reply, res));
+    return res;
+}
+}
+
+TEST_CASE("bulk transaction submission", "[herder]")
+{
+    Config cfg(getTestConfig());
+
+    VirtualClock clock;
+    Application::pointer app = Application::create(clock, cfg);
+
+    Hash const& networkID = app->getNetworkID();
+    app->start();
+
+    SecretKey root = getRoot(networkID);
+    SecretKey a1 = getAccount("A");
+    SecretKey b1 = getAccount("B");
+
+    const int64_t paymentAmount = app->getLedgerManager().getMinBalance(0);
+    SequenceNumber rootSeq = getAccountSeqNum(root, *app) + 1;
+
+    auto queue = std::make_shared<TxSubmitQueue>(*app);
+
+    SECTION("statuses in order")
+    {
+        auto txA = createCreateAccountTx(networkID, root, a1, rootSeq++,
+                                         paymentAmount);
+        auto txB = createCreateAccountTx(networkID, root, b1, rootSeq++,
+                                         paymentAmount);
+        // sequence number already used by txA
+        auto txBad = createCreateAccountTx(networkID, root, b1, rootSeq - 2,
+                                           paymentAmount + 1);
+
+        std::string body;
+        appendRecord(body, txA->getEnvelope());
+        appendRecord(body, txB->getEnvelope());
+        appendRecord(body, txA->getEnvelope());
+        // a record that is not an envelope
+        body.append("\x80\x00\x00\x04\xff\xff\xff\xff", 8);
+        appendRecord(body, txBad->getEnvelope());
+
+        auto res = submitBulk(*app, *queue, body);
+        REQUIRE(res.isArray());
+        REQUIRE(res.size() == 5);
+        REQUIRE(res[0]["status"].asString() == "PENDING");
+        REQUIRE(res[1]["status"].asString() == "PENDING");
+        REQUIRE(res[2]["status"].asString() == "DUPLICATE");
+        REQUIRE(res[3].isMember("exception"));
+        REQUIRE(res[4]["status"].asString() == "ERROR");
+        REQUIRE(res[4].isMember("error"));
+
+        SECTION("resubmitted")
+        {
+            std::string again;
+            appendRecord(again, txB->getEnvelope());
+            res = submitBulk(*app, *queue, again);
+            REQUIRE(res.size() == 1);
+            REQUIRE(res[0]["status"].asString() == "DUPLICATE");
+        }
+    }
+
+    SECTION("requests admitted together")
+    {
+        int replies = 0;
+        for (int i = 0; i < 10; i++)
+        {
+            std::string body;
+            auto tx = createCreateAccountTx(
+                networkID, root, SecretKey::random(), rootSeq++,
+                paymentAmount);
+            appendRecord(body, tx->getEnvelope());
+            queue->submit(body, [&](std::string const& r)
+                         {
+                             Json::Value res;
+                             REQUIRE(Json::Reader().parse(r, res));
+                             REQUIRE(res[0]["status"].asString() == "PENDING");
+                             replies++;
+                         });
+        }
+        while (replies != 10)
+        {
+            clock.crank(false);
+        }
+    }
+
+    SECTION("malformed stream")
+    {
+        auto tx = createCreateAccountTx(networkID, root, a1, rootSeq++,
+                                        paymentAmount);
+        std::string body;
+        appendRecord(body, tx->getEnvelope());
+        body.pop_back();
+
+        auto res = submitBulk(*app, *queue, body);
+        REQUIRE(res.isObject());
+        REQUIRE(res.isMember("exception"));
+    }
+
+    SECTION("empty stream")
+    {
+        auto res = submitBulk(*app, *queue, "");
+        REQUIRE(res.isArray());
+        REQUIRE(res.size() == 0);
+    }
+
+    SECTION("queue destroyed with a request in flight")
+    {
+        auto tx = createCreateAccountTx(networkID, root, a1, rootSeq++,
+                                        paymentAmount);
+        std::string body;
+        appendRecord(body, tx->getEnvelope());
+
+        bool replied = false;
+        queue->submit(body, [&](std::string const& r)
+                      {
+                          replied = true;
+                      });
+        queue.reset();
+        for (int i = 0; i < 10; i++)
+        {
+            clock.crank(false);
+        }
+        REQUIRE(!replied);
+    }
+}
+
+namespace
+{
+// sends a request to the HTTP server of `app` and returns the raw reply
+std::string
+httpRequest(Application& app, std::string const& method,
+            std::string const& uri, std::string const& body)
+{
+    auto& io = app.getClock().getIOService();
+    asio::ip::tcp::socket socket(io);
+    socket.connect(asio::ip::tcp::endpoint(
+        asio::ip::address::from_string("127.0.0.1"),
+        app.getConfig().HTTP_PORT));
+
+    std::string request = method + " /" + uri + " HTTP/1.0\r\n" +
+                          "Content-Length: " + std::to_string(body.size()) +
+                          "\r\n\r\n" + body;
+    asio::write(socket, asio::buffer(request));
+
+    // the server closes the connection once the reply is written
+    std::string reply;
+    bool done = false;
+    std::array<char, 1024> buffer;
+    std::function<void(asio::error_code, size_t)> onRead =
+        [&](asio::error_code ec, size_t n)
+    {
+        reply.append(buffer.data(), n);
+        if (ec)
+        {
+            done = true;
+            return;
+        }
+        socket.async_read_some(asio::buffer(buffer), onRead);
+    };
+    socket.async_read_some(asio::buffer(buffer), onRead);
+    while (!done)
+    {
+        app.getClock().crank(false);
+    }
+    return reply;
+}
+}
+
+TEST_CASE("bulk transaction submission over HTTP", "[herder][http]")
+{
+    Config cfg(getTestConfig());
+
+    VirtualClock clock;
+    Application::pointer app = Application::create(clock, cfg);
+
+    Hash const& networkID = app->getNetworkID();
+    app->start();
+
+    SecretKey root = getRoot(networkID);
+    SequenceNumber rootSeq = getAccountSeqNum(root, *app) + 1;
+    auto tx = createCreateAccountTx(networkID, root, getAccount("A"),
+                                    rootSeq,
+                                    app->getLedgerManager().getMinBalance(0));
+    std::string body;
+    appendRecord(body, tx->getEnvelope());
+
+    SECTION("POST")
+    {
+        auto reply = httpRequest(*app, "POST", "txs", body);
+        REQUIRE(reply.find("HTTP/1.0 200 OK\r\n") == 0);
+
+        Json::Value res;
+        auto content = reply.substr(reply.find("\r\n\r\n") + 4);
+        REQUIRE(Json::Reader().parse(content, res));
+        REQUIRE(res.size() == 1);
+        REQUIRE(res[0]["status"].asString() == "PENDING");
+    }
+
+    SECTION("GET")
+    {
+        auto reply = httpRequest(*app, "GET", "txs", body);
+        REQUIRE(reply.find("HTTP/1.0 405 Method Not Allowed\r\n") == 0);
+        // nothing was submitted
+        REQUIRE(app->getHerder().recvTransaction(tx) ==
+                Herder::TX_STATUS_PENDING);
+    }
+}
+
+TEST_CASE("bulk transaction submission benchmarking",
+          "[herder][bench][hide]")
+{
+    Config cfg(getTestConfig());
+
+    VirtualClock clock;
+    Application::pointer app = Application::create(clock, cfg);
+
+    Hash const& networkID = app->getNetworkID();
+    app->start();
+
+    SecretKey root = getRoot(networkID);
+    const int64_t paymentAmount = app->getLedgerManager().getMinBalance(0);
+    SequenceNumber rootSeq = getAccountSeqNum(root, *app) + 1;
+
+    size_t const n = 5000;
+    std::vector<TransactionFramePtr> txs;
+    for (size_t i = 0; i < 2 * n; i++)
+    {
+        txs.push_back(createCreateAccountTx(
+            networkID, root, SecretKey::random(), rootSeq++, paymentAmount));
+    }
+
+    {
+        TIMED_SCOPE(timerBlkObj, "tx");
+        for (size_t i = 0; i < n; i++)
+        {
+            auto bin = xdr::xdr_to_opaque(txs[i]->getEnvelope());
+            app->getCommandHandler().manualCmd("tx?blob=" +
+                                               bn::encode_b64(bin));
+        }
+    }
+
+    {
+        TIMED_SCOPE(timerBlkObj, "txs");
+        std::string body;
+        for (size_t i = n; i < 2 * n; i++)
+        {
+            appendRecord(body, txs[i]->getEnvelope());
+        }
+        auto queue = std::make_shared<TxSubmitQueue>(*app);
+        auto res = submitBulk(*app, *queue, body);
+        REQUIRE(res.size() == n);
+    }
+}
+
 TEST_CASE("SCP Driver", "[herder]")
 {
     Config cfg(getTestConfig());
@@ -11,8 +11,8 @@ namespace stellar
 {
 
 LedgerCloseData::LedgerCloseData(uint32_t ledgerSeq, TxSetFramePtr txSet,
-                                 StellarValue const& v)
-    : mLedgerSeq(ledgerSeq), mTxSet(txSet), mValue(v)
+                                 StellarValue const& v, bool fastReplay)
+    : mLedgerSeq(ledgerSeq), mTxSet(txSet), mValue(v), mFastReplay(fastReplay)
 {
     Value x;
     Value y(x.begin(), x.end());
@@ -25,8 +25,14 @@ class LedgerCloseData
     TxSetFramePtr mTxSet;
     StellarValue mValue;
 
+    // set by catchup for the ledgers of a hash-verified history chain, with
+    // CATCHUP_FAST_REPLAY: closing them trusts the signatures of their
+    // transactions and doesn't record their history, nor the history archive
+    // state, which the replay stores once per checkpoint
+    bool mFastReplay;
+
     LedgerCloseData(uint32_t ledgerSeq, TxSetFramePtr txSet,
-                    StellarValue const& v);
+                    StellarValue const& v, bool fastReplay = false);
 };
 
 std::string stellarValueToString(StellarValue const& sv);
@@ -12,6 +12,7 @@
 #include "main/Config.h"
 #include "database/Database.h"
 #include <algorithm>
+#include <unordered_map>
 
 #include "xdrpp/printer.h"
 
@@ -95,7 +96,7 @@ TxSetFrame::sortForApply()
     vector<TransactionFramePtr> retList;
 
     vector<vector<TransactionFramePtr>> txBatches(4);
-    map<AccountID, size_t> accountTxCountMap;
+    unordered_map<AccountID, size_t> accountTxCountMap;
     retList = mTransactions;
     // sort all the txs by seqnum
     std::sort(retList.begin(), retList.end(), SeqSorter);
@@ -117,11 +118,12 @@ TxSetFrame::sortForApply()
 
     retList.clear();
 
+    // randomize each batch using the hash of the transaction set
+    // as a way to randomize even more
+    Hash const setHash = getContentsHash();
+    ApplyTxSorter s(setHash);
     for (auto& batch : txBatches)
     {
-        // randomize each batch using the hash of the transaction set
-        // as a way to randomize even more
-        ApplyTxSorter s(getContentsHash());
         std::sort(batch.begin(), batch.end(), s);
         for (auto tx : batch)
         {
@@ -132,26 +134,6 @@ TxSetFrame::sortForApply()
     return retList;
 }
 
-struct SurgeSorter
-{
-    map<AccountID, double>& mAccountFeeMap;
-    SurgeSorter(map<AccountID, double>& afm) : mAccountFeeMap(afm)
-    {
-    }
-
-    bool operator()(TransactionFramePtr const& tx1,
-                    TransactionFramePtr const& tx2)
-    {
-        if (tx1->getSourceID() == tx2->getSourceID())
-            return tx1->getSeqNum() < tx2->getSeqNum();
-        double fee1 = mAccountFeeMap[tx1->getSourceID()];
-        double fee2 = mAccountFeeMap[tx2->getSourceID()];
-        if (fee1 == fee2)
-            return tx1->getSourceID() < tx2->getSourceID();
-        return fee1 > fee2;
-    }
-};
-
 void
 TxSetFrame::surgePricingFilter(LedgerManager const& lm)
 {
@@ -162,27 +144,61 @@ TxSetFrame::surgePricingFilter(LedgerManager const& lm)
                                 << mTransactions.size();
 
         // determine the fee ratio for each account
-        map<AccountID, double> accountFeeMap;
+        unordered_map<AccountID, double> accountFeeMap;
         for (auto& tx : mTransactions)
         {
             double r = tx->getFeeRatio(lm);
-            double now = accountFeeMap[tx->getSourceID()];
-            if (now == 0)
-                accountFeeMap[tx->getSourceID()] = r;
-            else if (r < now)
-                accountFeeMap[tx->getSourceID()] = r;
+            double& now = accountFeeMap[tx->getSourceID()];
+            if (now == 0 || r < now)
+            {
+                now = r;
+            }
         }
 
-        // sort tx by amount of fee they have paid
-        // remove the bottom that aren't paying enough
-        std::vector<TransactionFramePtr> tempList = mTransactions;
-        std::sort(tempList.begin(), tempList.end(), SurgeSorter(accountFeeMap));
+        // sort tx by the fee ratio of their account, looked up once per tx
+        struct Ranked
+        {
+            double mFeeRatio;
+            TransactionFrame const* mTx;
+        };
+        vector<Ranked> ranked;
+        ranked.reserve(mTransactions.size());
+        for (auto& tx : mTransactions)
+        {
+            ranked.push_back(
+                Ranked{accountFeeMap[tx->getSourceID()], tx.get()});
+        }
+        std::sort(ranked.begin(), ranked.end(),
+                  [](Ranked const& r1, Ranked const& r2)
+                  {
+                      auto const& tx1 = *r1.mTx;
+                      auto const& tx2 = *r2.mTx;
+                      if (tx1.getSourceID() == tx2.getSourceID())
+                          return tx1.getSeqNum() < tx2.getSeqNum();
+                      if (r1.mFeeRatio == r2.mFeeRatio)
+                          return tx1.getSourceID() < tx2.getSourceID();
+                      return r1.mFeeRatio > r2.mFeeRatio;
+                  });
 
-        for (auto iter = tempList.begin() + max; iter != tempList.end(); iter++)
+        // remove the bottom that aren't paying enough
+        unordered_set<TransactionFrame const*> removed;
+        for (auto iter = ranked.begin() + max; iter != ranked.end(); iter++)
         {
-            removeTx(*iter);
+            removed.insert(iter->mTx);
         }
+        removeTxs(removed);
+    }
+}
+
+void
+TxSetFrame::preverifySignatures(Application& app) const
+{
+    std::vector<PubKeyUtils::SignatureCheck> checks;
+    for (auto const& tx : mTransactions)
+    {
+        tx->addSignatureChecks(&app.getDatabase(), checks);
     }
+    PubKeyUtils::verifySigs(std::move(checks), app.getWorkerIOService());
 }
 
 // TODO.3 this and checkValid share a lot of code
@@ -194,8 +210,10 @@ TxSetFrame::trimInvalid(Application& app,
     app.getDatabase().setCurrentTransactionReadOnly();
 
     sortForHash();
+    preverifySignatures(app);
 
-    map<AccountID, vector<TransactionFramePtr>> accountTxMap;
+    unordered_map<AccountID, vector<TransactionFramePtr>> accountTxMap;
+    unordered_set<TransactionFrame const*> removed;
 
     for (auto tx : mTransactions)
     {
@@ -215,7 +233,7 @@ TxSetFrame::trimInvalid(Application& app,
             if (!tx->checkValid(app, lastSeq))
             {
                 trimmed.push_back(tx);
-                removeTx(tx);
+                removed.insert(tx.get());
                 continue;
             }
             totFee += tx->getFee();
@@ -234,11 +252,12 @@ TxSetFrame::trimInvalid(Application& app,
                 for (auto& tx : item.second)
                 {
                     trimmed.push_back(tx);
-                    removeTx(tx);
+                    removed.insert(tx.get());
                 }
             }
         }
     }
+    removeTxs(removed);
 }
 
 // need to make sure every account that is submitting a tx has enough to pay
@@ -271,7 +290,7 @@ TxSetFrame::checkValid(Application& app) const
         return false;
     }
 
-    map<AccountID, vector<TransactionFramePtr>> accountTxMap;
+    unordered_map<AccountID, vector<TransactionFramePtr>> accountTxMap;
 
     Hash lastHash;
     for (auto tx : mTransactions)
@@ -288,6 +307,8 @@ TxSetFrame::checkValid(Application& app) const
         lastHash = tx->getFullHash();
     }
 
+    preverifySignatures(app);
+
     for (auto& item : accountTxMap)
     {
         // order by sequence number
@@ -343,6 +364,23 @@ TxSetFrame::removeTx(TransactionFramePtr tx)
     mHashIsValid = false;
 }
 
+void
+TxSetFrame::removeTxs(unordered_set<TransactionFrame const*> const& txs)
+{
+    if (txs.empty())
+    {
+        return;
+    }
+    mTransactions.erase(
+        std::remove_if(mTransactions.begin(), mTransactions.end(),
+                       [&txs](TransactionFramePtr const& tx)
+                       {
+                           return txs.find(tx.get()) != txs.end();
+                       }),
+        mTransactions.end());
+    mHashIsValid = false;
+}
+
 Hash
 TxSetFrame::getContentsHash()
 {
@@ -6,6 +6,7 @@
 
 #include "overlay/StellarXDR.h"
 #include "transactions/TransactionFrame.h"
+#include <unordered_set>
 
 namespace stellar
 {
@@ -41,12 +42,18 @@ class TxSetFrame
 
     std::vector<TransactionFramePtr> sortForApply();
 
+    // verifies the signatures of all transactions in parallel, ahead of
+    // checking or applying the transactions one by one
+    void preverifySignatures(Application& app) const;
+
     bool checkValid(Application& app) const;
     void trimInvalid(Application& app,
                      std::vector<TransactionFramePtr>& trimmed);
     void surgePricingFilter(LedgerManager const& lm);
 
     void removeTx(TransactionFramePtr tx);
+    // removes all of `txs` in a single pass
+    void removeTxs(std::unordered_set<TransactionFrame const*> const& txs);
 
     void
     add(TransactionFramePtr tx)
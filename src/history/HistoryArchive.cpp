@@ -284,6 +284,15 @@ HistoryArchive::HistoryArchive(std::string const& name,
                                std::string const& mkdirCmd)
     : mName(name), mGetCmd(getCmd), mPutCmd(putCmd), mMkdirCmd(mkdirCmd)
 {
+    std::string const prefix("file://");
+    if (mGetCmd.compare(0, prefix.size(), prefix) == 0)
+    {
+        mLocalGetDir = mGetCmd.substr(prefix.size());
+    }
+    if (mPutCmd.compare(0, prefix.size(), prefix) == 0)
+    {
+        mLocalPutDir = mPutCmd.substr(prefix.size());
+    }
 }
 
 HistoryArchive::~HistoryArchive()
@@ -339,4 +348,30 @@ HistoryArchive::mkdirCmd(std::string const& remoteDir) const
         return "";
     return fmt::format(mMkdirCmd, remoteDir);
 }
+
+bool
+HistoryArchive::hasLocalGet() const
+{
+    return !mLocalGetDir.empty();
+}
+
+bool
+HistoryArchive::hasLocalPut() const
+{
+    return !mLocalPutDir.empty();
+}
+
+std::string
+HistoryArchive::localGetPath(std::string const& remote) const
+{
+    assert(hasLocalGet());
+    return mLocalGetDir + "/" + remote;
+}
+
+std::string
+HistoryArchive::localPutPath(std::string const& remote) const
+{
+    assert(hasLocalPut());
+    return mLocalPutDir + "/" + remote;
+}
 }
@@ -126,12 +126,21 @@ struct HistoryArchiveState
     void fromString(std::string const& str);
 };
 
+/**
+ * An archive is read and written with the get, put and mkdir commands of its
+ * configuration, run in subprocesses. A get or put "command" of the form
+ * file://<dir> designates a local directory instead, which files are copied
+ * from or to in-process (and which directories are created in-process).
+ */
 class HistoryArchive : public std::enable_shared_from_this<HistoryArchive>
 {
     std::string mName;
     std::string mGetCmd;
     std::string mPutCmd;
     std::string mMkdirCmd;
+    // directories of a file:// get or put, empty otherwise
+    std::string mLocalGetDir;
+    std::string mLocalPutDir;
 
   public:
     HistoryArchive(std::string const& name, std::string const& getCmd,
@@ -147,5 +156,11 @@ class HistoryArchive : public std::enable_shared_from_this<HistoryArchive>
     std::string putFileCmd(std::string const& local,
                            std::string const& remote) const;
     std::string mkdirCmd(std::string const& remoteDir) const;
+
+    bool hasLocalGet() const;
+    bool hasLocalPut() const;
+    // paths of a remote file or dir in the local directories
+    std::string localGetPath(std::string const& remote) const;
+    std::string localPutPath(std::string const& remote) const;
 };
 }
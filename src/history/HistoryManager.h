@@ -179,6 +179,7 @@ class BucketList;
 class Config;
 class Database;
 class HistoryArchive;
+class HistoryWriter;
 struct StateSnapshot;
 
 class HistoryManager
@@ -351,6 +352,10 @@ class HistoryManager
     // Return the HistoryArchiveState of the LedgerManager's LCL
     virtual HistoryArchiveState getLastClosedHistoryArchiveState() const = 0;
 
+    // Return the writer of the transaction and SCP history of closed ledgers
+    // (see PIPELINED_LEDGER_CLOSE).
+    virtual HistoryWriter& getHistoryWriter() = 0;
+
     // Infer a quorum set by reading SCP messages in history archives.
     virtual InferredQuorum inferQuorum() = 0;
 
@@ -16,6 +16,7 @@
 #include "history/HistoryArchive.h"
 #include "history/HistoryManagerImpl.h"
 #include "history/HistoryWork.h"
+#include "history/HistoryWriter.h"
 #include "history/StateSnapshot.h"
 #include "herder/HerderImpl.h"
 #include "history/FileTransferInfo.h"
@@ -206,6 +207,7 @@ HistoryManagerImpl::HistoryManagerImpl(Application& app)
     , mWorkDir(nullptr)
     , mPublishWork(nullptr)
     , mCatchupWork(nullptr)
+    , mHistoryWriter(make_unique<HistoryWriter>(app))
 
     , mPublishSkip(
           app.getMetrics().NewMeter({"history", "publish", "skip"}, "event"))
@@ -347,6 +349,12 @@ HistoryManagerImpl::getLastClosedHistoryArchiveState() const
     return HistoryArchiveState(seq, bl);
 }
 
+HistoryWriter&
+HistoryManagerImpl::getHistoryWriter()
+{
+    return *mHistoryWriter;
+}
+
 InferredQuorum
 HistoryManagerImpl::inferQuorum()
 {
@@ -17,6 +17,7 @@ namespace stellar
 {
 
 class Application;
+class HistoryWriter;
 class Work;
 
 class HistoryManagerImpl : public HistoryManager
@@ -25,6 +26,7 @@ class HistoryManagerImpl : public HistoryManager
     std::unique_ptr<TmpDir> mWorkDir;
     std::shared_ptr<Work> mPublishWork;
     std::shared_ptr<Work> mCatchupWork;
+    std::unique_ptr<HistoryWriter> mHistoryWriter;
 
     medida::Meter& mPublishSkip;
     medida::Meter& mPublishQueue;
@@ -90,6 +92,8 @@ class HistoryManagerImpl : public HistoryManager
 
     HistoryArchiveState getLastClosedHistoryArchiveState() const override;
 
+    HistoryWriter& getHistoryWriter() override;
+
     InferredQuorum inferQuorum() override;
 
     std::string const& getTmpDir() override;
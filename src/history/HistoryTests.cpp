@@ -10,11 +10,14 @@
 #include "main/ExternalQueue.h"
 #include "main/Config.h"
 #include "main/PersistentState.h"
+#include "bucket/Bucket.h"
 #include "bucket/BucketManager.h"
 #include "bucket/BucketList.h"
 #include "crypto/Hex.h"
+#include "database/Database.h"
 #include "lib/catch.hpp"
 #include "util/Fs.h"
+#include "util/Gzip.h"
 #include "util/Logging.h"
 #include "util/Timer.h"
 #include "util/TmpDir.h"
@@ -25,9 +28,12 @@
 #include "herder/LedgerCloseData.h"
 #include "work/WorkManager.h"
 #include "work/WorkParent.h"
+#include "medida/meter.h"
+#include "medida/metrics_registry.h"
 #include <cstdio>
 #include <xdrpp/autocheck.h>
 #include <fstream>
+#include <iterator>
 #include <random>
 
 using namespace stellar;
@@ -223,6 +229,29 @@ TEST_CASE_METHOD(HistoryTests, "HistoryManager::compress", "[history]")
     REQUIRE(u->getState() == Work::WORK_SUCCESS);
     REQUIRE(fs::exists(fname));
     REQUIRE(!fs::exists(compressed));
+    {
+        std::ifstream in(fname, std::ifstream::binary);
+        std::string content((std::istreambuf_iterator<char>(in)),
+                            std::istreambuf_iterator<char>());
+        REQUIRE(content == s);
+    }
+
+    // a truncated file is an error
+    wm.addWork<GzipFileWork>(fname, true);
+    wm.advanceChildren();
+    crankTillDone();
+    REQUIRE(fs::exists(fname));
+    {
+        std::ifstream in(compressed, std::ifstream::binary);
+        std::string gz((std::istreambuf_iterator<char>(in)),
+                       std::istreambuf_iterator<char>());
+        in.close();
+        std::ofstream out(compressed,
+                          std::ofstream::binary | std::ofstream::trunc);
+        out.write(gz.data(), gz.size() / 2);
+    }
+    REQUIRE_THROWS_AS(gunzipFile(compressed, fname), std::runtime_error);
+    REQUIRE(!fs::exists(fname));
 }
 
 TEST_CASE_METHOD(HistoryTests, "HistoryArchiveState::get_put", "[history]")
@@ -743,6 +772,124 @@ TEST_CASE_METHOD(HistoryTests, "Full history catchup",
     }
 }
 
+TEST_CASE_METHOD(HistoryTests, "Bulk-load catchup",
+                 "[history][historycatchup][bulkload]")
+{
+    generateAndPublishInitialHistory(3);
+    uint32_t initLedger = app.getLedgerManager().getLastClosedLedgerNum();
+
+    mCfgs.emplace_back(getTestConfig(static_cast<int>(mCfgs.size()) + 1,
+                                     Config::TESTDB_ON_DISK_SQLITE));
+    mCfgs.back().CATCHUP_BULK_LOAD = true;
+    Application::pointer app2 = Application::create(
+        clock, mConfigurator->configure(mCfgs.back(), false));
+    app2->start();
+
+    auto& loaded = app2->getMetrics().NewMeter(
+        {"bucket", "bulk-load", "write"}, "entry");
+    auto checkState = [&]()
+    {
+        auto& bm = app2->getBucketManager();
+        REQUIRE_NOTHROW(checkDBAgainstBuckets(
+            app2->getMetrics(), bm, app2->getDatabase(), bm.getBucketList()));
+    };
+
+    CHECK(catchupApplication(initLedger, HistoryManager::CATCHUP_MINIMAL,
+                             app2));
+    CHECK(loaded.count() != 0);
+    checkState();
+
+    // the tables are not empty anymore
+    generateAndPublishHistory(2);
+    initLedger = app.getLedgerManager().getLastClosedLedgerNum();
+    auto loadedBefore = loaded.count();
+    CHECK(catchupApplication(initLedger, HistoryManager::CATCHUP_MINIMAL,
+                             app2));
+    CHECK(loaded.count() > loadedBefore);
+    checkState();
+}
+
+TEST_CASE_METHOD(HistoryTests, "Catchup minimal one bucket at a time",
+                 "[history][historycatchup]")
+{
+    generateAndPublishInitialHistory(3);
+    uint32_t initLedger = app.getLedgerManager().getLastClosedLedgerNum();
+
+    // the levels are applied while the next buckets are downloaded, with a
+    // single download at a time
+    mCfgs.emplace_back(getTestConfig(static_cast<int>(mCfgs.size()) + 1,
+                                     Config::TESTDB_IN_MEMORY_SQLITE));
+    mCfgs.back().MAX_CONCURRENT_SUBPROCESSES = 1;
+    Application::pointer app2 = Application::create(
+        clock, mConfigurator->configure(mCfgs.back(), false));
+    app2->start();
+
+    auto checkState = [&]()
+    {
+        auto& bm = app2->getBucketManager();
+        REQUIRE_NOTHROW(checkDBAgainstBuckets(
+            app2->getMetrics(), bm, app2->getDatabase(), bm.getBucketList()));
+    };
+
+    CHECK(catchupApplication(initLedger, HistoryManager::CATCHUP_MINIMAL,
+                             app2));
+    checkState();
+
+    // only the buckets that changed are downloaded, the levels above them
+    // are kept
+    generateAndPublishHistory(2);
+    initLedger = app.getLedgerManager().getLastClosedLedgerNum();
+    CHECK(catchupApplication(initLedger, HistoryManager::CATCHUP_MINIMAL,
+                             app2));
+    checkState();
+}
+
+TEST_CASE_METHOD(HistoryTests, "Fast replay catchup",
+                 "[history][historycatchup][fastreplay]")
+{
+    generateAndPublishInitialHistory(3);
+    uint32_t initLedger = app.getLedgerManager().getLastClosedLedgerNum();
+
+    mCfgs.emplace_back(getTestConfig(static_cast<int>(mCfgs.size()) + 1,
+                                     Config::TESTDB_ON_DISK_SQLITE));
+    mCfgs.back().CATCHUP_FAST_REPLAY = true;
+    Application::pointer app2 = Application::create(
+        clock, mConfigurator->configure(mCfgs.back(), false));
+    app2->start();
+
+    // the hashes of the replayed ledgers are checked along the way
+    CHECK(catchupApplication(initLedger, HistoryManager::CATCHUP_COMPLETE,
+                             app2));
+
+    auto& bm = app2->getBucketManager();
+    REQUIRE_NOTHROW(checkDBAgainstBuckets(
+        app2->getMetrics(), bm, app2->getDatabase(), bm.getBucketList()));
+
+    // the history of the replayed ledgers isn't recorded
+    auto countTxHistory = [](Application& a, uint32_t lastSeq)
+    {
+        int count = 0;
+        a.getDatabase().getSession()
+            << "SELECT COUNT(*) FROM txhistory WHERE ledgerseq <= :s",
+            soci::into(count), soci::use(lastSeq);
+        return count;
+    };
+    auto firstCheckpoint = app.getHistoryManager().getCheckpointFrequency() - 1;
+    CHECK(countTxHistory(app, firstCheckpoint) != 0);
+    CHECK(countTxHistory(*app2, firstCheckpoint) == 0);
+
+    // the stored history archive state follows the last closed ledger
+    HistoryArchiveState has;
+    has.fromString(app2->getPersistentState().getState(
+        PersistentState::kHistoryArchiveState));
+    CHECK(has.currentLedger ==
+          app2->getLedgerManager().getLastClosedLedgerNum());
+    for (auto const& h : has.allBuckets())
+    {
+        CHECK(bm.getBucketByHash(hexToBin256(h)));
+    }
+}
+
 TEST_CASE_METHOD(HistoryTests, "History publish queueing",
                  "[history][historydelay][historycatchup]")
 {
@@ -980,6 +1127,62 @@ TEST_CASE_METHOD(S3HistoryTests, "Publish/catchup via s3", "[hide][s3]")
         "s3");
 }
 
+class LocalDirConfigurator : public Configurator
+{
+    TmpDirManager mArchtmp;
+    TmpDir mDir;
+
+  public:
+    LocalDirConfigurator()
+        : mArchtmp("archtmp"), mDir(mArchtmp.tmpDir("archive"))
+    {
+    }
+
+    std::string
+    getArchiveDirName() const override
+    {
+        return mDir.getName();
+    }
+
+    Config&
+    configure(Config& cfg, bool writable) const override
+    {
+        std::string dir = "file://" + mDir.getName();
+        cfg.HISTORY["test"] = std::make_shared<HistoryArchive>(
+            "test", dir, writable ? dir : "", "");
+        return cfg;
+    }
+};
+
+class LocalDirHistoryTests : public HistoryTests
+{
+  public:
+    LocalDirHistoryTests()
+        : HistoryTests(std::make_shared<LocalDirConfigurator>())
+    {
+    }
+};
+
+TEST_CASE_METHOD(LocalDirHistoryTests, "Publish/catchup via a local directory",
+                 "[history][historycatchup]")
+{
+    auto archive = app.getConfig().HISTORY.find("test")->second;
+    CHECK(archive->hasLocalGet());
+    CHECK(archive->hasLocalPut());
+
+    generateAndPublishInitialHistory(3);
+    CHECK(fs::exists(mConfigurator->getArchiveDirName() + "/" +
+                     HistoryArchiveState::wellKnownRemoteName()));
+
+    auto initLedger = app.getLedgerManager().getLastClosedLedgerNum();
+    auto app2 = catchupNewApplication(
+        initLedger, Config::TESTDB_IN_MEMORY_SQLITE,
+        HistoryManager::CATCHUP_COMPLETE, "local-complete");
+    auto app3 = catchupNewApplication(
+        initLedger, Config::TESTDB_IN_MEMORY_SQLITE,
+        HistoryManager::CATCHUP_MINIMAL, "local-minimal");
+}
+
 TEST_CASE("persist publish queue", "[history]")
 {
     Config cfg(getTestConfig(0, Config::TESTDB_ON_DISK_SQLITE));
@@ -6,16 +6,20 @@
 #include "bucket/BucketManager.h"
 #include "crypto/Hex.h"
 #include "crypto/SHA.h"
+#include "database/Database.h"
 #include "herder/LedgerCloseData.h"
 #include "herder/TxSetFrame.h"
 #include "history/FileTransferInfo.h"
 #include "history/HistoryManager.h"
 #include "history/HistoryWork.h"
+#include "history/HistoryWriter.h"
 #include "history/StateSnapshot.h"
 #include "ledger/LedgerHeaderFrame.h"
 #include "ledger/LedgerManager.h"
 #include "main/Config.h"
 #include "process/ProcessManager.h"
+#include "util/Fs.h"
+#include "util/Gzip.h"
 #include "util/Logging.h"
 #include "util/make_unique.h"
 #include "xdr/Stellar-ledger.h"
@@ -23,7 +27,9 @@
 
 #include "lib/util/format.h"
 
+#include <algorithm>
 #include <fstream>
+#include <set>
 
 namespace stellar
 {
@@ -55,6 +61,36 @@ fmtProgress(Application& app, std::string const& task, uint32_t first,
     return fmt::format("{:s} {:d}/{:d} ({:d}%)", task, done, total, pct);
 }
 
+// The in-process counterpart of running a command: runs `task` on a worker
+// thread, then `handler` on the main thread, with an error if `task` threw.
+static void
+runOnWorker(Application& app, std::string const& what,
+            std::function<void()> task,
+            std::function<void(asio::error_code const& ec)> handler)
+{
+    app.getWorkerIOService().post([&app, what, task, handler]()
+                                  {
+                                      asio::error_code ec;
+                                      try
+                                      {
+                                          task();
+                                      }
+                                      catch (std::exception& e)
+                                      {
+                                          CLOG(WARNING, "History")
+                                              << what << " failed: "
+                                              << e.what();
+                                          ec = std::make_error_code(
+                                              std::errc::io_error);
+                                      }
+                                      app.getClock().getIOService().post(
+                                          [ec, handler]()
+                                          {
+                                              handler(ec);
+                                          });
+                                  });
+}
+
 RunCommandWork::RunCommandWork(Application& app, WorkParent& parent,
                                std::string const& uniqueName,
                                size_t maxRetries)
@@ -99,14 +135,36 @@ GetRemoteFileWork::GetRemoteFileWork(
 void
 GetRemoteFileWork::getCommand(std::string& cmdLine, std::string& outFile)
 {
-    auto archive = mArchive;
-    if (!archive)
+    cmdLine = mCurrentArchive->getFileCmd(mRemote, mLocal);
+}
+
+void
+GetRemoteFileWork::onStart()
+{
+    mCurrentArchive = mArchive;
+    if (!mCurrentArchive)
+    {
+        mCurrentArchive =
+            mApp.getHistoryManager().selectRandomReadableHistoryArchive();
+    }
+    assert(mCurrentArchive);
+    assert(mCurrentArchive->hasGetCmd());
+
+    if (mCurrentArchive->hasLocalGet())
     {
-        archive = mApp.getHistoryManager().selectRandomReadableHistoryArchive();
+        auto from = mCurrentArchive->localGetPath(mRemote);
+        auto to = mLocal;
+        runOnWorker(mApp, "get " + from,
+                    [from, to]()
+                    {
+                        fs::copyFile(from, to);
+                    },
+                    callComplete());
+    }
+    else
+    {
+        RunCommandWork::onStart();
     }
-    assert(archive);
-    assert(archive->hasGetCmd());
-    cmdLine = archive->getFileCmd(mRemote, mLocal);
 }
 
 void
@@ -133,6 +191,26 @@ PutRemoteFileWork::getCommand(std::string& cmdLine, std::string& outFile)
     cmdLine = mArchive->putFileCmd(mLocal, mRemote);
 }
 
+void
+PutRemoteFileWork::onStart()
+{
+    if (mArchive->hasLocalPut())
+    {
+        auto from = mLocal;
+        auto to = mArchive->localPutPath(mRemote);
+        runOnWorker(mApp, "put " + to,
+                    [from, to]()
+                    {
+                        fs::copyFile(from, to);
+                    },
+                    callComplete());
+    }
+    else
+    {
+        RunCommandWork::onStart();
+    }
+}
+
 MakeRemoteDirWork::MakeRemoteDirWork(
     Application& app, WorkParent& parent, std::string const& dir,
     std::shared_ptr<HistoryArchive const> archive)
@@ -152,6 +230,28 @@ MakeRemoteDirWork::getCommand(std::string& cmdLine, std::string& outFile)
     }
 }
 
+void
+MakeRemoteDirWork::onStart()
+{
+    if (mArchive->hasLocalPut())
+    {
+        auto dir = mArchive->localPutPath(mDir);
+        runOnWorker(mApp, "mkdir " + dir,
+                    [dir]()
+                    {
+                        if (!fs::mkpath(dir))
+                        {
+                            throw std::runtime_error("failed to create dir");
+                        }
+                    },
+                    callComplete());
+    }
+    else
+    {
+        RunCommandWork::onStart();
+    }
+}
+
 ///////////////////////////////////////////////////////////////////////////
 // Gzip and Gunzip
 ///////////////////////////////////////////////////////////////////////////
@@ -180,7 +280,7 @@ checkNoGzipSuffix(std::string const& filename)
 
 GzipFileWork::GzipFileWork(Application& app, WorkParent& parent,
                            std::string const& filenameNoGz, bool keepExisting)
-    : RunCommandWork(app, parent, std::string("gzip-file ") + filenameNoGz)
+    : Work(app, parent, std::string("gzip-file ") + filenameNoGz)
     , mFilenameNoGz(filenameNoGz)
     , mKeepExisting(keepExisting)
 {
@@ -195,20 +295,31 @@ GzipFileWork::onReset()
 }
 
 void
-GzipFileWork::getCommand(std::string& cmdLine, std::string& outFile)
+GzipFileWork::onStart()
 {
-    cmdLine = "gzip ";
-    if (mKeepExisting)
-    {
-        cmdLine += "-c ";
-        outFile = mFilenameNoGz + ".gz";
-    }
-    cmdLine += mFilenameNoGz;
+    auto filenameNoGz = mFilenameNoGz;
+    auto keepExisting = mKeepExisting;
+    runOnWorker(mApp, "gzip " + filenameNoGz,
+                [filenameNoGz, keepExisting]()
+                {
+                    gzipFile(filenameNoGz, filenameNoGz + ".gz");
+                    if (!keepExisting)
+                    {
+                        std::remove(filenameNoGz.c_str());
+                    }
+                },
+                callComplete());
+}
+
+void
+GzipFileWork::onRun()
+{
+    // Do nothing: we spawned the compression in onStart().
 }
 
 GunzipFileWork::GunzipFileWork(Application& app, WorkParent& parent,
                                std::string const& filenameGz, bool keepExisting)
-    : RunCommandWork(app, parent, std::string("gunzip-file ") + filenameGz)
+    : Work(app, parent, std::string("gunzip-file ") + filenameGz)
     , mFilenameGz(filenameGz)
     , mKeepExisting(keepExisting)
 {
@@ -216,22 +327,34 @@ GunzipFileWork::GunzipFileWork(Application& app, WorkParent& parent,
 }
 
 void
-GunzipFileWork::getCommand(std::string& cmdLine, std::string& outFile)
+GunzipFileWork::onReset()
 {
-    cmdLine = "gzip -d ";
-    if (mKeepExisting)
-    {
-        cmdLine += "-c ";
-        outFile = mFilenameGz.substr(0, mFilenameGz.size() - 3);
-    }
-    cmdLine += mFilenameGz;
+    std::string filenameNoGz = mFilenameGz.substr(0, mFilenameGz.size() - 3);
+    std::remove(filenameNoGz.c_str());
 }
 
 void
-GunzipFileWork::onReset()
+GunzipFileWork::onStart()
 {
-    std::string filenameNoGz = mFilenameGz.substr(0, mFilenameGz.size() - 3);
-    std::remove(filenameNoGz.c_str());
+    auto filenameGz = mFilenameGz;
+    auto keepExisting = mKeepExisting;
+    runOnWorker(mApp, "gunzip " + filenameGz,
+                [filenameGz, keepExisting]()
+                {
+                    gunzipFile(filenameGz,
+                               filenameGz.substr(0, filenameGz.size() - 3));
+                    if (!keepExisting)
+                    {
+                        std::remove(filenameGz.c_str());
+                    }
+                },
+                callComplete());
+}
+
+void
+GunzipFileWork::onRun()
+{
+    // Do nothing: we spawned the decompression in onStart().
 }
 
 ///////////////////////////////////////////////////////////////////////////
@@ -262,8 +385,30 @@ VerifyBucketWork::onStart()
         {
             auto hasher = SHA256::create();
             asio::error_code ec;
-            char buf[4096];
+            std::string filenameGz = filename + ".gz";
+            bool compressed = fs::exists(filenameGz);
+            if (compressed)
             {
+                // decompress and hash in one pass
+                try
+                {
+                    gunzipFile(filenameGz, filename,
+                               [&hasher](ByteSlice const& data)
+                               {
+                                   hasher->add(data);
+                               });
+                }
+                catch (std::runtime_error& e)
+                {
+                    CLOG(WARNING, "History") << "FAILED decompressing "
+                                             << filenameGz << ": "
+                                             << e.what();
+                    ec = std::make_error_code(std::errc::io_error);
+                }
+            }
+            else
+            {
+                char buf[4096];
                 // ensure that the stream gets its own scope to avoid race with
                 // main thread
                 std::ifstream in(filename, std::ifstream::binary);
@@ -272,12 +417,19 @@ VerifyBucketWork::onStart()
                     in.read(buf, sizeof(buf));
                     hasher->add(ByteSlice(buf, in.gcount()));
                 }
+            }
+            if (!ec)
+            {
                 uint256 vHash = hasher->finish();
                 if (vHash == hash)
                 {
                     CLOG(DEBUG, "History") << "Verified hash ("
                                            << hexAbbrev(hash) << ") for "
                                            << filename;
+                    if (compressed)
+                    {
+                        std::remove(filenameGz.c_str());
+                    }
                 }
                 else
                 {
@@ -747,17 +899,109 @@ BatchDownloadWork::notify(std::string const& childChanged)
 // Apply Buckets
 ///////////////////////////////////////////////////////////////////////////
 
+ApplyBucketLevelWork::ApplyBucketLevelWork(
+    Application& app, WorkParent& parent, size_t level,
+    std::shared_ptr<Bucket> snap, std::shared_ptr<Bucket> curr,
+    FutureBucket const& next, bool& applying)
+    : Work(app, parent, fmt::format("apply-bucket-level-{:d}", level))
+    , mLevel(level)
+    , mSnapBucket(snap)
+    , mCurrBucket(curr)
+    , mNext(next)
+    , mApplying(applying)
+{
+}
+
+BucketLevel&
+ApplyBucketLevelWork::getBucketLevel()
+{
+    return mApp.getBucketManager().getBucketList().getLevel(mLevel);
+}
+
+void
+ApplyBucketLevelWork::onReset()
+{
+    mSnapApplicator.reset();
+    mCurrApplicator.reset();
+}
+
+void
+ApplyBucketLevelWork::onStart()
+{
+    auto& level = getBucketLevel();
+    if (mApplying || mSnapBucket->getHash() != level.getSnap()->getHash())
+    {
+        mSnapApplicator =
+            make_unique<BucketApplicator>(mApp.getDatabase(), mSnapBucket);
+        CLOG(DEBUG, "History") << "ApplyBuckets : starting level[" << mLevel
+                               << "].snap = "
+                               << binToHex(mSnapBucket->getHash());
+        mApplying = true;
+    }
+    if (mApplying || mCurrBucket->getHash() != level.getCurr()->getHash())
+    {
+        mCurrApplicator =
+            make_unique<BucketApplicator>(mApp.getDatabase(), mCurrBucket);
+        CLOG(DEBUG, "History") << "ApplyBuckets : starting level[" << mLevel
+                               << "].curr = "
+                               << binToHex(mCurrBucket->getHash());
+        mApplying = true;
+    }
+}
+
+void
+ApplyBucketLevelWork::onRun()
+{
+    if (mSnapApplicator && *mSnapApplicator)
+    {
+        mSnapApplicator->advance();
+    }
+    else if (mCurrApplicator && *mCurrApplicator)
+    {
+        mCurrApplicator->advance();
+    }
+    scheduleSuccess();
+}
+
+Work::State
+ApplyBucketLevelWork::onSuccess()
+{
+    if ((mSnapApplicator && *mSnapApplicator) ||
+        (mCurrApplicator && *mCurrApplicator))
+    {
+        return WORK_RUNNING;
+    }
+
+    auto& level = getBucketLevel();
+    if (mSnapApplicator)
+    {
+        level.setSnap(mSnapBucket);
+    }
+    if (mCurrApplicator)
+    {
+        level.setCurr(mCurrBucket);
+    }
+    mSnapApplicator.reset();
+    mCurrApplicator.reset();
+    level.setNext(mNext);
+    return WORK_SUCCESS;
+}
+
 ApplyBucketsWork::ApplyBucketsWork(
     Application& app, WorkParent& parent,
     std::map<std::string, std::shared_ptr<Bucket>>& buckets,
     HistoryArchiveState& applyState,
-    LedgerHeaderHistoryEntry const& firstVerified)
+    LedgerHeaderHistoryEntry const& firstVerified, TmpDir const& downloadDir,
+    std::vector<std::string> const& toDownload)
     : Work(app, parent, std::string("apply-buckets"))
     , mBuckets(buckets)
     , mApplyState(applyState)
     , mFirstVerified(firstVerified)
+    , mDownloadDir(downloadDir)
+    , mToDownload(toDownload)
+    , mVerified(0)
     , mApplying(false)
-    , mLevel(BucketList::kNumLevels - 1)
+    , mLevelsLeft(BucketList::kNumLevels)
 {
     // Consistency check: LCL should be in the _past_ from firstVerified,
     // since we're about to clobber a bunch of DB state with new buckets
@@ -776,12 +1020,6 @@ ApplyBucketsWork::getBucketList()
     return mApp.getBucketManager().getBucketList();
 }
 
-BucketLevel&
-ApplyBucketsWork::getBucketLevel(size_t level)
-{
-    return getBucketList().getLevel(level);
-}
-
 std::shared_ptr<Bucket>
 ApplyBucketsWork::getBucket(std::string const& hash)
 {
@@ -806,52 +1044,159 @@ ApplyBucketsWork::getBucket(std::string const& hash)
     return b;
 }
 
+std::string
+ApplyBucketsWork::getStatus() const
+{
+    if (mState == WORK_RUNNING && mBulkLoader)
+    {
+        return fmt::format("bulk-loading buckets: {:s}",
+                           mBulkLoader->getStatus());
+    }
+    if (mState == WORK_PENDING)
+    {
+        auto total = mVerified + mRunning.size() + mQueued.size();
+        if (mApplyLevelWork)
+        {
+            return fmt::format("Applying bucket level {:d}, {:d}/{:d} "
+                               "buckets downloaded and verified",
+                               mLevelsLeft - 1, mVerified, total);
+        }
+        return fmt::format("Downloading and verifying buckets: {:d}/{:d}",
+                           mVerified, total);
+    }
+    return Work::getStatus();
+}
+
+bool
+ApplyBucketsWork::levelVerified(size_t level) const
+{
+    // the buckets are queued level by level, from the oldest one: those of
+    // `level` and of the levels above it come first
+    if (!mQueued.empty() && mQueued.front().first >= level)
+    {
+        return false;
+    }
+    for (auto const& r : mRunning)
+    {
+        if (r.second >= level)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+void
+ApplyBucketsWork::addNextDownloadWorker()
+{
+    if (mQueued.empty())
+    {
+        return;
+    }
+
+    auto level = mQueued.front().first;
+    auto hash = mQueued.front().second;
+    mQueued.pop_front();
+
+    CLOG(DEBUG, "History") << "Downloading bucket " << hash << " of level "
+                           << level;
+    FileTransferInfo ft(mDownloadDir, HISTORY_FILE_TYPE_BUCKET, hash);
+    // download->gunzip+verify
+    auto verify = addWork<VerifyBucketWork>(mBuckets, ft.localPath_nogz(),
+                                            hexToBin256(hash));
+    verify->addWork<GetRemoteFileWork>(ft.remoteName(), ft.localPath_gz());
+    assert(mRunning.find(verify->getUniqueName()) == mRunning.end());
+    mRunning.insert(std::make_pair(verify->getUniqueName(), level));
+}
+
+void
+ApplyBucketsWork::addNextWork()
+{
+    size_t nRunning =
+        std::max<size_t>(1, mApp.getConfig().MAX_CONCURRENT_SUBPROCESSES);
+    while (mRunning.size() < nRunning && !mQueued.empty())
+    {
+        addNextDownloadWorker();
+    }
+
+    if (mApp.getConfig().CATCHUP_BULK_LOAD || mApplyLevelWork ||
+        mLevelsLeft == 0)
+    {
+        return;
+    }
+    size_t level = mLevelsLeft - 1;
+    if (!levelVerified(level))
+    {
+        return;
+    }
+    HistoryStateBucket& hsb = mApplyState.currentBuckets.at(level);
+    CLOG(DEBUG, "History") << "ApplyBuckets : starting level: " << level;
+    mApplyLevelWork = addWork<ApplyBucketLevelWork>(
+        level, getBucket(hsb.snap), getBucket(hsb.curr), hsb.next, mApplying);
+}
+
 void
 ApplyBucketsWork::onReset()
 {
-    mLevel = BucketList::kNumLevels - 1;
+    clearChildren();
+    mQueued.clear();
+    mRunning.clear();
+    mVerified = 0;
     mApplying = false;
-    mSnapBucket.reset();
-    mCurrBucket.reset();
-    mSnapApplicator.reset();
-    mCurrApplicator.reset();
+    mLevelsLeft = BucketList::kNumLevels;
+    mApplyLevelWork.reset();
+    mBulkLoader.reset();
+
+    // Each bucket is downloaded for the first level needing it, the oldest
+    // level first; the buckets verified before a retry are kept.
+    std::set<std::string> toDownload(mToDownload.begin(), mToDownload.end());
+    for (size_t i = BucketList::kNumLevels; i-- > 0;)
+    {
+        HistoryStateBucket const& hsb = mApplyState.currentBuckets.at(i);
+        std::vector<std::string> hashes{hsb.snap, hsb.curr};
+        if (hsb.next.hasOutputHash())
+        {
+            hashes.push_back(hsb.next.getOutputHash());
+        }
+        for (auto const& hash : hashes)
+        {
+            if (toDownload.erase(hash) != 0 &&
+                mBuckets.find(hash) == mBuckets.end())
+            {
+                mQueued.push_back(std::make_pair(i, hash));
+            }
+        }
+    }
+    addNextWork();
 }
 
 void
 ApplyBucketsWork::onStart()
 {
-    auto& level = getBucketLevel(mLevel);
-    HistoryStateBucket& i = mApplyState.currentBuckets.at(mLevel);
-    if (mApplying || i.snap != binToHex(level.getSnap()->getHash()))
+    // Without bulk loading, the levels were applied by the children
+    if (!mApp.getConfig().CATCHUP_BULK_LOAD || mBulkLoader)
     {
-        mSnapBucket = getBucket(i.snap);
-        mSnapApplicator =
-            make_unique<BucketApplicator>(mApp.getDatabase(), mSnapBucket);
-        CLOG(DEBUG, "History") << "ApplyBuckets : starting level[" << mLevel
-                               << "].snap = " << i.snap;
-        mApplying = true;
+        return;
     }
-    if (mApplying || i.curr != binToHex(level.getCurr()->getHash()))
+
+    // newest first
+    std::vector<std::shared_ptr<Bucket const>> buckets;
+    for (size_t i = 0; i < BucketList::kNumLevels; ++i)
     {
-        mCurrBucket = getBucket(i.curr);
-        mCurrApplicator =
-            make_unique<BucketApplicator>(mApp.getDatabase(), mCurrBucket);
-        CLOG(DEBUG, "History") << "ApplyBuckets : starting level[" << mLevel
-                               << "].curr = " << i.curr;
-        mApplying = true;
+        HistoryStateBucket& hsb = mApplyState.currentBuckets.at(i);
+        buckets.push_back(getBucket(hsb.curr));
+        buckets.push_back(getBucket(hsb.snap));
     }
+    CLOG(DEBUG, "History") << "ApplyBuckets : starting bulk load";
+    mBulkLoader = make_unique<BucketBulkLoader>(mApp, std::move(buckets));
 }
 
 void
 ApplyBucketsWork::onRun()
 {
-    if (mSnapApplicator && *mSnapApplicator)
+    if (mBulkLoader)
     {
-        mSnapApplicator->advance();
-    }
-    else if (mCurrApplicator && *mCurrApplicator)
-    {
-        mCurrApplicator->advance();
+        mBulkLoader->advance();
     }
     scheduleSuccess();
 }
@@ -859,42 +1204,71 @@ ApplyBucketsWork::onRun()
 Work::State
 ApplyBucketsWork::onSuccess()
 {
-    if ((mSnapApplicator && *mSnapApplicator) ||
-        (mCurrApplicator && *mCurrApplicator))
+    if (mBulkLoader)
     {
-        return WORK_RUNNING;
-    }
-
-    auto& level = getBucketLevel(mLevel);
-    if (mSnapBucket)
-    {
-        level.setSnap(mSnapBucket);
-    }
-    if (mCurrBucket)
-    {
-        level.setCurr(mCurrBucket);
-    }
-    mSnapBucket.reset();
-    mCurrBucket.reset();
-    mSnapApplicator.reset();
-    mCurrApplicator.reset();
+        if (*mBulkLoader)
+        {
+            return WORK_RUNNING;
+        }
+        mBulkLoader.reset();
 
-    HistoryStateBucket& i = mApplyState.currentBuckets.at(mLevel);
-    level.setNext(i.next);
+        for (size_t i = BucketList::kNumLevels; i-- > 0;)
+        {
+            auto& level = getBucketList().getLevel(i);
+            HistoryStateBucket& hsb = mApplyState.currentBuckets.at(i);
+            level.setSnap(getBucket(hsb.snap));
+            level.setCurr(getBucket(hsb.curr));
+            level.setNext(hsb.next);
+        }
 
-    if (mLevel != 0)
-    {
-        --mLevel;
         CLOG(DEBUG, "History")
-            << "ApplyBuckets : starting next level: " << mLevel;
-        return WORK_PENDING;
+            << "ApplyBuckets : bulk load done, restarting merges";
+        getBucketList().restartMerges(mApp, mFirstVerified.header.ledgerSeq);
+        return WORK_SUCCESS;
     }
 
+    assert(mLevelsLeft == 0);
     CLOG(DEBUG, "History") << "ApplyBuckets : done, restarting merges";
     getBucketList().restartMerges(mApp, mFirstVerified.header.ledgerSeq);
     return WORK_SUCCESS;
 }
 
+void
+ApplyBucketsWork::notify(std::string const& childChanged)
+{
+    std::vector<std::string> done;
+    for (auto const& c : mChildren)
+    {
+        if (c.second->getState() == WORK_SUCCESS)
+        {
+            done.push_back(c.first);
+        }
+    }
+    for (auto const& d : done)
+    {
+        mChildren.erase(d);
+        auto i = mRunning.find(d);
+        if (i != mRunning.end())
+        {
+            CLOG(DEBUG, "History") << "Finished " << d << " for level "
+                                   << i->second;
+            mRunning.erase(i);
+            ++mVerified;
+        }
+        else
+        {
+            assert(mApplyLevelWork && mApplyLevelWork->getUniqueName() == d);
+            CLOG(DEBUG, "History") << "ApplyBuckets : applied level: "
+                                   << (mLevelsLeft - 1);
+            mApplyLevelWork.reset();
+            --mLevelsLeft;
+        }
+    }
+    addNextWork();
+    mApp.getHistoryManager().logAndUpdateStatus(true);
+    advance();
+}
+
 ///////////////////////////////////////////////////////////////////////////
 // Apply Ledger Chain
 ///////////////////////////////////////////////////////////////////////////
@@ -908,7 +1282,17 @@ ApplyLedgerChainWork::ApplyLedgerChainWork(
     , mCurrSeq(first)
     , mLastSeq(last)
     , mLastApplied(lastApplied)
+    , mFastReplay(false)
+{
+}
+
+ApplyLedgerChainWork::~ApplyLedgerChainWork()
 {
+    if (mBatch)
+    {
+        // rolled back, as on a crash
+        mApp.getDatabase().setBatchTransactionOpen(false);
+    }
 }
 
 std::string
@@ -925,6 +1309,10 @@ ApplyLedgerChainWork::getStatus() const
 void
 ApplyLedgerChainWork::onReset()
 {
+    if (mBatch)
+    {
+        commitCheckpoint();
+    }
     mLastApplied = mApp.getLedgerManager().getLastClosedLedgerHeader();
     uint32_t step = mApp.getHistoryManager().getCheckpointFrequency();
     auto& lm = mApp.getLedgerManager();
@@ -936,6 +1324,15 @@ ApplyLedgerChainWork::onReset()
     mCurrSeq = mFirstSeq;
     mHdrIn.close();
     mTxIn.close();
+
+    mFastReplay = mApp.getConfig().CATCHUP_FAST_REPLAY;
+    if (mFastReplay && mApp.getHistoryManager().hasAnyWritableHistoryArchive())
+    {
+        // the replayed checkpoints would be published without their history
+        CLOG(WARNING, "History") << "Ignoring CATCHUP_FAST_REPLAY: a history "
+                                    "archive is writable";
+        mFastReplay = false;
+    }
 }
 
 void
@@ -1063,7 +1460,8 @@ ApplyLedgerChainWork::applyHistoryOfSingleLedger()
                                  "hash in replay ledger");
     }
 
-    LedgerCloseData closeData(header.ledgerSeq, txset, header.scpValue);
+    LedgerCloseData closeData(header.ledgerSeq, txset, header.scpValue,
+                              mFastReplay);
     lm.closeLedger(closeData);
 
     CLOG(DEBUG, "History") << "LedgerManager LCL:\n"
@@ -1078,6 +1476,31 @@ ApplyLedgerChainWork::applyHistoryOfSingleLedger()
     return true;
 }
 
+// The ledgers of a checkpoint are closed within a batch, each in a nested
+// transaction, and the history archive state is stored once, at the end: a
+// crash rolls back the whole batch, leaving the database at the previous
+// checkpoint, consistent with the buckets it references. The batch spans the
+// runs of the work, one ledger each, so that the main thread keeps handling
+// its other events meanwhile.
+void
+ApplyLedgerChainWork::beginCheckpoint()
+{
+    mBatch = make_unique<soci::transaction>(mApp.getDatabase().getSession());
+    mApp.getDatabase().setBatchTransactionOpen(true);
+}
+
+// Also called on failure or reset: the ledgers closed so far are kept, as
+// they are when replaying ledger by ledger.
+void
+ApplyLedgerChainWork::commitCheckpoint()
+{
+    auto batch = std::move(mBatch);
+    mApp.getDatabase().setBatchTransactionOpen(false);
+    mApp.getLedgerManager().storeHistoryArchiveState();
+    batch->commit();
+    mApp.getBucketManager().forgetUnreferencedBuckets();
+}
+
 void
 ApplyLedgerChainWork::onStart()
 {
@@ -1089,8 +1512,16 @@ ApplyLedgerChainWork::onRun()
 {
     try
     {
+        if (mFastReplay && !mBatch)
+        {
+            beginCheckpoint();
+        }
         if (!applyHistoryOfSingleLedger())
         {
+            if (mBatch)
+            {
+                commitCheckpoint();
+            }
             mCurrSeq += mApp.getHistoryManager().getCheckpointFrequency();
             openCurrentInputFiles();
         }
@@ -1099,6 +1530,10 @@ ApplyLedgerChainWork::onRun()
     catch (std::runtime_error& e)
     {
         CLOG(ERROR, "History") << "Replay failed: " << e.what();
+        if (mBatch)
+        {
+            commitCheckpoint();
+        }
         scheduleFailure();
     }
 }
@@ -1212,10 +1647,6 @@ CatchupMinimalWork::getStatus() const
         {
             return mApplyWork->getStatus();
         }
-        else if (mDownloadBucketsWork)
-        {
-            return mDownloadBucketsWork->getStatus();
-        }
         else if (mVerifyLedgersWork)
         {
             return mVerifyLedgersWork->getStatus();
@@ -1238,7 +1669,6 @@ CatchupMinimalWork::onReset()
     CatchupWork::onReset();
     mDownloadLedgersWork.reset();
     mVerifyLedgersWork.reset();
-    mDownloadBucketsWork.reset();
     mApplyWork.reset();
 }
 
@@ -1273,39 +1703,19 @@ CatchupMinimalWork::onSuccess()
         return WORK_PENDING;
     }
 
-    // Phase 4: download and verify the buckets themselves.
-    if (!mDownloadBucketsWork)
-    {
-        CLOG(INFO, "History")
-            << "Catchup MINIMAL downloading and verifying buckets";
-        std::vector<std::string> buckets =
-            mRemoteState.differingBuckets(mLocalState);
-        mDownloadBucketsWork = addWork<Work>("download and verify buckets");
-        for (auto const& hash : buckets)
-        {
-            FileTransferInfo ft(*mDownloadDir, HISTORY_FILE_TYPE_BUCKET, hash);
-            // Each bucket gets its own work-chain of download->gunzip->verify
-
-            auto verify = mDownloadBucketsWork->addWork<VerifyBucketWork>(
-                mBuckets, ft.localPath_nogz(), hexToBin256(hash));
-            auto gunzip = verify->addWork<GunzipFileWork>(ft.localPath_gz());
-            gunzip->addWork<GetRemoteFileWork>(ft.remoteName(),
-                                               ft.localPath_gz());
-        }
-        return WORK_PENDING;
-    }
-
     assert(mDownloadLedgersWork->getState() == WORK_SUCCESS);
     assert(mVerifyLedgersWork->getState() == WORK_SUCCESS);
-    assert(mDownloadBucketsWork->getState() == WORK_SUCCESS);
 
-    // Phase 3: apply the buckets.
+    // Phase 4: download, verify and apply the buckets, each level as soon
+    // as its buckets are there.
     if (!mApplyWork)
     {
-        CLOG(INFO, "History") << "Catchup MINIMAL applying buckets for state "
-                              << LedgerManager::ledgerAbbrev(mFirstVerified);
-        mApplyWork =
-            addWork<ApplyBucketsWork>(mBuckets, mRemoteState, mFirstVerified);
+        CLOG(INFO, "History")
+            << "Catchup MINIMAL downloading and applying buckets for state "
+            << LedgerManager::ledgerAbbrev(mFirstVerified);
+        mApplyWork = addWork<ApplyBucketsWork>(
+            mBuckets, mRemoteState, mFirstVerified, *mDownloadDir,
+            mRemoteState.differingBuckets(mLocalState));
         return WORK_PENDING;
     }
 
@@ -1493,6 +1903,9 @@ WriteSnapshotWork::WriteSnapshotWork(Application& app, WorkParent& parent,
 void
 WriteSnapshotWork::onStart()
 {
+    // the snapshot reads the history of the checkpoint from the database
+    mApp.getHistoryManager().getHistoryWriter().flush();
+
     auto handler = callComplete();
     auto snap = mSnapshot;
     auto work = [handler, snap]()
@@ -1716,11 +2129,10 @@ RepairMissingBucketsWork::onReset()
     for (auto const& hash : bucketsToFetch)
     {
         FileTransferInfo ft(*mDownloadDir, HISTORY_FILE_TYPE_BUCKET, hash);
-        // Each bucket gets its own work-chain of download->gunzip->verify
+        // Each bucket gets its own work-chain of download->gunzip+verify
         auto verify = addWork<VerifyBucketWork>(mBuckets, ft.localPath_nogz(),
                                                 hexToBin256(hash));
-        auto gunzip = verify->addWork<GunzipFileWork>(ft.localPath_gz());
-        gunzip->addWork<GetRemoteFileWork>(ft.remoteName(), ft.localPath_gz());
+        verify->addWork<GetRemoteFileWork>(ft.remoteName(), ft.localPath_gz());
     }
 }
 
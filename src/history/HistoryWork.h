@@ -10,12 +10,19 @@
 #include "bucket/Bucket.h"
 #include "bucket/BucketList.h"
 #include "bucket/BucketApplicator.h"
+#include "bucket/BucketBulkLoader.h"
 #include "util/TmpDir.h"
 
+#include <deque>
 #include <memory>
 #include <map>
 #include <string>
 
+namespace soci
+{
+class transaction;
+}
+
 /*
  * This file contains a variety of Work subclasses for the History subsystem.
  */
@@ -41,11 +48,15 @@ class RunCommandWork : public Work
     void onRun() override;
 };
 
+// Transfers to and from archives with a local directory (see HistoryArchive)
+// copy the files in-process, on a worker thread, instead of running commands.
 class GetRemoteFileWork : public RunCommandWork
 {
     std::string mRemote;
     std::string mLocal;
     std::shared_ptr<HistoryArchive const> mArchive;
+    // the archive of the current attempt
+    std::shared_ptr<HistoryArchive const> mCurrentArchive;
     void getCommand(std::string& cmdLine, std::string& outFile) override;
 
   public:
@@ -57,6 +68,7 @@ class GetRemoteFileWork : public RunCommandWork
                       std::shared_ptr<HistoryArchive const> archive = nullptr,
                       size_t maxRetries = Work::RETRY_A_FEW);
     void onReset() override;
+    void onStart() override;
 };
 
 class PutRemoteFileWork : public RunCommandWork
@@ -70,6 +82,7 @@ class PutRemoteFileWork : public RunCommandWork
     PutRemoteFileWork(Application& app, WorkParent& parent,
                       std::string const& remote, std::string const& local,
                       std::shared_ptr<HistoryArchive const> archive);
+    void onStart() override;
 };
 
 class MakeRemoteDirWork : public RunCommandWork
@@ -82,32 +95,39 @@ class MakeRemoteDirWork : public RunCommandWork
     MakeRemoteDirWork(Application& app, WorkParent& parent,
                       std::string const& dir,
                       std::shared_ptr<HistoryArchive const> archive);
+    void onStart() override;
 };
 
-class GzipFileWork : public RunCommandWork
+// Compress or decompress a file in-process, on a worker thread, like gzip and
+// gzip -d would: the original file is removed unless `keepExisting`.
+class GzipFileWork : public Work
 {
     std::string mFilenameNoGz;
     bool mKeepExisting;
-    void getCommand(std::string& cmdLine, std::string& outFile) override;
 
   public:
     GzipFileWork(Application& app, WorkParent& parent,
                  std::string const& filenameNoGz, bool keepExisting = false);
     void onReset() override;
+    void onStart() override;
+    void onRun() override;
 };
 
-class GunzipFileWork : public RunCommandWork
+class GunzipFileWork : public Work
 {
     std::string mFilenameGz;
     bool mKeepExisting;
-    void getCommand(std::string& cmdLine, std::string& outFile) override;
 
   public:
     GunzipFileWork(Application& app, WorkParent& parent,
                    std::string const& filenameGz, bool keepExisting = false);
     void onReset() override;
+    void onStart() override;
+    void onRun() override;
 };
 
+// Verify the hash of a bucket file and adopt it. When the compressed file is
+// there too, as downloaded, it is decompressed and hashed in the same pass.
 class VerifyBucketWork : public Work
 {
     std::map<std::string, std::shared_ptr<Bucket>>& mBuckets;
@@ -123,33 +143,85 @@ class VerifyBucketWork : public Work
     Work::State onSuccess() override;
 };
 
+// Apply the snap and curr buckets of one level of the bucket list, unless
+// the level holds them already, and set its next merge. `applying` is shared
+// by the levels of a bucket list: once a level has been applied, the levels
+// below it are applied whatever they hold.
+class ApplyBucketLevelWork : public Work
+{
+    size_t mLevel;
+    std::shared_ptr<Bucket> mSnapBucket;
+    std::shared_ptr<Bucket> mCurrBucket;
+    FutureBucket mNext;
+    bool& mApplying;
+
+    std::unique_ptr<BucketApplicator> mSnapApplicator;
+    std::unique_ptr<BucketApplicator> mCurrApplicator;
+
+    BucketLevel& getBucketLevel();
+
+  public:
+    ApplyBucketLevelWork(Application& app, WorkParent& parent, size_t level,
+                         std::shared_ptr<Bucket> snap,
+                         std::shared_ptr<Bucket> curr, FutureBucket const& next,
+                         bool& applying);
+
+    void onReset() override;
+    void onStart() override;
+    void onRun() override;
+    Work::State onSuccess() override;
+};
+
+// Download, verify and apply the buckets of `applyState`, as a pipeline: up
+// to MAX_CONCURRENT_SUBPROCESSES buckets at a time go through
+// download->gunzip+verify, in the order their levels are applied (from the
+// oldest level down), and each level is applied as soon as its buckets are
+// verified and the level above it is applied. Only `toDownload` is
+// downloaded, the other buckets are expected in the BucketManager.
+//
+// With CATCHUP_BULK_LOAD, all the buckets are downloaded before they are
+// loaded at once.
 class ApplyBucketsWork : public Work
 {
     std::map<std::string, std::shared_ptr<Bucket>>& mBuckets;
     HistoryArchiveState& mApplyState;
     LedgerHeaderHistoryEntry const& mFirstVerified;
+    TmpDir const& mDownloadDir;
+    std::vector<std::string> const mToDownload;
+
+    // (level, hash) of the buckets left to download, in download order
+    std::deque<std::pair<size_t, std::string>> mQueued;
+    // level of the buckets being downloaded and verified, by work name
+    std::map<std::string, size_t> mRunning;
+    size_t mVerified;
 
     bool mApplying;
-    size_t mLevel;
-    std::shared_ptr<Bucket> mSnapBucket;
-    std::shared_ptr<Bucket> mCurrBucket;
-    std::unique_ptr<BucketApplicator> mSnapApplicator;
-    std::unique_ptr<BucketApplicator> mCurrApplicator;
+    // the levels below this one are left to apply
+    size_t mLevelsLeft;
+    std::shared_ptr<Work> mApplyLevelWork;
+    // loads all the levels at once, see CATCHUP_BULK_LOAD
+    std::unique_ptr<BucketBulkLoader> mBulkLoader;
 
     std::shared_ptr<Bucket> getBucket(std::string const& bucketHash);
-    BucketLevel& getBucketLevel(size_t level);
     BucketList& getBucketList();
+    bool levelVerified(size_t level) const;
+    void addNextDownloadWorker();
+    void addNextWork();
 
   public:
     ApplyBucketsWork(Application& app, WorkParent& parent,
                      std::map<std::string, std::shared_ptr<Bucket>>& buckets,
                      HistoryArchiveState& applyState,
-                     LedgerHeaderHistoryEntry const& firstVerified);
+                     LedgerHeaderHistoryEntry const& firstVerified,
+                     TmpDir const& downloadDir,
+                     std::vector<std::string> const& toDownload);
 
+    std::string getStatus() const override;
     void onReset() override;
     void onStart() override;
     void onRun() override;
     Work::State onSuccess() override;
+    void notify(std::string const& childChanged) override;
 };
 
 class GetHistoryArchiveStateWork : public Work
@@ -235,7 +307,6 @@ class CatchupMinimalWork : public CatchupWork
   protected:
     std::shared_ptr<Work> mDownloadLedgersWork;
     std::shared_ptr<Work> mVerifyLedgersWork;
-    std::shared_ptr<Work> mDownloadBucketsWork;
     std::shared_ptr<Work> mApplyWork;
     handler mEndHandler;
     virtual uint32_t firstCheckpointSeq() const override;
@@ -367,15 +438,23 @@ class ApplyLedgerChainWork : public Work
     XDRInputFileStream mTxIn;
     TransactionHistoryEntry mTxHistoryEntry;
     LedgerHeaderHistoryEntry& mLastApplied;
+    // see CATCHUP_FAST_REPLAY
+    bool mFastReplay;
+    // with the fast replay, the SQL transaction the ledgers of the current
+    // checkpoint are closed in, one per run
+    std::unique_ptr<soci::transaction> mBatch;
 
     TxSetFramePtr getCurrentTxSet();
     void openCurrentInputFiles();
     bool applyHistoryOfSingleLedger();
+    void beginCheckpoint();
+    void commitCheckpoint();
 
   public:
     ApplyLedgerChainWork(Application& app, WorkParent& parent,
                          TmpDir const& downloadDir, uint32_t first,
                          uint32_t last, LedgerHeaderHistoryEntry& lastApplied);
+    ~ApplyLedgerChainWork();
     std::string getStatus() const override;
     void onReset() override;
     void onStart() override;
@@ -0,0 +1,470 @@
+// Copyright 2017 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "util/asio.h"
+#include "history/HistoryWriter.h"
+#include "crypto/Hex.h"
+#include "database/Database.h"
+#include "herder/Herder.h"
+#include "main/Application.h"
+#include "main/Config.h"
+#include "transactions/TransactionFrame.h"
+#include "util/Logging.h"
+#include "util/make_unique.h"
+#include "medida/counter.h"
+#include "medida/meter.h"
+#include "medida/metrics_registry.h"
+#include "medida/timer.h"
+
+namespace stellar
+{
+
+size_t const HistoryWriter::MAX_PENDING;
+
+HistoryWriter::HistoryWriter(Application& app)
+    : mApp(app)
+    , mPipelined(app.getConfig().PIPELINED_LEDGER_CLOSE)
+    , mThreaded(mPipelined && !app.getDatabase().isSqlite())
+    , mStopping(false)
+    , mTimer(app)
+    , mScheduled(false)
+    , mPending(app.getMetrics().NewCounter({"history", "writer", "pending"}))
+    , mFailure(app.getMetrics().NewMeter({"history", "writer", "failure"},
+                                         "failure"))
+    , mWrite(app.getMetrics().NewTimer({"history", "writer", "write"}))
+    , mFlush(app.getMetrics().NewTimer({"history", "writer", "flush"}))
+{
+    if (mThreaded)
+    {
+        mSession = make_unique<soci::session>();
+        mSession->open(app.getConfig().DATABASE);
+        mThread = std::thread([this]()
+                              {
+                                  runThread();
+                              });
+    }
+}
+
+HistoryWriter::~HistoryWriter()
+{
+    if (mThread.joinable())
+    {
+        // the thread writes what is queued before exiting
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mStopping = true;
+        }
+        mCond.notify_all();
+        mThread.join();
+    }
+}
+
+bool
+HistoryWriter::isPipelined() const
+{
+    return mPipelined;
+}
+
+void
+HistoryWriter::addTransactionFee(LedgerEntryChanges const& changes)
+{
+    mFeeChanges.emplace_back(changes);
+}
+
+void
+HistoryWriter::addTransaction(TransactionFrame const& tx,
+                              TransactionResultPair const& result,
+                              TransactionMeta&& meta)
+{
+    mEnvelopes.emplace_back(tx.getEnvelope());
+    mResults.emplace_back(result);
+    mMetas.emplace_back(std::move(meta));
+}
+
+void
+HistoryWriter::journalLedger(uint32_t ledgerSeq)
+{
+    if (mFeeChanges.size() != mEnvelopes.size())
+    {
+        throw std::runtime_error("fee history doesn't match transactions");
+    }
+
+    Job job{ledgerSeq, KIND_TRANSACTIONS,
+            xdr::xdr_to_opaque(mEnvelopes, mResults, mMetas, mFeeChanges)};
+    mEnvelopes.clear();
+    mResults.clear();
+    mMetas.clear();
+    mFeeChanges.clear();
+    journal(std::move(job));
+}
+
+void
+HistoryWriter::journalSCPHistory(uint32_t ledgerSeq,
+                                 xdr::xvector<SCPEnvelope> const& envelopes,
+                                 xdr::xvector<SCPQuorumSet> const& qSets)
+{
+    journal(Job{ledgerSeq, KIND_SCP, xdr::xdr_to_opaque(envelopes, qSets)});
+}
+
+void
+HistoryWriter::journal(Job&& job)
+{
+    auto& db = mApp.getDatabase();
+
+    {
+        auto prep = db.getPreparedStatement(
+            "DELETE FROM historyjournal WHERE ledgerseq = :l AND kind = :k");
+        auto& st = prep.statement();
+        st.exchange(soci::use(job.mLedgerSeq));
+        st.exchange(soci::use(job.mKind));
+        st.define_and_bind();
+        {
+            auto timer = db.getDeleteTimer("historyjournal");
+            st.execute(true);
+        }
+    }
+
+    BinaryColumn data(db, db.getSession());
+    data.set(job.mData);
+
+    auto prep = db.getPreparedStatement(
+        "INSERT INTO historyjournal (ledgerseq, kind, data) VALUES "
+        "(:l, :k, :d)");
+    auto& st = prep.statement();
+    st.exchange(soci::use(job.mLedgerSeq));
+    st.exchange(soci::use(job.mKind));
+    st.exchange(data.use());
+    st.define_and_bind();
+    {
+        auto timer = db.getInsertTimer("historyjournal");
+        st.execute(true);
+    }
+    if (st.get_affected_rows() != 1)
+    {
+        throw std::runtime_error("Could not update data in SQL");
+    }
+
+    mJournaled.emplace_back(std::move(job));
+}
+
+void
+HistoryWriter::submit()
+{
+    if (mJournaled.empty())
+    {
+        return;
+    }
+
+    if (!mThreaded)
+    {
+        for (auto& job : mJournaled)
+        {
+            mQueue.emplace_back(std::move(job));
+        }
+        mJournaled.clear();
+        while (mQueue.size() > MAX_PENDING)
+        {
+            write(mApp.getDatabase().getSession(), mQueue.front());
+            mQueue.pop_front();
+        }
+        mPending.set_count(mQueue.size());
+        scheduleOnMainThread();
+        return;
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        mCond.wait(lock, [this]()
+                   {
+                       return mQueue.size() < MAX_PENDING || mError;
+                   });
+        rethrowError();
+        for (auto& job : mJournaled)
+        {
+            mQueue.emplace_back(std::move(job));
+        }
+        mPending.set_count(mQueue.size());
+    }
+    mJournaled.clear();
+    mCond.notify_all();
+}
+
+void
+HistoryWriter::flush()
+{
+    auto timer = mFlush.TimeScope();
+
+    if (!mThreaded)
+    {
+        while (!mQueue.empty())
+        {
+            write(mApp.getDatabase().getSession(), mQueue.front());
+            mQueue.pop_front();
+        }
+        mPending.set_count(0);
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock(mMutex);
+    mCond.wait(lock, [this]()
+               {
+                   return mQueue.empty() || mError;
+               });
+    rethrowError();
+}
+
+void
+HistoryWriter::recover()
+{
+    auto& db = mApp.getDatabase();
+    auto& sess = db.getSession();
+
+    std::vector<Job> jobs;
+    {
+        Job job;
+        BinaryColumn data(db, sess);
+        soci::statement st =
+            (sess.prepare << "SELECT ledgerseq, kind, data FROM historyjournal "
+                             "ORDER BY ledgerseq, kind",
+             soci::into(job.mLedgerSeq), soci::into(job.mKind), data.into());
+        st.execute(true);
+        while (st.got_data())
+        {
+            data.get(job.mData);
+            jobs.emplace_back(job);
+            st.fetch();
+        }
+    }
+
+    if (jobs.empty())
+    {
+        return;
+    }
+
+    CLOG(INFO, "History") << "Writing the journaled history of "
+                          << jobs.size() << " entries, from ledger "
+                          << jobs.front().mLedgerSeq;
+    for (auto const& job : jobs)
+    {
+        write(sess, job);
+    }
+}
+
+size_t
+HistoryWriter::getPendingCount()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mQueue.size();
+}
+
+void
+HistoryWriter::runThread()
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+    while (true)
+    {
+        mCond.wait(lock, [this]()
+                   {
+                       return !mQueue.empty() || mStopping;
+                   });
+        if (mQueue.empty())
+        {
+            return;
+        }
+
+        // the main thread only appends to the queue, which leaves the front
+        // job in place
+        Job const& job = mQueue.front();
+        lock.unlock();
+        std::exception_ptr error;
+        try
+        {
+            write(*mSession, job);
+        }
+        catch (std::exception& e)
+        {
+            error = std::current_exception();
+            CLOG(FATAL, "History") << "Could not write history of ledger "
+                                   << job.mLedgerSeq << ": " << e.what();
+        }
+        catch (...)
+        {
+            error = std::current_exception();
+            CLOG(FATAL, "History") << "Could not write history of ledger "
+                                   << job.mLedgerSeq;
+        }
+        lock.lock();
+        if (error)
+        {
+            // fatal, see rethrowError(): the rest stays in the journal, for
+            // recover() on the next start
+            CLOG(FATAL, "History") << "History writer stopped, restart to "
+                                      "write the journaled history";
+            mFailure.Mark();
+            mError = error;
+            mQueue.clear();
+        }
+        else
+        {
+            mQueue.pop_front();
+        }
+        mPending.set_count(mQueue.size());
+        mCond.notify_all();
+    }
+}
+
+void
+HistoryWriter::scheduleOnMainThread()
+{
+    if (mScheduled || mQueue.empty())
+    {
+        return;
+    }
+    mScheduled = true;
+    mTimer.expires_from_now(std::chrono::seconds(0));
+    mTimer.async_wait(
+        [this]()
+        {
+            writeNextOnMainThread();
+        },
+        &VirtualTimer::onFailureNoop);
+}
+
+void
+HistoryWriter::writeNextOnMainThread()
+{
+    mScheduled = false;
+    if (!mQueue.empty())
+    {
+        write(mApp.getDatabase().getSession(), mQueue.front());
+        mQueue.pop_front();
+        mPending.set_count(mQueue.size());
+    }
+    scheduleOnMainThread();
+}
+
+void
+HistoryWriter::rethrowError()
+{
+    // a failed write is never cleared: the history tables can only be
+    // completed by recover(), on the next start
+    if (mError)
+    {
+        std::rethrow_exception(mError);
+    }
+}
+
+void
+HistoryWriter::write(soci::session& sess, Job const& job)
+{
+    auto timer = mWrite.TimeScope();
+
+    soci::transaction tx(sess);
+    switch (job.mKind)
+    {
+    case KIND_TRANSACTIONS:
+        writeTransactions(sess, job.mLedgerSeq, job.mData);
+        break;
+    case KIND_SCP:
+        writeSCPHistory(sess, job.mLedgerSeq, job.mData);
+        break;
+    default:
+        throw std::runtime_error("unknown history journal entry");
+    }
+    sess << "DELETE FROM historyjournal WHERE ledgerseq = :l AND kind = :k",
+        soci::use(job.mLedgerSeq), soci::use(job.mKind);
+    tx.commit();
+}
+
+void
+HistoryWriter::writeTransactions(soci::session& sess, uint32_t ledgerSeq,
+                                 xdr::opaque_vec<> const& data)
+{
+    xdr::xvector<TransactionEnvelope> envelopes;
+    xdr::xvector<TransactionResultPair> results;
+    xdr::xvector<TransactionMeta> metas;
+    xdr::xvector<LedgerEntryChanges> feeChanges;
+    xdr::xdr_from_opaque(data, envelopes, results, metas, feeChanges);
+    if (results.size() != envelopes.size() ||
+        metas.size() != envelopes.size() ||
+        feeChanges.size() != envelopes.size())
+    {
+        throw std::runtime_error("corrupt history journal entry");
+    }
+
+    // rows written before a crash are written again
+    sess << "DELETE FROM txhistory WHERE ledgerseq = :l", soci::use(ledgerSeq);
+    sess << "DELETE FROM txfeehistory WHERE ledgerseq = :l",
+        soci::use(ledgerSeq);
+
+    auto& db = mApp.getDatabase();
+    std::string txID;
+    int txIndex = 0;
+    BinaryColumn body(db, sess), result(db, sess), meta(db, sess);
+    BinaryColumn changes(db, sess);
+
+    soci::statement st =
+        (sess.prepare << "INSERT INTO txhistory "
+                         "( txid, ledgerseq, txindex,  txbody, txresult, "
+                         "txmeta) VALUES "
+                         "(:id,  :seq,      :txindex, :txb,   :txres,   "
+                         ":meta)",
+         soci::use(txID), soci::use(ledgerSeq), soci::use(txIndex),
+         body.use(), result.use(), meta.use());
+    soci::statement stFee =
+        (sess.prepare << "INSERT INTO txfeehistory "
+                         "( txid, ledgerseq, txindex,  txchanges) VALUES "
+                         "(:id,  :seq,      :txindex, :txchanges)",
+         soci::use(txID), soci::use(ledgerSeq), soci::use(txIndex),
+         changes.use());
+
+    for (size_t i = 0; i < envelopes.size(); i++)
+    {
+        txID = binToHex(results[i].transactionHash);
+        txIndex = static_cast<int>(i) + 1;
+        body.set(xdr::xdr_to_opaque(envelopes[i]));
+        result.set(xdr::xdr_to_opaque(results[i]));
+        meta.set(xdr::xdr_to_opaque(metas[i]));
+        changes.set(xdr::xdr_to_opaque(feeChanges[i]));
+
+        st.execute(true);
+        if (st.get_affected_rows() != 1)
+        {
+            throw std::runtime_error("Could not update data in SQL");
+        }
+        stFee.execute(true);
+        if (stFee.get_affected_rows() != 1)
+        {
+            throw std::runtime_error("Could not update data in SQL");
+        }
+    }
+}
+
+void
+HistoryWriter::writeSCPHistory(soci::session& sess, uint32_t ledgerSeq,
+                               xdr::opaque_vec<> const& data)
+{
+    xdr::xvector<SCPEnvelope> envelopes;
+    xdr::xvector<SCPQuorumSet> qSets;
+    xdr::xdr_from_opaque(data, envelopes, qSets);
+    Herder::storeSCPHistory(mApp.getDatabase(), sess, ledgerSeq, envelopes,
+                            qSets);
+}
+
+void
+HistoryWriter::dropAll(Database& db)
+{
+    db.getSession() << "DROP TABLE IF EXISTS historyjournal";
+
+    // one row per ledger and kind of history (transactions, SCP messages)
+    db.getSession() << "CREATE TABLE historyjournal ("
+                       "ledgerseq   INT NOT NULL CHECK (ledgerseq >= 0),"
+                       "kind        INT NOT NULL,"
+                       "data        "
+                    << (db.isSqlite() ? "BLOB" : "BYTEA")
+                    << " NOT NULL,"
+                       "PRIMARY KEY (ledgerseq, kind)"
+                       ")";
+}
+}
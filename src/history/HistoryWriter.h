@@ -0,0 +1,161 @@
+#pragma once
+
+// Copyright 2017 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "overlay/StellarXDR.h"
+#include "util/NonCopyable.h"
+#include "util/Timer.h"
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace soci
+{
+class session;
+}
+
+namespace medida
+{
+class Counter;
+class Meter;
+class Timer;
+}
+
+namespace stellar
+{
+
+class Application;
+class Database;
+class TransactionFrame;
+
+/**
+ * Writes the append-only history of closed ledgers -- the txhistory,
+ * txfeehistory and scphistory rows -- off the ledger-close path, when
+ * PIPELINED_LEDGER_CLOSE is set.
+ *
+ * The history of a ledger is first journaled: serialized into a single
+ * historyjournal row, within the transaction that closes the ledger (or that
+ * saves its SCP messages). Once that transaction is committed, the writer
+ * expands the journal row into the history tables and deletes it, in a
+ * transaction of its own. With PostgreSQL this happens on a dedicated thread
+ * and session; SQLite only allows one writing connection, so the writer runs
+ * on the main thread instead, one ledger per event, between the events of
+ * the consensus round.
+ *
+ * At most MAX_PENDING ledgers wait to be written, beyond that submit() waits
+ * for the writer. flush() is the durability barrier: once it returns, the
+ * history of every closed ledger is in the history tables; it runs before a
+ * checkpoint is published. On startup, recover() replays the journal rows
+ * left by a crash, from the last ledger whose history was written on.
+ *
+ * A failed write is fatal, as the history of ledgers already closed would be
+ * missing from the history tables. On the main thread the error propagates
+ * from the write. The writer thread logs it and stops, and every later
+ * submit() or flush() rethrows it, failing the ledger close. Either way, the
+ * history left in the journal is written by recover() on the next start.
+ */
+class HistoryWriter : NonMovableOrCopyable
+{
+  public:
+    static size_t const MAX_PENDING = 16;
+
+    explicit HistoryWriter(Application& app);
+    ~HistoryWriter();
+
+    // true if the history is to be journaled rather than written directly
+    bool isPipelined() const;
+
+    // collect the history of the ledger being closed, in apply order
+    void addTransactionFee(LedgerEntryChanges const& changes);
+    void addTransaction(TransactionFrame const& tx,
+                        TransactionResultPair const& result,
+                        TransactionMeta&& meta);
+
+    // journal what was collected for `ledgerSeq`, within the transaction
+    // closing the ledger
+    void journalLedger(uint32_t ledgerSeq);
+    // journal the SCP messages externalizing `ledgerSeq`, within a
+    // transaction of the caller; replaces any previous ones
+    void journalSCPHistory(uint32_t ledgerSeq,
+                           xdr::xvector<SCPEnvelope> const& envelopes,
+                           xdr::xvector<SCPQuorumSet> const& qSets);
+
+    // hands what was journaled to the writer, once the journaling
+    // transaction is committed
+    void submit();
+
+    // waits until everything submitted is written
+    void flush();
+
+    // writes the journal rows found in the database; to be called on
+    // startup, before anything is journaled
+    void recover();
+
+    // number of journaled ledgers not written yet
+    size_t getPendingCount();
+
+    static void dropAll(Database& db);
+
+  private:
+    enum Kind
+    {
+        KIND_TRANSACTIONS = 0,
+        KIND_SCP = 1
+    };
+
+    struct Job
+    {
+        uint32_t mLedgerSeq;
+        int mKind;
+        xdr::opaque_vec<> mData;
+    };
+
+    Application& mApp;
+    bool const mPipelined;
+    bool const mThreaded;
+
+    // history of the ledger being closed
+    xdr::xvector<TransactionEnvelope> mEnvelopes;
+    xdr::xvector<TransactionResultPair> mResults;
+    xdr::xvector<TransactionMeta> mMetas;
+    xdr::xvector<LedgerEntryChanges> mFeeChanges;
+
+    // journaled, not submitted yet
+    std::vector<Job> mJournaled;
+
+    std::mutex mMutex;
+    std::condition_variable mCond;
+    // jobs leave the queue once written
+    std::deque<Job> mQueue;
+    bool mStopping;
+    // set by the first failed write, for good
+    std::exception_ptr mError;
+    std::unique_ptr<soci::session> mSession;
+    std::thread mThread;
+    VirtualTimer mTimer;
+    bool mScheduled;
+
+    medida::Counter& mPending;
+    medida::Meter& mFailure;
+    medida::Timer& mWrite;
+    medida::Timer& mFlush;
+
+    void journal(Job&& job);
+    void runThread();
+    void scheduleOnMainThread();
+    void writeNextOnMainThread();
+    void rethrowError();
+    void write(soci::session& sess, Job const& job);
+    void writeTransactions(soci::session& sess, uint32_t ledgerSeq,
+                           xdr::opaque_vec<> const& data);
+    void writeSCPHistory(soci::session& sess, uint32_t ledgerSeq,
+                         xdr::opaque_vec<> const& data);
+};
+}
@@ -9,6 +9,7 @@
 #include "LedgerDelta.h"
 #include "ledger/LedgerManager.h"
 #include "util/basen.h"
+#include "util/make_unique.h"
 #include "util/types.h"
 #include "lib/util/format.h"
 #include <algorithm>
@@ -215,15 +216,15 @@ AccountFrame::loadAccount(AccountID const& accountID, Database& db)
     LedgerKey key;
     key.type(ACCOUNT);
     key.account().accountID = accountID;
-    if (cachedEntryExists(key, db))
+    std::shared_ptr<LedgerEntry const> p;
+    if (getCachedEntry(key, p, db))
     {
-        auto p = getCachedEntry(key, db);
         return p ? std::make_shared<AccountFrame>(*p) : nullptr;
     }
 
-    std::string actIDStrKey = PubKeyUtils::toStrKey(accountID);
+    AccountIDColumn actID(db), inflationDest(db);
+    actID.set(accountID);
 
-    std::string publicKey, inflationDest, creditAuthKey;
     std::string homeDomain, thresholds;
     soci::indicator inflationDestInd;
 
@@ -239,13 +240,13 @@ AccountFrame::loadAccount(AccountID const& accountID, Database& db)
     st.exchange(into(account.balance));
     st.exchange(into(account.seqNum));
     st.exchange(into(account.numSubEntries));
-    st.exchange(into(inflationDest, inflationDestInd));
+    st.exchange(inflationDest.into(inflationDestInd));
     st.exchange(into(homeDomain));
     st.exchange(into(account.accountType));
     st.exchange(into(thresholds));
     st.exchange(into(account.flags));
     st.exchange(into(res->getLastModified()));
-    st.exchange(use(actIDStrKey));
+    st.exchange(actID.use());
     st.define_and_bind();
     {
         auto timer = db.getSelectTimer("account");
@@ -265,15 +266,14 @@ AccountFrame::loadAccount(AccountID const& accountID, Database& db)
 
     if (inflationDestInd == soci::i_ok)
     {
-        account.inflationDest.activate() =
-            PubKeyUtils::fromStrKey(inflationDest);
+        account.inflationDest.activate() = inflationDest.get();
     }
 
     account.signers.clear();
 
     if (account.numSubEntries != 0)
     {
-        auto signers = loadSigners(db, actIDStrKey);
+        auto signers = loadSigners(db, accountID);
         account.signers.insert(account.signers.begin(), signers.begin(),
                                signers.end());
     }
@@ -287,17 +287,18 @@ AccountFrame::loadAccount(AccountID const& accountID, Database& db)
 }
 
 std::vector<Signer>
-AccountFrame::loadSigners(Database& db, std::string const& actIDStrKey)
+AccountFrame::loadSigners(Database& db, AccountID const& accountID)
 {
     std::vector<Signer> res;
-    string pubKey;
+    AccountIDColumn actID(db), pubKey(db);
+    actID.set(accountID);
     Signer signer;
 
     auto prep2 = db.getPreparedStatement("SELECT publickey, weight, signertype FROM "
                                          "signers WHERE accountid =:id");
     auto& st2 = prep2.statement();
-    st2.exchange(use(actIDStrKey));
-    st2.exchange(into(pubKey));
+    st2.exchange(actID.use());
+    st2.exchange(pubKey.into());
     st2.exchange(into(signer.weight));
     st2.exchange(into(signer.signerType));
     st2.define_and_bind();
@@ -307,7 +308,7 @@ AccountFrame::loadSigners(Database& db, std::string const& actIDStrKey)
     }
     while (st2.got_data())
     {
-        signer.pubKey = PubKeyUtils::fromStrKey(pubKey);
+        signer.pubKey = pubKey.get();
         res.push_back(signer);
         st2.fetch();
     }
@@ -320,12 +321,14 @@ AccountFrame::loadSigners(Database& db, std::string const& actIDStrKey)
 bool
 AccountFrame::exists(Database& db, LedgerKey const& key)
 {
-    if (cachedEntryExists(key, db) && getCachedEntry(key, db) != nullptr)
+    std::shared_ptr<LedgerEntry const> cached;
+    if (getCachedEntry(key, cached, db))
     {
-        return true;
+        return cached != nullptr;
     }
 
-    std::string actIDStrKey = PubKeyUtils::toStrKey(key.account().accountID);
+    AccountIDColumn actID(db);
+    actID.set(key.account().accountID);
     int exists = 0;
     {
         auto timer = db.getSelectTimer("account-exists");
@@ -333,7 +336,7 @@ AccountFrame::exists(Database& db, LedgerKey const& key)
             db.getPreparedStatement("SELECT EXISTS (SELECT NULL FROM accounts "
                                     "WHERE accountid=:v1)");
         auto& st = prep.statement();
-        st.exchange(use(actIDStrKey));
+        st.exchange(actID.use());
         st.exchange(into(exists));
         st.define_and_bind();
         st.execute(true);
@@ -361,28 +364,123 @@ AccountFrame::storeDelete(LedgerDelta& delta, Database& db,
 {
     flushCachedEntry(key, db);
 
-    std::string actIDStrKey = PubKeyUtils::toStrKey(key.account().accountID);
+    AccountIDColumn actID(db);
+    actID.set(key.account().accountID);
+    if (delta.isWriteBack(key))
+    {
+        delta.storePending(key, nullptr);
+    }
+    else
     {
         auto timer = db.getDeleteTimer("account");
         auto prep = db.getPreparedStatement(
             "DELETE from accounts where accountid= :v1");
         auto& st = prep.statement();
-        st.exchange(soci::use(actIDStrKey));
+        st.exchange(actID.use());
         st.define_and_bind();
         st.execute(true);
     }
     {
+        // signers are always written right away
         auto timer = db.getDeleteTimer("signer");
         auto prep =
             db.getPreparedStatement("DELETE from signers where accountid= :v1");
         auto& st = prep.statement();
-        st.exchange(soci::use(actIDStrKey));
+        st.exchange(actID.use());
         st.define_and_bind();
         st.execute(true);
     }
     delta.deleteEntry(key);
 }
 
+void
+AccountFrame::storePending(Database& db,
+                           std::vector<LedgerEntry const*> const& live,
+                           std::vector<LedgerKey const*> const& dead)
+{
+    size_t const nColumns = 10;
+    for (size_t begin = 0; begin < live.size(); begin += PENDING_BATCH_ROWS)
+    {
+        size_t n = std::min(PENDING_BATCH_ROWS, live.size() - begin);
+
+        std::string sql(db.isSqlite() ? "INSERT OR REPLACE INTO accounts "
+                                      : "INSERT INTO accounts ");
+        sql += "( accountid, balance, seqnum, numsubentries, inflationdest, "
+               "homedomain, accounttype, thresholds, flags, lastmodified ) "
+               "VALUES ";
+        sql += batchPlaceholders(n, nColumns);
+        if (!db.isSqlite())
+        {
+            sql += " ON CONFLICT (accountid) DO UPDATE SET "
+                   "balance = excluded.balance, seqnum = excluded.seqnum, "
+                   "numsubentries = excluded.numsubentries, "
+                   "inflationdest = excluded.inflationdest, "
+                   "homedomain = excluded.homedomain, "
+                   "accounttype = excluded.accounttype, "
+                   "thresholds = excluded.thresholds, "
+                   "flags = excluded.flags, "
+                   "lastmodified = excluded.lastmodified";
+        }
+
+        std::vector<std::unique_ptr<AccountIDColumn>> ids, inflationDests;
+        std::vector<std::string> homeDomains(n), thresholds(n);
+        std::vector<soci::indicator> inflationInds(n, soci::i_null);
+
+        auto prep = db.getPreparedStatement(sql);
+        auto& st = prep.statement();
+        for (size_t i = 0; i < n; i++)
+        {
+            LedgerEntry const& le = *live[begin + i];
+            AccountEntry const& account = le.data.account();
+
+            ids.emplace_back(make_unique<AccountIDColumn>(db));
+            ids[i]->set(account.accountID);
+            inflationDests.emplace_back(make_unique<AccountIDColumn>(db));
+            if (account.inflationDest)
+            {
+                inflationDests[i]->set(*account.inflationDest);
+                inflationInds[i] = soci::i_ok;
+            }
+            homeDomains[i] = account.homeDomain;
+            thresholds[i] = bn::encode_b64(account.thresholds);
+
+            st.exchange(ids[i]->use());
+            st.exchange(use(account.balance));
+            st.exchange(use(account.seqNum));
+            st.exchange(use(account.numSubEntries));
+            st.exchange(inflationDests[i]->use(inflationInds[i]));
+            st.exchange(use(homeDomains[i]));
+            st.exchange(use(account.accountType));
+            st.exchange(use(thresholds[i]));
+            st.exchange(use(account.flags));
+            st.exchange(use(le.lastModifiedLedgerSeq));
+        }
+        st.define_and_bind();
+        {
+            auto timer = db.getUpdateTimer("account-batch");
+            st.execute(true);
+        }
+
+        if (st.get_affected_rows() != static_cast<long long>(n))
+        {
+            throw std::runtime_error("Could not update data in SQL");
+        }
+    }
+
+    for (auto key : dead)
+    {
+        AccountIDColumn actID(db);
+        actID.set(key->account().accountID);
+        auto timer = db.getDeleteTimer("account");
+        auto prep =
+            db.getPreparedStatement("DELETE from accounts where accountid= :v1");
+        auto& st = prep.statement();
+        st.exchange(actID.use());
+        st.define_and_bind();
+        st.execute(true);
+    }
+}
+
 void
 AccountFrame::storeUpdate(LedgerDelta& delta, Database& db, bool insert)
 {
@@ -392,7 +490,27 @@ AccountFrame::storeUpdate(LedgerDelta& delta, Database& db, bool insert)
 
     flushCachedEntry(db);
 
-    std::string actIDStrKey = PubKeyUtils::toStrKey(mAccountEntry.accountID);
+    if (delta.isWriteBack(getKey()))
+    {
+        delta.storePending(getKey(),
+                           std::make_shared<LedgerEntry const>(mEntry));
+        if (insert)
+        {
+            delta.addEntry(*this);
+        }
+        else
+        {
+            delta.modEntry(*this);
+        }
+        if (mUpdateSigners)
+        {
+            applySigners(db, insert);
+        }
+        return;
+    }
+
+    AccountIDColumn actID(db);
+    actID.set(mAccountEntry.accountID);
     std::string sql;
 
     if (insert)
@@ -415,12 +533,11 @@ AccountFrame::storeUpdate(LedgerDelta& delta, Database& db, bool insert)
     auto prep = db.getPreparedStatement(sql);
 
     soci::indicator inflation_ind = soci::i_null;
-    string inflationDestStrKey;
+    AccountIDColumn inflationDest(db);
 
     if (mAccountEntry.inflationDest)
     {
-        inflationDestStrKey =
-            PubKeyUtils::toStrKey(*mAccountEntry.inflationDest);
+        inflationDest.set(*mAccountEntry.inflationDest);
         inflation_ind = soci::i_ok;
     }
 
@@ -428,11 +545,11 @@ AccountFrame::storeUpdate(LedgerDelta& delta, Database& db, bool insert)
 
     {
         soci::statement& st = prep.statement();
-        st.exchange(use(actIDStrKey, "id"));
+        st.exchange(actID.use("id"));
         st.exchange(use(mAccountEntry.balance, "v1"));
         st.exchange(use(mAccountEntry.seqNum, "v2"));
         st.exchange(use(mAccountEntry.numSubEntries, "v3"));
-        st.exchange(use(inflationDestStrKey, inflation_ind, "v4"));
+        st.exchange(inflationDest.use(inflation_ind, "v4"));
         string homeDomain(mAccountEntry.homeDomain);
         st.exchange(use(homeDomain, "v5"));
         st.exchange(use(mAccountEntry.accountType, "v6"));
@@ -469,7 +586,8 @@ AccountFrame::storeUpdate(LedgerDelta& delta, Database& db, bool insert)
 void
 AccountFrame::applySigners(Database& db, bool insert)
 {
-    std::string actIDStrKey = PubKeyUtils::toStrKey(mAccountEntry.accountID);
+    AccountIDColumn actID(db);
+    actID.set(mAccountEntry.accountID);
 
     // generates a diff with the signers stored in the database
 
@@ -477,7 +595,7 @@ AccountFrame::applySigners(Database& db, bool insert)
     std::vector<Signer> signers;
     if (!insert)
     {
-        signers = loadSigners(db, actIDStrKey);
+        signers = loadSigners(db, mAccountEntry.accountID);
     }
 
     auto it_new = mAccountEntry.signers.begin();
@@ -509,8 +627,8 @@ AccountFrame::applySigners(Database& db, bool insert)
         {
             if (it_new->weight != it_old->weight)
             {
-                std::string signerStrKey =
-                    PubKeyUtils::toStrKey(it_new->pubKey);
+                AccountIDColumn signerKey(db);
+                signerKey.set(it_new->pubKey);
                 auto timer = db.getUpdateTimer("signer");
                 auto prep2 = db.getPreparedStatement(
                     "UPDATE signers set weight=:v1, signertype = :v2 WHERE "
@@ -518,8 +636,8 @@ AccountFrame::applySigners(Database& db, bool insert)
                 auto& st = prep2.statement();
                 st.exchange(use(it_new->weight));
                 st.exchange(use(it_new->signerType));
-                st.exchange(use(actIDStrKey));
-                st.exchange(use(signerStrKey));
+                st.exchange(actID.use());
+                st.exchange(signerKey.use());
                 st.define_and_bind();
                 st.execute(true);
                 if (st.get_affected_rows() != 1)
@@ -534,14 +652,15 @@ AccountFrame::applySigners(Database& db, bool insert)
         else if (added)
         {
             // signer was added
-            std::string signerStrKey = PubKeyUtils::toStrKey(it_new->pubKey);
+            AccountIDColumn signerKey(db);
+            signerKey.set(it_new->pubKey);
 
             auto prep2 = db.getPreparedStatement("INSERT INTO signers "
                                                  "(accountid,publickey,weight,signertype) "
                                                  "VALUES (:v1,:v2,:v3,:v4)");
             auto& st = prep2.statement();
-            st.exchange(use(actIDStrKey));
-            st.exchange(use(signerStrKey));
+            st.exchange(actID.use());
+            st.exchange(signerKey.use());
             st.exchange(use(it_new->weight));
             st.exchange(use(it_new->signerType));
             st.define_and_bind();
@@ -557,14 +676,15 @@ AccountFrame::applySigners(Database& db, bool insert)
         else
         {
             // signer was deleted
-            std::string signerStrKey = PubKeyUtils::toStrKey(it_old->pubKey);
+            AccountIDColumn signerKey(db);
+            signerKey.set(it_old->pubKey);
 
             auto prep2 = db.getPreparedStatement("DELETE from signers WHERE "
                                                  "accountid=:v2 AND "
                                                  "publickey=:v3");
             auto& st = prep2.statement();
-            st.exchange(use(actIDStrKey));
-            st.exchange(use(signerStrKey));
+            st.exchange(actID.use());
+            st.exchange(signerKey.use());
             st.define_and_bind();
             {
                 auto timer = db.getDeleteTimer("signer");
@@ -608,7 +728,57 @@ AccountFrame::processForInflation(
     soci::session& session = db.getSession();
 
     InflationVotes v;
-    std::string inflationDest;
+    AccountIDColumn inflationDest(db);
+
+    if (db.hasBinaryAccountIDs())
+    {
+        // raw keys do not sort like their StrKeys, so fetch every tie at the
+        // cut-off and break ties in StrKey order like the query below does
+        std::vector<std::pair<std::string, InflationVotes>> winners;
+        soci::statement st =
+            (session.prepare
+                 << "SELECT"
+                    " sum(balance) AS votes, inflationdest FROM accounts WHERE"
+                    " inflationdest IS NOT NULL"
+                    " AND balance >= 1000000000 GROUP BY inflationdest"
+                    " ORDER BY votes DESC",
+             into(v.mVotes), inflationDest.into());
+
+        st.execute(true);
+
+        while (st.got_data())
+        {
+            if (winners.size() >= static_cast<size_t>(maxWinners) &&
+                v.mVotes < winners.back().second.mVotes)
+            {
+                break;
+            }
+            v.mInflationDest = inflationDest.get();
+            winners.emplace_back(PubKeyUtils::toStrKey(v.mInflationDest), v);
+            st.fetch();
+        }
+
+        std::sort(winners.begin(), winners.end(),
+                  [](std::pair<std::string, InflationVotes> const& l,
+                     std::pair<std::string, InflationVotes> const& r)
+                  {
+                      if (l.second.mVotes != r.second.mVotes)
+                      {
+                          return l.second.mVotes > r.second.mVotes;
+                      }
+                      return l.first > r.first;
+                  });
+
+        for (size_t i = 0;
+             i < winners.size() && i < static_cast<size_t>(maxWinners); i++)
+        {
+            if (!inflationProcessor(winners[i].second))
+            {
+                break;
+            }
+        }
+        return;
+    }
 
     soci::statement st =
         (session.prepare
@@ -617,13 +787,13 @@ AccountFrame::processForInflation(
                 " inflationdest IS NOT NULL"
                 " AND balance >= 1000000000 GROUP BY inflationdest"
                 " ORDER BY votes DESC, inflationdest DESC LIMIT :lim",
-         into(v.mVotes), into(inflationDest), use(maxWinners));
+         into(v.mVotes), inflationDest.into(), use(maxWinners));
 
     st.execute(true);
 
     while (st.got_data())
     {
-        v.mInflationDest = PubKeyUtils::fromStrKey(inflationDest);
+        v.mInflationDest = inflationDest.get();
         if (!inflationProcessor(v))
         {
             break;
@@ -637,14 +807,14 @@ AccountFrame::checkDB(Database& db)
 {
     std::unordered_map<AccountID, AccountFrame::pointer> state;
     {
-        std::string id;
+        AccountIDColumn id(db);
         soci::statement st =
             (db.getSession().prepare << "select accountid from accounts",
-             soci::into(id));
+             id.into());
         st.execute(true);
         while (st.got_data())
         {
-            state.insert(std::make_pair(PubKeyUtils::fromStrKey(id), nullptr));
+            state.insert(std::make_pair(id.get(), nullptr));
             st.fetch();
         }
     }
@@ -655,27 +825,29 @@ AccountFrame::checkDB(Database& db)
     }
 
     {
-        std::string id;
+        AccountIDColumn id(db);
         size_t n;
         // sanity check signers state
         soci::statement st =
             (db.getSession().prepare << "select count(*), accountid from "
                                         "signers group by accountid",
-             soci::into(n), soci::into(id));
+             soci::into(n), id.into());
         st.execute(true);
         while (st.got_data())
         {
-            AccountID aid(PubKeyUtils::fromStrKey(id));
+            AccountID aid(id.get());
             auto it = state.find(aid);
             if (it == state.end())
             {
                 throw std::runtime_error(fmt::format(
-                    "Found extra signers in database for account {}", id));
+                    "Found extra signers in database for account {}",
+                    PubKeyUtils::toStrKey(aid)));
             }
             else if (n != it->second->mAccountEntry.signers.size())
             {
                 throw std::runtime_error(
-                    fmt::format("Mismatch signers for account {}", id));
+                    fmt::format("Mismatch signers for account {}",
+                                PubKeyUtils::toStrKey(aid)));
             }
             st.fetch();
         }
@@ -684,13 +856,22 @@ AccountFrame::checkDB(Database& db)
 }
 
 void
-AccountFrame::dropAll(Database& db)
+AccountFrame::dropAll(Database& db, bool withIndexes)
 {
     db.getSession() << "DROP TABLE IF EXISTS accounts;";
     db.getSession() << "DROP TABLE IF EXISTS signers;";
 
-    db.getSession() << kSQLCreateStatement1;
-    db.getSession() << kSQLCreateStatement2;
+    db.getSession() << db.withAccountIDType(kSQLCreateStatement1);
+    db.getSession() << db.withAccountIDType(kSQLCreateStatement2);
+    if (withIndexes)
+    {
+        createIndexes(db);
+    }
+}
+
+void
+AccountFrame::createIndexes(Database& db)
+{
     db.getSession() << kSQLCreateStatement3;
     db.getSession() << kSQLCreateStatement4;
 }
@@ -36,7 +36,7 @@ class AccountFrame : public EntryFrame
     bool isValid();
 
     static std::vector<Signer> loadSigners(Database& db,
-                                           std::string const& actIDStrKey);
+                                           AccountID const& accountID);
     void applySigners(Database& db, bool insert);
 
   public:
@@ -117,6 +117,10 @@ class AccountFrame : public EntryFrame
     // Static helper that don't assume an instance.
     static void storeDelete(LedgerDelta& delta, Database& db,
                             LedgerKey const& key);
+    // writes pending entries, see EntryFrame::storePending
+    static void storePending(Database& db,
+                             std::vector<LedgerEntry const*> const& live,
+                             std::vector<LedgerKey const*> const& dead);
     static bool exists(Database& db, LedgerKey const& key);
     static uint64_t countObjects(soci::session& sess);
 
@@ -146,7 +150,10 @@ class AccountFrame : public EntryFrame
     static std::unordered_map<AccountID, AccountFrame::pointer>
     checkDB(Database& db);
 
-    static void dropAll(Database& db);
+    // without `withIndexes`, the secondary indexes are left for
+    // createIndexes, to be created once the tables are filled
+    static void dropAll(Database& db, bool withIndexes = true);
+    static void createIndexes(Database& db);
     static const char* kSQLCreateStatement1;
     static const char* kSQLCreateStatement2;
     static const char* kSQLCreateStatement3;
@@ -79,17 +79,18 @@ DataFrame::loadData(AccountID const& accountID, std::string dataName,
 {
     DataFrame::pointer retData;
 
-    std::string actIDStrKey = PubKeyUtils::toStrKey(accountID);
+    AccountIDColumn actID(db);
+    actID.set(accountID);
 
     std::string sql = dataColumnSelector;
     sql += " WHERE accountid = :id AND dataname = :dataname";
     auto prep = db.getPreparedStatement(sql);
     auto& st = prep.statement();
-    st.exchange(use(actIDStrKey));
+    st.exchange(actID.use());
     st.exchange(use(dataName));
 
     auto timer = db.getSelectTimer("data");
-    loadData(prep, [&retData](LedgerEntry const& data)
+    loadData(db, prep, [&retData](LedgerEntry const& data)
                {
                    retData = make_shared<DataFrame>(data);
                });
@@ -98,10 +99,10 @@ DataFrame::loadData(AccountID const& accountID, std::string dataName,
 }
 
 void
-DataFrame::loadData(StatementContext& prep,
+DataFrame::loadData(Database& db, StatementContext& prep,
                        std::function<void(LedgerEntry const&)> dataProcessor)
 {
-    string actIDStrKey;
+    AccountIDColumn actID(db);
    
     std::string dataName,dataValue;
 
@@ -112,14 +113,14 @@ DataFrame::loadData(StatementContext& prep,
     DataEntry& oe = le.data.data();
 
     statement& st = prep.statement();
-    st.exchange(into(actIDStrKey));
+    st.exchange(actID.into());
     st.exchange(into(dataName, dataNameIndicator));
     st.exchange(into(dataValue, dataValueIndicator));
     st.define_and_bind();
     st.execute(true);
     while (st.got_data())
     {
-        oe.accountID = PubKeyUtils::fromStrKey(actIDStrKey);
+        oe.accountID = actID.get();
         
         if((dataNameIndicator != soci::i_ok) ||
             (dataValueIndicator != soci::i_ok))
@@ -141,17 +142,17 @@ DataFrame::loadAccountsData(AccountID const& accountID,
                        std::vector<DataFrame::pointer>& retData,
                        Database& db)
 {
-    std::string actIDStrKey;
-    actIDStrKey = PubKeyUtils::toStrKey(accountID);
+    AccountIDColumn actID(db);
+    actID.set(accountID);
 
     std::string sql = dataColumnSelector;
     sql += " WHERE accountid = :id";
     auto prep = db.getPreparedStatement(sql);
     auto& st = prep.statement();
-    st.exchange(use(actIDStrKey));
+    st.exchange(actID.use());
 
     auto timer = db.getSelectTimer("data");
-    loadData(prep, [&retData](LedgerEntry const& of)
+    loadData(db, prep, [&retData](LedgerEntry const& of)
                {
                    retData.emplace_back(make_shared<DataFrame>(of));
                });
@@ -166,7 +167,7 @@ DataFrame::loadAllData(Database& db)
     auto prep = db.getPreparedStatement(sql);
 
     auto timer = db.getSelectTimer("data");
-    loadData(prep, [&retData](LedgerEntry const& of)
+    loadData(db, prep, [&retData](LedgerEntry const& of)
                {
                    auto& thisUserData = retData[of.data.data().accountID];
                    thisUserData.emplace_back(make_shared<DataFrame>(of));
@@ -177,7 +178,8 @@ DataFrame::loadAllData(Database& db)
 bool
 DataFrame::exists(Database& db, LedgerKey const& key)
 {
-    std::string actIDStrKey = PubKeyUtils::toStrKey(key.data().accountID);
+    AccountIDColumn actID(db);
+    actID.set(key.data().accountID);
     std::string dataName = key.data().dataName;
     int exists = 0;
     auto timer = db.getSelectTimer("data-exists");
@@ -185,7 +187,7 @@ DataFrame::exists(Database& db, LedgerKey const& key)
         db.getPreparedStatement("SELECT EXISTS (SELECT NULL FROM accountdata "
                                 "WHERE accountid=:id AND dataname=:s)");
     auto& st = prep.statement();
-    st.exchange(use(actIDStrKey));
+    st.exchange(actID.use());
     st.exchange(use(dataName));
     st.exchange(into(exists));
     st.define_and_bind();
@@ -210,12 +212,13 @@ DataFrame::storeDelete(LedgerDelta& delta, Database& db) const
 void
 DataFrame::storeDelete(LedgerDelta& delta, Database& db, LedgerKey const& key)
 {
-    std::string actIDStrKey = PubKeyUtils::toStrKey(key.data().accountID);
+    AccountIDColumn actID(db);
+    actID.set(key.data().accountID);
     std::string dataName = key.data().dataName;
     auto timer = db.getDeleteTimer("data");
     auto prep = db.getPreparedStatement("DELETE FROM accountdata WHERE accountid=:id AND dataname=:s");
     auto& st = prep.statement();
-    st.exchange(use(actIDStrKey));
+    st.exchange(actID.use());
     st.exchange(use(dataName));
     st.define_and_bind();
     st.execute(true);
@@ -240,7 +243,8 @@ DataFrame::storeUpdateHelper(LedgerDelta& delta, Database& db, bool insert)
 {
     touch(delta);
 
-    std::string actIDStrKey = PubKeyUtils::toStrKey(mData.accountID);
+    AccountIDColumn actID(db);
+    actID.set(mData.accountID);
     std::string dataName = mData.dataName;
     std::string dataValue = bn::encode_b64(mData.dataValue);
    
@@ -263,7 +267,7 @@ DataFrame::storeUpdateHelper(LedgerDelta& delta, Database& db, bool insert)
     auto& st = prep.statement();
 
     
-    st.exchange(use(actIDStrKey, "aid"));
+    st.exchange(actID.use("aid"));
     st.exchange(use(dataName, "dn"));
     st.exchange(use(dataValue, "dv"));
 
@@ -289,6 +293,6 @@ void
 DataFrame::dropAll(Database& db)
 {
     db.getSession() << "DROP TABLE IF EXISTS accountdata;";
-    db.getSession() << kSQLCreateStatement1;
+    db.getSession() << db.withAccountIDType(kSQLCreateStatement1);
 }
 }
@@ -21,7 +21,7 @@ class StatementContext;
 class DataFrame : public EntryFrame
 {
     static void
-    loadData(StatementContext& prep,
+    loadData(Database& db, StatementContext& prep,
                std::function<void(LedgerEntry const&)> dataProcessor);
 
     DataEntry& mData;
@@ -12,13 +12,14 @@
 #include "ledger/LedgerDelta.h"
 #include "xdrpp/printer.h"
 #include "xdrpp/marshal.h"
-#include "crypto/Hex.h"
 #include "database/Database.h"
 
 namespace stellar
 {
 using xdr::operator==;
 
+const size_t EntryFrame::PENDING_BATCH_ROWS;
+
 EntryFrame::pointer
 EntryFrame::FromXDR(LedgerEntry const& from)
 {
@@ -120,30 +121,35 @@ EntryFrame::touch(LedgerDelta const& delta)
 void
 EntryFrame::flushCachedEntry(LedgerKey const& key, Database& db)
 {
-    auto s = binToHex(xdr::xdr_to_opaque(key));
-    db.getEntryCache().erase_if_exists(s);
+    db.getEntryCache().erase(key);
+    if (key.type() == REVERSED_PAYMENT)
+    {
+        db.getReversedPaymentIndex().forget(key.reversedPayment().rID);
+    }
+    else if (key.type() == OFFER)
+    {
+        db.getOrderBook().forget(key.offer().offerID);
+    }
 }
 
 bool
 EntryFrame::cachedEntryExists(LedgerKey const& key, Database& db)
 {
-    auto s = binToHex(xdr::xdr_to_opaque(key));
-    return db.getEntryCache().exists(s);
+    return db.getEntryCache().exists(key);
 }
 
-std::shared_ptr<LedgerEntry const>
-EntryFrame::getCachedEntry(LedgerKey const& key, Database& db)
+bool
+EntryFrame::getCachedEntry(LedgerKey const& key,
+                           std::shared_ptr<LedgerEntry const>& p, Database& db)
 {
-    auto s = binToHex(xdr::xdr_to_opaque(key));
-    return db.getEntryCache().get(s);
+    return db.getEntryCache().get(key, p);
 }
 
 void
 EntryFrame::putCachedEntry(LedgerKey const& key,
                            std::shared_ptr<LedgerEntry const> p, Database& db)
 {
-    auto s = binToHex(xdr::xdr_to_opaque(key));
-    db.getEntryCache().put(s, p);
+    db.getEntryCache().put(key, p);
 }
 
 void
@@ -251,6 +257,65 @@ EntryFrame::storeDelete(LedgerDelta& delta, Database& db, LedgerKey const& key)
     }
 }
 
+std::string
+EntryFrame::batchPlaceholders(size_t rows, size_t columns)
+{
+    std::string res;
+    for (size_t r = 0; r < rows; r++)
+    {
+        res += (r == 0) ? "(" : ", (";
+        for (size_t c = 0; c < columns; c++)
+        {
+            if (c != 0)
+            {
+                res += ", ";
+            }
+            res += ":r" + std::to_string(r) + "c" + std::to_string(c);
+        }
+        res += ")";
+    }
+    return res;
+}
+
+void
+EntryFrame::storePending(Database& db)
+{
+    std::vector<LedgerEntry const*> accounts, trustLines;
+    std::vector<LedgerKey const*> deadAccounts, deadTrustLines;
+
+    for (auto const& d : db.getEntryCache().getDirtyEntries())
+    {
+        switch (d.first.type())
+        {
+        case ACCOUNT:
+            if (d.second)
+            {
+                accounts.push_back(d.second.get());
+            }
+            else
+            {
+                deadAccounts.push_back(&d.first);
+            }
+            break;
+        case TRUSTLINE:
+            if (d.second)
+            {
+                trustLines.push_back(d.second.get());
+            }
+            else
+            {
+                deadTrustLines.push_back(&d.first);
+            }
+            break;
+        default:
+            throw std::runtime_error("unexpected pending entry type");
+        }
+    }
+
+    AccountFrame::storePending(db, accounts, deadAccounts);
+    TrustFrame::storePending(db, trustLines, deadTrustLines);
+}
+
 LedgerKey
 LedgerEntryKey(LedgerEntry const& e)
 {
@@ -31,6 +31,13 @@ class EntryFrame : public NonMovableOrCopyable
         mKeyCalculated = false;
     }
 
+    // pending entries are written in multi-row statements of at most this
+    // many rows (SQLite accepts at most 999 parameters per statement)
+    static const size_t PENDING_BATCH_ROWS = 64;
+    // returns the placeholders "(:r0c0, ...), (:r1c0, ...), ..." of a
+    // multi-row VALUES clause
+    static std::string batchPlaceholders(size_t rows, size_t columns);
+
   public:
     typedef std::shared_ptr<EntryFrame> pointer;
 
@@ -45,8 +52,11 @@ class EntryFrame : public NonMovableOrCopyable
     // Static helpers for working with the DB LedgerEntry cache.
     static void flushCachedEntry(LedgerKey const& key, Database& db);
     static bool cachedEntryExists(LedgerKey const& key, Database& db);
-    static std::shared_ptr<LedgerEntry const>
-    getCachedEntry(LedgerKey const& key, Database& db);
+    // returns false if `key` is not cached, otherwise sets `p` to the cached
+    // entry (nullptr if the entry is known not to exist)
+    static bool getCachedEntry(LedgerKey const& key,
+                               std::shared_ptr<LedgerEntry const>& p,
+                               Database& db);
     static void putCachedEntry(LedgerKey const& key,
                                std::shared_ptr<LedgerEntry const> p,
                                Database& db);
@@ -78,6 +88,10 @@ class EntryFrame : public NonMovableOrCopyable
     static bool exists(Database& db, LedgerKey const& key);
     static void storeDelete(LedgerDelta& delta, Database& db,
                             LedgerKey const& key);
+
+    // writes the dirty entries of the db entry cache to the database,
+    // leaving them dirty (see LedgerDelta::setWriteBack)
+    static void storePending(Database& db);
 };
 
 // static helper for getting a LedgerKey from a LedgerEntry.
@@ -3,6 +3,8 @@
 // of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
 
 #include "ledger/LedgerDelta.h"
+#include "database/Database.h"
+#include "ledger/OfferFrame.h"
 #include "xdr/Stellar-ledger.h"
 #include "main/Application.h"
 #include "main/Config.h"
@@ -21,6 +23,8 @@ LedgerDelta::LedgerDelta(LedgerDelta& outerDelta)
     , mPreviousHeaderValue(outerDelta.getHeader())
     , mDb(outerDelta.mDb)
     , mUpdateLastModified(outerDelta.mUpdateLastModified)
+    , mCommissionDeferred(outerDelta.mCommissionDeferred)
+    , mWriteBack(outerDelta.mWriteBack)
 {
 }
 
@@ -32,6 +36,8 @@ LedgerDelta::LedgerDelta(LedgerHeader& header, Database& db,
     , mPreviousHeaderValue(header)
     , mDb(db)
     , mUpdateLastModified(updateLastModified)
+    , mCommissionDeferred(false)
+    , mWriteBack(false)
 {
 }
 
@@ -204,6 +210,8 @@ LedgerDelta::mergeEntries(LedgerDelta& other)
             recordEntry(*it->second);
         }
     }
+    // keeps our own undo record when we have one: it is the older one
+    mPendingUndo.insert(other.mPendingUndo.begin(), other.mPendingUndo.end());
 }
 
 void
@@ -222,6 +230,10 @@ LedgerDelta::commit()
         mOuterDelta->mergeEntries(*this);
         mOuterDelta = nullptr;
     }
+    else if (!mPendingUndo.empty())
+    {
+        throw std::runtime_error("pending entries were not flushed");
+    }
     *mHeader = mCurrentHeader.mHeader;
     mHeader = nullptr;
 }
@@ -232,6 +244,19 @@ LedgerDelta::rollback()
     checkState();
     mHeader = nullptr;
 
+    auto& cache = mDb.getEntryCache();
+    for (auto const& u : mPendingUndo)
+    {
+        if (u.second.first)
+        {
+            cache.putDirty(u.first, u.second.second);
+        }
+        else
+        {
+            cache.eraseDirty(u.first);
+        }
+    }
+
     for (auto& d : mDelete)
     {
         EntryFrame::flushCachedEntry(d, mDb);
@@ -244,6 +269,25 @@ LedgerDelta::rollback()
     {
         EntryFrame::flushCachedEntry(m.first, mDb);
     }
+
+    // the order book finds the offers still in it by id, the others by the
+    // pair they were in
+    auto& book = mDb.getOrderBook();
+    for (auto const& p : mPrevious)
+    {
+        if (p.first.type() == OFFER)
+        {
+            book.forget(p.second->mEntry.data.offer());
+        }
+    }
+    for (auto& d : mDelete)
+    {
+        if (d.type() == OFFER && mPrevious.find(d) == mPrevious.end())
+        {
+            book.clear();
+            break;
+        }
+    }
 }
 
 void
@@ -330,6 +374,72 @@ LedgerDelta::updateLastModified() const
     return mUpdateLastModified;
 }
 
+bool
+LedgerDelta::isCommissionDeferred() const
+{
+    return mCommissionDeferred;
+}
+
+void
+LedgerDelta::setCommissionDeferred(bool deferred)
+{
+    mCommissionDeferred = deferred;
+}
+
+void
+LedgerDelta::storeCommission(EntryFrame& entry, Database& db)
+{
+    checkState();
+    LedgerDelta commissionDelta(*this);
+    commissionDelta.setWriteBack(mWriteBack || mCommissionDeferred);
+    entry.storeChange(commissionDelta, db);
+    commissionDelta.commit();
+}
+
+bool
+LedgerDelta::isWriteBack() const
+{
+    return mWriteBack;
+}
+
+bool
+LedgerDelta::isWriteBack(LedgerKey const& key) const
+{
+    EntryCache::EntryPtr pending;
+    return mWriteBack || mDb.getEntryCache().getDirty(key, pending);
+}
+
+void
+LedgerDelta::setWriteBack(bool writeBack)
+{
+    mWriteBack = writeBack;
+}
+
+void
+LedgerDelta::storePending(LedgerKey const& key,
+                          std::shared_ptr<LedgerEntry const> entry)
+{
+    checkState();
+    assert(isWriteBack(key));
+    auto& cache = mDb.getEntryCache();
+    if (mPendingUndo.find(key) == mPendingUndo.end())
+    {
+        auto& undo = mPendingUndo[key];
+        undo.first = cache.getDirty(key, undo.second);
+    }
+    cache.putDirty(key, entry);
+}
+
+void
+LedgerDelta::flushPending()
+{
+    checkState();
+    assert(!mOuterDelta);
+    EntryFrame::storePending(mDb);
+    mDb.getEntryCache().markClean();
+    mPendingUndo.clear();
+}
+
 void
 LedgerDelta::markMeters(Application& app) const
 {
@@ -453,6 +563,27 @@ LedgerDelta::checkAgainstDatabase(Application& app) const
             s += xdr::xdr_to_string(d);
             throw std::runtime_error(s);
         }
+        if (d.type() == OFFER && db.getOrderBook().contains(d.offer().offerID))
+        {
+            std::string s;
+            s = "Inconsistent state ; offer should not be in the order book: ";
+            s += xdr::xdr_to_string(d);
+            throw std::runtime_error(s);
+        }
+    }
+
+    std::set<OrderBook::AssetPair, OrderBook::AssetPairLess> books;
+    for (auto const& l : live)
+    {
+        if (l.data.type() == OFFER)
+        {
+            auto const& offer = l.data.offer();
+            books.emplace(offer.selling, offer.buying);
+        }
+    }
+    for (auto const& b : books)
+    {
+        OfferFrame::checkOrderBook(b.first, b.second, db);
     }
 }
 }
@@ -20,6 +20,12 @@ class LedgerDelta
 {
     typedef std::map<LedgerKey, EntryFrame::pointer, LedgerEntryIdCmp>
         KeyEntryMap;
+    // for every entry stored as pending by this delta, whether it was
+    // already pending before and with what value
+    typedef std::map<LedgerKey,
+                     std::pair<bool, std::shared_ptr<LedgerEntry const>>,
+                     LedgerEntryIdCmp>
+        PendingUndoMap;
 
     LedgerDelta*
         mOuterDelta;       // set when this delta is nested inside another delta
@@ -35,10 +41,19 @@ class LedgerDelta
     std::set<LedgerKey, LedgerEntryIdCmp> mDelete;
     KeyEntryMap mPrevious;
 
-    Database& mDb; // Used strictly for rollback of db entry cache.
+    Database& mDb; // Used strictly for the db entry cache.
 
     bool mUpdateLastModified;
 
+    // the commission account and its trust lines are kept in the entry
+    // cache until the end of the ledger, see storeCommission
+    bool mCommissionDeferred;
+
+    // accounts and trust lines are kept in the entry cache until the end of
+    // the ledger instead of being written to the database, see storePending
+    bool mWriteBack;
+    PendingUndoMap mPendingUndo;
+
     void checkState();
     void addEntry(EntryFrame::pointer entry);
     void deleteEntry(EntryFrame::pointer entry);
@@ -85,6 +100,36 @@ class LedgerDelta
 
     bool updateLastModified() const;
 
+    // When commission is deferred, the commission account and its trust
+    // lines, credited by every payment, are stored by storeCommission as
+    // pending entries (see storePending) whatever the write-back setting:
+    // every load finds them in the entry cache and they are written once per
+    // ledger by flushPending.
+    // Nested deltas inherit the setting of their outer delta.
+    bool isCommissionDeferred() const;
+    void setCommissionDeferred(bool deferred);
+
+    // stores a commission account or trust line credited by a payment
+    void storeCommission(EntryFrame& entry, Database& db);
+
+    // In write-back mode, accounts and trust lines stored through the delta
+    // are held as dirty entries of the database entry cache, where loads
+    // find them, and written to the database in batches by flushPending
+    // instead of one statement per store.
+    // Nested deltas inherit the setting of their outer delta.
+    bool isWriteBack() const;
+    void setWriteBack(bool writeBack);
+    // whether stores of `key` go to the entry cache: in write-back mode, and
+    // for an entry already pending, which stays so until flushPending
+    bool isWriteBack(LedgerKey const& key) const;
+
+    // makes `entry` (nullptr if deleted) the pending value of `key`; rolling
+    // back the delta restores the value pending before
+    void storePending(LedgerKey const& key,
+                      std::shared_ptr<LedgerEntry const> entry);
+    // writes all pending entries to the database (top level delta only)
+    void flushPending();
+
     void markMeters(Application& app) const;
 
     std::vector<LedgerEntry> getLiveEntries() const;
@@ -164,6 +164,14 @@ class LedgerManager
     // permit testing.
     virtual void closeLedger(LedgerCloseData const& ledgerData) = 0;
 
+    // Stores the history archive state of the last closed ledger, which
+    // checkpoints the bucket list so that a restart can re-attach to its
+    // buckets. closeLedger does it for every ledger but those closed with
+    // LedgerCloseData::mFastReplay: the fast replay calls this at the end of
+    // each of its batches, before collecting the buckets no longer
+    // referenced.
+    virtual void storeHistoryArchiveState() = 0;
+
     // deletes old entries stored in the database
     virtual void deleteOldEntries(Database& db, uint32_t ledgerSeq) = 0;
 
@@ -11,6 +11,7 @@
 #include "herder/TxSetFrame.h"
 #include "herder/LedgerCloseData.h"
 #include "history/HistoryManager.h"
+#include "history/HistoryWriter.h"
 #include "ledger/LedgerDelta.h"
 #include "ledger/LedgerHeaderFrame.h"
 #include "ledger/LedgerManagerImpl.h"
@@ -695,19 +696,50 @@ LedgerManagerImpl::closeLedger(LedgerCloseData const& ledgerData)
     mCurrentLedger->mHeader.scpValue = sv;
 
     LedgerDelta ledgerDelta(mCurrentLedger->mHeader, getDatabase());
+    // the commission collected by payments is written once per entry, at the
+    // end of the ledger
+    ledgerDelta.setCommissionDeferred(true);
+    // with LEDGER_WRITE_BACK, accounts and trust lines are written once, at
+    // the end of the ledger
+    ledgerDelta.setWriteBack(mApp.getConfig().LEDGER_WRITE_BACK);
 
     // the transaction set that was agreed upon by consensus
     // was sorted by hash; we reorder it so that transactions are
     // sorted such that sequence numbers are respected
     vector<TransactionFramePtr> txs = ledgerData.mTxSet->sortForApply();
 
+    bool const fastReplay = ledgerData.mFastReplay;
+    if (fastReplay)
+    {
+        // the results of the transactions are part of the ledger hash the
+        // replay checks: a signature wrongly taken for valid shows up there
+        for (auto const& tx : txs)
+        {
+            tx->setSignaturesTrusted(true);
+        }
+    }
+    else
+    {
+        // the transactions are applied one by one on this thread, their
+        // signatures are all verified up front on the worker threads
+        ledgerData.mTxSet->preverifySignatures(mApp);
+    }
+
     // first, charge fees
-    processFeesSeqNums(txs, ledgerDelta);
+    processFeesSeqNums(txs, ledgerDelta, fastReplay);
 
     TransactionResultSet txResultSet;
     txResultSet.results.reserve(txs.size());
 
-    applyTransactions(txs, ledgerDelta, txResultSet);
+    applyTransactions(txs, ledgerDelta, txResultSet, fastReplay);
+
+    ledgerDelta.flushPending();
+
+    auto& historyWriter = mApp.getHistoryManager().getHistoryWriter();
+    if (historyWriter.isPipelined() && !fastReplay)
+    {
+        historyWriter.journalLedger(ledgerDelta.getHeader().ledgerSeq);
+    }
 
     ledgerDelta.getHeader().txSetResultHash =
         sha256(xdr::xdr_to_opaque(txResultSet));
@@ -745,10 +777,13 @@ LedgerManagerImpl::closeLedger(LedgerCloseData const& ledgerData)
         }
     }
 
-    ledgerDelta.checkAgainstDatabase(mApp);
+    if (!fastReplay)
+    {
+        ledgerDelta.checkAgainstDatabase(mApp);
+    }
 
     ledgerDelta.commit();
-    closeLedgerHelper(ledgerDelta);
+    closeLedgerHelper(ledgerDelta, fastReplay);
 
     // The next 4 steps happen in a relatively non-obvious, subtle order.
     // This is unfortunate and it would be nice if we could make it not
@@ -758,7 +793,8 @@ LedgerManagerImpl::closeLedger(LedgerCloseData const& ledgerData)
     //    transaction. This way if there's a crash after commit and before
     //    we've published successfully, we'll re-publish on restart.
     //
-    // 2. Commit the current transaction.
+    // 2. Commit the current transaction, then hand the history journaled by
+    //    it over to the history writer (see PIPELINED_LEDGER_CLOSE).
     //
     // 3. Start any queued checkpoint publishing, _after_ the commit so that
     //    it takes its snapshot of history-rows from the committed state, but
@@ -766,21 +802,31 @@ LedgerManagerImpl::closeLedger(LedgerCloseData const& ledgerData)
     //    bucket refcounts are incremented for the duration of the publish).
     //
     // 4. GC unreferenced buckets. Only do this once publishes are in progress.
+    //
+    // A fast replay doesn't publish, and as the history archive state stored
+    // in the database may still reference buckets the bucket list dropped, it
+    // collects them itself once that state is updated.
 
     // step 1
     auto& hm = mApp.getHistoryManager();
-    hm.maybeQueueHistoryCheckpoint();
+    if (!fastReplay)
+    {
+        hm.maybeQueueHistoryCheckpoint();
+    }
 
     // step 2
-    mApp.getDatabase().clearPreparedStatementCache();
     txscope.commit();
+    historyWriter.submit();
 
     // step 3
     hm.publishQueuedHistory();
     hm.logAndUpdateStatus(true);
 
     // step 4
-    mApp.getBucketManager().forgetUnreferencedBuckets();
+    if (!fastReplay)
+    {
+        mApp.getBucketManager().forgetUnreferencedBuckets();
+    }
 }
 
 void
@@ -872,7 +918,7 @@ LedgerManagerImpl::advanceLedgerPointers()
 
 void
 LedgerManagerImpl::processFeesSeqNums(std::vector<TransactionFramePtr>& txs,
-                                      LedgerDelta& delta)
+                                      LedgerDelta& delta, bool fastReplay)
 {
     CLOG(DEBUG, "Ledger") << "processing fees and sequence numbers";
     int index = 0;
@@ -883,7 +929,11 @@ LedgerManagerImpl::processFeesSeqNums(std::vector<TransactionFramePtr>& txs,
         {
             LedgerDelta thisTxDelta(delta);
             tx->processFeeSeqNum(thisTxDelta, *this);
-            tx->storeTransactionFee(*this, thisTxDelta.getChanges(), ++index);
+            ++index;
+            if (!fastReplay)
+            {
+                storeTransactionFee(*tx, thisTxDelta.getChanges(), index);
+            }
             thisTxDelta.commit();
         }
         sqlTx.commit();
@@ -899,50 +949,104 @@ LedgerManagerImpl::processFeesSeqNums(std::vector<TransactionFramePtr>& txs,
 void
 LedgerManagerImpl::applyTransactions(std::vector<TransactionFramePtr>& txs,
                                      LedgerDelta& ledgerDelta,
-                                     TransactionResultSet& txResultSet)
+                                     TransactionResultSet& txResultSet,
+                                     bool fastReplay)
 {
     CLOG(DEBUG, "Tx") << "applyTransactions: ledger = "
                       << mCurrentLedger->mHeader.ledgerSeq;
+
     int index = 0;
     for (auto tx : txs)
     {
-        auto txTime = mTransactionApply.TimeScope();
-        LedgerDelta delta(ledgerDelta);
         TransactionMeta tm;
-        try
+        applyTransaction(tx, index, ledgerDelta, tm);
+        ++index;
+        if (fastReplay)
         {
-            CLOG(DEBUG, "Tx")
-                << " tx#" << index << " = " << hexAbbrev(tx->getFullHash())
-                << " txseq=" << tx->getSeqNum() << " (@ "
-                << mApp.getConfig().toShortString(tx->getSourceID()) << ")";
-
-            if (tx->apply(delta, tm, mApp))
-            {
-                delta.commit();
-            }
-            else
-            {
-                // failure means there should be no side effects
-                assert(delta.getChanges().size() == 0);
-                assert(delta.getHeader() == ledgerDelta.getHeader());
-            }
+            txResultSet.results.emplace_back(tx->getResultPair());
         }
-        catch (std::runtime_error& e)
+        else
+        {
+            storeTransaction(*tx, tm, index, txResultSet);
+        }
+    }
+}
+
+void
+LedgerManagerImpl::applyTransaction(TransactionFramePtr tx, int index,
+                                    LedgerDelta& ledgerDelta,
+                                    TransactionMeta& tm)
+{
+    auto txTime = mTransactionApply.TimeScope();
+
+    LedgerDelta delta(ledgerDelta);
+    try
+    {
+        CLOG(DEBUG, "Tx") << " tx#" << index << " = "
+                          << hexAbbrev(tx->getFullHash())
+                          << " txseq=" << tx->getSeqNum() << " (@ "
+                          << mApp.getConfig().toShortString(tx->getSourceID())
+                          << ")";
+
+        if (tx->apply(delta, tm, mApp))
         {
-            CLOG(ERROR, "Ledger") << "Exception during tx->apply: " << e.what();
-            tx->getResult().result.code(txINTERNAL_ERROR);
+            delta.commit();
         }
-        catch (...)
+        else
         {
-            CLOG(ERROR, "Ledger") << "Unknown exception during tx->apply";
-            tx->getResult().result.code(txINTERNAL_ERROR);
+            // failure means there should be no side effects
+            assert(delta.getChanges().size() == 0);
+            assert(delta.getHeader() == ledgerDelta.getHeader());
         }
-        tx->storeTransaction(*this, tm, ++index, txResultSet);
+    }
+    catch (std::runtime_error& e)
+    {
+        CLOG(ERROR, "Ledger") << "Exception during tx->apply: " << e.what();
+        tx->getResult().result.code(txINTERNAL_ERROR);
+    }
+    catch (...)
+    {
+        CLOG(ERROR, "Ledger") << "Unknown exception during tx->apply";
+        tx->getResult().result.code(txINTERNAL_ERROR);
     }
 }
 
 void
-LedgerManagerImpl::closeLedgerHelper(LedgerDelta const& delta)
+LedgerManagerImpl::storeTransactionFee(TransactionFrame const& tx,
+                                       LedgerEntryChanges const& changes,
+                                       int index)
+{
+    auto& historyWriter = mApp.getHistoryManager().getHistoryWriter();
+    if (historyWriter.isPipelined())
+    {
+        historyWriter.addTransactionFee(changes);
+    }
+    else
+    {
+        tx.storeTransactionFee(*this, changes, index);
+    }
+}
+
+void
+LedgerManagerImpl::storeTransaction(TransactionFrame const& tx,
+                                    TransactionMeta& tm, int index,
+                                    TransactionResultSet& txResultSet)
+{
+    auto& historyWriter = mApp.getHistoryManager().getHistoryWriter();
+    if (historyWriter.isPipelined())
+    {
+        txResultSet.results.emplace_back(tx.getResultPair());
+        historyWriter.addTransaction(tx, txResultSet.results.back(),
+                                     std::move(tm));
+    }
+    else
+    {
+        tx.storeTransaction(*this, tm, index, txResultSet);
+    }
+}
+
+void
+LedgerManagerImpl::closeLedgerHelper(LedgerDelta const& delta, bool fastReplay)
 {
     delta.markMeters(mApp);
     mApp.getBucketManager().addBatch(mApp, mCurrentLedger->mHeader.ledgerSeq,
@@ -956,9 +1060,20 @@ LedgerManagerImpl::closeLedgerHelper(LedgerDelta const& delta)
     mApp.getPersistentState().setState(PersistentState::kLastClosedLedger,
                                        binToHex(mCurrentLedger->getHash()));
 
+    advanceLedgerPointers();
+
+    if (!fastReplay)
+    {
+        storeHistoryArchiveState();
+    }
+}
+
+void
+LedgerManagerImpl::storeHistoryArchiveState()
+{
     // Store the current HAS in the database; this is really just to checkpoint
     // the bucketlist so we can survive a restart and re-attach to the buckets.
-    HistoryArchiveState has(mCurrentLedger->mHeader.ledgerSeq,
+    HistoryArchiveState has(getLastClosedLedgerNum(),
                             mApp.getBucketManager().getBucketList());
 
     // We almost always want to try to resolve completed merges to single
@@ -973,7 +1088,5 @@ LedgerManagerImpl::closeLedgerHelper(LedgerDelta const& delta)
 
     mApp.getPersistentState().setState(PersistentState::kHistoryArchiveState,
                                        has.toString());
-
-    advanceLedgerPointers();
 }
 }
@@ -22,6 +22,7 @@ namespace medida
 {
 class Timer;
 class Counter;
+class Meter;
 }
 
 namespace stellar
@@ -53,13 +54,25 @@ class LedgerManagerImpl : public LedgerManager
                          HistoryManager::CatchupMode mode,
                          LedgerHeaderHistoryEntry const& lastClosed);
 
+    // with `fastReplay` (see LedgerCloseData::mFastReplay), the history of
+    // the transactions isn't recorded, only their results are collected
     void processFeesSeqNums(std::vector<TransactionFramePtr>& txs,
-                            LedgerDelta& delta);
+                            LedgerDelta& delta, bool fastReplay);
     void applyTransactions(std::vector<TransactionFramePtr>& txs,
                            LedgerDelta& ledgerDelta,
-                           TransactionResultSet& txResultSet);
-
-    void closeLedgerHelper(LedgerDelta const& delta);
+                           TransactionResultSet& txResultSet,
+                           bool fastReplay);
+    void applyTransaction(TransactionFramePtr tx, int index,
+                          LedgerDelta& ledgerDelta, TransactionMeta& tm);
+
+    // record the history of a transaction: in the history tables, or with
+    // PIPELINED_LEDGER_CLOSE, in the history writer
+    void storeTransactionFee(TransactionFrame const& tx,
+                             LedgerEntryChanges const& changes, int index);
+    void storeTransaction(TransactionFrame const& tx, TransactionMeta& tm,
+                          int index, TransactionResultSet& txResultSet);
+
+    void closeLedgerHelper(LedgerDelta const& delta, bool fastReplay);
     void advanceLedgerPointers();
 
     State mState;
@@ -97,6 +110,7 @@ class LedgerManagerImpl : public LedgerManager
     HistoryManager::VerifyHashStatus
     verifyCatchupCandidate(LedgerHeaderHistoryEntry const&) const override;
     void closeLedger(LedgerCloseData const& ledgerData) override;
+    void storeHistoryArchiveState() override;
     void deleteOldEntries(Database& db, uint32_t ledgerSeq) override;
     void checkDbState() override;
 };
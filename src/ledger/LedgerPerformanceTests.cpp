@@ -221,3 +221,79 @@ TEST_CASE("ledger performance test", "[performance][hide]")
         LOG(INFO) << "done";
     }
 }
+
+TEST_CASE("prepared statement cache performance", "[performance][hide]")
+{
+    int const nbAccounts = 1000;
+    int const nbLedgers = 200;
+    int const nbPaymentsPerLedger = 100;
+
+    Config::TestDbMode mode = Config::TESTDB_ON_DISK_SQLITE;
+#ifdef USE_POSTGRES
+    if (!force_sqlite)
+        mode = Config::TESTDB_POSTGRESQL;
+#endif
+
+    auto closeLedgers = [&](size_t cacheSize)
+    {
+        Config cfg(getTestConfig(0, mode));
+        cfg.PREPARED_STATEMENT_CACHE_SIZE = cacheSize;
+        VirtualClock clock;
+        Application::pointer app = Application::create(clock, cfg);
+        app->start();
+
+        auto& lm = app->getLedgerManager();
+        Hash const& networkID = app->getNetworkID();
+        SecretKey root = txtest::getRoot(networkID);
+        SequenceNumber rootSeq = txtest::getAccountSeqNum(root, *app) + 1;
+
+        auto close = [&](TxSetFramePtr txSet)
+        {
+            uint32 ledgerSeq = lm.getLedgerNum();
+            StellarValue sv(txSet->getContentsHash(), ledgerSeq * 5,
+                            emptyUpgradeSteps, 0);
+            LedgerCloseData ledgerData(ledgerSeq, txSet, sv);
+            lm.closeLedger(ledgerData);
+        };
+
+        std::vector<SecretKey> accounts;
+        auto txSet =
+            make_shared<TxSetFrame>(lm.getLastClosedLedgerHeader().hash);
+        for (int i = 0; i < nbAccounts; i++)
+        {
+            accounts.push_back(SecretKey::random());
+            txSet->add(txtest::createCreateAccountTx(networkID, root,
+                                                     accounts.back(),
+                                                     rootSeq++, 0));
+        }
+        close(txSet);
+
+        Timer& ledgerTimer = app->getMetrics().NewTimer(
+            {"performance-test", "ledger", "close"});
+        for (int i = 0; i < nbLedgers; i++)
+        {
+            txSet =
+                make_shared<TxSetFrame>(lm.getLastClosedLedgerHeader().hash);
+            for (int j = 0; j < nbPaymentsPerLedger; j++)
+            {
+                txSet->add(txtest::createPaymentTx(
+                    networkID, root, accounts[rand_uniform(0, nbAccounts - 1)],
+                    rootSeq++, 1000000));
+            }
+            auto scope = ledgerTimer.TimeScope();
+            close(txSet);
+        }
+
+        auto& prepares = app->getMetrics().NewMeter(
+            {"database", "statement", "prepare"}, "statement");
+        LOG(INFO) << "PREPARED_STATEMENT_CACHE_SIZE=" << cacheSize << ": "
+                  << ledgerTimer.mean() << " ms per close, "
+                  << prepares.count() << " statements prepared";
+        return ledgerTimer.mean();
+    };
+
+    auto uncached = closeLedgers(0);
+    auto cached = closeLedgers(Config().PREPARED_STATEMENT_CACHE_SIZE);
+    LOG(INFO) << "close time with cache: " << cached << " ms, without: "
+              << uncached << " ms";
+}
@@ -7,11 +7,17 @@
 #include "main/test.h"
 #include "main/Config.h"
 #include "lib/catch.hpp"
+#include "crypto/SecretKey.h"
 #include "database/Database.h"
 #include "ledger/LedgerDelta.h"
 #include "ledger/LedgerManager.h"
 #include "ledger/EntryFrame.h"
 #include "ledger/AccountFrame.h"
+#include "herder/LedgerCloseData.h"
+#include "herder/TxSetFrame.h"
+#include "history/HistoryManager.h"
+#include "history/HistoryWriter.h"
+#include "transactions/TxTests.h"
 #include "util/Logging.h"
 #include "util/types.h"
 #include <xdrpp/autocheck.h>
@@ -137,3 +143,335 @@ TEST_CASE("DB cache interaction with transactions", "[ledger][dbcache]")
 
     CHECK(balance0 == acc->getAccount().balance);
 }
+
+TEST_CASE("ledger entry write-back", "[ledger][dbcache][writeback]")
+{
+    Config::TestDbMode mode = Config::TESTDB_ON_DISK_SQLITE;
+#ifdef USE_POSTGRES
+    if (!force_sqlite)
+        mode = Config::TESTDB_POSTGRESQL;
+#endif
+
+    VirtualClock clock;
+    Application::pointer app =
+        Application::create(clock, getTestConfig(0, mode));
+    app->start();
+
+    auto& db = app->getDatabase();
+    auto& session = db.getSession();
+    auto& header = app->getLedgerManager().getCurrentLedgerHeader();
+
+    // enough accounts and trust lines for a few batches of each
+    std::vector<EntryFrame::pointer> entries;
+    std::vector<AccountFrame::pointer> accounts;
+    {
+        LedgerDelta delta(header, db);
+        while (entries.size() < 300)
+        {
+            auto le = EntryFrame::FromXDR(
+                LedgerTestUtils::generateValidLedgerEntry(3));
+            auto type = le->mEntry.data.type();
+            if ((type == ACCOUNT || type == TRUSTLINE) &&
+                !EntryFrame::exists(db, le->getKey()))
+            {
+                le->storeAdd(delta, db);
+                entries.push_back(le);
+                if (type == ACCOUNT)
+                {
+                    accounts.push_back(
+                        std::static_pointer_cast<AccountFrame>(le));
+                }
+            }
+        }
+        delta.commit();
+    }
+    REQUIRE(accounts.size() > 1);
+
+    auto sqlBalance = [&](AccountFrame::pointer const& acc)
+    {
+        int64_t balance = 0;
+        std::string id = PubKeyUtils::toStrKey(acc->getID());
+        session << "SELECT balance FROM accounts WHERE accountid = :id",
+            soci::into(balance), soci::use(id);
+        return balance;
+    };
+
+    auto changeAll = [&](LedgerDelta& delta)
+    {
+        for (auto const& e : entries)
+        {
+            if (e->mEntry.data.type() == ACCOUNT)
+            {
+                e->mEntry.data.account().balance ^= 1;
+            }
+            e->storeChange(delta, db);
+        }
+    };
+
+    SECTION("rollback drops pending entries")
+    {
+        auto balance = sqlBalance(accounts[0]);
+        {
+            soci::transaction sqltx(session);
+            LedgerDelta delta(header, db);
+            delta.setWriteBack(true);
+            changeAll(delta);
+            REQUIRE(!db.getEntryCache().getDirtyEntries().empty());
+        }
+        REQUIRE(db.getEntryCache().getDirtyEntries().empty());
+        auto acc = AccountFrame::loadAccount(accounts[0]->getID(), db);
+        REQUIRE(acc->getBalance() == balance);
+    }
+
+    SECTION("flush writes pending entries")
+    {
+        soci::transaction sqltx(session);
+        LedgerDelta delta(header, db);
+        delta.setWriteBack(true);
+        changeAll(delta);
+
+        // loads see the new values, the database still has the old ones
+        for (auto const& acc : accounts)
+        {
+            auto loaded = AccountFrame::loadAccount(acc->getID(), db);
+            REQUIRE(loaded->getBalance() == acc->getBalance());
+            REQUIRE(sqlBalance(acc) == (acc->getBalance() ^ 1));
+        }
+
+        // rolling back a nested delta restores the values pending before
+        {
+            LedgerDelta inner(delta);
+            accounts[0]->storeDelete(inner, db);
+            REQUIRE(!EntryFrame::exists(db, accounts[0]->getKey()));
+            REQUIRE(!AccountFrame::loadAccount(accounts[0]->getID(), db));
+
+            auto acc = AccountFrame::loadAccount(accounts[1]->getID(), db);
+            acc->getAccount().balance ^= 2;
+            acc->storeChange(inner, db);
+        }
+        for (int i = 0; i < 2; i++)
+        {
+            auto loaded = AccountFrame::loadAccount(accounts[i]->getID(), db);
+            REQUIRE(loaded);
+            REQUIRE(loaded->getBalance() == accounts[i]->getBalance());
+        }
+
+        // while a committed one keeps its changes
+        {
+            LedgerDelta inner(delta);
+            accounts[0]->storeDelete(inner, db);
+            inner.commit();
+        }
+        REQUIRE(!AccountFrame::loadAccount(accounts[0]->getID(), db));
+
+        delta.flushPending();
+        REQUIRE(db.getEntryCache().getDirtyEntries().empty());
+        delta.commit();
+        sqltx.commit();
+
+        REQUIRE(!EntryFrame::exists(db, accounts[0]->getKey()));
+        for (size_t i = 1; i < accounts.size(); i++)
+        {
+            REQUIRE(sqlBalance(accounts[i]) == accounts[i]->getBalance());
+        }
+        for (auto const& e : entries)
+        {
+            if (e != accounts[0])
+            {
+                EntryFrame::checkAgainstDatabase(e->mEntry, db);
+            }
+        }
+    }
+}
+
+namespace
+{
+// closes ledgers creating accounts and making payments between them, one of
+// them underfunded, and returns their headers
+std::vector<LedgerHeaderHistoryEntry>
+closePaymentLedgers(Config const& cfg)
+{
+    int const nbAccounts = 10;
+    int64_t const paymentAmount = 1000000;
+
+    VirtualClock clock;
+    Application::pointer app = Application::create(clock, cfg);
+    app->start();
+
+    auto& lm = app->getLedgerManager();
+    Hash const& networkID = app->getNetworkID();
+    SecretKey root = txtest::getRoot(networkID);
+    std::vector<SecretKey> accounts;
+    for (int i = 0; i < nbAccounts; i++)
+    {
+        std::string name = "A" + std::to_string(i);
+        accounts.push_back(txtest::getAccount(name.c_str()));
+    }
+
+    std::vector<LedgerHeaderHistoryEntry> headers;
+    auto close = [&](TxSetFramePtr txSet)
+    {
+        uint32 ledgerSeq = lm.getLedgerNum();
+        StellarValue sv(txSet->getContentsHash(), ledgerSeq * 5,
+                        emptyUpgradeSteps, 0);
+        LedgerCloseData ledgerData(ledgerSeq, txSet, sv);
+        lm.closeLedger(ledgerData);
+        headers.push_back(lm.getLastClosedLedgerHeader());
+    };
+
+    SequenceNumber rootSeq = txtest::getAccountSeqNum(root, *app) + 1;
+
+    auto txSet =
+        std::make_shared<TxSetFrame>(lm.getLastClosedLedgerHeader().hash);
+    for (auto& a : accounts)
+    {
+        txSet->add(txtest::createCreateAccountTx(networkID, root, a,
+                                                 rootSeq++, 0));
+    }
+    close(txSet);
+
+    txSet =
+        std::make_shared<TxSetFrame>(lm.getLastClosedLedgerHeader().hash);
+    for (auto& a : accounts)
+    {
+        txSet->add(txtest::createPaymentTx(networkID, root, a, rootSeq++,
+                                           paymentAmount));
+    }
+    close(txSet);
+
+    // every account pays another one, some destinations receiving twice,
+    // and the last payment of the first account is underfunded
+    txSet =
+        std::make_shared<TxSetFrame>(lm.getLastClosedLedgerHeader().hash);
+    for (int i = 0; i < nbAccounts; i++)
+    {
+        SequenceNumber seq = txtest::getAccountSeqNum(accounts[i], *app);
+        txSet->add(txtest::createPaymentTx(
+            networkID, accounts[i], accounts[(i * 3 + 1) % nbAccounts],
+            seq + 1, paymentAmount / 10));
+        if (i == 0)
+        {
+            txSet->add(txtest::createPaymentTx(networkID, accounts[i],
+                                               accounts[nbAccounts - 1],
+                                               seq + 2, paymentAmount * 10));
+        }
+    }
+    close(txSet);
+
+    return headers;
+}
+}
+
+TEST_CASE("ledger write-back matches write-through",
+          "[ledger][dbcache][writeback]")
+{
+    auto closeLedgers = [&](bool writeBack, int instance)
+    {
+        Config cfg(getTestConfig(instance));
+        cfg.LEDGER_WRITE_BACK = writeBack;
+        return closePaymentLedgers(cfg);
+    };
+
+    auto writeThrough = closeLedgers(false, 0);
+    auto writeBack = closeLedgers(true, 1);
+
+    REQUIRE(writeThrough.size() == writeBack.size());
+    for (size_t i = 0; i < writeThrough.size(); i++)
+    {
+        REQUIRE(writeThrough[i].header.txSetResultHash ==
+                writeBack[i].header.txSetResultHash);
+        REQUIRE(writeThrough[i].hash == writeBack[i].hash);
+    }
+}
+
+TEST_CASE("pipelined ledger close", "[ledger][history]")
+{
+    Config cfg = getTestConfig();
+    cfg.PIPELINED_LEDGER_CLOSE = true;
+    VirtualClock clock;
+    Application::pointer app = Application::create(clock, cfg);
+    app->start();
+
+    auto& session = app->getDatabase().getSession();
+    auto& lm = app->getLedgerManager();
+    auto& writer = app->getHistoryManager().getHistoryWriter();
+
+    auto rows = [&](std::string const& table, uint32_t ledgerSeq)
+    {
+        int n = 0;
+        session << "SELECT COUNT(*) FROM " << table
+                << " WHERE ledgerseq = :l",
+            soci::into(n), soci::use(ledgerSeq);
+        return n;
+    };
+
+    SecretKey root = txtest::getRoot(app->getNetworkID());
+    SecretKey a1 = txtest::getAccount("A");
+    SequenceNumber rootSeq = txtest::getAccountSeqNum(root, *app) + 1;
+
+    // the transaction gets into the history whether it succeeds or not
+    auto closeWithPayment = [&]()
+    {
+        uint32_t ledgerSeq = lm.getLedgerNum();
+        auto txSet = std::make_shared<TxSetFrame>(
+            lm.getLastClosedLedgerHeader().hash);
+        txSet->add(txtest::createPaymentTx(app->getNetworkID(), root, a1,
+                                           rootSeq++, 1000));
+        txSet->sortForHash();
+        StellarValue sv(txSet->getContentsHash(),
+                        txtest::getTestDate(1, 1, 2017), emptyUpgradeSteps,
+                        0);
+        lm.closeLedger(LedgerCloseData(ledgerSeq, txSet, sv));
+        return ledgerSeq;
+    };
+
+    SECTION("history is written after the close")
+    {
+        auto ledgerSeq = closeWithPayment();
+        REQUIRE(writer.getPendingCount() == 1);
+        REQUIRE(rows("historyjournal", ledgerSeq) == 1);
+        REQUIRE(rows("txhistory", ledgerSeq) == 0);
+
+        writer.flush();
+        REQUIRE(writer.getPendingCount() == 0);
+        REQUIRE(rows("historyjournal", ledgerSeq) == 0);
+        REQUIRE(rows("txhistory", ledgerSeq) == 1);
+        REQUIRE(rows("txfeehistory", ledgerSeq) == 1);
+        auto results = TransactionFrame::getTransactionHistoryResults(
+            app->getDatabase(), ledgerSeq);
+        REQUIRE(results.results.size() == 1);
+    }
+
+    SECTION("history is written between events")
+    {
+        auto ledgerSeq = closeWithPayment();
+        while (writer.getPendingCount() != 0)
+        {
+            clock.crank(false);
+        }
+        REQUIRE(rows("historyjournal", ledgerSeq) == 0);
+        REQUIRE(rows("txhistory", ledgerSeq) == 1);
+    }
+
+    SECTION("journal is replayed on recovery")
+    {
+        auto first = closeWithPayment();
+        auto second = closeWithPayment();
+        REQUIRE(rows("historyjournal", first) == 1);
+        REQUIRE(rows("historyjournal", second) == 1);
+
+        // as on restart after a crash
+        writer.recover();
+        for (auto ledgerSeq : {first, second})
+        {
+            REQUIRE(rows("historyjournal", ledgerSeq) == 0);
+            REQUIRE(rows("txhistory", ledgerSeq) == 1);
+            REQUIRE(rows("txfeehistory", ledgerSeq) == 1);
+        }
+
+        // writing the same history again changes nothing
+        writer.flush();
+        REQUIRE(rows("txhistory", first) == 1);
+        REQUIRE(rows("txhistory", second) == 1);
+    }
+}
@@ -9,12 +9,17 @@
 #include "crypto/SHA.h"
 #include "LedgerDelta.h"
 #include "util/types.h"
+#include "xdrpp/printer.h"
+#include <algorithm>
+#include <limits>
 
 using namespace std;
 using namespace soci;
 
 namespace stellar
 {
+using xdr::operator==;
+
 const char* OfferFrame::kSQLCreateStatement1 =
     "CREATE TABLE offers"
     "("
@@ -133,17 +138,18 @@ OfferFrame::loadOffer(AccountID const& sellerID, uint64_t offerID, Database& db,
 {
     OfferFrame::pointer retOffer;
 
-    std::string actIDStrKey = PubKeyUtils::toStrKey(sellerID);
+    AccountIDColumn actID(db);
+    actID.set(sellerID);
 
     std::string sql = offerColumnSelector;
     sql += " WHERE sellerid = :id AND offerid = :offerid";
     auto prep = db.getPreparedStatement(sql);
     auto& st = prep.statement();
-    st.exchange(use(actIDStrKey));
+    st.exchange(actID.use());
     st.exchange(use(offerID));
 
     auto timer = db.getSelectTimer("offer");
-    loadOffers(prep, [&retOffer](LedgerEntry const& offer)
+    loadOffers(db, prep, [&retOffer](LedgerEntry const& offer)
                {
                    retOffer = make_shared<OfferFrame>(offer);
                });
@@ -157,13 +163,12 @@ OfferFrame::loadOffer(AccountID const& sellerID, uint64_t offerID, Database& db,
 }
 
 void
-OfferFrame::loadOffers(StatementContext& prep,
+OfferFrame::loadOffers(Database& db, StatementContext& prep,
                        std::function<void(LedgerEntry const&)> offerProcessor)
 {
-    string actIDStrKey;
+    AccountIDColumn actID(db), sellingIssuer(db), buyingIssuer(db);
     unsigned int sellingAssetType, buyingAssetType;
-    std::string sellingAssetCode, buyingAssetCode, sellingIssuerStrKey,
-        buyingIssuerStrKey;
+    std::string sellingAssetCode, buyingAssetCode;
 
     soci::indicator sellingAssetCodeIndicator, buyingAssetCodeIndicator,
         sellingIssuerIndicator, buyingIssuerIndicator;
@@ -173,14 +178,14 @@ OfferFrame::loadOffers(StatementContext& prep,
     OfferEntry& oe = le.data.offer();
 
     statement& st = prep.statement();
-    st.exchange(into(actIDStrKey));
+    st.exchange(actID.into());
     st.exchange(into(oe.offerID));
     st.exchange(into(sellingAssetType));
     st.exchange(into(sellingAssetCode, sellingAssetCodeIndicator));
-    st.exchange(into(sellingIssuerStrKey, sellingIssuerIndicator));
+    st.exchange(sellingIssuer.into(sellingIssuerIndicator));
     st.exchange(into(buyingAssetType));
     st.exchange(into(buyingAssetCode, buyingAssetCodeIndicator));
-    st.exchange(into(buyingIssuerStrKey, buyingIssuerIndicator));
+    st.exchange(buyingIssuer.into(buyingIssuerIndicator));
     st.exchange(into(oe.amount));
     st.exchange(into(oe.price.n));
     st.exchange(into(oe.price.d));
@@ -190,7 +195,7 @@ OfferFrame::loadOffers(StatementContext& prep,
     st.execute(true);
     while (st.got_data())
     {
-        oe.sellerID = PubKeyUtils::fromStrKey(actIDStrKey);
+        oe.sellerID = actID.get();
         if ((buyingAssetType > ASSET_TYPE_CREDIT_ALPHANUM12) ||
             (sellingAssetType > ASSET_TYPE_CREDIT_ALPHANUM12))
             throw std::runtime_error("bad database state");
@@ -207,15 +212,13 @@ OfferFrame::loadOffers(StatementContext& prep,
 
             if (sellingAssetType == ASSET_TYPE_CREDIT_ALPHANUM12)
             {
-                oe.selling.alphaNum12().issuer =
-                    PubKeyUtils::fromStrKey(sellingIssuerStrKey);
+                oe.selling.alphaNum12().issuer = sellingIssuer.get();
                 strToAssetCode(oe.selling.alphaNum12().assetCode,
                                sellingAssetCode);
             }
             else if (sellingAssetType == ASSET_TYPE_CREDIT_ALPHANUM4)
             {
-                oe.selling.alphaNum4().issuer =
-                    PubKeyUtils::fromStrKey(sellingIssuerStrKey);
+                oe.selling.alphaNum4().issuer = sellingIssuer.get();
                 strToAssetCode(oe.selling.alphaNum4().assetCode,
                                sellingAssetCode);
             }
@@ -231,15 +234,13 @@ OfferFrame::loadOffers(StatementContext& prep,
 
             if (buyingAssetType == ASSET_TYPE_CREDIT_ALPHANUM12)
             {
-                oe.buying.alphaNum12().issuer =
-                    PubKeyUtils::fromStrKey(buyingIssuerStrKey);
+                oe.buying.alphaNum12().issuer = buyingIssuer.get();
                 strToAssetCode(oe.buying.alphaNum12().assetCode,
                                buyingAssetCode);
             }
             else if (buyingAssetType == ASSET_TYPE_CREDIT_ALPHANUM4)
             {
-                oe.buying.alphaNum4().issuer =
-                    PubKeyUtils::fromStrKey(buyingIssuerStrKey);
+                oe.buying.alphaNum4().issuer = buyingIssuer.get();
                 strToAssetCode(oe.buying.alphaNum4().assetCode,
                                buyingAssetCode);
             }
@@ -259,11 +260,31 @@ void
 OfferFrame::loadBestOffers(size_t numOffers, size_t offset,
                            Asset const& selling, Asset const& buying,
                            vector<OfferFrame::pointer>& retOffers, Database& db)
+{
+    auto& book = db.getOrderBook();
+    std::vector<OrderBook::EntryPtr> offers;
+    if (!book.getBestOffers(selling, buying, numOffers, offset, offers))
+    {
+        loadOrderBook(selling, buying, db);
+        book.getBestOffers(selling, buying, numOffers, offset, offers);
+    }
+
+    retOffers.reserve(retOffers.size() + offers.size());
+    for (auto const& of : offers)
+    {
+        retOffers.emplace_back(make_shared<OfferFrame>(*of));
+    }
+}
+
+void
+OfferFrame::loadBookOffers(Asset const& selling, Asset const& buying,
+                           std::vector<OrderBook::EntryPtr>& retOffers,
+                           Database& db)
 {
     std::string sql = offerColumnSelector;
 
-    std::string sellingAssetCode, sellingIssuerStrKey;
-    std::string buyingAssetCode, buyingIssuerStrKey;
+    std::string sellingAssetCode, buyingAssetCode;
+    AccountIDColumn sellingIssuer(db), buyingIssuer(db);
 
     bool useSellingAsset = false;
     bool useBuyingAsset = false;
@@ -277,14 +298,12 @@ OfferFrame::loadBestOffers(size_t numOffers, size_t offset,
         if (selling.type() == ASSET_TYPE_CREDIT_ALPHANUM4)
         {
             assetCodeToStr(selling.alphaNum4().assetCode, sellingAssetCode);
-            sellingIssuerStrKey =
-                PubKeyUtils::toStrKey(selling.alphaNum4().issuer);
+            sellingIssuer.set(selling.alphaNum4().issuer);
         }
         else if (selling.type() == ASSET_TYPE_CREDIT_ALPHANUM12)
         {
             assetCodeToStr(selling.alphaNum12().assetCode, sellingAssetCode);
-            sellingIssuerStrKey =
-                PubKeyUtils::toStrKey(selling.alphaNum12().issuer);
+            sellingIssuer.set(selling.alphaNum12().issuer);
         }
         else
         {
@@ -304,14 +323,12 @@ OfferFrame::loadBestOffers(size_t numOffers, size_t offset,
         if (buying.type() == ASSET_TYPE_CREDIT_ALPHANUM4)
         {
             assetCodeToStr(buying.alphaNum4().assetCode, buyingAssetCode);
-            buyingIssuerStrKey =
-                PubKeyUtils::toStrKey(buying.alphaNum4().issuer);
+            buyingIssuer.set(buying.alphaNum4().issuer);
         }
         else if (buying.type() == ASSET_TYPE_CREDIT_ALPHANUM12)
         {
             assetCodeToStr(buying.alphaNum12().assetCode, buyingAssetCode);
-            buyingIssuerStrKey =
-                PubKeyUtils::toStrKey(buying.alphaNum12().issuer);
+            buyingIssuer.set(buying.alphaNum12().issuer);
         }
         else
         {
@@ -324,7 +341,7 @@ OfferFrame::loadBestOffers(size_t numOffers, size_t offset,
 
     // price is an approximation of the actual n/d (truncated math, 15 digits)
     // ordering by offerid gives precendence to older offers for fairness
-    sql += " ORDER BY price, offerid LIMIT :n OFFSET :o";
+    sql += " ORDER BY price, offerid";
 
     auto prep = db.getPreparedStatement(sql);
     auto& st = prep.statement();
@@ -332,23 +349,77 @@ OfferFrame::loadBestOffers(size_t numOffers, size_t offset,
     if (useSellingAsset)
     {
         st.exchange(use(sellingAssetCode));
-        st.exchange(use(sellingIssuerStrKey));
+        st.exchange(sellingIssuer.use());
     }
 
     if (useBuyingAsset)
     {
         st.exchange(use(buyingAssetCode));
-        st.exchange(use(buyingIssuerStrKey));
+        st.exchange(buyingIssuer.use());
     }
 
-    st.exchange(use(numOffers));
-    st.exchange(use(offset));
+    auto timer = db.getSelectTimer("offer-book");
+    loadOffers(db, prep, [&retOffers](LedgerEntry const& of)
+               {
+                   retOffers.emplace_back(make_shared<LedgerEntry const>(of));
+               });
+}
 
-    auto timer = db.getSelectTimer("offer");
-    loadOffers(prep, [&retOffers](LedgerEntry const& of)
+void
+OfferFrame::loadOrderBook(Asset const& selling, Asset const& buying,
+                          Database& db)
+{
+    std::vector<OrderBook::EntryPtr> offers;
+    loadBookOffers(selling, buying, offers, db);
+    db.getOrderBook().load(selling, buying, offers);
+}
+
+void
+OfferFrame::loadOrderBook(Database& db)
+{
+    std::vector<OrderBook::EntryPtr> offers;
+    offers.reserve(countObjects(db.getSession()));
+
+    auto prep = db.getPreparedStatement(offerColumnSelector);
+    auto timer = db.getSelectTimer("offer-book");
+    loadOffers(db, prep, [&offers](LedgerEntry const& of)
                {
-                   retOffers.emplace_back(make_shared<OfferFrame>(of));
+                   offers.emplace_back(make_shared<LedgerEntry const>(of));
                });
+    db.getOrderBook().load(offers);
+}
+
+void
+OfferFrame::checkOrderBook(Asset const& selling, Asset const& buying,
+                           Database& db)
+{
+    std::vector<OrderBook::EntryPtr> inMemory;
+    if (!db.getOrderBook().getBestOffers(
+            selling, buying, std::numeric_limits<size_t>::max(), 0, inMemory))
+    {
+        return;
+    }
+    std::vector<OrderBook::EntryPtr> fromDb;
+    loadBookOffers(selling, buying, fromDb, db);
+
+    for (size_t i = 0; i < std::max(inMemory.size(), fromDb.size()); i++)
+    {
+        if (i >= inMemory.size() || i >= fromDb.size() ||
+            !(*inMemory[i] == *fromDb[i]))
+        {
+            std::string s;
+            s = "Inconsistent state between the order book and the database: ";
+            if (i < fromDb.size())
+            {
+                s += xdr::xdr_to_string(*fromDb[i], "db");
+            }
+            if (i < inMemory.size())
+            {
+                s += xdr::xdr_to_string(*inMemory[i], "book");
+            }
+            throw std::runtime_error(s);
+        }
+    }
 }
 
 void
@@ -356,17 +427,17 @@ OfferFrame::loadOffers(AccountID const& accountID,
                        std::vector<OfferFrame::pointer>& retOffers,
                        Database& db)
 {
-    std::string actIDStrKey;
-    actIDStrKey = PubKeyUtils::toStrKey(accountID);
+    AccountIDColumn actID(db);
+    actID.set(accountID);
 
     std::string sql = offerColumnSelector;
     sql += " WHERE sellerid = :id";
     auto prep = db.getPreparedStatement(sql);
     auto& st = prep.statement();
-    st.exchange(use(actIDStrKey));
+    st.exchange(actID.use());
 
     auto timer = db.getSelectTimer("offer");
-    loadOffers(prep, [&retOffers](LedgerEntry const& of)
+    loadOffers(db, prep, [&retOffers](LedgerEntry const& of)
                {
                    retOffers.emplace_back(make_shared<OfferFrame>(of));
                });
@@ -381,7 +452,7 @@ OfferFrame::loadAllOffers(Database& db)
     auto prep = db.getPreparedStatement(sql);
 
     auto timer = db.getSelectTimer("offer");
-    loadOffers(prep, [&retOffers](LedgerEntry const& of)
+    loadOffers(db, prep, [&retOffers](LedgerEntry const& of)
                {
                    auto& thisUserOffers = retOffers[of.data.offer().sellerID];
                    thisUserOffers.emplace_back(make_shared<OfferFrame>(of));
@@ -392,14 +463,15 @@ OfferFrame::loadAllOffers(Database& db)
 bool
 OfferFrame::exists(Database& db, LedgerKey const& key)
 {
-    std::string actIDStrKey = PubKeyUtils::toStrKey(key.offer().sellerID);
+    AccountIDColumn actID(db);
+    actID.set(key.offer().sellerID);
     int exists = 0;
     auto timer = db.getSelectTimer("offer-exists");
     auto prep =
         db.getPreparedStatement("SELECT EXISTS (SELECT NULL FROM offers "
                                 "WHERE sellerid=:id AND offerid=:s)");
     auto& st = prep.statement();
-    st.exchange(use(actIDStrKey));
+    st.exchange(actID.use());
     st.exchange(use(key.offer().offerID));
     st.exchange(into(exists));
     st.define_and_bind();
@@ -430,6 +502,7 @@ OfferFrame::storeDelete(LedgerDelta& delta, Database& db, LedgerKey const& key)
     st.exchange(use(key.offer().offerID));
     st.define_and_bind();
     st.execute(true);
+    db.getOrderBook().erase(key.offer().offerID);
     delta.deleteEntry(key);
 }
 
@@ -461,40 +534,36 @@ OfferFrame::storeUpdateHelper(LedgerDelta& delta, Database& db, bool insert)
         throw std::runtime_error("Invalid asset");
     }
 
-    std::string actIDStrKey = PubKeyUtils::toStrKey(mOffer.sellerID);
+    AccountIDColumn actID(db), sellingIssuer(db), buyingIssuer(db);
+    actID.set(mOffer.sellerID);
 
     unsigned int sellingType = mOffer.selling.type();
     unsigned int buyingType = mOffer.buying.type();
-    std::string sellingIssuerStrKey, buyingIssuerStrKey;
     std::string sellingAssetCode, buyingAssetCode;
     soci::indicator selling_ind = soci::i_null, buying_ind = soci::i_null;
 
     if (sellingType == ASSET_TYPE_CREDIT_ALPHANUM4)
     {
-        sellingIssuerStrKey =
-            PubKeyUtils::toStrKey(mOffer.selling.alphaNum4().issuer);
+        sellingIssuer.set(mOffer.selling.alphaNum4().issuer);
         assetCodeToStr(mOffer.selling.alphaNum4().assetCode, sellingAssetCode);
         selling_ind = soci::i_ok;
     }
     else if (sellingType == ASSET_TYPE_CREDIT_ALPHANUM12)
     {
-        sellingIssuerStrKey =
-            PubKeyUtils::toStrKey(mOffer.selling.alphaNum12().issuer);
+        sellingIssuer.set(mOffer.selling.alphaNum12().issuer);
         assetCodeToStr(mOffer.selling.alphaNum12().assetCode, sellingAssetCode);
         selling_ind = soci::i_ok;
     }
 
     if (buyingType == ASSET_TYPE_CREDIT_ALPHANUM4)
     {
-        buyingIssuerStrKey =
-            PubKeyUtils::toStrKey(mOffer.buying.alphaNum4().issuer);
+        buyingIssuer.set(mOffer.buying.alphaNum4().issuer);
         assetCodeToStr(mOffer.buying.alphaNum4().assetCode, buyingAssetCode);
         buying_ind = soci::i_ok;
     }
     else if (buyingType == ASSET_TYPE_CREDIT_ALPHANUM12)
     {
-        buyingIssuerStrKey =
-            PubKeyUtils::toStrKey(mOffer.buying.alphaNum12().issuer);
+        buyingIssuer.set(mOffer.buying.alphaNum12().issuer);
         assetCodeToStr(mOffer.buying.alphaNum12().assetCode, buyingAssetCode);
         buying_ind = soci::i_ok;
     }
@@ -523,15 +592,15 @@ OfferFrame::storeUpdateHelper(LedgerDelta& delta, Database& db, bool insert)
 
     if (insert)
     {
-        st.exchange(use(actIDStrKey, "sid"));
+        st.exchange(actID.use("sid"));
     }
     st.exchange(use(mOffer.offerID, "oid"));
     st.exchange(use(sellingType, "sat"));
     st.exchange(use(sellingAssetCode, selling_ind, "sac"));
-    st.exchange(use(sellingIssuerStrKey, selling_ind, "si"));
+    st.exchange(sellingIssuer.use(selling_ind, "si"));
     st.exchange(use(buyingType, "bat"));
     st.exchange(use(buyingAssetCode, buying_ind, "bac"));
-    st.exchange(use(buyingIssuerStrKey, buying_ind, "bi"));
+    st.exchange(buyingIssuer.use(buying_ind, "bi"));
     st.exchange(use(mOffer.amount, "a"));
     st.exchange(use(mOffer.price.n, "pn"));
     st.exchange(use(mOffer.price.d, "pd"));
@@ -549,6 +618,7 @@ OfferFrame::storeUpdateHelper(LedgerDelta& delta, Database& db, bool insert)
     {
         throw std::runtime_error("could not update SQL");
     }
+    db.getOrderBook().put(mEntry);
 
     if (insert)
     {
@@ -561,10 +631,20 @@ OfferFrame::storeUpdateHelper(LedgerDelta& delta, Database& db, bool insert)
 }
 
 void
-OfferFrame::dropAll(Database& db)
+OfferFrame::dropAll(Database& db, bool withIndexes)
 {
     db.getSession() << "DROP TABLE IF EXISTS offers;";
-    db.getSession() << kSQLCreateStatement1;
+    db.getSession() << db.withAccountIDType(kSQLCreateStatement1);
+    db.getOrderBook().clear();
+    if (withIndexes)
+    {
+        createIndexes(db);
+    }
+}
+
+void
+OfferFrame::createIndexes(Database& db)
+{
     db.getSession() << kSQLCreateStatement2;
     db.getSession() << kSQLCreateStatement3;
     db.getSession() << kSQLCreateStatement4;
@@ -4,6 +4,7 @@
 // under the Apache License, Version 2.0. See the COPYING file at the root
 // of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
 
+#include "database/OrderBook.h"
 #include "ledger/EntryFrame.h"
 #include <functional>
 #include <unordered_map>
@@ -21,7 +22,7 @@ class StatementContext;
 class OfferFrame : public EntryFrame
 {
     static void
-    loadOffers(StatementContext& prep,
+    loadOffers(Database& db, StatementContext& prep,
                std::function<void(LedgerEntry const&)> offerProcessor);
 
     double computePrice() const;
@@ -32,6 +33,11 @@ class OfferFrame : public EntryFrame
 
     void storeUpdateHelper(LedgerDelta& delta, Database& db, bool insert);
 
+    // all the offers of a pair from the database, best first
+    static void loadBookOffers(Asset const& selling, Asset const& buying,
+                               std::vector<OrderBook::EntryPtr>& retOffers,
+                               Database& db);
+
   public:
     typedef std::shared_ptr<OfferFrame> pointer;
 
@@ -88,11 +94,22 @@ class OfferFrame : public EntryFrame
     static pointer loadOffer(AccountID const& accountID, uint64_t offerID,
                              Database& db, LedgerDelta* delta = nullptr);
 
+    // reads the book of the pair from the order book, loading it from the
+    // database first if needed
     static void loadBestOffers(size_t numOffers, size_t offset,
                                Asset const& pays, Asset const& gets,
                                std::vector<OfferFrame::pointer>& retOffers,
                                Database& db);
 
+    // loads the book of a pair, or of every pair with offers, into the
+    // order book
+    static void loadOrderBook(Asset const& selling, Asset const& buying,
+                              Database& db);
+    static void loadOrderBook(Database& db);
+    // throws if the book of the pair, when loaded, differs from the database
+    static void checkOrderBook(Asset const& selling, Asset const& buying,
+                               Database& db);
+
     static void loadOffers(AccountID const& accountID,
                            std::vector<OfferFrame::pointer>& retOffers,
                            Database& db);
@@ -101,7 +118,10 @@ class OfferFrame : public EntryFrame
     static std::unordered_map<AccountID, std::vector<OfferFrame::pointer>>
     loadAllOffers(Database& db);
 
-    static void dropAll(Database& db);
+    // without `withIndexes`, the secondary indexes are left for
+    // createIndexes, to be created once the tables are filled
+    static void dropAll(Database& db, bool withIndexes = true);
+    static void createIndexes(Database& db);
     static const char* kSQLCreateStatement1;
     static const char* kSQLCreateStatement2;
     static const char* kSQLCreateStatement3;
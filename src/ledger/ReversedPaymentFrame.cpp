@@ -93,19 +93,63 @@ ReversedPaymentFrame::loadData(StatementContext& prep,
 bool
 ReversedPaymentFrame::exists(Database& db, LedgerKey const& key)
 {
+    auto& index = db.getReversedPaymentIndex();
+    auto id = key.reversedPayment().rID;
+    switch (index.lookup(id))
+    {
+    case ReversedPaymentIndex::PRESENT:
+        return true;
+    case ReversedPaymentIndex::ABSENT:
+        return false;
+    default:
+        break;
+    }
+
     int exists = 0;
     auto timer = db.getSelectTimer("reversed_payment-exists");
     auto prep =
         db.getPreparedStatement("SELECT EXISTS (SELECT NULL FROM reversed_payment "
                                 "WHERE id=:id)");
     auto& st = prep.statement();
-    st.exchange(use(key.reversedPayment().rID));
+    st.exchange(use(id));
     st.exchange(into(exists));
     st.define_and_bind();
     st.execute(true);
+
+    if (exists != 0)
+    {
+        index.insert(id);
+    }
+    else
+    {
+        index.erase(id);
+    }
     return exists != 0;
 }
 
+void
+ReversedPaymentFrame::loadIndex(Database& db)
+{
+    std::vector<int64> ids;
+    ids.reserve(countObjects(db.getSession()));
+
+    int64 id;
+    auto prep = db.getPreparedStatement("SELECT id FROM reversed_payment");
+    auto& st = prep.statement();
+    st.exchange(into(id));
+    st.define_and_bind();
+    {
+        auto timer = db.getSelectTimer("reversed_payment-index");
+        st.execute(true);
+        while (st.got_data())
+        {
+            ids.push_back(id);
+            st.fetch();
+        }
+    }
+    db.getReversedPaymentIndex().load(std::move(ids));
+}
+
 uint64_t
 ReversedPaymentFrame::countObjects(soci::session& sess)
 {
@@ -129,6 +173,7 @@ ReversedPaymentFrame::storeDelete(LedgerDelta& delta, Database& db, LedgerKey co
     st.exchange(use(key.reversedPayment().rID));
     st.define_and_bind();
     st.execute(true);
+    db.getReversedPaymentIndex().erase(key.reversedPayment().rID);
     delta.deleteEntry(key);
 }
 
@@ -179,6 +224,7 @@ ReversedPaymentFrame::storeUpdateHelper(LedgerDelta& delta, Database& db, bool i
 
     if (insert)
     {
+        db.getReversedPaymentIndex().insert(mReversedPayment.rID);
         delta.addEntry(*this);
     }
     else
@@ -192,5 +238,6 @@ ReversedPaymentFrame::dropAll(Database& db)
 {
     db.getSession() << "DROP TABLE IF EXISTS reversed_payment;";
     db.getSession() << kSQLCreateStatement1;
+    db.getReversedPaymentIndex().clear();
 }
 }
@@ -64,11 +64,15 @@ class ReversedPaymentFrame : public EntryFrame
     // Static helpers that don't assume an instance.
     static void storeDelete(LedgerDelta& delta, Database& db,
                             LedgerKey const& key);
+    // looks the id up in the ReversedPaymentIndex, the database is only
+    // queried if the index can't tell
     static bool exists(Database& db, LedgerKey const& key);
     static uint64_t countObjects(soci::session& sess);
 
     // database utilities
     static pointer loadReversedPayment(int64 id, Database& db);
+    // fills the ReversedPaymentIndex with the ids of the table
+    static void loadIndex(Database& db);
 
     static void dropAll(Database& db);
     static const char* kSQLCreateStatement1;
@@ -7,7 +7,9 @@
 #include "crypto/SHA.h"
 #include "database/Database.h"
 #include "LedgerDelta.h"
+#include "util/make_unique.h"
 #include "util/types.h"
+#include <algorithm>
 
 using namespace std;
 using namespace soci;
@@ -61,20 +63,18 @@ TrustFrame& TrustFrame::operator=(TrustFrame const& other)
 }
 
 void
-TrustFrame::getKeyFields(LedgerKey const& key, std::string& actIDStrKey,
-                         std::string& issuerStrKey, std::string& assetCode)
+TrustFrame::getKeyFields(LedgerKey const& key, AccountIDColumn& actID,
+                         AccountIDColumn& issuer, std::string& assetCode)
 {
-    actIDStrKey = PubKeyUtils::toStrKey(key.trustLine().accountID);
+    actID.set(key.trustLine().accountID);
     if (key.trustLine().asset.type() == ASSET_TYPE_CREDIT_ALPHANUM4)
     {
-        issuerStrKey =
-            PubKeyUtils::toStrKey(key.trustLine().asset.alphaNum4().issuer);
+        issuer.set(key.trustLine().asset.alphaNum4().issuer);
         assetCodeToStr(key.trustLine().asset.alphaNum4().assetCode, assetCode);
     }
     else if (key.trustLine().asset.type() == ASSET_TYPE_CREDIT_ALPHANUM12)
     {
-        issuerStrKey =
-            PubKeyUtils::toStrKey(key.trustLine().asset.alphaNum12().issuer);
+        issuer.set(key.trustLine().asset.alphaNum12().issuer);
         assetCodeToStr(key.trustLine().asset.alphaNum12().assetCode, assetCode);
     }
 }
@@ -159,21 +159,23 @@ TrustFrame::isValid() const
 bool
 TrustFrame::exists(Database& db, LedgerKey const& key)
 {
-    if (cachedEntryExists(key, db) && getCachedEntry(key, db) != nullptr)
+    std::shared_ptr<LedgerEntry const> cached;
+    if (getCachedEntry(key, cached, db))
     {
-        return true;
+        return cached != nullptr;
     }
 
-    std::string actIDStrKey, issuerStrKey, assetCode;
-    getKeyFields(key, actIDStrKey, issuerStrKey, assetCode);
+    AccountIDColumn actID(db), issuer(db);
+    std::string assetCode;
+    getKeyFields(key, actID, issuer, assetCode);
     int exists = 0;
     auto timer = db.getSelectTimer("trust-exists");
     auto prep = db.getPreparedStatement(
         "SELECT EXISTS (SELECT NULL FROM trustlines "
         "WHERE accountid=:v1 AND issuer=:v2 AND assetcode=:v3)");
     auto& st = prep.statement();
-    st.exchange(use(actIDStrKey));
-    st.exchange(use(issuerStrKey));
+    st.exchange(actID.use());
+    st.exchange(issuer.use());
     st.exchange(use(assetCode));
     st.exchange(into(exists));
     st.define_and_bind();
@@ -200,13 +202,21 @@ TrustFrame::storeDelete(LedgerDelta& delta, Database& db, LedgerKey const& key)
 {
     flushCachedEntry(key, db);
 
-    std::string actIDStrKey, issuerStrKey, assetCode;
-    getKeyFields(key, actIDStrKey, issuerStrKey, assetCode);
+    if (delta.isWriteBack(key))
+    {
+        delta.storePending(key, nullptr);
+        delta.deleteEntry(key);
+        return;
+    }
+
+    AccountIDColumn actID(db), issuer(db);
+    std::string assetCode;
+    getKeyFields(key, actID, issuer, assetCode);
 
     auto timer = db.getDeleteTimer("trust");
     db.getSession() << "DELETE FROM trustlines "
                        "WHERE accountid=:v1 AND issuer=:v2 AND assetcode=:v3",
-        use(actIDStrKey), use(issuerStrKey), use(assetCode);
+        actID.use(), issuer.use(), use(assetCode);
 
     delta.deleteEntry(key);
 }
@@ -227,8 +237,16 @@ TrustFrame::storeChange(LedgerDelta& delta, Database& db)
 
     touch(delta);
 
-    std::string actIDStrKey, issuerStrKey, assetCode;
-    getKeyFields(key, actIDStrKey, issuerStrKey, assetCode);
+    if (delta.isWriteBack(key))
+    {
+        delta.storePending(key, std::make_shared<LedgerEntry const>(mEntry));
+        delta.modEntry(*this);
+        return;
+    }
+
+    AccountIDColumn actID(db), issuer(db);
+    std::string assetCode;
+    getKeyFields(key, actID, issuer, assetCode);
 
     auto prep = db.getPreparedStatement(
         "UPDATE trustlines "
@@ -239,8 +257,8 @@ TrustFrame::storeChange(LedgerDelta& delta, Database& db)
     st.exchange(use(mTrustLine.limit));
     st.exchange(use(mTrustLine.flags));
     st.exchange(use(getLastModified()));
-    st.exchange(use(actIDStrKey));
-    st.exchange(use(issuerStrKey));
+    st.exchange(actID.use());
+    st.exchange(issuer.use());
     st.exchange(use(assetCode));
     st.define_and_bind();
     {
@@ -271,9 +289,17 @@ TrustFrame::storeAdd(LedgerDelta& delta, Database& db)
 
     touch(delta);
 
-    std::string actIDStrKey, issuerStrKey, assetCode;
+    if (delta.isWriteBack(key))
+    {
+        delta.storePending(key, std::make_shared<LedgerEntry const>(mEntry));
+        delta.addEntry(*this);
+        return;
+    }
+
+    AccountIDColumn actID(db), issuer(db);
+    std::string assetCode;
     unsigned int assetType = getKey().trustLine().asset.type();
-    getKeyFields(getKey(), actIDStrKey, issuerStrKey, assetCode);
+    getKeyFields(getKey(), actID, issuer, assetCode);
 
     auto prep = db.getPreparedStatement(
         "INSERT INTO trustlines "
@@ -281,9 +307,9 @@ TrustFrame::storeAdd(LedgerDelta& delta, Database& db)
         "lastmodified) "
         "VALUES (:v1, :v2, :v3, :v4, :v5, :v6, :v7, :v8)");
     auto& st = prep.statement();
-    st.exchange(use(actIDStrKey));
+    st.exchange(actID.use());
     st.exchange(use(assetType));
-    st.exchange(use(issuerStrKey));
+    st.exchange(issuer.use());
     st.exchange(use(assetCode));
     st.exchange(use(mTrustLine.balance));
     st.exchange(use(mTrustLine.limit));
@@ -303,6 +329,86 @@ TrustFrame::storeAdd(LedgerDelta& delta, Database& db)
     delta.addEntry(*this);
 }
 
+void
+TrustFrame::storePending(Database& db,
+                         std::vector<LedgerEntry const*> const& live,
+                         std::vector<LedgerKey const*> const& dead)
+{
+    size_t const nColumns = 8;
+    for (size_t begin = 0; begin < live.size(); begin += PENDING_BATCH_ROWS)
+    {
+        size_t n = std::min(PENDING_BATCH_ROWS, live.size() - begin);
+
+        std::string sql(db.isSqlite() ? "INSERT OR REPLACE INTO trustlines "
+                                      : "INSERT INTO trustlines ");
+        sql += "(accountid, assettype, issuer, assetcode, balance, tlimit, "
+               "flags, lastmodified) VALUES ";
+        sql += batchPlaceholders(n, nColumns);
+        if (!db.isSqlite())
+        {
+            sql += " ON CONFLICT (accountid, issuer, assetcode) DO UPDATE SET "
+                   "balance = excluded.balance, tlimit = excluded.tlimit, "
+                   "flags = excluded.flags, "
+                   "lastmodified = excluded.lastmodified";
+        }
+
+        std::vector<std::unique_ptr<AccountIDColumn>> actIDs, issuers;
+        std::vector<std::string> assetCodes(n);
+        std::vector<unsigned int> assetTypes(n);
+
+        auto prep = db.getPreparedStatement(sql);
+        auto& st = prep.statement();
+        for (size_t i = 0; i < n; i++)
+        {
+            LedgerEntry const& le = *live[begin + i];
+            TrustLineEntry const& tl = le.data.trustLine();
+
+            actIDs.emplace_back(make_unique<AccountIDColumn>(db));
+            issuers.emplace_back(make_unique<AccountIDColumn>(db));
+            getKeyFields(LedgerEntryKey(le), *actIDs[i], *issuers[i],
+                         assetCodes[i]);
+            assetTypes[i] = tl.asset.type();
+
+            st.exchange(actIDs[i]->use());
+            st.exchange(use(assetTypes[i]));
+            st.exchange(issuers[i]->use());
+            st.exchange(use(assetCodes[i]));
+            st.exchange(use(tl.balance));
+            st.exchange(use(tl.limit));
+            st.exchange(use(tl.flags));
+            st.exchange(use(le.lastModifiedLedgerSeq));
+        }
+        st.define_and_bind();
+        {
+            auto timer = db.getUpdateTimer("trust-batch");
+            st.execute(true);
+        }
+
+        if (st.get_affected_rows() != static_cast<long long>(n))
+        {
+            throw std::runtime_error("Could not update data in SQL");
+        }
+    }
+
+    for (auto key : dead)
+    {
+        AccountIDColumn actID(db), issuer(db);
+        std::string assetCode;
+        getKeyFields(*key, actID, issuer, assetCode);
+
+        auto timer = db.getDeleteTimer("trust");
+        auto prep = db.getPreparedStatement(
+            "DELETE FROM trustlines "
+            "WHERE accountid=:v1 AND issuer=:v2 AND assetcode=:v3");
+        auto& st = prep.statement();
+        st.exchange(actID.use());
+        st.exchange(issuer.use());
+        st.exchange(use(assetCode));
+        st.define_and_bind();
+        st.execute(true);
+    }
+}
+
 static const char* trustLineColumnSelector =
     "SELECT "
     "accountid,assettype,issuer,assetcode,tlimit,balance,flags,lastmodified "
@@ -337,25 +443,15 @@ TrustFrame::loadTrustLine(AccountID const& accountID, Asset const& asset,
     key.type(TRUSTLINE);
     key.trustLine().accountID = accountID;
     key.trustLine().asset = asset;
-    if (cachedEntryExists(key, db))
+    std::shared_ptr<LedgerEntry const> p;
+    if (getCachedEntry(key, p, db))
     {
-        auto p = getCachedEntry(key, db);
         return p ? std::make_shared<TrustFrame>(*p) : nullptr;
     }
 
-    std::string accStr, issuerStr, assetStr;
-
-    accStr = PubKeyUtils::toStrKey(accountID);
-    if (asset.type() == ASSET_TYPE_CREDIT_ALPHANUM4)
-    {
-        assetCodeToStr(asset.alphaNum4().assetCode, assetStr);
-        issuerStr = PubKeyUtils::toStrKey(asset.alphaNum4().issuer);
-    }
-    else if (asset.type() == ASSET_TYPE_CREDIT_ALPHANUM12)
-    {
-        assetCodeToStr(asset.alphaNum12().assetCode, assetStr);
-        issuerStr = PubKeyUtils::toStrKey(asset.alphaNum12().issuer);
-    }
+    AccountIDColumn actID(db), issuer(db);
+    std::string assetStr;
+    getKeyFields(key, actID, issuer, assetStr);
 
     auto query = std::string(trustLineColumnSelector);
     query += (" WHERE accountid = :id "
@@ -363,13 +459,13 @@ TrustFrame::loadTrustLine(AccountID const& accountID, Asset const& asset,
               " AND assetcode = :asset");
     auto prep = db.getPreparedStatement(query);
     auto& st = prep.statement();
-    st.exchange(use(accStr));
-    st.exchange(use(issuerStr));
+    st.exchange(actID.use());
+    st.exchange(issuer.use());
     st.exchange(use(assetStr));
 
     pointer retLine;
     auto timer = db.getSelectTimer("trust");
-    loadLines(prep, [&retLine](LedgerEntry const& trust)
+    loadLines(db, prep, [&retLine](LedgerEntry const& trust)
               {
                   retLine = make_shared<TrustFrame>(trust);
               });
@@ -402,11 +498,11 @@ TrustFrame::loadTrustLineIssuer(AccountID const& accountID, Asset const& asset,
 }
 
 void
-TrustFrame::loadLines(StatementContext& prep,
+TrustFrame::loadLines(Database& db, StatementContext& prep,
                       std::function<void(LedgerEntry const&)> trustProcessor)
 {
-    string actIDStrKey;
-    std::string issuerStrKey, assetCode;
+    AccountIDColumn actID(db), issuer(db);
+    std::string assetCode;
     unsigned int assetType;
 
     LedgerEntry le;
@@ -415,9 +511,9 @@ TrustFrame::loadLines(StatementContext& prep,
     TrustLineEntry& tl = le.data.trustLine();
 
     auto& st = prep.statement();
-    st.exchange(into(actIDStrKey));
+    st.exchange(actID.into());
     st.exchange(into(assetType));
-    st.exchange(into(issuerStrKey));
+    st.exchange(issuer.into());
     st.exchange(into(assetCode));
     st.exchange(into(tl.limit));
     st.exchange(into(tl.balance));
@@ -428,17 +524,16 @@ TrustFrame::loadLines(StatementContext& prep,
     st.execute(true);
     while (st.got_data())
     {
-        tl.accountID = PubKeyUtils::fromStrKey(actIDStrKey);
+        tl.accountID = actID.get();
         tl.asset.type((AssetType)assetType);
         if (assetType == ASSET_TYPE_CREDIT_ALPHANUM4)
         {
-            tl.asset.alphaNum4().issuer = PubKeyUtils::fromStrKey(issuerStrKey);
+            tl.asset.alphaNum4().issuer = issuer.get();
             strToAssetCode(tl.asset.alphaNum4().assetCode, assetCode);
         }
         else if (assetType == ASSET_TYPE_CREDIT_ALPHANUM12)
         {
-            tl.asset.alphaNum12().issuer =
-                PubKeyUtils::fromStrKey(issuerStrKey);
+            tl.asset.alphaNum12().issuer = issuer.get();
             strToAssetCode(tl.asset.alphaNum12().assetCode, assetCode);
         }
 
@@ -457,17 +552,17 @@ void
 TrustFrame::loadLines(AccountID const& accountID,
                       std::vector<TrustFrame::pointer>& retLines, Database& db)
 {
-    std::string actIDStrKey;
-    actIDStrKey = PubKeyUtils::toStrKey(accountID);
+    AccountIDColumn actID(db);
+    actID.set(accountID);
 
     auto query = std::string(trustLineColumnSelector);
     query += (" WHERE accountid = :id ");
     auto prep = db.getPreparedStatement(query);
     auto& st = prep.statement();
-    st.exchange(use(actIDStrKey));
+    st.exchange(actID.use());
 
     auto timer = db.getSelectTimer("trust");
-    loadLines(prep, [&retLines](LedgerEntry const& cur)
+    loadLines(db, prep, [&retLines](LedgerEntry const& cur)
               {
                   retLines.emplace_back(make_shared<TrustFrame>(cur));
               });
@@ -483,7 +578,7 @@ TrustFrame::loadAllLines(Database& db)
     auto prep = db.getPreparedStatement(query);
 
     auto timer = db.getSelectTimer("trust");
-    loadLines(prep, [&retLines](LedgerEntry const& cur)
+    loadLines(db, prep, [&retLines](LedgerEntry const& cur)
               {
                   auto& thisUserLines =
                       retLines[cur.data.trustLine().accountID];
@@ -496,6 +591,6 @@ void
 TrustFrame::dropAll(Database& db)
 {
     db.getSession() << "DROP TABLE IF EXISTS trustlines;";
-    db.getSession() << kSQLCreateStatement1;
+    db.getSession() << db.withAccountIDType(kSQLCreateStatement1);
 }
 }
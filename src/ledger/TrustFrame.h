@@ -23,6 +23,7 @@ namespace stellar
 
 class TrustSetTx;
 class StatementContext;
+class AccountIDColumn;
 
 class TrustFrame : public EntryFrame
 {
@@ -30,11 +31,11 @@ class TrustFrame : public EntryFrame
     typedef std::shared_ptr<TrustFrame> pointer;
 
   private:
-    static void getKeyFields(LedgerKey const& key, std::string& actIDStrKey,
-                             std::string& issuerStrKey, std::string& assetCode);
+    static void getKeyFields(LedgerKey const& key, AccountIDColumn& actID,
+                             AccountIDColumn& issuer, std::string& assetCode);
 
     static void
-    loadLines(StatementContext& prep,
+    loadLines(Database& db, StatementContext& prep,
               std::function<void(LedgerEntry const&)> trustProcessor);
 
     TrustLineEntry& mTrustLine;
@@ -63,6 +64,10 @@ class TrustFrame : public EntryFrame
     // Static helper that don't assume an instance.
     static void storeDelete(LedgerDelta& delta, Database& db,
                             LedgerKey const& key);
+    // writes pending entries, see EntryFrame::storePending
+    static void storePending(Database& db,
+                             std::vector<LedgerEntry const*> const& live,
+                             std::vector<LedgerKey const*> const& dead);
     static bool exists(Database& db, LedgerKey const& key);
     static uint64_t countObjects(soci::session& sess);
 
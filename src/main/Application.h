@@ -35,6 +35,7 @@ class PersistentState;
 class LoadGenerator;
 class CommandHandler;
 class WorkManager;
+class OperationMetrics;
 
 /*
  * State of a single instance of the stellar-core application.
@@ -169,6 +170,10 @@ class Application
     // reported through the administrative HTTP interface, see CommandHandler.
     virtual medida::MetricsRegistry& getMetrics() = 0;
 
+    // Get the meters of transactions and operations, resolved from the
+    // registry above, see OperationMeter.
+    virtual OperationMetrics& getOperationMetrics() = 0;
+
     // Ensure any App-local metrics that are "current state" gauge-like counters
     // reflect the current reality as best as possible.
     virtual void syncOwnMetrics() = 0;
@@ -10,11 +10,14 @@
 // else.
 #include "util/asio.h"
 #include "ledger/LedgerManager.h"
+#include "ledger/OfferFrame.h"
+#include "ledger/ReversedPaymentFrame.h"
 #include "herder/Herder.h"
 #include "overlay/OverlayManager.h"
 #include "bucket/Bucket.h"
 #include "bucket/BucketManager.h"
 #include "history/HistoryManager.h"
+#include "history/HistoryWriter.h"
 #include "database/Database.h"
 #include "process/ProcessManager.h"
 #include "main/CommandHandler.h"
@@ -24,6 +27,8 @@
 #include "crypto/SHA.h"
 #include "scp/LocalNode.h"
 #include "main/ExternalQueue.h"
+#include "transactions/OperationMetrics.h"
+#include "transactions/TransactionFrame.h"
 #include "medida/metrics_registry.h"
 #include "medida/reporting/console_reporter.h"
 #include "medida/meter.h"
@@ -52,6 +57,7 @@ ApplicationImpl::ApplicationImpl(VirtualClock& clock, Config const& cfg)
     , mStopping(false)
     , mStoppingTimer(*this)
     , mMetrics(make_unique<medida::MetricsRegistry>())
+    , mOperationMetrics(make_unique<OperationMetrics>(*mMetrics))
     , mAppStateCurrent(mMetrics->NewCounter({"app", "state", "current"}))
     , mAppStateChanges(mMetrics->NewTimer({"app", "state", "changes"}))
     , mLastStateChange(clock.now())
@@ -66,6 +72,7 @@ ApplicationImpl::ApplicationImpl(VirtualClock& clock, Config const& cfg)
     std::srand(static_cast<uint32>(clock.now().time_since_epoch().count()));
 
     mNetworkID = sha256(mConfig.NETWORK_PASSPHRASE);
+    PubKeyUtils::setVerifySigCacheSize(mConfig.SIGNATURE_CACHE_SIZE);
 
     unsigned t = std::thread::hardware_concurrency();
     LOG(DEBUG) << "Application constructing "
@@ -221,6 +228,10 @@ void
 ApplicationImpl::start()
 {
     mDatabase->upgradeToCurrentSchema();
+    ReversedPaymentFrame::loadIndex(*mDatabase);
+    OfferFrame::loadOrderBook(*mDatabase);
+    // history journaled by a previous run that didn't get written
+    mHistoryManager->getHistoryWriter().recover();
 
     if (mPersistentState->getState(PersistentState::kForceSCPOnNextLaunch) ==
         "true")
@@ -500,6 +511,12 @@ ApplicationImpl::getMetrics()
     return *mMetrics;
 }
 
+OperationMetrics&
+ApplicationImpl::getOperationMetrics()
+{
+    return *mOperationMetrics;
+}
+
 void
 ApplicationImpl::syncOwnMetrics()
 {
@@ -524,6 +541,14 @@ ApplicationImpl::syncOwnMetrics()
         .Mark(vignore);
     mMetrics->NewMeter({"crypto", "verify", "total"}, "signature")
         .Mark(vhit + vmiss + vignore);
+    // signatures not even looked up, as their transaction had verified them
+    mMetrics->NewMeter({"crypto", "verify", "memo-hit"}, "signature")
+        .Mark(TransactionFrame::flushVerifiedSignatureHits());
+
+    uint64_t shit = 0, smiss = 0;
+    PubKeyUtils::flushStrKeyCacheCounts(shit, smiss);
+    mMetrics->NewMeter({"crypto", "strkey", "hit"}, "key").Mark(shit);
+    mMetrics->NewMeter({"crypto", "strkey", "miss"}, "key").Mark(smiss);
 
     // Similarly, flush global process-table stats.
     mMetrics->NewCounter({"process", "memory", "handles"}).set_count(
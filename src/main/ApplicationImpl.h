@@ -46,6 +46,7 @@ class ApplicationImpl : public Application
     virtual bool isStopping() const override;
     virtual VirtualClock& getClock() override;
     virtual medida::MetricsRegistry& getMetrics() override;
+    virtual OperationMetrics& getOperationMetrics() override;
     virtual void syncOwnMetrics() override;
     virtual void syncAllMetrics() override;
     virtual TmpDirManager& getTmpDirManager() override;
@@ -137,6 +138,7 @@ class ApplicationImpl : public Application
     VirtualTimer mStoppingTimer;
 
     std::unique_ptr<medida::MetricsRegistry> mMetrics;
+    std::unique_ptr<OperationMetrics> mOperationMetrics;
     medida::Counter& mAppStateCurrent;
     medida::Timer& mAppStateChanges;
     VirtualClock::time_point mLastStateChange;
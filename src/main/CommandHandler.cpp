@@ -29,10 +29,12 @@ using namespace stellar::txtest;
 
 using std::placeholders::_1;
 using std::placeholders::_2;
+using std::placeholders::_3;
 
 namespace stellar
 {
-CommandHandler::CommandHandler(Application& app) : mApp(app)
+CommandHandler::CommandHandler(Application& app)
+    : mApp(app), mTxSubmitQueue(std::make_shared<TxSubmitQueue>(app))
 {
     if (mApp.getConfig().HTTP_PORT)
     {
@@ -94,6 +96,8 @@ CommandHandler::CommandHandler(Application& app) : mApp(app)
     mServer->addRoute("testtx",
                       std::bind(&CommandHandler::testTx, this, _1, _2));
     mServer->addRoute("tx", std::bind(&CommandHandler::tx, this, _1, _2));
+    mServer->addAsyncRoute("txs",
+                           std::bind(&CommandHandler::txs, this, _1, _2, _3));
 }
 
 void
@@ -292,6 +296,11 @@ CommandHandler::fileNotFound(std::string const& params, std::string& retStr)
         "returns a JSON object<br>"
         "wasReceived: boolean, true if transaction was queued properly<br>"
         "result: base64 encoded, XDR serialized 'TransactionResult'<br>"
+        "</p><p><h1> POST /txs</h1>"
+        "submit transactions to the network in bulk.<br>"
+        "the body is a stream of XDR serialized 'TransactionEnvelope', each "
+        "one prefixed by its length, as in history archive files<br>"
+        "returns a JSON array with an object per transaction, as for /tx<br>"
         "</p><p><h1> /dropcursor?id=XYZ</h1> deletes the tracking cursor with "
         "identified by `id`. See `setcursor` for more information"
         "</p><p><h1> /setcursor?id=ID&cursor=N</h1> sets or creates a cursor "
@@ -410,6 +419,12 @@ CommandHandler::peers(std::string const& params, std::string& retStr)
         root["peers"][counter]["olver"] = (int)peer->getRemoteOverlayVersion();
         root["peers"][counter]["id"] =
             mApp.getConfig().toStrKey(peer->getPeerID());
+        root["peers"][counter]["write_queue"] =
+            (Json::UInt64)peer->getWriteQueueLength();
+        root["peers"][counter]["write_queue_bytes"] =
+            (Json::UInt64)peer->getWriteQueueBytes();
+        root["peers"][counter]["write_in_flight_bytes"] =
+            (Json::UInt64)peer->getBytesInFlight();
 
         counter++;
     }
@@ -787,6 +802,13 @@ CommandHandler::tx(std::string const& params, std::string& retStr)
     retStr = output.str();
 }
 
+void
+CommandHandler::txs(std::string const& params, std::string const& body,
+                    std::function<void(std::string const&)> reply)
+{
+    mTxSubmitQueue->submit(body, std::move(reply));
+}
+
 void
 CommandHandler::dropcursor(std::string const& params, std::string& retStr)
 {
@@ -6,6 +6,7 @@
 
 #include <string>
 #include "lib/http/server.hpp"
+#include "main/TxSubmitQueue.h"
 
 /*
 handler functions for the http commands this server supports
@@ -20,6 +21,7 @@ class CommandHandler
 
     Application& mApp;
     std::unique_ptr<http::server::server> mServer;
+    std::shared_ptr<TxSubmitQueue> mTxSubmitQueue;
 
   public:
     CommandHandler(Application& app);
@@ -45,6 +47,8 @@ class CommandHandler
     void setcursor(std::string const& params, std::string& retStr);
     void scpInfo(std::string const& params, std::string& retStr);
     void tx(std::string const& params, std::string& retStr);
+    void txs(std::string const& params, std::string const& body,
+             std::function<void(std::string const&)> reply);
     void testAcc(std::string const& params, std::string& retStr);
     void testTx(std::string const& params, std::string& retStr);
 };
@@ -36,6 +36,8 @@ using xdr::operator<;
     MANUAL_CLOSE = false;
     CATCHUP_COMPLETE = false;
     CATCHUP_RECENT = 0;
+    CATCHUP_BULK_LOAD = false;
+    CATCHUP_FAST_REPLAY = false;
     MAINTENANCE_ON_STARTUP = true;
     ARTIFICIALLY_GENERATE_LOAD_FOR_TESTING = false;
     ARTIFICIALLY_ACCELERATE_TIME_FOR_TESTING = false;
@@ -48,6 +50,7 @@ using xdr::operator<;
     LOG_FILE_PATH = "stellar-core.log";
     TMP_DIR_PATH = "tmp";
     BUCKET_DIR_PATH = "buckets";
+    BUCKET_MERGE_THREADS = 4;
 
     DESIRED_BASE_FEE = 0;
     DESIRED_MAX_TX_PER_LEDGER = 5000;
@@ -59,14 +62,22 @@ using xdr::operator<;
     TARGET_PEER_CONNECTIONS = 8;
     MAX_PEER_CONNECTIONS = 12;
     PREFERRED_PEERS_ONLY = false;
+    PEER_WRITE_BATCH_SIZE = 256 * 1024;
+    PEER_FLOOD_QUEUE_LIMIT = 4 * 1024 * 1024;
 
     MINIMUM_IDLE_PERCENT = 0;
 
     MAX_CONCURRENT_SUBPROCESSES = 16;
+    ENTRY_CACHE_SIZE = 4096;
+    SIGNATURE_CACHE_SIZE = 0xffff;
+    PREPARED_STATEMENT_CACHE_SIZE = 1024;
     PARANOID_MODE = false;
+    LEDGER_WRITE_BACK = false;
+    PIPELINED_LEDGER_CLOSE = false;
     NODE_IS_VALIDATOR = false;
 
     DATABASE = "sqlite3://:memory:";
+    BINARY_ACCOUNT_IDS = false;
 }
 
 void
@@ -296,6 +307,22 @@ Config::load(std::string const& filename)
                 }
                 CATCHUP_RECENT = r;
             }
+            else if (item.first == "CATCHUP_BULK_LOAD")
+            {
+                if (!item.second->as<bool>())
+                {
+                    throw std::invalid_argument("invalid CATCHUP_BULK_LOAD");
+                }
+                CATCHUP_BULK_LOAD = item.second->as<bool>()->value();
+            }
+            else if (item.first == "CATCHUP_FAST_REPLAY")
+            {
+                if (!item.second->as<bool>())
+                {
+                    throw std::invalid_argument("invalid CATCHUP_FAST_REPLAY");
+                }
+                CATCHUP_FAST_REPLAY = item.second->as<bool>()->value();
+            }
             else if (item.first == "ARTIFICIALLY_GENERATE_LOAD_FOR_TESTING")
             {
                 if (!item.second->as<bool>())
@@ -372,6 +399,18 @@ Config::load(std::string const& filename)
                 }
                 BUCKET_DIR_PATH = item.second->as<std::string>()->value();
             }
+            else if (item.first == "BUCKET_MERGE_THREADS")
+            {
+                // a deep merge must not be able to take the only thread, see
+                // BucketMergeExecutor
+                if (!item.second->as<int64_t>() ||
+                    item.second->as<int64_t>()->value() < 2)
+                {
+                    throw std::invalid_argument("invalid BUCKET_MERGE_THREADS");
+                }
+                BUCKET_MERGE_THREADS =
+                    (size_t)item.second->as<int64_t>()->value();
+            }
             else if (item.first == "NODE_NAMES")
             {
                 if (!item.second->is_array())
@@ -509,6 +548,28 @@ Config::load(std::string const& filename)
                     COMMANDS.push_back(v->as<std::string>()->value());
                 }
             }
+            else if (item.first == "PEER_WRITE_BATCH_SIZE")
+            {
+                if (!item.second->as<int64_t>() ||
+                    item.second->as<int64_t>()->value() <= 0)
+                {
+                    throw std::invalid_argument(
+                        "invalid PEER_WRITE_BATCH_SIZE");
+                }
+                PEER_WRITE_BATCH_SIZE =
+                    (size_t)item.second->as<int64_t>()->value();
+            }
+            else if (item.first == "PEER_FLOOD_QUEUE_LIMIT")
+            {
+                if (!item.second->as<int64_t>() ||
+                    item.second->as<int64_t>()->value() < 0)
+                {
+                    throw std::invalid_argument(
+                        "invalid PEER_FLOOD_QUEUE_LIMIT");
+                }
+                PEER_FLOOD_QUEUE_LIMIT =
+                    (size_t)item.second->as<int64_t>()->value();
+            }
             else if (item.first == "MAX_CONCURRENT_SUBPROCESSES")
             {
                 if (!item.second->as<int64_t>())
@@ -519,6 +580,36 @@ Config::load(std::string const& filename)
                 MAX_CONCURRENT_SUBPROCESSES =
                     (size_t)item.second->as<int64_t>()->value();
             }
+            else if (item.first == "ENTRY_CACHE_SIZE")
+            {
+                if (!item.second->as<int64_t>() ||
+                    item.second->as<int64_t>()->value() <= 0)
+                {
+                    throw std::invalid_argument("invalid ENTRY_CACHE_SIZE");
+                }
+                ENTRY_CACHE_SIZE = (size_t)item.second->as<int64_t>()->value();
+            }
+            else if (item.first == "SIGNATURE_CACHE_SIZE")
+            {
+                if (!item.second->as<int64_t>() ||
+                    item.second->as<int64_t>()->value() <= 0)
+                {
+                    throw std::invalid_argument("invalid SIGNATURE_CACHE_SIZE");
+                }
+                SIGNATURE_CACHE_SIZE =
+                    (size_t)item.second->as<int64_t>()->value();
+            }
+            else if (item.first == "PREPARED_STATEMENT_CACHE_SIZE")
+            {
+                if (!item.second->as<int64_t>() ||
+                    item.second->as<int64_t>()->value() < 0)
+                {
+                    throw std::invalid_argument(
+                        "invalid PREPARED_STATEMENT_CACHE_SIZE");
+                }
+                PREPARED_STATEMENT_CACHE_SIZE =
+                    (size_t)item.second->as<int64_t>()->value();
+            }
             else if (item.first == "MINIMUM_IDLE_PERCENT")
             {
                 if (!item.second->as<int64_t>() ||
@@ -587,6 +678,14 @@ Config::load(std::string const& filename)
                 }
                 DATABASE = item.second->as<std::string>()->value();
             }
+            else if (item.first == "BINARY_ACCOUNT_IDS")
+            {
+                if (!item.second->as<bool>())
+                {
+                    throw std::invalid_argument("invalid BINARY_ACCOUNT_IDS");
+                }
+                BINARY_ACCOUNT_IDS = item.second->as<bool>()->value();
+            }
             else if (item.first == "PARANOID_MODE")
             {
                 if (!item.second->as<bool>())
@@ -595,6 +694,23 @@ Config::load(std::string const& filename)
                 }
                 PARANOID_MODE = item.second->as<bool>()->value();
             }
+            else if (item.first == "LEDGER_WRITE_BACK")
+            {
+                if (!item.second->as<bool>())
+                {
+                    throw std::invalid_argument("invalid LEDGER_WRITE_BACK");
+                }
+                LEDGER_WRITE_BACK = item.second->as<bool>()->value();
+            }
+            else if (item.first == "PIPELINED_LEDGER_CLOSE")
+            {
+                if (!item.second->as<bool>())
+                {
+                    throw std::invalid_argument(
+                        "invalid PIPELINED_LEDGER_CLOSE");
+                }
+                PIPELINED_LEDGER_CLOSE = item.second->as<bool>()->value();
+            }
             else if (item.first == "NETWORK_PASSPHRASE")
             {
                 if (!item.second->as<std::string>())
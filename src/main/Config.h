@@ -78,6 +78,21 @@ class Config : public std::enable_shared_from_this<Config>
     // If you want, say, a week of history, set this to 120000.
     uint32_t CATCHUP_RECENT;
 
+    // Rebuild the ledger entry tables from the whole bucket list when
+    // applying buckets during catchup, with multi-row inserts and without
+    // looking up each entry first, instead of applying the buckets that
+    // differ from the local ones on top of the current state. See
+    // BucketBulkLoader.
+    bool CATCHUP_BULK_LOAD;
+
+    // Replay the ledgers of the history archives in checkpoint-sized SQL
+    // transactions, trusting the signatures of their transactions and without
+    // recording their history (txhistory and txfeehistory rows), when catching
+    // up. Ignored when a history archive can be written to, as the replayed
+    // checkpoints would then be published without their transactions. See
+    // ApplyLedgerChainWork.
+    bool CATCHUP_FAST_REPLAY;
+
     // Enables or disables automatic maintenance on startup
     bool MAINTENANCE_ON_STARTUP;
 
@@ -128,6 +143,8 @@ class Config : public std::enable_shared_from_this<Config>
     std::string LOG_FILE_PATH;
     std::string TMP_DIR_PATH;
     std::string BUCKET_DIR_PATH;
+    // number of threads merging buckets, at least 2
+    size_t BUCKET_MERGE_THREADS;
     uint32_t DESIRED_BASE_FEE;     // in stroops
     uint32_t DESIRED_BASE_RESERVE; // in stroops
     uint32_t DESIRED_MAX_TX_PER_LEDGER;
@@ -150,6 +167,13 @@ class Config : public std::enable_shared_from_this<Config>
     // Whether to exclude peers that are not preferred.
     bool PREFERRED_PEERS_ONLY;
 
+    // Maximum number of bytes of queued messages written to a peer at once.
+    size_t PEER_WRITE_BATCH_SIZE;
+
+    // Number of bytes waiting to be written to a peer beyond which
+    // transactions are no longer flooded to it, 0 for no limit.
+    size_t PEER_FLOOD_QUEUE_LIMIT;
+
     // Percentage, between 0 and 100, of system activity (measured in terms
     // of both event-loop cycles and database time) below-which the system
     // will consider itself "loaded" and attempt to shed load. Set this
@@ -161,11 +185,32 @@ class Config : public std::enable_shared_from_this<Config>
     // process-management config
     size_t MAX_CONCURRENT_SUBPROCESSES;
 
+    // number of ledger entries kept in memory in front of the database
+    size_t ENTRY_CACHE_SIZE;
+
+    // number of signature verification results kept in memory, shared by
+    // all the Applications of the process
+    size_t SIGNATURE_CACHE_SIZE;
+
+    // number of prepared SQL statements kept open, 0 to prepare every
+    // statement each time it is used
+    size_t PREPARED_STATEMENT_CACHE_SIZE;
+
     // Setting this causes all sorts of extra checks to occur
     // the overhead may cause slower systems to not perform as fast
     // as the rest of the network, caution is advised when using this.
     bool PARANOID_MODE;
 
+    // Keep the accounts and trust lines stored while closing a ledger in the
+    // entry cache and write them once, in multi-row statements, at the end of
+    // the ledger. See LedgerDelta::setWriteBack.
+    bool LEDGER_WRITE_BACK;
+
+    // Write the transaction and SCP history of closed ledgers (txhistory,
+    // txfeehistory, scphistory) after the ledger is closed, overlapping with
+    // the consensus round of the next ledger. See HistoryWriter.
+    bool PIPELINED_LEDGER_CLOSE;
+
     // SCP config
     SecretKey NODE_SEED;
     bool NODE_IS_VALIDATOR;
@@ -179,6 +224,11 @@ class Config : public std::enable_shared_from_this<Config>
     // Database config
     std::string DATABASE;
 
+    // Store account ids, signers and issuers as the 32 bytes of their keys
+    // (BYTEA on PostgreSQL, BLOB on SQLite) rather than as StrKeys. Applied
+    // by the upgrade to schema version 6, see Database::hasBinaryAccountIDs.
+    bool BINARY_ACCOUNT_IDS;
+
     std::vector<std::string> COMMANDS;
     std::vector<std::string> REPORT_METRICS;
 
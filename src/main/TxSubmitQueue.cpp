@@ -0,0 +1,227 @@
+// Copyright 2017 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "util/asio.h"
+#include "main/TxSubmitQueue.h"
+#include "crypto/SecretKey.h"
+#include "database/Database.h"
+#include "lib/json/json.h"
+#include "main/Application.h"
+#include "overlay/OverlayManager.h"
+#include "util/Logging.h"
+#include "util/basen.h"
+#include "medida/meter.h"
+#include "medida/metrics_registry.h"
+#include "medida/timer.h"
+#include "xdrpp/marshal.h"
+
+namespace stellar
+{
+
+static const char* TX_STATUS_STRING[Herder::TX_STATUS_COUNT] = {
+    "PENDING", "DUPLICATE", "ERROR"};
+
+TxSubmitQueue::TxSubmitQueue(Application& app)
+    : mApp(app)
+    , mAdmissionScheduled(false)
+    , mReceived(app.getMetrics().NewMeter(
+          {"herder", "bulk-submit", "received"}, "transaction"))
+    , mAdmit(app.getMetrics().NewTimer({"herder", "bulk-submit", "admit"}))
+{
+}
+
+void
+TxSubmitQueue::submit(std::string const& body, Reply reply)
+{
+    auto req = std::make_shared<Request>();
+    req->mReply = std::move(reply);
+
+    // the body is copied, the connection is free to reuse its buffer
+    std::weak_ptr<TxSubmitQueue> weak = shared_from_this();
+    auto networkID = mApp.getNetworkID();
+    auto& workers = mApp.getWorkerIOService();
+    auto& main = mApp.getClock().getIOService();
+    workers.post([weak, req, networkID, body, &workers, &main]()
+                 {
+                     decode(*req, networkID, body, workers);
+                     main.post([weak, req]()
+                               {
+                                   auto self = weak.lock();
+                                   if (self)
+                                   {
+                                       self->enqueue(req);
+                                   }
+                               });
+                 });
+}
+
+void
+TxSubmitQueue::decode(Request& req, Hash const& networkID,
+                      std::string const& body, asio::io_service& workers)
+{
+    try
+    {
+        std::vector<PubKeyUtils::SignatureCheck> checks;
+        size_t pos = 0;
+        while (pos < body.size())
+        {
+            if (body.size() - pos < 4)
+            {
+                throw std::runtime_error("truncated record mark");
+            }
+            uint32_t sz = 0;
+            sz |= static_cast<uint8_t>(body[pos] & '\x7f');
+            sz <<= 8;
+            sz |= static_cast<uint8_t>(body[pos + 1]);
+            sz <<= 8;
+            sz |= static_cast<uint8_t>(body[pos + 2]);
+            sz <<= 8;
+            sz |= static_cast<uint8_t>(body[pos + 3]);
+            pos += 4;
+            if (body.size() - pos < sz)
+            {
+                throw std::runtime_error("truncated record");
+            }
+
+            TransactionFramePtr tx;
+            std::string error;
+            try
+            {
+                TransactionEnvelope envelope;
+                xdr::xdr_get g(body.data() + pos, body.data() + pos + sz);
+                xdr::xdr_argpack_archive(g, envelope);
+                g.done();
+                tx = TransactionFrame::makeTransactionFromWire(networkID,
+                                                               envelope);
+                // computed here rather than by the main thread
+                tx->getFullHash();
+                tx->addSignatureChecks(nullptr, checks);
+            }
+            catch (std::exception& e)
+            {
+                tx.reset();
+                error = e.what();
+            }
+            req.mTransactions.emplace_back(tx);
+            req.mErrors.emplace_back(error);
+            pos += sz;
+        }
+
+        // fills the verification cache, so that checking the signatures of
+        // the source accounts on admission is a cache hit
+        PubKeyUtils::verifySigs(std::move(checks), workers);
+    }
+    catch (std::exception& e)
+    {
+        req.mException = e.what();
+        req.mTransactions.clear();
+        req.mErrors.clear();
+    }
+}
+
+void
+TxSubmitQueue::enqueue(RequestPtr req)
+{
+    mQueue.emplace_back(std::move(req));
+    if (!mAdmissionScheduled)
+    {
+        // requests decoded until then are admitted together
+        mAdmissionScheduled = true;
+        std::weak_ptr<TxSubmitQueue> weak = shared_from_this();
+        mApp.getClock().getIOService().post([weak]()
+                                            {
+                                                auto self = weak.lock();
+                                                if (self)
+                                                {
+                                                    self->admit();
+                                                }
+                                            });
+    }
+}
+
+void
+TxSubmitQueue::admit()
+{
+    mAdmissionScheduled = false;
+    std::vector<RequestPtr> queue;
+    queue.swap(mQueue);
+
+    {
+        auto timer = mAdmit.TimeScope();
+        auto& herder = mApp.getHerder();
+
+        // a single transaction for the whole batch, the ones of
+        // recvTransaction become savepoints
+        soci::transaction sqltx(mApp.getDatabase().getSession());
+        mApp.getDatabase().setCurrentTransactionReadOnly();
+
+        for (auto& req : queue)
+        {
+            try
+            {
+                req->mStatuses.reserve(req->mTransactions.size());
+                for (auto const& tx : req->mTransactions)
+                {
+                    auto status = Herder::TX_STATUS_ERROR;
+                    if (tx)
+                    {
+                        mReceived.Mark();
+                        status = herder.recvTransaction(tx);
+                        if (status == Herder::TX_STATUS_PENDING)
+                        {
+                            StellarMessage msg;
+                            msg.type(TRANSACTION);
+                            msg.transaction() = tx->getEnvelope();
+                            mApp.getOverlayManager().broadcastMessage(msg);
+                        }
+                    }
+                    req->mStatuses.emplace_back(status);
+                }
+            }
+            catch (std::exception& e)
+            {
+                CLOG(ERROR, "Herder")
+                    << "Could not admit submitted transactions: " << e.what();
+                req->mException = e.what();
+            }
+        }
+    }
+
+    for (auto const& req : queue)
+    {
+        req->mReply(toJson(*req));
+    }
+}
+
+std::string
+TxSubmitQueue::toJson(Request const& req)
+{
+    Json::Value root;
+    if (!req.mException.empty())
+    {
+        root["exception"] = req.mException;
+        return Json::FastWriter().write(root);
+    }
+
+    root = Json::Value(Json::arrayValue);
+    for (size_t i = 0; i < req.mTransactions.size(); i++)
+    {
+        Json::Value& res = root.append(Json::Value(Json::objectValue));
+        auto const& tx = req.mTransactions[i];
+        if (!tx)
+        {
+            res["exception"] = req.mErrors[i];
+            continue;
+        }
+        auto status = req.mStatuses[i];
+        res["status"] = TX_STATUS_STRING[status];
+        if (status == Herder::TX_STATUS_ERROR)
+        {
+            auto resultBin = xdr::xdr_to_opaque(tx->getResult());
+            res["error"] = bn::encode_b64(resultBin);
+        }
+    }
+    return Json::FastWriter().write(root);
+}
+}
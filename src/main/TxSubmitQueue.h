@@ -0,0 +1,89 @@
+#pragma once
+
+// Copyright 2017 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "herder/Herder.h"
+#include "transactions/TransactionFrame.h"
+#include "util/NonCopyable.h"
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace asio
+{
+class io_service;
+}
+
+namespace medida
+{
+class Meter;
+class Timer;
+}
+
+namespace stellar
+{
+
+class Application;
+
+/**
+ * Admits the transactions submitted in bulk through the "txs" command.
+ *
+ * The body of a request is a stream of XDR TransactionEnvelopes, each one
+ * prefixed by its length as in history archive files. Decoding the stream,
+ * hashing the transactions and checking their signatures happen on the
+ * worker threads. The decoded requests are then queued for the main thread,
+ * which admits everything queued since its last turn at once, within a single
+ * (read-only) SQL transaction, and replies to each request with the status of
+ * each of its transactions, in order.
+ *
+ * The queue must be owned by a shared_ptr: the work left for the main thread
+ * only holds a weak reference to it, requests still in flight when the queue
+ * is destroyed are dropped without a reply.
+ */
+class TxSubmitQueue : public std::enable_shared_from_this<TxSubmitQueue>,
+                      NonMovableOrCopyable
+{
+  public:
+    typedef std::function<void(std::string const&)> Reply;
+
+    explicit TxSubmitQueue(Application& app);
+
+    // `reply` is called on the main thread with a JSON array holding, for
+    // each transaction of `body`, an object formatted as the reply of the
+    // "tx" command
+    void submit(std::string const& body, Reply reply);
+
+  private:
+    struct Request
+    {
+        Reply mReply;
+        // set if the body is not a well formed stream
+        std::string mException;
+        // one per envelope of the body, nullptr if it could not be decoded
+        std::vector<TransactionFramePtr> mTransactions;
+        std::vector<std::string> mErrors;
+        std::vector<Herder::TransactionSubmitStatus> mStatuses;
+    };
+    typedef std::shared_ptr<Request> RequestPtr;
+
+    Application& mApp;
+    // decoded requests, waiting for admission
+    std::vector<RequestPtr> mQueue;
+    bool mAdmissionScheduled;
+
+    medida::Meter& mReceived;
+    medida::Timer& mAdmit;
+
+    // runs on a worker thread
+    static void decode(Request& req, Hash const& networkID,
+                       std::string const& body, asio::io_service& workers);
+
+    void enqueue(RequestPtr req);
+    void admit();
+    static std::string toJson(Request const& req);
+};
+}
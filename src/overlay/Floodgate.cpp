@@ -54,13 +54,14 @@ Floodgate::clearBelow(uint32_t currentLedger)
 }
 
 bool
-Floodgate::addRecord(StellarMessage const& msg, Peer::pointer peer)
+Floodgate::addRecord(StellarMessage const& msg,
+                     Peer::SerializedMessage const& body, Peer::pointer peer)
 {
     if (mShuttingDown)
     {
         return false;
     }
-    Hash index = sha256(xdr::xdr_to_opaque(msg));
+    Hash index = sha256(*body);
     auto result = mFloodMap.find(index);
     if (result == mFloodMap.end())
     { // we have never seen this message
@@ -78,13 +79,15 @@ Floodgate::addRecord(StellarMessage const& msg, Peer::pointer peer)
 
 // send message to anyone you haven't gotten it from
 void
-Floodgate::broadcast(StellarMessage const& msg, bool force)
+Floodgate::broadcast(StellarMessage const& msg,
+                     Peer::SerializedMessage const& body, bool force)
 {
     if (mShuttingDown)
     {
         return;
     }
-    Hash index = sha256(xdr::xdr_to_opaque(msg));
+    // serialized once, for the index and for all the peers
+    Hash index = sha256(*body);
     CLOG(TRACE, "Overlay") << "broadcast " << hexAbbrev(index);
 
     auto result = mFloodMap.find(index);
@@ -106,7 +109,7 @@ Floodgate::broadcast(StellarMessage const& msg, bool force)
         if (peersTold.find(peer) == peersTold.end() && peer->isAuthenticated())
         {
             mSendFromBroadcast.Mark();
-            peer->sendMessage(msg);
+            peer->sendMessage(msg, body);
             peersTold.insert(peer);
         }
     }
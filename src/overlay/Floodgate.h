@@ -54,10 +54,14 @@ class Floodgate
     Floodgate(Application& app);
     // Floodgate will be cleared after every ledger close
     void clearBelow(uint32_t currentLedger);
-    // returns true if this is a new record
-    bool addRecord(StellarMessage const& msg, Peer::pointer fromPeer);
+    // returns true if this is a new record; `body` is the result of
+    // Peer::serializeMessage(msg), hashed for the index of the record
+    bool addRecord(StellarMessage const& msg,
+                   Peer::SerializedMessage const& body, Peer::pointer fromPeer);
 
-    void broadcast(StellarMessage const& msg, bool force);
+    // `body` is hashed for the index of the record and sent to the peers
+    void broadcast(StellarMessage const& msg,
+                   Peer::SerializedMessage const& body, bool force);
 
     // returns the list of peers that sent us the item with hash `h`
     std::set<Peer::pointer> getPeersKnows(Hash const& h);
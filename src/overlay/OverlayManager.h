@@ -68,6 +68,10 @@ class OverlayManager
     // Herder.
     virtual void broadcastMessage(StellarMessage const& msg,
                                   bool force = false) = 0;
+    // same as above, with `body` the result of Peer::serializeMessage(msg)
+    virtual void broadcastMessage(StellarMessage const& msg,
+                                  Peer::SerializedMessage const& body,
+                                  bool force = false) = 0;
 
     // Make a note in the FloodGate that a given peer has provided us with a
     // given broadcast message, so that it is inhibited from being resent to
@@ -75,6 +79,10 @@ class OverlayManager
     // that, call broadcastMessage, above.
     virtual void recvFloodedMsg(StellarMessage const& msg,
                                 Peer::pointer peer) = 0;
+    // same as above, with `body` the result of Peer::serializeMessage(msg)
+    virtual void recvFloodedMsg(StellarMessage const& msg,
+                                Peer::SerializedMessage const& body,
+                                Peer::pointer peer) = 0;
 
     // Return a list of random peers from the set of authenticated peers.
     virtual std::vector<Peer::pointer> getRandomPeers() = 0;
@@ -374,16 +374,32 @@ OverlayManagerImpl::getRandomPeers()
 void
 OverlayManagerImpl::recvFloodedMsg(StellarMessage const& msg,
                                    Peer::pointer peer)
+{
+    recvFloodedMsg(msg, Peer::serializeMessage(msg), peer);
+}
+
+void
+OverlayManagerImpl::recvFloodedMsg(StellarMessage const& msg,
+                                   Peer::SerializedMessage const& body,
+                                   Peer::pointer peer)
 {
     mMessagesReceived.Mark();
-    mFloodGate.addRecord(msg, peer);
+    mFloodGate.addRecord(msg, body, peer);
 }
 
 void
 OverlayManagerImpl::broadcastMessage(StellarMessage const& msg, bool force)
+{
+    broadcastMessage(msg, Peer::serializeMessage(msg), force);
+}
+
+void
+OverlayManagerImpl::broadcastMessage(StellarMessage const& msg,
+                                     Peer::SerializedMessage const& body,
+                                     bool force)
 {
     mMessagesBroadcast.Mark();
-    mFloodGate.broadcast(msg, force);
+    mFloodGate.broadcast(msg, body, force);
 }
 
 void
@@ -69,8 +69,14 @@ class OverlayManagerImpl : public OverlayManager
 
     void ledgerClosed(uint32_t lastClosedledgerSeq) override;
     void recvFloodedMsg(StellarMessage const& msg, Peer::pointer peer) override;
+    void recvFloodedMsg(StellarMessage const& msg,
+                        Peer::SerializedMessage const& body,
+                        Peer::pointer peer) override;
     void broadcastMessage(StellarMessage const& msg,
                           bool force = false) override;
+    void broadcastMessage(StellarMessage const& msg,
+                          Peer::SerializedMessage const& body,
+                          bool force = false) override;
     void connectTo(std::string const& addr) override;
     virtual void connectTo(PeerRecord& pr) override;
 
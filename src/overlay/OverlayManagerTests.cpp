@@ -159,6 +159,33 @@ class OverlayManagerTests
         vector<int> expectedFinal{2, 2, 1, 2, 2};
         REQUIRE(sentCounts(pm) == expectedFinal);
     }
+
+    void
+    test_broadcastSerialized()
+    {
+        OverlayManagerStub& pm = app.getOverlayManager();
+
+        pm.storePeerList(fourPeers);
+        pm.storePeerList(threePeers);
+        pm.connectToMorePeers(5);
+        REQUIRE(pm.mPeers.size() == 5);
+        SecretKey a = getAccount("a");
+        SecretKey b = getAccount("b");
+
+        Hash const& networkID = app.getNetworkID();
+
+        // recorded and sent from a single serialization, under the same
+        // index as the message serialized again
+        StellarMessage AtoB =
+            createPaymentTx(networkID, a, b, 1, 10)->toStellarMessage();
+        auto body = Peer::serializeMessage(AtoB);
+        pm.recvFloodedMsg(AtoB, body, *(pm.mPeers.begin() + 2));
+        pm.broadcastMessage(AtoB, body);
+        vector<int> expected{1, 1, 0, 1, 1};
+        REQUIRE(sentCounts(pm) == expected);
+        pm.broadcastMessage(AtoB);
+        REQUIRE(sentCounts(pm) == expected);
+    }
 };
 
 TEST_CASE_METHOD(OverlayManagerTests, "addPeerList() adds", "[overlay]")
@@ -170,4 +197,10 @@ TEST_CASE_METHOD(OverlayManagerTests, "broadcast() broadcasts", "[overlay]")
 {
     test_broadcast();
 }
+
+TEST_CASE_METHOD(OverlayManagerTests,
+                 "broadcast() of a serialized message broadcasts", "[overlay]")
+{
+    test_broadcastSerialized();
+}
 }
@@ -46,6 +46,36 @@ TEST_CASE("loopback peer hello", "[overlay]")
     REQUIRE(conn.getAcceptor()->isAuthenticated());
 }
 
+TEST_CASE("loopback peer shared message", "[overlay]")
+{
+    VirtualClock clock;
+    Config const& cfg1 = getTestConfig(0);
+    Config const& cfg2 = getTestConfig(1);
+    auto app1 = Application::create(clock, cfg1);
+    auto app2 = Application::create(clock, cfg2);
+
+    LoopbackPeerConnection conn(*app1, *app2);
+    crankSome(clock);
+    REQUIRE(conn.getInitiator()->isAuthenticated());
+
+    StellarMessage msg;
+    msg.type(DONT_HAVE);
+    msg.dontHave().type = TX_SET;
+    auto body = Peer::serializeMessage(msg);
+
+    // each copy gets its own sequence number and MAC
+    for (int i = 0; i < 3; i++)
+    {
+        conn.getInitiator()->sendMessage(msg, body);
+    }
+    crankSome(clock);
+
+    REQUIRE(conn.getAcceptor()->isAuthenticated());
+    REQUIRE(app2->getMetrics()
+                .NewTimer({"overlay", "recv", "dont-have"})
+                .count() == 3);
+}
+
 TEST_CASE("failed auth", "[overlay]")
 {
     VirtualClock clock;
@@ -7,10 +7,12 @@
 #include "crypto/Hex.h"
 #include "crypto/SHA.h"
 #include "crypto/Random.h"
+#include "crypto/SecretKey.h"
 #include "database/Database.h"
 #include "overlay/StellarXDR.h"
 #include "herder/Herder.h"
 #include "herder/TxSetFrame.h"
+#include "transactions/TransactionFrame.h"
 #include "main/Application.h"
 #include "main/Config.h"
 #include "overlay/LoadManager.h"
@@ -25,6 +27,7 @@
 
 #include "xdrpp/marshal.h"
 
+#include <cstring>
 #include <soci.h>
 #include <time.h>
 
@@ -129,6 +132,8 @@ Peer::Peer(Application& app, PeerRole role)
           {"overlay", "send", "scp-message"}, "message"))
     , mSendGetSCPStateMeter(app.getMetrics().NewMeter(
           {"overlay", "send", "get-scp-state"}, "message"))
+    , mSendTransactionShedMeter(app.getMetrics().NewMeter(
+          {"overlay", "send", "transaction-shed"}, "message"))
     , mDropInConnectHandlerMeter(app.getMetrics().NewMeter(
           {"overlay", "drop", "connect-handler"}, "drop"))
     , mDropInRecvMessageDecodeMeter(app.getMetrics().NewMeter(
@@ -437,9 +442,31 @@ msgSummary(StellarMessage const& msg)
     return "UNKNOWN";
 }
 
+Peer::SerializedMessage
+Peer::serializeMessage(StellarMessage const& msg)
+{
+    return std::make_shared<xdr::opaque_vec<> const>(xdr::xdr_to_opaque(msg));
+}
+
 void
 Peer::sendMessage(StellarMessage const& msg)
 {
+    sendMessage(msg, serializeMessage(msg));
+}
+
+void
+Peer::sendMessage(StellarMessage const& msg, SerializedMessage const& body)
+{
+    // transactions are flooded again by other peers, unlike SCP messages
+    // they can be shed when this peer does not keep up
+    auto queueLimit = mApp.getConfig().PEER_FLOOD_QUEUE_LIMIT;
+    if (msg.type() == TRANSACTION && queueLimit != 0 &&
+        getWriteQueueBytes() > queueLimit)
+    {
+        mSendTransactionShedMeter.Mark();
+        return;
+    }
+
     if (Logging::logTrace("Overlay"))
         CLOG(TRACE, "Overlay") << "("
                                << mApp.getConfig().toShortString(
@@ -490,16 +517,31 @@ Peer::sendMessage(StellarMessage const& msg)
         break;
     };
 
-    AuthenticatedMessage amsg;
-    amsg.v0().message = msg;
-    if (msg.type() != HELLO && msg.type() != ERROR_MSG)
+    // the frame is the XDR of the AuthenticatedMessage: version, sequence,
+    // message and MAC, the MAC being computed over the sequence and message
+    size_t const headerSize = 4 + 8;
+    HmacSha256Mac mac;
+    xdr::msg_ptr xdrBytes(
+        xdr::message_t::alloc(headerSize + body->size() + mac.mac.size()));
+    char* data = xdrBytes->data();
+
+    uint32_t const version = 0;
+    uint64_t sequence = 0;
+    bool authenticated = msg.type() != HELLO && msg.type() != ERROR_MSG;
+    if (authenticated)
     {
-        amsg.v0().sequence = mSendMacSeq;
-        amsg.v0().mac =
-            hmacSha256(mSendMacKey, xdr::xdr_to_opaque(mSendMacSeq, msg));
-        ++mSendMacSeq;
+        sequence = mSendMacSeq++;
     }
-    xdr::msg_ptr xdrBytes(xdr::xdr_to_msg(amsg));
+    xdr::xdr_put header(data, data + headerSize);
+    xdr::xdr_argpack_archive(header, version, sequence);
+    std::memcpy(data + headerSize, body->data(), body->size());
+    if (authenticated)
+    {
+        mac = hmacSha256(mSendMacKey, ByteSlice(data + 4, 8 + body->size()));
+    }
+    std::memcpy(data + headerSize + body->size(), mac.mac.data(),
+                mac.mac.size());
+
     this->sendMessage(std::move(xdrBytes));
 }
 
@@ -557,28 +599,101 @@ Peer::recvMessage(AuthenticatedMessage const& msg)
 
     if (mState >= GOT_HELLO && msg.v0().message.type() != ERROR_MSG)
     {
-        if (msg.v0().sequence != mRecvMacSeq)
+        auto res = checkMessageAuth(
+            msg, xdr::xdr_to_opaque(msg.v0().sequence, msg.v0().message));
+        if (res != AUTH_OK)
         {
-            CLOG(ERROR, "Overlay") << "Unexpected message-auth sequence";
-            mDropInRecvMessageSeqMeter.Mark();
-            ++mRecvMacSeq;
-            drop(ERR_AUTH, "unexpected auth sequence");
+            dropOnAuthFailure(res);
             return;
         }
+    }
+    recvMessage(msg.v0().message);
+}
+
+Peer::AuthResult
+Peer::checkMessageAuth(AuthenticatedMessage const& msg,
+                       ByteSlice const& authenticated)
+{
+    auto res = AUTH_OK;
+    if (msg.v0().sequence != mRecvMacSeq)
+    {
+        res = AUTH_UNEXPECTED_SEQUENCE;
+    }
+    else if (!hmacSha256Verify(msg.v0().mac, mRecvMacKey, authenticated))
+    {
+        res = AUTH_UNEXPECTED_MAC;
+    }
+    ++mRecvMacSeq;
+    return res;
+}
+
+void
+Peer::dropOnAuthFailure(AuthResult res)
+{
+    if (res == AUTH_UNEXPECTED_SEQUENCE)
+    {
+        CLOG(ERROR, "Overlay") << "Unexpected message-auth sequence";
+        mDropInRecvMessageSeqMeter.Mark();
+        drop(ERR_AUTH, "unexpected auth sequence");
+    }
+    else
+    {
+        CLOG(ERROR, "Overlay") << "Message-auth check failed";
+        mDropInRecvMessageMacMeter.Mark();
+        drop(ERR_AUTH, "unexpected MAC");
+    }
+}
 
-        if (!hmacSha256Verify(
-                msg.v0().mac, mRecvMacKey,
-                xdr::xdr_to_opaque(msg.v0().sequence, msg.v0().message)))
+void
+Peer::prepareMessage(PreparedMessage& msg, asio::io_service& workers) const
+{
+    std::vector<PubKeyUtils::SignatureCheck> checks;
+    switch (msg.mMessage.type())
+    {
+    case TRANSACTION:
+        msg.mTransaction = TransactionFrame::makeTransactionFromWire(
+            mApp.getNetworkID(), msg.mMessage.transaction());
+        msg.mTransaction->getFullHash();
+        msg.mTransaction->addSignatureChecks(nullptr, checks);
+        break;
+    case TX_SET:
+        msg.mTxSet = std::make_shared<TxSetFrame>(mApp.getNetworkID(),
+                                                  msg.mMessage.txSet());
+        msg.mTxSet->getContentsHash();
+        for (auto const& tx : msg.mTxSet->mTransactions)
         {
-            CLOG(ERROR, "Overlay") << "Message-auth check failed";
-            mDropInRecvMessageMacMeter.Mark();
-            ++mRecvMacSeq;
-            drop(ERR_AUTH, "unexpected MAC");
-            return;
+            tx->addSignatureChecks(nullptr, checks);
         }
-        ++mRecvMacSeq;
+        break;
+    default:
+        return;
+    }
+    // fills the verification cache for the checks done on the main thread
+    PubKeyUtils::verifySigs(std::move(checks), workers);
+}
+
+void
+Peer::recvMessage(PreparedMessage const& msg)
+{
+    if (shouldAbort())
+    {
+        return;
+    }
+
+    if (msg.mTransaction)
+    {
+        auto t = mRecvTransactionTimer.TimeScope();
+        recvTransaction(msg.mMessage, msg.mTransaction);
+    }
+    else if (msg.mTxSet)
+    {
+        auto t = mRecvTxSetTimer.TimeScope();
+        recvTxSet(*msg.mTxSet);
+    }
+    else
+    {
+        recvMessage(msg.mMessage);
     }
-    recvMessage(msg.v0().message);
 }
 
 void
@@ -733,14 +848,26 @@ void
 Peer::recvTxSet(StellarMessage const& msg)
 {
     TxSetFrame frame(mApp.getNetworkID(), msg.txSet());
+    recvTxSet(frame);
+}
+
+void
+Peer::recvTxSet(TxSetFrame& frame)
+{
     mApp.getHerder().recvTxSet(frame.getContentsHash(), frame);
 }
 
 void
 Peer::recvTransaction(StellarMessage const& msg)
 {
-    TransactionFramePtr transaction = TransactionFrame::makeTransactionFromWire(
-        mApp.getNetworkID(), msg.transaction());
+    recvTransaction(msg, TransactionFrame::makeTransactionFromWire(
+                             mApp.getNetworkID(), msg.transaction()));
+}
+
+void
+Peer::recvTransaction(StellarMessage const& msg,
+                      TransactionFramePtr transaction)
+{
     if (transaction)
     {
         // add it to our current set
@@ -750,13 +877,17 @@ Peer::recvTransaction(StellarMessage const& msg)
         if (recvRes == Herder::TX_STATUS_PENDING ||
             recvRes == Herder::TX_STATUS_DUPLICATE)
         {
+            // serialized once, for the flood map and for the peers
+            auto body = serializeMessage(msg);
+
             // record that this peer sent us this transaction
-            mApp.getOverlayManager().recvFloodedMsg(msg, shared_from_this());
+            mApp.getOverlayManager().recvFloodedMsg(msg, body,
+                                                    shared_from_this());
 
             if (recvRes == Herder::TX_STATUS_PENDING)
             {
                 // if it's a new transaction, broadcast it
-                mApp.getOverlayManager().broadcastMessage(msg);
+                mApp.getOverlayManager().broadcastMessage(msg, body);
             }
         }
     }
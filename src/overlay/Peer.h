@@ -6,6 +6,7 @@
 
 #include "util/asio.h"
 #include "xdrpp/message.h"
+#include "crypto/ByteSlice.h"
 #include "overlay/StellarXDR.h"
 #include "util/Timer.h"
 #include "database/Database.h"
@@ -24,6 +25,8 @@ typedef std::shared_ptr<SCPQuorumSet> SCPQuorumSetPtr;
 
 class Application;
 class LoopbackPeer;
+class TransactionFrame;
+class TxSetFrame;
 
 /*
  * Another peer out there that we are connected to
@@ -35,6 +38,10 @@ class Peer : public std::enable_shared_from_this<Peer>,
   public:
     typedef std::shared_ptr<Peer> pointer;
 
+    // XDR of a StellarMessage, serialized once and shared by all the peers
+    // it is sent to
+    typedef std::shared_ptr<xdr::opaque_vec<> const> SerializedMessage;
+
     enum PeerState
     {
         CONNECTING = 0,
@@ -116,6 +123,7 @@ class Peer : public std::enable_shared_from_this<Peer>,
     medida::Meter& mSendSCPQuorumSetMeter;
     medida::Meter& mSendSCPMessageSetMeter;
     medida::Meter& mSendGetSCPStateMeter;
+    medida::Meter& mSendTransactionShedMeter;
 
     medida::Meter& mDropInConnectHandlerMeter;
     medida::Meter& mDropInRecvMessageDecodeMeter;
@@ -133,10 +141,37 @@ class Peer : public std::enable_shared_from_this<Peer>,
     medida::Meter& mDropInRecvAuthRejectMeter;
     medida::Meter& mDropInRecvErrorMeter;
 
+    // A message decoded and authenticated off the main thread, with the
+    // transactions it carries hashed and their signatures verified.
+    struct PreparedMessage
+    {
+        StellarMessage mMessage;
+        std::shared_ptr<TransactionFrame> mTransaction;
+        std::shared_ptr<TxSetFrame> mTxSet;
+    };
+
+    enum AuthResult
+    {
+        AUTH_OK,
+        AUTH_UNEXPECTED_SEQUENCE,
+        AUTH_UNEXPECTED_MAC
+    };
+
     bool shouldAbort() const;
     void recvMessage(StellarMessage const& msg);
     void recvMessage(AuthenticatedMessage const& msg);
     void recvMessage(xdr::msg_ptr const& xdrBytes);
+    void recvMessage(PreparedMessage const& msg);
+
+    // checks the sequence number and the MAC of `msg`, `authenticated` being
+    // the XDR of its sequence number and message, and moves to the next
+    // sequence number
+    AuthResult checkMessageAuth(AuthenticatedMessage const& msg,
+                                ByteSlice const& authenticated);
+    void dropOnAuthFailure(AuthResult res);
+
+    // builds the transaction frames of `msg`, can be called from any thread
+    void prepareMessage(PreparedMessage& msg, asio::io_service& workers) const;
 
     virtual void recvError(StellarMessage const& msg);
     // returns false if we should drop this peer
@@ -149,7 +184,10 @@ class Peer : public std::enable_shared_from_this<Peer>,
 
     void recvGetTxSet(StellarMessage const& msg);
     void recvTxSet(StellarMessage const& msg);
+    void recvTxSet(TxSetFrame& frame);
     void recvTransaction(StellarMessage const& msg);
+    void recvTransaction(StellarMessage const& msg,
+                         std::shared_ptr<TransactionFrame> transaction);
     void recvGetSCPQuorumSet(StellarMessage const& msg);
     void recvSCPQuorumSet(StellarMessage const& msg);
     void recvSCPMessage(StellarMessage const& msg);
@@ -197,7 +235,12 @@ class Peer : public std::enable_shared_from_this<Peer>,
     void sendGetPeers();
     void sendGetScpState(uint32 ledgerSeq);
 
+    static SerializedMessage serializeMessage(StellarMessage const& msg);
+
     void sendMessage(StellarMessage const& msg);
+    // same as above, with `body` the result of serializeMessage(msg): only
+    // the sequence number and the MAC are computed for this peer
+    void sendMessage(StellarMessage const& msg, SerializedMessage const& body);
 
     PeerRole
     getRole() const
@@ -237,6 +280,24 @@ class Peer : public std::enable_shared_from_this<Peer>,
     {
         return mRemoteListeningPort;
     }
+
+    // messages and bytes waiting to be written to the peer
+    virtual size_t
+    getWriteQueueLength() const
+    {
+        return 0;
+    }
+    virtual size_t
+    getWriteQueueBytes() const
+    {
+        return 0;
+    }
+    // bytes of the write in progress
+    virtual size_t
+    getBytesInFlight() const
+    {
+        return 0;
+    }
     NodeID
     getPeerID()
     {
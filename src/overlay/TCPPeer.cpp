@@ -11,11 +11,15 @@
 #include "overlay/OverlayManager.h"
 #include "database/Database.h"
 #include "overlay/PeerRecord.h"
+#include "medida/counter.h"
+#include "medida/histogram.h"
 #include "medida/metrics_registry.h"
 #include "medida/meter.h"
 #include "main/Config.h"
 #include "util/GlobalChecks.h"
 
+#include <functional>
+
 #define MAX_UNAUTH_MESSAGE_SIZE 0x1000
 #define MAX_MESSAGE_SIZE 0x1000000
 
@@ -32,7 +36,15 @@ using namespace std;
 
 TCPPeer::TCPPeer(Application& app, Peer::PeerRole role,
                  std::shared_ptr<TCPPeer::SocketType> socket)
-    : Peer(app, role), mSocket(socket)
+    : Peer(app, role)
+    , mSocket(socket)
+    , mRecvStrand(app.getWorkerIOService())
+    , mWriteQueueDepth(
+          app.getMetrics().NewHistogram({"overlay", "write", "queue-depth"}))
+    , mWriteBatchSize(
+          app.getMetrics().NewHistogram({"overlay", "write", "batch-size"}))
+    , mWriteInFlight(
+          app.getMetrics().NewCounter({"overlay", "write", "in-flight"}))
 {
 }
 
@@ -124,6 +136,24 @@ TCPPeer::getIP()
     return mIP;
 }
 
+size_t
+TCPPeer::getWriteQueueLength() const
+{
+    return mWriteQueue.size();
+}
+
+size_t
+TCPPeer::getWriteQueueBytes() const
+{
+    return mWriteQueueBytes;
+}
+
+size_t
+TCPPeer::getBytesInFlight() const
+{
+    return mBytesInFlight;
+}
+
 void
 TCPPeer::sendMessage(xdr::msg_ptr&& xdrBytes)
 {
@@ -132,17 +162,14 @@ TCPPeer::sendMessage(xdr::msg_ptr&& xdrBytes)
     assertThreadIsMain();
 
     // places the buffer to write into the write queue
-    auto buf = std::make_shared<xdr::msg_ptr>(std::move(xdrBytes));
-
-    auto self = static_pointer_cast<TCPPeer>(shared_from_this());
+    mWriteQueueBytes += xdrBytes->raw_size();
+    mWriteQueue.emplace_back(std::move(xdrBytes));
 
-    self->mWriteQueue.emplace(buf);
-
-    if (!self->mWriting)
+    if (!mWriting)
     {
-        self->mWriting = true;
+        mWriting = true;
         // kick off the async write chain if we're the first one
-        self->messageSender();
+        messageSender();
     }
 }
 
@@ -151,42 +178,48 @@ TCPPeer::messageSender()
 {
     assertThreadIsMain();
 
-    auto self = static_pointer_cast<TCPPeer>(shared_from_this());
-
-    // if nothing to do, flush and return
     if (mWriteQueue.empty())
     {
-        mSocket->async_flush([self](asio::error_code const& ec, std::size_t)
-                             {
-                                 self->writeHandler(ec, 0);
-                                 if (!ec)
-                                 {
-                                     if (!self->mWriteQueue.empty())
-                                     {
-                                         self->messageSender();
-                                     }
-                                     else
-                                     {
-                                         self->mWriting = false;
-                                     }
-                                 }
-                             });
+        mWriting = false;
         return;
     }
 
-    // peek the buffer from the queue
-    // do not remove it yet as we need the buffer for the duration of the
+    // moves as many queued messages as fit in the batch size (at least one)
+    // into a single write; they stay in mWriteBatch for the duration of the
     // write operation
-    auto buf = mWriteQueue.front();
+    mWriteQueueDepth.Update(mWriteQueue.size());
+    size_t const batchSize = mApp.getConfig().PEER_WRITE_BATCH_SIZE;
+    std::vector<asio::const_buffer> buffers;
+    size_t bytes = 0;
+    while (!mWriteQueue.empty())
+    {
+        auto& msg = mWriteQueue.front();
+        if (!mWriteBatch.empty() && bytes + msg->raw_size() > batchSize)
+        {
+            break;
+        }
+        bytes += msg->raw_size();
+        buffers.emplace_back(asio::buffer(msg->raw_data(), msg->raw_size()));
+        mWriteBatch.emplace_back(std::move(msg));
+        mWriteQueue.pop_front();
+    }
+    mWriteQueueBytes -= bytes;
+    mBytesInFlight = bytes;
+    mWriteInFlight.inc(bytes);
+    mWriteBatchSize.Update(bytes);
 
-    asio::async_write(*(mSocket.get()),
-                      asio::buffer((*buf)->raw_data(), (*buf)->raw_size()),
+    // the messages are written as a whole, so they bypass the write buffer
+    // of the buffered stream, which would split them in buffer-sized writes
+    auto self = static_pointer_cast<TCPPeer>(shared_from_this());
+    asio::async_write(mSocket->next_layer(), buffers,
                       [self](asio::error_code const& ec, std::size_t length)
                       {
                           self->writeHandler(ec, length);
-                          self->mWriteQueue.pop(); // done with front element
+                          self->mWriteInFlight.dec(self->mBytesInFlight);
+                          self->mBytesInFlight = 0;
+                          self->mWriteBatch.clear();
 
-                          // continue processing the queue/flush
+                          // continue processing the queue
                           if (!ec)
                           {
                               self->messageSender();
@@ -216,7 +249,7 @@ TCPPeer::writeHandler(asio::error_code const& error,
     else if (bytes_transferred != 0)
     {
         LoadManager::PeerContext loadCtx(mApp, mPeerID);
-        mMessageWrite.Mark();
+        mMessageWrite.Mark(mWriteBatch.size());
         mByteWrite.Mark(bytes_transferred);
     }
 }
@@ -334,7 +367,14 @@ TCPPeer::readBodyHandler(asio::error_code const& error,
     if (!error)
     {
         receivedBytes(bytes_transferred, true);
-        recvMessage();
+        if (isAuthenticated())
+        {
+            recvMessageOnWorker();
+        }
+        else
+        {
+            recvMessage();
+        }
         mIncomingHeader.clear();
         startRead();
     }
@@ -372,6 +412,93 @@ TCPPeer::recvMessage()
     }
 }
 
+void
+TCPPeer::recvMessageOnWorker()
+{
+    assertThreadIsMain();
+    auto self = static_pointer_cast<TCPPeer>(shared_from_this());
+    auto body = std::make_shared<std::vector<uint8_t>>();
+    body->swap(mIncomingBody);
+    mRecvStrand.post([self, body]() mutable
+                     {
+                         prepareIncomingMessage(std::move(self), *body);
+                     });
+}
+
+void
+TCPPeer::prepareIncomingMessage(std::shared_ptr<TCPPeer> self,
+                                std::vector<uint8_t> const& body)
+{
+    // `self` is handed back to the main thread, so that the peer is never
+    // destroyed on a worker thread
+    auto& mainIO = self->mApp.getClock().getIOService();
+    if (self->mRecvFailed)
+    {
+        mainIO.post(std::bind([](std::shared_ptr<TCPPeer> const&)
+                              {
+                              },
+                              std::move(self)));
+        return;
+    }
+
+    auto msg = std::make_shared<PreparedMessage>();
+    auto res = AUTH_OK;
+    std::string error;
+    try
+    {
+        xdr::xdr_get g(body.data(), body.data() + body.size());
+        AuthenticatedMessage am;
+        xdr::xdr_argpack_archive(g, am);
+        g.done();
+        if (am.v0().message.type() != ERROR_MSG)
+        {
+            // the sequence number and the message, as received
+            size_t const macSize = am.v0().mac.mac.size();
+            res = self->checkMessageAuth(
+                am, ByteSlice(body.data() + 4, body.size() - 4 - macSize));
+        }
+        if (res == AUTH_OK)
+        {
+            msg->mMessage = std::move(am.v0().message);
+            self->prepareMessage(*msg, self->mApp.getWorkerIOService());
+        }
+    }
+    catch (std::exception& e)
+    {
+        error = e.what();
+    }
+    self->mRecvFailed = res != AUTH_OK || !error.empty();
+
+    mainIO.post(std::bind(&TCPPeer::recvPreparedMessage, std::move(self), msg,
+                          res, error));
+}
+
+void
+TCPPeer::recvPreparedMessage(std::shared_ptr<PreparedMessage> msg,
+                             AuthResult res, std::string const& error)
+{
+    assertThreadIsMain();
+    if (shouldAbort())
+    {
+        return;
+    }
+
+    LoadManager::PeerContext loadCtx(mApp, mPeerID);
+    if (!error.empty())
+    {
+        CLOG(ERROR, "Overlay") << "recvMessage got a corrupt xdr: " << error;
+        Peer::drop(ERR_DATA, "received corrupt XDR");
+    }
+    else if (res != AUTH_OK)
+    {
+        dropOnAuthFailure(res);
+    }
+    else
+    {
+        Peer::recvMessage(*msg);
+    }
+}
+
 void
 TCPPeer::drop()
 {
@@ -6,10 +6,13 @@
 
 #include "overlay/Peer.h"
 #include "util/Timer.h"
-#include <queue>
+#include <deque>
+#include <vector>
 
 namespace medida
 {
+class Counter;
+class Histogram;
 class Meter;
 }
 
@@ -27,10 +30,31 @@ class TCPPeer : public Peer
     std::vector<uint8_t> mIncomingHeader;
     std::vector<uint8_t> mIncomingBody;
 
-    std::queue<std::shared_ptr<xdr::msg_ptr>> mWriteQueue;
+    // Once the peer is authenticated, received messages are decoded,
+    // authenticated and prepared on the worker threads, in order, and then
+    // handed to the main thread.
+    asio::io_service::strand mRecvStrand;
+    // set in mRecvStrand once a message is rejected
+    bool mRecvFailed{false};
+
+    // messages waiting to be written, and the ones being written in a
+    // single gathered write
+    std::deque<xdr::msg_ptr> mWriteQueue;
+    std::vector<xdr::msg_ptr> mWriteBatch;
+    size_t mWriteQueueBytes{0};
+    size_t mBytesInFlight{0};
     bool mWriting{false};
 
+    medida::Histogram& mWriteQueueDepth;
+    medida::Histogram& mWriteBatchSize;
+    medida::Counter& mWriteInFlight;
+
     void recvMessage();
+    void recvMessageOnWorker();
+    static void prepareIncomingMessage(std::shared_ptr<TCPPeer> self,
+                                       std::vector<uint8_t> const& body);
+    void recvPreparedMessage(std::shared_ptr<PreparedMessage> msg,
+                             AuthResult res, std::string const& error);
     void sendMessage(xdr::msg_ptr&& xdrBytes) override;
 
     void messageSender();
@@ -46,6 +70,8 @@ class TCPPeer : public Peer
     void readBodyHandler(asio::error_code const& error,
                          std::size_t bytes_transferred) override;
 
+    friend class TCPPeerTests;
+
   public:
     typedef std::shared_ptr<TCPPeer> pointer;
 
@@ -63,5 +89,9 @@ class TCPPeer : public Peer
 
     virtual void drop() override;
     virtual std::string getIP() override;
+
+    size_t getWriteQueueLength() const override;
+    size_t getWriteQueueBytes() const override;
+    size_t getBytesInFlight() const override;
 };
 }
@@ -12,6 +12,17 @@
 #include "util/Logging.h"
 #include "simulation/Simulation.h"
 #include "overlay/OverlayManager.h"
+#include "medida/histogram.h"
+#include "medida/meter.h"
+#include "medida/metrics_registry.h"
+#include "medida/timer.h"
+#include "crypto/SHA.h"
+#include "herder/Herder.h"
+#include "herder/TxSetFrame.h"
+#include "ledger/LedgerManager.h"
+#include "transactions/TxTests.h"
+#include "xdrpp/marshal.h"
+#include <future>
 
 namespace stellar
 {
@@ -52,4 +63,342 @@ TEST_CASE("TCPPeer can communicate", "[overlay]")
     REQUIRE(p1->isAuthenticated());
     s->stopAllNodes();
 }
+
+TEST_CASE("TCPPeer batches writes and sheds transactions", "[overlay]")
+{
+    Hash networkID = sha256(getTestConfig().NETWORK_PASSPHRASE);
+    Simulation::pointer s =
+        std::make_shared<Simulation>(Simulation::OVER_TCP, networkID);
+
+    auto v10SecretKey = SecretKey::fromSeed(sha256("v10"));
+    auto v11SecretKey = SecretKey::fromSeed(sha256("v11"));
+
+    Config cfg0(getTestConfig(10));
+    cfg0.ARTIFICIALLY_ACCELERATE_TIME_FOR_TESTING = true;
+    cfg0.PEER_WRITE_BATCH_SIZE = 1024;
+    cfg0.PEER_FLOOD_QUEUE_LIMIT = 4096;
+
+    SCPQuorumSet n0_qset;
+    n0_qset.threshold = 1;
+    n0_qset.validators.push_back(v10SecretKey.getPublicKey());
+    auto n0 =
+        s->getNode(s->addNode(v10SecretKey, n0_qset, s->getClock(), &cfg0));
+
+    SCPQuorumSet n1_qset;
+    n1_qset.threshold = 1;
+    n1_qset.validators.push_back(v11SecretKey.getPublicKey());
+    auto n1 = s->getNode(s->addNode(v11SecretKey, n1_qset, s->getClock()));
+
+    s->addPendingConnection(v10SecretKey.getPublicKey(),
+                            v11SecretKey.getPublicKey());
+    s->startAllNodes();
+    s->crankForAtLeast(std::chrono::seconds(1), false);
+
+    auto p0 = n0->getOverlayManager().getConnectedPeer(
+        "127.0.0.1", n1->getConfig().PEER_PORT);
+    REQUIRE(p0);
+    REQUIRE(p0->isAuthenticated());
+
+    auto& batches =
+        n0->getMetrics().NewHistogram({"overlay", "write", "batch-size"});
+    auto& shed = n0->getMetrics().NewMeter(
+        {"overlay", "send", "transaction-shed"}, "message");
+    auto& received =
+        n1->getMetrics().NewTimer({"overlay", "recv", "dont-have"});
+    auto batchesBefore = batches.count();
+    auto receivedBefore = received.count();
+
+    StellarMessage dontHave;
+    dontHave.type(DONT_HAVE);
+    dontHave.dontHave().type = TX_SET;
+    size_t const n = 200;
+    for (size_t i = 0; i < n; i++)
+    {
+        p0->sendMessage(dontHave);
+    }
+    REQUIRE(p0->getWriteQueueLength() == n - 1);
+    REQUIRE(p0->getWriteQueueBytes() > cfg0.PEER_FLOOD_QUEUE_LIMIT);
+
+    // transactions are shed while the queue is over the limit, SCP
+    // messages and others are not
+    StellarMessage tx;
+    tx.type(TRANSACTION);
+    p0->sendMessage(tx);
+    REQUIRE(shed.count() == 1);
+    REQUIRE(p0->getWriteQueueLength() == n - 1);
+
+    s->crankForAtLeast(std::chrono::seconds(1), false);
+
+    REQUIRE(p0->getWriteQueueLength() == 0);
+    REQUIRE(p0->getBytesInFlight() == 0);
+    REQUIRE(received.count() - receivedBefore == n);
+    // one write for the first message, then batches of up to 1024 bytes
+    REQUIRE(batches.count() - batchesBefore < n / 4);
+    s->stopAllNodes();
+}
+
+// Two nodes connected over TCP, mPeer1 being the end of the connection in
+// mApp1. Messages are handed to mPeer1 as if they had just been read from
+// its socket.
+class TCPPeerTests
+{
+  protected:
+    Hash mNetworkID;
+    Simulation::pointer mSimulation;
+    Application::pointer mApp0;
+    Application::pointer mApp1;
+    Peer::pointer mPeer0;
+    TCPPeer::pointer mPeer1;
+
+  public:
+    TCPPeerTests()
+        : mNetworkID(sha256(getTestConfig().NETWORK_PASSPHRASE))
+        , mSimulation(
+              std::make_shared<Simulation>(Simulation::OVER_TCP, mNetworkID))
+    {
+        auto v10SecretKey = SecretKey::fromSeed(sha256("v10"));
+        auto v11SecretKey = SecretKey::fromSeed(sha256("v11"));
+
+        SCPQuorumSet n0_qset;
+        n0_qset.threshold = 1;
+        n0_qset.validators.push_back(v10SecretKey.getPublicKey());
+        mApp0 = mSimulation->getNode(mSimulation->addNode(
+            v10SecretKey, n0_qset, mSimulation->getClock()));
+
+        SCPQuorumSet n1_qset;
+        n1_qset.threshold = 1;
+        n1_qset.validators.push_back(v11SecretKey.getPublicKey());
+        mApp1 = mSimulation->getNode(mSimulation->addNode(
+            v11SecretKey, n1_qset, mSimulation->getClock()));
+
+        mSimulation->addPendingConnection(v10SecretKey.getPublicKey(),
+                                          v11SecretKey.getPublicKey());
+        mSimulation->startAllNodes();
+        mSimulation->crankForAtLeast(std::chrono::seconds(1), false);
+
+        mPeer0 = mApp0->getOverlayManager().getConnectedPeer(
+            "127.0.0.1", mApp1->getConfig().PEER_PORT);
+        auto p1 = mApp1->getOverlayManager().getConnectedPeer(
+            "127.0.0.1", mApp0->getConfig().PEER_PORT);
+        REQUIRE(mPeer0);
+        REQUIRE(p1);
+        REQUIRE(mPeer0->isAuthenticated());
+        REQUIRE(p1->isAuthenticated());
+        mPeer1 = std::static_pointer_cast<TCPPeer>(p1);
+    }
+
+    ~TCPPeerTests()
+    {
+        mSimulation->stopAllNodes();
+    }
+
+    // waits for the messages already handed to the worker threads, the
+    // receive sequence number of mPeer1 then only changes on this thread
+    void
+    drainReceive()
+    {
+        std::promise<void> done;
+        auto drained = done.get_future();
+        mPeer1->mRecvStrand.post([&done]()
+                                 {
+                                     done.set_value();
+                                 });
+        drained.wait();
+    }
+
+    uint64_t
+    nextRecvSequence() const
+    {
+        return mPeer1->mRecvMacSeq;
+    }
+
+    // `msg` as the remote end of mPeer1 sends it, with a damaged MAC if
+    // `damageMac`
+    std::vector<uint8_t>
+    authenticatedBody(StellarMessage const& msg, uint64_t sequence,
+                      bool damageMac = false) const
+    {
+        AuthenticatedMessage am;
+        am.v(0);
+        am.v0().sequence = sequence;
+        am.v0().message = msg;
+        am.v0().mac = hmacSha256(mPeer1->mRecvMacKey,
+                                 xdr::xdr_to_opaque(sequence, msg));
+        if (damageMac)
+        {
+            am.v0().mac.mac[0] ^= 1;
+        }
+        auto bytes = xdr::xdr_to_opaque(am);
+        return std::vector<uint8_t>(bytes.begin(), bytes.end());
+    }
+
+    // hands `body` to mPeer1, keeping the buffer of a read in progress
+    void
+    receive(std::vector<uint8_t> body, bool onWorker)
+    {
+        std::vector<uint8_t> pending;
+        pending.swap(mPeer1->mIncomingBody);
+        mPeer1->mIncomingBody = std::move(body);
+        if (onWorker)
+        {
+            mPeer1->recvMessageOnWorker();
+        }
+        else
+        {
+            mPeer1->recvMessage();
+        }
+        mPeer1->mIncomingBody.swap(pending);
+    }
+
+    // prepares `msg` as mPeer1 does on the worker threads
+    void
+    prepare(StellarMessage const& msg, TransactionFramePtr& tx,
+            TxSetFramePtr& txSet)
+    {
+        TCPPeer::PreparedMessage prepared;
+        prepared.mMessage = msg;
+        mPeer1->prepareMessage(prepared, mApp1->getWorkerIOService());
+        tx = prepared.mTransaction;
+        txSet = prepared.mTxSet;
+    }
+};
+
+TEST_CASE_METHOD(TCPPeerTests, "TCPPeer receives messages in order",
+                 "[overlay]")
+{
+    using namespace txtest;
+
+    SecretKey root = getRoot(mNetworkID);
+    SequenceNumber rootSeq = getAccountSeqNum(root, *mApp1);
+
+    // a transaction received before the one preceding it is rejected, the
+    // last sequence number accepted is the last one sent only if all of them
+    // arrived in order
+    int const n = 20;
+    for (int i = 0; i < n; i++)
+    {
+        auto a = getAccount(("A" + std::to_string(i)).c_str());
+        auto tx =
+            createCreateAccountTx(mNetworkID, root, a, rootSeq + i + 1, 0);
+        mPeer0->sendMessage(tx->toStellarMessage());
+    }
+    mSimulation->crankForAtLeast(std::chrono::seconds(1), false);
+
+    REQUIRE(mPeer1->isConnected());
+    // the transactions may already be in a closed ledger
+    auto lastSeq = std::max(
+        mApp1->getHerder().getMaxSeqInPendingTxs(root.getPublicKey()),
+        getAccountSeqNum(root, *mApp1));
+    REQUIRE(lastSeq == rootSeq + n);
+}
+
+TEST_CASE_METHOD(TCPPeerTests, "TCPPeer prepares transactions and tx sets",
+                 "[overlay]")
+{
+    using namespace txtest;
+
+    SecretKey root = getRoot(mNetworkID);
+    SequenceNumber rootSeq = getAccountSeqNum(root, *mApp1);
+
+    TxSetFrame txSet(
+        mApp1->getLedgerManager().getLastClosedLedgerHeader().hash);
+    for (int i = 0; i < 4; i++)
+    {
+        auto a = getAccount(("B" + std::to_string(i)).c_str());
+        txSet.add(
+            createCreateAccountTx(mNetworkID, root, a, rootSeq + i + 1, 0));
+    }
+
+    // every signature of `txs` is a hit in the verification cache
+    auto requireCached = [&](std::vector<TransactionFramePtr> const& txs)
+    {
+        uint64_t hits, misses, ignores;
+        PubKeyUtils::flushVerifySigCacheCounts(hits, misses, ignores);
+        size_t sigs = 0;
+        for (auto const& tx : txs)
+        {
+            for (auto const& sig : tx->getEnvelope().signatures)
+            {
+                REQUIRE(PubKeyUtils::verifySig(
+                    root.getPublicKey(), sig.signature, tx->getContentsHash()));
+                sigs++;
+            }
+        }
+        PubKeyUtils::flushVerifySigCacheCounts(hits, misses, ignores);
+        REQUIRE(sigs != 0);
+        REQUIRE(hits == sigs);
+        REQUIRE(misses == 0);
+    };
+
+    PubKeyUtils::clearVerifySigCache();
+
+    SECTION("transaction")
+    {
+        auto sent = txSet.mTransactions[0];
+        TransactionFramePtr tx;
+        TxSetFramePtr set;
+        prepare(sent->toStellarMessage(), tx, set);
+        REQUIRE(tx);
+        REQUIRE(!set);
+        REQUIRE(tx->getFullHash() == sent->getFullHash());
+        REQUIRE(tx->getContentsHash() == sent->getContentsHash());
+        requireCached({tx});
+    }
+
+    SECTION("tx set")
+    {
+        StellarMessage msg;
+        msg.type(TX_SET);
+        txSet.toXDR(msg.txSet());
+        TransactionFramePtr tx;
+        TxSetFramePtr set;
+        prepare(msg, tx, set);
+        REQUIRE(!tx);
+        REQUIRE(set);
+        REQUIRE(set->getContentsHash() == txSet.getContentsHash());
+        REQUIRE(set->mTransactions.size() == txSet.mTransactions.size());
+        requireCached(set->mTransactions);
+    }
+}
+
+TEST_CASE_METHOD(TCPPeerTests, "TCPPeer drops peers failing message auth",
+                 "[overlay]")
+{
+    auto& macDrops = mApp1->getMetrics().NewMeter(
+        {"overlay", "drop", "recv-message-mac"}, "drop");
+    auto& seqDrops = mApp1->getMetrics().NewMeter(
+        {"overlay", "drop", "recv-message-seq"}, "drop");
+    auto macDropsBefore = macDrops.count();
+    auto seqDropsBefore = seqDrops.count();
+
+    StellarMessage dontHave;
+    dontHave.type(DONT_HAVE);
+    dontHave.dontHave().type = TX_SET;
+
+    // the worker threads and the main thread reject the same messages
+    for (auto onWorker : {true, false})
+    {
+        SECTION(onWorker ? "worker threads, bad MAC" : "main thread, bad MAC")
+        {
+            drainReceive();
+            receive(authenticatedBody(dontHave, nextRecvSequence(), true),
+                    onWorker);
+            mSimulation->crankForAtLeast(std::chrono::seconds(1), false);
+            REQUIRE(!mPeer1->isConnected());
+            REQUIRE(macDrops.count() == macDropsBefore + 1);
+            REQUIRE(seqDrops.count() == seqDropsBefore);
+        }
+        SECTION(onWorker ? "worker threads, bad sequence"
+                         : "main thread, bad sequence")
+        {
+            drainReceive();
+            receive(authenticatedBody(dontHave, nextRecvSequence() + 1000),
+                    onWorker);
+            mSimulation->crankForAtLeast(std::chrono::seconds(1), false);
+            REQUIRE(!mPeer1->isConnected());
+            REQUIRE(seqDrops.count() == seqDropsBefore + 1);
+            REQUIRE(macDrops.count() == macDropsBefore);
+        }
+    }
+}
 }
@@ -7,9 +7,8 @@
 #include "util/Logging.h"
 #include "ledger/LedgerDelta.h"
 #include "database/Database.h"
-#include "medida/meter.h"
-#include "medida/metrics_registry.h"
 #include "main/Application.h"
+#include "transactions/OperationMetrics.h"
 #include <algorithm>
 
 namespace stellar
@@ -18,6 +17,18 @@ namespace stellar
 using namespace std;
 using xdr::operator==;
 
+namespace
+{
+OperationMeter const
+    administrativeSuccessApply("op-administrative", "success", "apply");
+OperationMeter const administrativeInvalidEmptyOpData(
+    "op-administrative", "invalid", "empty-op-data");
+OperationMeter const administrativeInvalidBankIsNotSource(
+    "op-administrative", "invalid", "bank-is-not-source");
+OperationMeter const administrativeInvalidSignersAreNotAdmins(
+    "op-administrative", "invalid", "signers-are-not-admins");
+}
+
 AdministrativeOpFrame::AdministrativeOpFrame(Operation const& op, OperationResult& res, OperationFee* fee,
                                TransactionFrame& parentTx)
     : OperationFrame(op, res, fee, parentTx), mAdministrative(mOperation.body.adminOp())
@@ -28,7 +39,7 @@ bool
 AdministrativeOpFrame::doApply(Application& app, LedgerDelta& delta,
                         LedgerManager& ledgerManager)
 {
-	app.getMetrics().NewMeter({ "op-administrative", "success", "apply" }, "operation").Mark();
+	app.getOperationMetrics().mark(administrativeSuccessApply);
 	innerResult().code(ADMINISTRATIVE_SUCCESS);
 	return true;
 }
@@ -37,15 +48,13 @@ bool
 AdministrativeOpFrame::doCheckValid(Application& app)
 {
 	if (mAdministrative.opData.empty()) {
-		app.getMetrics().NewMeter({ "op-administrative", "invalid", "empty-op-data" },
-			"operation").Mark();
+		app.getOperationMetrics().mark(administrativeInvalidEmptyOpData);
 		innerResult().code(ADMINISTRATIVE_MALFORMED);
 		return false;
 	}
 	
 	if (!(getSourceID() == app.getConfig().BANK_MASTER_KEY)) {
-		app.getMetrics().NewMeter({ "op-administrative", "invalid", "bank-is-not-source" },
-			"operation").Mark();
+		app.getOperationMetrics().mark(administrativeInvalidBankIsNotSource);
 		innerResult().code(ADMINISTRATIVE_NOT_AUTHORIZED);
 		return false;
 	}
@@ -59,8 +68,8 @@ AdministrativeOpFrame::doCheckValid(Application& app)
 	}
 
 	if (!isAllAdmins) {
-		app.getMetrics().NewMeter({ "op-administrative", "invalid", "signers-are-not-admins" },
-			"operation").Mark();
+		app.getOperationMetrics().mark(
+			administrativeInvalidSignersAreNotAdmins);
 		innerResult().code(ADMINISTRATIVE_NOT_AUTHORIZED);
 		return false;
 	}
@@ -7,11 +7,26 @@
 #include "ledger/TrustFrame.h"
 #include "database/Database.h"
 #include "main/Application.h"
-#include "medida/meter.h"
-#include "medida/metrics_registry.h"
+#include "transactions/OperationMetrics.h"
 
 namespace stellar
 {
+namespace
+{
+OperationMeter const
+    allowTrustFailureNotRequired("op-allow-trust", "failure", "not-required");
+OperationMeter const
+    allowTrustFailureCantRevoke("op-allow-trust", "failure", "cant-revoke");
+OperationMeter const
+    allowTrustFailureNoTrustLine("op-allow-trust", "failure", "no-trust-line");
+OperationMeter const
+    allowTrustSuccessApply("op-allow-trust", "success", "apply");
+OperationMeter const allowTrustInvalidMalformedNonAlphanum(
+    "op-allow-trust", "invalid", "malformed-non-alphanum");
+OperationMeter const allowTrustInvalidMalformedInvalidAsset(
+    "op-allow-trust", "invalid", "malformed-invalid-asset");
+}
+
 AllowTrustOpFrame::AllowTrustOpFrame(Operation const& op, OperationResult& res, OperationFee* fee,
                                      TransactionFrame& parentTx)
     : OperationFrame(op, res, fee, parentTx)
@@ -31,8 +46,7 @@ AllowTrustOpFrame::doApply(Application& app, LedgerDelta& delta,
 {
     if (!(mSourceAccount->getAccount().flags & AUTH_REQUIRED_FLAG))
     { // this account doesn't require authorization to hold credit
-        app.getMetrics().NewMeter({"op-allow-trust", "failure", "not-required"},
-                         "operation").Mark();
+        app.getOperationMetrics().mark(allowTrustFailureNotRequired);
         innerResult().code(ALLOW_TRUST_TRUST_NOT_REQUIRED);
         return false;
     }
@@ -40,8 +54,7 @@ AllowTrustOpFrame::doApply(Application& app, LedgerDelta& delta,
     if (!(mSourceAccount->getAccount().flags & AUTH_REVOCABLE_FLAG) &&
         !mAllowTrust.authorize)
     {
-        app.getMetrics().NewMeter({"op-allow-trust", "failure", "cant-revoke"},
-                         "operation").Mark();
+        app.getOperationMetrics().mark(allowTrustFailureCantRevoke);
         innerResult().code(ALLOW_TRUST_CANT_REVOKE);
         return false;
     }
@@ -65,14 +78,12 @@ AllowTrustOpFrame::doApply(Application& app, LedgerDelta& delta,
 
     if (!trustLine)
     {
-        app.getMetrics().NewMeter({"op-allow-trust", "failure", "no-trust-line"},
-                         "operation").Mark();
+        app.getOperationMetrics().mark(allowTrustFailureNoTrustLine);
         innerResult().code(ALLOW_TRUST_NO_TRUST_LINE);
         return false;
     }
 
-    app.getMetrics().NewMeter({"op-allow-trust", "success", "apply"}, "operation")
-        .Mark();
+    app.getOperationMetrics().mark(allowTrustSuccessApply);
     innerResult().code(ALLOW_TRUST_SUCCESS);
 
     trustLine->setAuthorized(mAllowTrust.authorize);
@@ -87,9 +98,7 @@ AllowTrustOpFrame::doCheckValid(Application& app)
 {
     if (mAllowTrust.asset.type() == ASSET_TYPE_NATIVE)
     {
-        app.getMetrics().NewMeter(
-                    {"op-allow-trust", "invalid", "malformed-non-alphanum"},
-                    "operation").Mark();
+        app.getOperationMetrics().mark(allowTrustInvalidMalformedNonAlphanum);
         innerResult().code(ALLOW_TRUST_MALFORMED);
         return false;
     }
@@ -108,9 +117,7 @@ AllowTrustOpFrame::doCheckValid(Application& app)
 
     if (!isAssetValid(app.getIssuer(), ci))
     {
-        app.getMetrics().NewMeter(
-                    {"op-allow-trust", "invalid", "malformed-invalid-asset"},
-                    "operation").Mark();
+        app.getOperationMetrics().mark(allowTrustInvalidMalformedInvalidAsset);
         innerResult().code(ALLOW_TRUST_MALFORMED);
         return false;
     }
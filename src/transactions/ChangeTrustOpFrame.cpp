@@ -7,12 +7,27 @@
 #include "ledger/LedgerManager.h"
 #include "database/Database.h"
 #include "main/Application.h"
-#include "medida/meter.h"
-#include "medida/metrics_registry.h"
+#include "transactions/OperationMetrics.h"
 
 namespace stellar
 {
 
+namespace
+{
+OperationMeter const changeTrustFailureInvalidLimit(
+    "op-change-trust", "failure", "invalid-limit");
+OperationMeter const
+    changeTrustFailureNoIssuer("op-change-trust", "failure", "no-issuer");
+OperationMeter const
+    changeTrustSuccessApply("op-change-trust", "success", "apply");
+OperationMeter const
+    changeTrustFailureLowReserve("op-change-trust", "failure", "low-reserve");
+OperationMeter const changeTrustInvalidMalformedNegativeLimit(
+    "op-change-trust", "invalid", "malformed-negative-limit");
+OperationMeter const changeTrustInvalidMalformedInvalidAsset(
+    "op-change-trust", "invalid", "malformed-invalid-asset");
+}
+
 ChangeTrustOpFrame::ChangeTrustOpFrame(Operation const& op,
                                        OperationResult& res, OperationFee* fee,
                                        TransactionFrame& parentTx)
@@ -36,8 +51,7 @@ ChangeTrustOpFrame::doApply(Application& app,
 
         if (mChangeTrust.limit < mTrustLine->getBalance())
         { // Can't drop the limit below the balance you are holding with them
-            app.getMetrics().NewMeter({"op-change-trust", "failure", "invalid-limit"},
-                             "operation").Mark();
+            app.getOperationMetrics().mark(changeTrustFailureInvalidLimit);
             innerResult().code(CHANGE_TRUST_INVALID_LIMIT);
             return false;
         }
@@ -53,16 +67,14 @@ ChangeTrustOpFrame::doApply(Application& app,
         {
             if (!issuer)
             {
-                app.getMetrics().NewMeter({"op-change-trust", "failure", "no-issuer"},
-                                 "operation").Mark();
+                app.getOperationMetrics().mark(changeTrustFailureNoIssuer);
                 innerResult().code(CHANGE_TRUST_NO_ISSUER);
                 return false;
             }
 			mTrustLine->getTrustLine().limit = mChangeTrust.limit;
 			mTrustLine->storeChange(delta, db);
         }
-        app.getMetrics().NewMeter({"op-change-trust", "success", "apply"}, "operation")
-            .Mark();
+        app.getOperationMetrics().mark(changeTrustSuccessApply);
         innerResult().code(CHANGE_TRUST_SUCCESS);
         return true;
     }
@@ -70,15 +82,13 @@ ChangeTrustOpFrame::doApply(Application& app,
     { // new trust line
         if (mChangeTrust.limit == 0)
         {
-            app.getMetrics().NewMeter({"op-change-trust", "failure", "invalid-limit"},
-                             "operation").Mark();
+            app.getOperationMetrics().mark(changeTrustFailureInvalidLimit);
             innerResult().code(CHANGE_TRUST_INVALID_LIMIT);
             return false;
         }
         if (!issuer)
         {
-            app.getMetrics().NewMeter({"op-change-trust", "failure", "no-issuer"},
-                             "operation").Mark();
+            app.getOperationMetrics().mark(changeTrustFailureNoIssuer);
             innerResult().code(CHANGE_TRUST_NO_ISSUER);
             return false;
         }
@@ -92,8 +102,7 @@ ChangeTrustOpFrame::doApply(Application& app,
 
         if (!mSourceAccount->addNumEntries(1, ledgerManager))
         {
-            app.getMetrics().NewMeter({"op-change-trust", "failure", "low-reserve"},
-                             "operation").Mark();
+            app.getOperationMetrics().mark(changeTrustFailureLowReserve);
             innerResult().code(CHANGE_TRUST_LOW_RESERVE);
             return false;
         }
@@ -101,8 +110,7 @@ ChangeTrustOpFrame::doApply(Application& app,
         mSourceAccount->storeChange(delta, db);
 		mTrustLine->storeAdd(delta, db);
 
-        app.getMetrics().NewMeter({"op-change-trust", "success", "apply"}, "operation")
-            .Mark();
+        app.getOperationMetrics().mark(changeTrustSuccessApply);
         innerResult().code(CHANGE_TRUST_SUCCESS);
         return true;
     }
@@ -113,17 +121,14 @@ ChangeTrustOpFrame::doCheckValid(Application& app)
 {
     if (mChangeTrust.limit < 0)
     {
-        app.getMetrics().NewMeter(
-                    {"op-change-trust", "invalid", "malformed-negative-limit"},
-                    "operation").Mark();
+        app.getOperationMetrics().mark(
+            changeTrustInvalidMalformedNegativeLimit);
         innerResult().code(CHANGE_TRUST_MALFORMED);
         return false;
     }
     if (!isAssetValid(app.getIssuer(), mChangeTrust.line))
     {
-        app.getMetrics().NewMeter(
-                    {"op-change-trust", "invalid", "malformed-invalid-asset"},
-                    "operation").Mark();
+        app.getOperationMetrics().mark(changeTrustInvalidMalformedInvalidAsset);
         innerResult().code(CHANGE_TRUST_MALFORMED);
         return false;
     }
@@ -14,8 +14,7 @@
 #include <algorithm>
 
 #include "main/Application.h"
-#include "medida/meter.h"
-#include "medida/metrics_registry.h"
+#include "transactions/OperationMetrics.h"
 
 namespace stellar
 {
@@ -23,6 +22,35 @@ namespace stellar
 using namespace std;
 using xdr::operator==;
 
+namespace
+{
+OperationMeter const createScratchcardAccountInvalidMalformedSourceType(
+    "op-create-scratchcard-account", "invalid", "malformed-source-type");
+OperationMeter const
+    createAccountSuccessApply("op-create-account", "success", "apply");
+OperationMeter const createAccountFailureAlreadyExist(
+    "op-create-account", "failure", "already-exist");
+OperationMeter const createAccountFailureUnderfunded(
+    "op-create-account", "failure", "underfunded");
+OperationMeter const createAccountFailureSrcNotAuthorized(
+    "op-create-account", "failure", "src-not-authorized");
+OperationMeter const
+    createAccountFailureLineFull("op-create-account", "failure", "line-full");
+OperationMeter const
+    createAccountFailureNoIssuer("op-create-account", "failure", "no-issuer");
+OperationMeter const paymentSuccessApply("op-payment", "success", "apply");
+OperationMeter const createAccountInvalidMalformedScratchCardAmount(
+    "op-create-account", "invalid", "malformed-scratch-card-amount");
+OperationMeter const createAccountInvalidMalformedScratchCardInvalidAsset(
+    "op-create-account", "invalid", "malformed-scratch-card-invalid-asset");
+OperationMeter const createAccountInvalidNotBankCreatingType(
+    "op-create-account", "invalid", "not-bank-creating-type");
+OperationMeter const createAccountInvalidMalformedWrongType(
+    "op-create-account", "invalid", "malformed-wrong-type");
+OperationMeter const createAccountInvalidMalformedDestinationEqualsSource(
+    "op-create-account", "invalid", "malformed-destination-equals-source");
+}
+
 CreateAccountOpFrame::CreateAccountOpFrame(Operation const& op,
                                            OperationResult& res,
                                            OperationFee* fee,
@@ -44,9 +72,8 @@ CreateAccountOpFrame::doApply(Application& app,
         AccountFrame::loadAccount(delta, mCreateAccount.destination, db);
 
     if (mCreateAccount.body.accountType() == ACCOUNT_SCRATCH_CARD && mSourceAccount->getAccount().accountType != ACCOUNT_DISTRIBUTION_AGENT){
-        app.getMetrics().NewMeter({"op-create-scratchcard-account", "invalid",
-                                   "malformed-source-type"},
-                                  "operation").Mark();
+        app.getOperationMetrics().mark(
+            createScratchcardAccountInvalidMalformedSourceType);
         innerResult().code(CREATE_ACCOUNT_WRONG_TYPE);
         return false;
     }
@@ -62,15 +89,13 @@ CreateAccountOpFrame::doApply(Application& app,
             return doApplyCreateScratch(app, delta, ledgerManager);
 		}
         
-        app.getMetrics().NewMeter({"op-create-account", "success", "apply"},
-                                  "operation").Mark();
+        app.getOperationMetrics().mark(createAccountSuccessApply);
         innerResult().code(CREATE_ACCOUNT_SUCCESS);
         return true;
     }
     else
     {
-        app.getMetrics().NewMeter({"op-create-account", "failure", "already-exist"},
-                         "operation").Mark();
+        app.getOperationMetrics().mark(createAccountFailureAlreadyExist);
         innerResult().code(CREATE_ACCOUNT_ALREADY_EXIST);
         return false;
     }
@@ -112,23 +137,23 @@ CreateAccountOpFrame::doApply(Application& app,
             {
                 case PATH_PAYMENT_UNDERFUNDED:
                 case PATH_PAYMENT_SRC_NO_TRUST:
-                    app.getMetrics().NewMeter({"op-create-account", "failure", "underfunded"},
-                                              "operation").Mark();
+                    app.getOperationMetrics().mark(
+                        createAccountFailureUnderfunded);
                     res = CREATE_ACCOUNT_UNDERFUNDED;
                     break;
                 case PATH_PAYMENT_SRC_NOT_AUTHORIZED:
-                    app.getMetrics().NewMeter({"op-create-account", "failure", "src-not-authorized"},
-                                              "operation").Mark();
+                    app.getOperationMetrics().mark(
+                        createAccountFailureSrcNotAuthorized);
                     res = CREATE_ACCOUNT_NOT_AUTHORIZED_TYPE;
                     break;
                 case PATH_PAYMENT_LINE_FULL:
-                    app.getMetrics().NewMeter({"op-create-account", "failure", "line-full"},
-                                              "operation").Mark();
+                    app.getOperationMetrics().mark(
+                        createAccountFailureLineFull);
                     res = CREATE_ACCOUNT_LINE_FULL;
                     break;
                 case PATH_PAYMENT_NO_ISSUER:
-                    app.getMetrics().NewMeter({"op-create-account", "failure", "no-issuer"},
-                                              "operation").Mark();
+                    app.getOperationMetrics().mark(
+                        createAccountFailureNoIssuer);
                     res = CREATE_ACCOUNT_NO_ISSUER;
                     break;
                 default:
@@ -141,7 +166,7 @@ CreateAccountOpFrame::doApply(Application& app,
         assert(PathPaymentOpFrame::getInnerCode(ppayment.getResult()) ==
                PATH_PAYMENT_SUCCESS);
         
-        app.getMetrics().NewMeter({"op-payment", "success", "apply"}, "operation").Mark();
+        app.getOperationMetrics().mark(paymentSuccessApply);
         innerResult().code(CREATE_ACCOUNT_SUCCESS);
         
         return true;
@@ -155,18 +180,16 @@ CreateAccountOpFrame::doCheckValid(Application& app)
 			break;
         case ACCOUNT_SCRATCH_CARD:
 			if (mCreateAccount.body.scratchCard().amount <= 0) {
-				app.getMetrics().NewMeter({ "op-create-account", "invalid",
-					"malformed-scratch-card-amount" },
-					"operation").Mark();
+				app.getOperationMetrics().mark(
+					createAccountInvalidMalformedScratchCardAmount);
 				innerResult().code(CREATE_ACCOUNT_MALFORMED);
 				return false;
 			}
 
 			if (!isAssetValid(app.getIssuer(), mCreateAccount.body.scratchCard().asset))
 			{
-				app.getMetrics().NewMeter({ "op-create-account", "invalid",
-					"malformed-scratch-card-invalid-asset" },
-					"operation").Mark();
+				app.getOperationMetrics().mark(
+					createAccountInvalidMalformedScratchCardInvalidAsset);
 				innerResult().code(CREATE_ACCOUNT_MALFORMED);
 				return false;
 			}
@@ -180,26 +203,23 @@ CreateAccountOpFrame::doCheckValid(Application& app)
                 break;
             }
             else{
-                app.getMetrics().NewMeter({"op-create-account", "invalid",
-                    "not-bank-creating-type"},
-                                          "operation").Mark();
+                app.getOperationMetrics().mark(
+                    createAccountInvalidNotBankCreatingType);
                 innerResult().code(CREATE_ACCOUNT_NOT_AUTHORIZED_TYPE);
                 return false;
             }
             break;
         default:
-            app.getMetrics().NewMeter({"op-create-account", "invalid",
-                "malformed-wrong-type"},
-                                      "operation").Mark();
+            app.getOperationMetrics().mark(
+                createAccountInvalidMalformedWrongType);
             innerResult().code(CREATE_ACCOUNT_WRONG_TYPE);
             return false;
             break;
     }
     if (mCreateAccount.destination == getSourceID())
     {
-        app.getMetrics().NewMeter({"op-create-account", "invalid",
-                          "malformed-destination-equals-source"},
-                         "operation").Mark();
+        app.getOperationMetrics().mark(
+            createAccountInvalidMalformedDestinationEqualsSource);
         innerResult().code(CREATE_ACCOUNT_MALFORMED);
         return false;
     }
@@ -7,9 +7,8 @@
 #include "ledger/LedgerDelta.h"
 #include "ledger/LedgerManager.h"
 #include "overlay/StellarXDR.h"
-#include "medida/meter.h"
-#include "medida/metrics_registry.h"
 #include "main/Application.h"
+#include "transactions/OperationMetrics.h"
 
 const uint32_t INFLATION_FREQUENCY = (60 * 60 * 24 * 7); // every 7 days
 // inflation is .000190721 per 7 days, or 1% a year
@@ -21,6 +20,13 @@ const time_t INFLATION_START_TIME = (1404172800LL); // 1-jul-2014 (unix epoch)
 
 namespace stellar
 {
+namespace
+{
+OperationMeter const
+    inflationFailureNotTime("op-inflation", "failure", "not-time");
+OperationMeter const inflationSuccessApply("op-inflation", "success", "apply");
+}
+
 InflationOpFrame::InflationOpFrame(Operation const& op, OperationResult& res, OperationFee* fee,
                                    TransactionFrame& parentTx)
     : OperationFrame(op, res, fee, parentTx)
@@ -40,8 +46,7 @@ InflationOpFrame::doApply(Application& app, LedgerDelta& delta,
     time_t inflationTime = (INFLATION_START_TIME + seq * INFLATION_FREQUENCY);
     if (closeTime < inflationTime)
     {
-        app.getMetrics().NewMeter({"op-inflation", "failure", "not-time"}, "operation")
-            .Mark();
+        app.getOperationMetrics().mark(inflationFailureNotTime);
         innerResult().code(INFLATION_NOT_TIME);
         return false;
     }
@@ -62,6 +67,10 @@ InflationOpFrame::doApply(Application& app, LedgerDelta& delta,
     std::vector<AccountFrame::InflationVotes> winners;
     auto& db = ledgerManager.getDatabase();
 
+    // votes are tallied in SQL: write the accounts still pending in the
+    // entry cache first
+    EntryFrame::storePending(db);
+
     AccountFrame::processForInflation(
         [&](AccountFrame::InflationVotes const& votes)
         {
@@ -114,7 +123,7 @@ InflationOpFrame::doApply(Application& app, LedgerDelta& delta,
 
     inflationDelta.commit();
 
-    app.getMetrics().NewMeter({"op-inflation", "success", "apply"}, "operation").Mark();
+    app.getOperationMetrics().mark(inflationSuccessApply);
     return true;
 }
 
@@ -9,9 +9,8 @@
 #include "util/types.h"
 #include "database/Database.h"
 #include "ledger/LedgerDelta.h"
-#include "medida/meter.h"
-#include "medida/metrics_registry.h"
 #include "main/Application.h"
+#include "transactions/OperationMetrics.h"
 
 namespace stellar
 {
@@ -19,6 +18,20 @@ namespace stellar
 using namespace std;
 using xdr::operator==;
 
+namespace
+{
+OperationMeter const
+    manageDataInvalidLowReserve("op-manage-data", "invalid", "low reserve");
+OperationMeter const
+    manageDataInvalidNotFound("op-manage-data", "invalid", "not-found");
+OperationMeter const
+    manageDataSuccessApply("op-manage-data", "success", "apply");
+OperationMeter const setOptionsInvalidInvalidDataOldProtocol(
+    "op-set-options", "invalid", "invalid-data-old-protocol");
+OperationMeter const setOptionsInvalidInvalidDataName(
+    "op-set-options", "invalid", "invalid-data-name");
+}
+
 ManageDataOpFrame::ManageDataOpFrame(Operation const& op,
     OperationResult& res,
     OperationFee* fee,
@@ -44,8 +57,7 @@ ManageDataOpFrame::doApply(Application& app,
             
             if(!mSourceAccount->addNumEntries(1, ledgerManager))
             {
-                app.getMetrics().NewMeter({ "op-manage-data", "invalid", "low reserve" },
-                    "operation").Mark();
+                app.getOperationMetrics().mark(manageDataInvalidLowReserve);
                 innerResult().code(MANAGE_DATA_LOW_RESERVE);
                 return false;
             }
@@ -67,8 +79,7 @@ ManageDataOpFrame::doApply(Application& app,
         
         if(!dataFrame)
         {
-            app.getMetrics().NewMeter({ "op-manage-data", "invalid", "not-found" },
-                "operation").Mark();
+            app.getOperationMetrics().mark(manageDataInvalidNotFound);
             innerResult().code(MANAGE_DATA_NAME_NOT_FOUND);
             return false;
         }
@@ -81,8 +92,7 @@ ManageDataOpFrame::doApply(Application& app,
 
     innerResult().code(MANAGE_DATA_SUCCESS);
 
-    app.getMetrics().NewMeter({"op-manage-data", "success", "apply"}, "operation")
-        .Mark();
+    app.getOperationMetrics().mark(manageDataSuccessApply);
     return true;
 }
 
@@ -92,9 +102,7 @@ ManageDataOpFrame::doCheckValid(Application& app)
 {
     if(app.getLedgerManager().getCurrentLedgerHeader().ledgerVersion < 2)
     {
-        app.getMetrics().NewMeter(
-        { "op-set-options", "invalid", "invalid-data-old-protocol" },
-            "operation").Mark();
+        app.getOperationMetrics().mark(setOptionsInvalidInvalidDataOldProtocol);
         innerResult().code(MANAGE_DATA_NOT_SUPPORTED_YET);
         return false;
     }
@@ -102,9 +110,7 @@ ManageDataOpFrame::doCheckValid(Application& app)
     if( (mManageData.dataName.size()<1) || 
         (!isString32Valid(mManageData.dataName)))
     {
-        app.getMetrics().NewMeter(
-        { "op-set-options", "invalid", "invalid-data-name" },
-            "operation").Mark();
+        app.getOperationMetrics().mark(setOptionsInvalidInvalidDataName);
         innerResult().code(MANAGE_DATA_INVALID_NAME);
         return false;
     }
@@ -10,9 +10,8 @@
 #include "database/Database.h"
 #include "ledger/LedgerDelta.h"
 #include "OfferExchange.h"
-#include "medida/meter.h"
-#include "medida/metrics_registry.h"
 #include "main/Application.h"
+#include "transactions/OperationMetrics.h"
 
 // convert from sheep to wheat
 // selling sheep
@@ -24,6 +23,38 @@ namespace stellar
 using namespace std;
 using xdr::operator==;
 
+namespace
+{
+OperationMeter const manageOfferInvalidSellNoIssuer(
+    "op-manage-offer", "invalid", "sell-no-issuer");
+OperationMeter const manageOfferInvalidSellNoTrust(
+    "op-manage-offer", "invalid", "sell-no-trust");
+OperationMeter const
+    manageOfferInvalidUnderfunded("op-manage-offer", "invalid", "underfunded");
+OperationMeter const manageOfferInvalidSellNotAuthorized(
+    "op-manage-offer", "invalid", "sell-not-authorized");
+OperationMeter const manageOfferInvalidBuyNoIssuer(
+    "op-manage-offer", "invalid", "buy-no-issuer");
+OperationMeter const
+    manageOfferInvalidBuyNoTrust("op-manage-offer", "invalid", "buy-no-trust");
+OperationMeter const manageOfferInvalidBuyNotAuthorized(
+    "op-manage-offer", "invalid", "buy-not-authorized");
+OperationMeter const
+    manageOfferInvalidNotFound("op-manage-offer", "invalid", "not-found");
+OperationMeter const
+    manageOfferInvalidLineFull("op-manage-offer", "invalid", "line-full");
+OperationMeter const
+    manageOfferInvalidLowReserve("op-manage-offer", "invalid", "low reserve");
+OperationMeter const
+    createOfferSuccessApply("op-create-offer", "success", "apply");
+OperationMeter const manageOfferInvalidInvalidAsset(
+    "op-manage-offer", "invalid", "invalid-asset");
+OperationMeter const manageOfferInvalidEqualCurrencies(
+    "op-manage-offer", "invalid", "equal-currencies");
+OperationMeter const manageOfferInvalidNegativeOrZeroValues(
+    "op-manage-offer", "invalid", "negative-or-zero-values");
+}
+
 ManageOfferOpFrame::ManageOfferOpFrame(Operation const& op,
                                        OperationResult& res,
                                        OperationFee* fee,
@@ -36,7 +67,7 @@ ManageOfferOpFrame::ManageOfferOpFrame(Operation const& op,
 
 // make sure these issuers exist and you can hold the ask asset
 bool
-ManageOfferOpFrame::checkOfferValid(medida::MetricsRegistry& metrics,
+ManageOfferOpFrame::checkOfferValid(OperationMetrics& metrics,
                                     Database& db, LedgerDelta& delta)
 {
     Asset const& sheep = mManageOffer.selling;
@@ -55,30 +86,25 @@ ManageOfferOpFrame::checkOfferValid(medida::MetricsRegistry& metrics,
         mSheepLineA = tlI.first;
         if (!tlI.second)
         {
-            metrics.NewMeter({"op-manage-offer", "invalid", "sell-no-issuer"},
-                             "operation").Mark();
+            metrics.mark(manageOfferInvalidSellNoIssuer);
             innerResult().code(MANAGE_OFFER_SELL_NO_ISSUER);
             return false;
         }
         if (!mSheepLineA)
         { // we don't have what we are trying to sell
-            metrics.NewMeter({"op-manage-offer", "invalid", "sell-no-trust"},
-                             "operation").Mark();
+            metrics.mark(manageOfferInvalidSellNoTrust);
             innerResult().code(MANAGE_OFFER_SELL_NO_TRUST);
             return false;
         }
         if (mSheepLineA->getBalance() == 0)
         {
-            metrics.NewMeter({"op-manage-offer", "invalid", "underfunded"},
-                             "operation").Mark();
+            metrics.mark(manageOfferInvalidUnderfunded);
             innerResult().code(MANAGE_OFFER_UNDERFUNDED);
             return false;
         }
         if (!mSheepLineA->isAuthorized())
         {
-            metrics.NewMeter(
-                        {"op-manage-offer", "invalid", "sell-not-authorized"},
-                        "operation").Mark();
+            metrics.mark(manageOfferInvalidSellNotAuthorized);
             // we are not authorized to sell
             innerResult().code(MANAGE_OFFER_SELL_NOT_AUTHORIZED);
             return false;
@@ -92,23 +118,19 @@ ManageOfferOpFrame::checkOfferValid(medida::MetricsRegistry& metrics,
         mWheatLineA = tlI.first;
         if (!tlI.second)
         {
-            metrics.NewMeter({"op-manage-offer", "invalid", "buy-no-issuer"},
-                             "operation").Mark();
+            metrics.mark(manageOfferInvalidBuyNoIssuer);
             innerResult().code(MANAGE_OFFER_BUY_NO_ISSUER);
             return false;
         }
         if (!mWheatLineA)
         { // we can't hold what we are trying to buy
-            metrics.NewMeter({"op-manage-offer", "invalid", "buy-no-trust"},
-                             "operation").Mark();
+            metrics.mark(manageOfferInvalidBuyNoTrust);
             innerResult().code(MANAGE_OFFER_BUY_NO_TRUST);
             return false;
         }
         if (!mWheatLineA->isAuthorized())
         { // we are not authorized to hold what we are trying to buy
-            metrics.NewMeter(
-                        {"op-manage-offer", "invalid", "buy-not-authorized"},
-                        "operation").Mark();
+            metrics.mark(manageOfferInvalidBuyNotAuthorized);
             innerResult().code(MANAGE_OFFER_BUY_NOT_AUTHORIZED);
             return false;
         }
@@ -125,7 +147,7 @@ ManageOfferOpFrame::doApply(Application& app,
                             LedgerDelta& delta, LedgerManager& ledgerManager)
 {
     Database& db = ledgerManager.getDatabase();
-    if (!checkOfferValid(app.getMetrics(), db, delta))
+    if (!checkOfferValid(app.getOperationMetrics(), db, delta))
     {
         return false;
     }
@@ -143,8 +165,7 @@ ManageOfferOpFrame::doApply(Application& app,
 
         if (!mSellSheepOffer)
         {
-            app.getMetrics().NewMeter({"op-manage-offer", "invalid", "not-found"},
-                             "operation").Mark();
+            app.getOperationMetrics().mark(manageOfferInvalidNotFound);
             innerResult().code(MANAGE_OFFER_NOT_FOUND);
             return false;
         }
@@ -200,8 +221,7 @@ ManageOfferOpFrame::doApply(Application& app,
             maxWheatCanSell = mWheatLineA->getMaxAmountReceive();
             if (maxWheatCanSell == 0)
             {
-                app.getMetrics().NewMeter({"op-manage-offer", "invalid", "line-full"},
-                                 "operation").Mark();
+                app.getOperationMetrics().mark(manageOfferInvalidLineFull);
                 innerResult().code(MANAGE_OFFER_LINE_FULL);
                 return false;
             }
@@ -329,8 +349,7 @@ ManageOfferOpFrame::doApply(Application& app,
             // the minbalance
             if (!mSourceAccount->addNumEntries(1, ledgerManager))
             {
-                app.getMetrics().NewMeter({"op-manage-offer", "invalid", "low reserve"},
-                                 "operation").Mark();
+                app.getOperationMetrics().mark(manageOfferInvalidLowReserve);
                 innerResult().code(MANAGE_OFFER_LOW_RESERVE);
                 return false;
             }
@@ -362,8 +381,7 @@ ManageOfferOpFrame::doApply(Application& app,
     sqlTx.commit();
     tempDelta.commit();
 
-    app.getMetrics().NewMeter({"op-create-offer", "success", "apply"}, "operation")
-        .Mark();
+    app.getOperationMetrics().mark(createOfferSuccessApply);
     return true;
 }
 
@@ -376,24 +394,20 @@ ManageOfferOpFrame::doCheckValid(Application& app)
 
     if (!isAssetValid(app.getIssuer(), sheep) || !isAssetValid(app.getIssuer(), wheat))
     {
-        app.getMetrics().NewMeter({"op-manage-offer", "invalid", "invalid-asset"},
-                         "operation").Mark();
+        app.getOperationMetrics().mark(manageOfferInvalidInvalidAsset);
         innerResult().code(MANAGE_OFFER_MALFORMED);
         return false;
     }
     if (compareAsset(sheep, wheat))
     {
-        app.getMetrics().NewMeter({"op-manage-offer", "invalid", "equal-currencies"},
-                         "operation").Mark();
+        app.getOperationMetrics().mark(manageOfferInvalidEqualCurrencies);
         innerResult().code(MANAGE_OFFER_MALFORMED);
         return false;
     }
     if (mManageOffer.amount < 0 || mManageOffer.price.d <= 0 ||
         mManageOffer.price.n <= 0)
     {
-        app.getMetrics().NewMeter(
-                    {"op-manage-offer", "invalid", "negative-or-zero-values"},
-                    "operation").Mark();
+        app.getOperationMetrics().mark(manageOfferInvalidNegativeOrZeroValues);
         innerResult().code(MANAGE_OFFER_MALFORMED);
         return false;
     }
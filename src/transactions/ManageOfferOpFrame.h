@@ -10,6 +10,8 @@
 
 namespace stellar
 {
+class OperationMetrics;
+
 class ManageOfferOpFrame : public OperationFrame
 {
     TrustFrame::pointer mSheepLineA;
@@ -17,7 +19,7 @@ class ManageOfferOpFrame : public OperationFrame
 
     OfferFrame::pointer mSellSheepOffer;
 
-    bool checkOfferValid(medida::MetricsRegistry& metrics, Database& db,
+    bool checkOfferValid(OperationMetrics& metrics, Database& db,
                          LedgerDelta& delta);
 
     ManageOfferResult&
@@ -6,8 +6,7 @@
 #include "database/Database.h"
 #include "ledger/TrustFrame.h"
 #include "main/Application.h"
-#include "medida/meter.h"
-#include "medida/metrics_registry.h"
+#include "transactions/OperationMetrics.h"
 
 using namespace soci;
 
@@ -15,6 +14,24 @@ namespace stellar
 {
 using xdr::operator==;
 
+namespace
+{
+OperationMeter const mergeFailureNoAccount("op-merge", "failure", "no-account");
+OperationMeter const
+    mergeFailureStaticAuth("op-merge", "failure", "static-auth");
+OperationMeter const
+    mergeFailureHasSubEntries("op-merge", "failure", "has-sub-entries");
+OperationMeter const mergeSuccessApply("op-merge", "success", "apply");
+OperationMeter const
+    operationInvalidNoAccount("operation", "invalid", "no-account");
+OperationMeter const
+    operationInvalidBadAuth("operation", "invalid", "bad-auth");
+OperationMeter const mergeInvalidMalformedSelfMerge(
+    "op-merge", "invalid", "malformed-self-merge");
+OperationMeter const
+    mergeInvalidBankAccountMerge("op-merge", "invalid", "bank-account-merge");
+}
+
 MergeOpFrame::MergeOpFrame(Operation const& op, OperationResult& res, OperationFee* fee,
                            TransactionFrame& parentTx)
     : OperationFrame(op, res, fee, parentTx)
@@ -43,16 +60,14 @@ MergeOpFrame::doApply(Application& app, LedgerDelta& delta,
 
     if (!otherAccount)
     {
-        app.getMetrics().NewMeter({"op-merge", "failure", "no-account"}, "operation")
-            .Mark();
+        app.getOperationMetrics().mark(mergeFailureNoAccount);
         innerResult().code(ACCOUNT_MERGE_NO_ACCOUNT);
         return false;
     }
 
     if (mSourceAccount->isImmutableAuth())
     {
-        app.getMetrics().NewMeter({"op-merge", "failure", "static-auth"}, "operation")
-            .Mark();
+        app.getOperationMetrics().mark(mergeFailureStaticAuth);
         innerResult().code(ACCOUNT_MERGE_IMMUTABLE_SET);
         return false;
     }
@@ -60,8 +75,7 @@ MergeOpFrame::doApply(Application& app, LedgerDelta& delta,
     auto const& sourceAccount = mSourceAccount->getAccount();
     if (sourceAccount.numSubEntries != sourceAccount.signers.size())
     {
-        app.getMetrics().NewMeter({"op-merge", "failure", "has-sub-entries"},
-                         "operation").Mark();
+        app.getOperationMetrics().mark(mergeFailureHasSubEntries);
         innerResult().code(ACCOUNT_MERGE_HAS_SUB_ENTRIES);
         return false;
     }
@@ -71,7 +85,7 @@ MergeOpFrame::doApply(Application& app, LedgerDelta& delta,
     otherAccount->storeChange(delta, db);
     mSourceAccount->storeDelete(delta, db);
 
-    app.getMetrics().NewMeter({"op-merge", "success", "apply"}, "operation").Mark();
+    app.getOperationMetrics().mark(mergeSuccessApply);
     innerResult().code(ACCOUNT_MERGE_SUCCESS);
     innerResult().sourceAccountBalance() = sourceBalance;
     return true;
@@ -85,9 +99,7 @@ MergeOpFrame::checkValid(Application& app, LedgerDelta* delta)
     {
         if (forApply || !mOperation.sourceAccount)
         {
-            app.getMetrics()
-                .NewMeter({"operation", "invalid", "no-account"}, "operation")
-                .Mark();
+            app.getOperationMetrics().mark(operationInvalidNoAccount);
             mResult.code(opNO_ACCOUNT);
             return false;
         }
@@ -110,9 +122,7 @@ MergeOpFrame::checkValid(Application& app, LedgerDelta* delta)
         }
         if (!isBank)
         {
-            app.getMetrics()
-            .NewMeter({"operation", "invalid", "bad-auth"}, "operation")
-            .Mark();
+            app.getOperationMetrics().mark(operationInvalidBadAuth);
             mResult.code(opBAD_AUTH);
             return false;
         }
@@ -136,23 +146,20 @@ MergeOpFrame::doCheckValid(Application& app)
 {
     if (!mOperation.sourceAccount)
     {
-        app.getMetrics().NewMeter({"op-merge", "invalid", "malformed-self-merge"},
-                         "operation").Mark();
+        app.getOperationMetrics().mark(mergeInvalidMalformedSelfMerge);
         innerResult().code(ACCOUNT_MERGE_MALFORMED);
         return false;
     }
     // makes sure not merging into self
     if (*mOperation.sourceAccount == mOperation.body.destination())
     {
-        app.getMetrics().NewMeter({"op-merge", "invalid", "malformed-self-merge"},
-                         "operation").Mark();
+        app.getOperationMetrics().mark(mergeInvalidMalformedSelfMerge);
         innerResult().code(ACCOUNT_MERGE_MALFORMED);
         return false;
     }
     if (*mOperation.sourceAccount == app.getConfig().BANK_MASTER_KEY)
     {
-        app.getMetrics().NewMeter({"op-merge", "invalid", "bank-account-merge"},
-                         "operation").Mark();
+        app.getOperationMetrics().mark(mergeInvalidBankAccountMerge);
         innerResult().code(ACCOUNT_MERGE_MALFORMED);
         return false;
     }
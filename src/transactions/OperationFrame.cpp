@@ -25,15 +25,25 @@
 #include "transactions/AdministrativeOpFrame.h"
 #include "transactions/PaymentReversalOpFrame.h"
 #include "database/Database.h"
-
-#include "medida/meter.h"
-#include "medida/metrics_registry.h"
+#include "transactions/OperationMetrics.h"
 
 namespace stellar
 {
 
 using namespace std;
 
+namespace
+{
+OperationMeter const
+    operationInvalidNoAccount("operation", "invalid", "no-account");
+OperationMeter const
+    operationInvalidBadAuth("operation", "invalid", "bad-auth");
+OperationMeter const opFailureMalformedChangeTrustOp(
+    "op", "failure", "malformed-change-trust-op");
+OperationMeter const opFailureInvalidLimitChangeTrustOp(
+    "op", "failure", "invalid-limit-change-trust-op");
+}
+
 shared_ptr<OperationFrame>
 OperationFrame::makeHelper(Operation const& op, OperationResult& res, OperationFee* fee,
                            TransactionFrame& tx)
@@ -141,9 +151,7 @@ OperationFrame::checkValid(Application& app, LedgerDelta* delta)
     {
         if (forApply || !mOperation.sourceAccount)
         {
-            app.getMetrics()
-                .NewMeter({"operation", "invalid", "no-account"}, "operation")
-                .Mark();
+            app.getOperationMetrics().mark(operationInvalidNoAccount);
             mResult.code(opNO_ACCOUNT);
             return false;
         }
@@ -156,9 +164,7 @@ OperationFrame::checkValid(Application& app, LedgerDelta* delta)
 
     if (!checkSignature())
     {
-        app.getMetrics()
-            .NewMeter({"operation", "invalid", "bad-auth"}, "operation")
-            .Mark();
+        app.getOperationMetrics().mark(operationInvalidBadAuth);
         mResult.code(opBAD_AUTH);
         return false;
     }
@@ -212,10 +218,10 @@ OperationFrame::createTrustLine(Application& app, LedgerManager& ledgerManager,
 		case CHANGE_TRUST_LOW_RESERVE:
 			return nullptr;
 		case CHANGE_TRUST_MALFORMED:
-			app.getMetrics().NewMeter({ "op", "failure", "malformed-change-trust-op" }, "operation").Mark();
+			app.getOperationMetrics().mark(opFailureMalformedChangeTrustOp);
 			throw std::runtime_error("Failed to create trust line - change trust line op is malformed");
 		case CHANGE_TRUST_INVALID_LIMIT:
-			app.getMetrics().NewMeter({ "op", "failure", "invalid-limit-change-trust-op" }, "operation").Mark();
+			app.getOperationMetrics().mark(opFailureInvalidLimitChangeTrustOp);
 			throw std::runtime_error("Failed to create trust line - invalid limit");
 		default:
 			throw std::runtime_error("Unexpected error code from change trust line");
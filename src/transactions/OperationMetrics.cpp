@@ -0,0 +1,64 @@
+// Copyright 2017 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "transactions/OperationMetrics.h"
+#include "medida/meter.h"
+#include "medida/metrics_registry.h"
+#include "medida/timer.h"
+
+namespace stellar
+{
+
+namespace
+{
+struct MeterName
+{
+    medida::MetricName mName;
+    std::string mUnit;
+};
+
+// filled during static initialization, read-only afterwards
+std::vector<MeterName>&
+declaredMeters()
+{
+    static std::vector<MeterName> meters;
+    return meters;
+}
+
+size_t
+declare(std::string domain, std::string type, std::string name,
+        std::string unit)
+{
+    auto& meters = declaredMeters();
+    meters.push_back(MeterName{
+        medida::MetricName(std::move(domain), std::move(type), std::move(name)),
+        std::move(unit)});
+    return meters.size() - 1;
+}
+}
+
+OperationMeter::OperationMeter(std::string domain, std::string type,
+                               std::string name, std::string unit)
+    : mIndex(declare(std::move(domain), std::move(type), std::move(name),
+                     std::move(unit)))
+{
+}
+
+OperationMetrics::OperationMetrics(medida::MetricsRegistry& registry)
+    : mOperationApply(registry.NewTimer({"transaction", "op", "apply"}))
+{
+    auto const& meters = declaredMeters();
+    mMeters.reserve(meters.size());
+    for (auto const& m : meters)
+    {
+        mMeters.push_back(&registry.NewMeter(m.mName, m.mUnit));
+    }
+}
+
+void
+OperationMetrics::mark(OperationMeter const& meter)
+{
+    get(meter).Mark();
+}
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+// Copyright 2017 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "util/NonCopyable.h"
+#include <string>
+#include <vector>
+
+namespace medida
+{
+class MetricsRegistry;
+class Meter;
+class Timer;
+}
+
+namespace stellar
+{
+
+/**
+ * Name of a meter marked while checking or applying transactions and
+ * operations, such as {"op-payment", "failure", "underfunded"}.
+ *
+ * OperationMeters are declared at namespace scope, next to the code marking
+ * them, so all of them are known before any Application is created. Each one
+ * gets an index into the OperationMetrics table of the Application.
+ */
+class OperationMeter : NonMovableOrCopyable
+{
+  public:
+    OperationMeter(std::string domain, std::string type, std::string name,
+                   std::string unit = "operation");
+
+    size_t
+    getIndex() const
+    {
+        return mIndex;
+    }
+
+  private:
+    size_t const mIndex;
+};
+
+/**
+ * Meters of every OperationMeter, resolved from the metrics registry of the
+ * Application once, when it is created: marking one is an index into a
+ * vector and an increment, with no lookup in the registry.
+ */
+class OperationMetrics : NonMovableOrCopyable
+{
+  public:
+    explicit OperationMetrics(medida::MetricsRegistry& registry);
+
+    medida::Meter&
+    get(OperationMeter const& meter)
+    {
+        return *mMeters[meter.getIndex()];
+    }
+
+    void mark(OperationMeter const& meter);
+
+    // time spent applying each operation
+    medida::Timer&
+    getOperationApplyTimer()
+    {
+        return mOperationApply;
+    }
+
+  private:
+    std::vector<medida::Meter*> mMeters;
+    medida::Timer& mOperationApply;
+};
+}
@@ -13,9 +13,8 @@
 #include "OfferExchange.h"
 #include <algorithm>
 
-#include "medida/meter.h"
-#include "medida/metrics_registry.h"
 #include "main/Application.h"
+#include "transactions/OperationMetrics.h"
 
 namespace stellar
 {
@@ -23,6 +22,52 @@ namespace stellar
 using namespace std;
 using xdr::operator==;
 
+namespace
+{
+OperationMeter const pathPaymentFailureMalformedCreateAccountOp(
+    "op-path-payment", "failure", "malformed-create-account-op");
+OperationMeter const pathPaymentFailureAlreadyExistsCreateAccountOp(
+    "op-path-payment", "failure", "already-exists-create-account-op");
+OperationMeter const pathPaymentFailureWrongTypeCreateAccountOp(
+    "op-path-payment", "failure", "wrong-type-create-account-op");
+OperationMeter const pathPaymentFailureNoDestination(
+    "op-path-payment", "failure", "no-destination");
+OperationMeter const pathPaymentFailureDestinationScratchCard(
+    "op-path-payment", "failure", "destination-scratch-card");
+OperationMeter const
+    pathPaymentFailureNoIssuer("op-path-payment", "failure", "no-issuer");
+OperationMeter const pathPaymentFailureNotAuthorized(
+    "op-path-payment", "failure", "not-authorized");
+OperationMeter const
+    pathPaymentFailureLineFull("op-path-payment", "failure", "line-full");
+OperationMeter const pathPaymentFailureComissionDestLowReserve(
+    "op-path-payment", "failure", "comission-dest-low-reserve");
+OperationMeter const pathPaymentFailureCommissionLineFull(
+    "op-path-payment", "failure", "commission-line-full");
+OperationMeter const pathPaymentFailureOfferCrossSelf(
+    "op-path-payment", "failure", "offer-cross-self");
+OperationMeter const pathPaymentFailureTooFewOffers(
+    "op-path-payment", "failure", "too-few-offers");
+OperationMeter const pathPaymentFailureOverSendMax(
+    "op-path-payment", "failure", "over-send-max");
+OperationMeter const
+    pathPaymentFailureUnderfunded("op-path-payment", "failure", "underfunded");
+OperationMeter const
+    pathPaymentFailureSrcNoTrust("op-path-payment", "failure", "src-no-trust");
+OperationMeter const pathPaymentFailureSrcNotAuthorized(
+    "op-path-payment", "failure", "src-not-authorized");
+OperationMeter const
+    pathPaymentSuccessApply("op-path-payment", "success", "apply");
+OperationMeter const pathPaymentFailureFeeInvalidAsset(
+    "op-path-payment", "failure", "fee-invalid-asset");
+OperationMeter const pathPaymentFailureFeeInvalidAmount(
+    "op-path-payment", "failure", "fee-invalid-amount");
+OperationMeter const pathPaymentInvalidMalformedAmounts(
+    "op-path-payment", "invalid", "malformed-amounts");
+OperationMeter const pathPaymentInvalidMalformedCurrencies(
+    "op-path-payment", "invalid", "malformed-currencies");
+}
+
 PathPaymentOpFrame::PathPaymentOpFrame(Operation const& op,
                                        OperationResult& res,
                                        OperationFee* fee,
@@ -57,7 +102,7 @@ TrustFrame::pointer PathPaymentOpFrame::getCommissionDest(LedgerManager const& l
 			return nullptr;
 		}
 
-		commissionDest->storeChange(delta, db);
+		delta.storeCommission(*commissionDest, db);
 		commissionDestLine->storeAdd(delta, db);
 	}
 
@@ -100,16 +145,16 @@ PathPaymentOpFrame::createDestination(Application& app, LedgerManager& ledgerMan
 		case CREATE_ACCOUNT_NOT_AUTHORIZED_TYPE:
 			return nullptr;
 		case CREATE_ACCOUNT_MALFORMED:
-			app.getMetrics().NewMeter({ "op-path-payment", "failure", "malformed-create-account-op" },
-				"operation").Mark();
+			app.getOperationMetrics().mark(
+				pathPaymentFailureMalformedCreateAccountOp);
 			throw std::runtime_error("Failed to create account - create account op is malformed");
 		case CREATE_ACCOUNT_ALREADY_EXIST:
-			app.getMetrics().NewMeter({ "op-path-payment", "failure", "already-exists-create-account-op" },
-				"operation").Mark();
+			app.getOperationMetrics().mark(
+				pathPaymentFailureAlreadyExistsCreateAccountOp);
 			throw std::runtime_error("Failed to create account - already exists");
 		case CREATE_ACCOUNT_WRONG_TYPE:
-			app.getMetrics().NewMeter({ "op-path-payment", "failure", "wrong-type-create-account-op" },
-				"operation").Mark();
+			app.getOperationMetrics().mark(
+				pathPaymentFailureWrongTypeCreateAccountOp);
 			throw std::runtime_error("Failed to create account - wrong type");
 		default:
 			throw std::runtime_error("Unexpected error code from createAccount");
@@ -165,8 +210,7 @@ PathPaymentOpFrame::doApply(Application& app,
         }
         if (!destinationCreated)
         {
-            app.getMetrics().NewMeter({ "op-path-payment", "failure", "no-destination" },
-                                      "operation").Mark();
+            app.getOperationMetrics().mark(pathPaymentFailureNoDestination);
             innerResult().code(PATH_PAYMENT_NO_DESTINATION);
             return false;
         }
@@ -177,8 +221,8 @@ PathPaymentOpFrame::doApply(Application& app,
     {
         if (destination->getAccount().accountType == ACCOUNT_SCRATCH_CARD)
         {
-            app.getMetrics().NewMeter({ "op-path-payment", "failure", "destination-scratch-card" },
-                                      "operation").Mark();
+            app.getOperationMetrics().mark(
+                pathPaymentFailureDestinationScratchCard);
             innerResult().code(PATH_PAYMENT_NO_DESTINATION);
             return false;
         }
@@ -186,7 +230,7 @@ PathPaymentOpFrame::doApply(Application& app,
         destination->getAccount().balance += curBReceived;
 		commissionDestination->getAccount().balance += curBCommission;
         destination->storeChange(delta, db);
-		commissionDestination->storeChange(delta, db);
+		delta.storeCommission(*commissionDestination, db);
     }
     else
     {
@@ -196,8 +240,7 @@ PathPaymentOpFrame::doApply(Application& app,
                                                    curB, db, delta);
         if (!tlI.second)
         {
-            app.getMetrics().NewMeter({"op-path-payment", "failure", "no-issuer"},
-                                      "operation").Mark();
+            app.getOperationMetrics().mark(pathPaymentFailureNoIssuer);
             innerResult().code(PATH_PAYMENT_NO_ISSUER);
             innerResult().noIssuer() = curB;
             return false;
@@ -219,24 +262,22 @@ PathPaymentOpFrame::doApply(Application& app,
 
         if (!destLine->isAuthorized())
         {
-            app.getMetrics().NewMeter({"op-path-payment", "failure", "not-authorized"},
-                             "operation").Mark();
+            app.getOperationMetrics().mark(pathPaymentFailureNotAuthorized);
             innerResult().code(PATH_PAYMENT_NOT_AUTHORIZED);
             return false;
         }
 
         if (destination->getAccount().accountType == ACCOUNT_SCRATCH_CARD && !mIsCreate)
         {
-            app.getMetrics().NewMeter({ "op-path-payment", "failure", "destination-scratch-card" },
-                                      "operation").Mark();
+            app.getOperationMetrics().mark(
+                pathPaymentFailureDestinationScratchCard);
             innerResult().code(PATH_PAYMENT_NO_DESTINATION);
             return false;
         }
 
         if (!destLine->addBalance(curBReceived))
         {
-            app.getMetrics().NewMeter({"op-path-payment", "failure", "line-full"},
-                             "operation").Mark();
+            app.getOperationMetrics().mark(pathPaymentFailureLineFull);
             innerResult().code(PATH_PAYMENT_LINE_FULL);
             return false;
         }
@@ -244,20 +285,20 @@ PathPaymentOpFrame::doApply(Application& app,
 		TrustFrame::pointer commissionDestLine = getCommissionDest(ledgerManager, delta, db, commissionDestination, curB);
 
 		if (!commissionDestLine) {
-			app.getMetrics().NewMeter({ "op-path-payment", "failure", "comission-dest-low-reserve" },
-				"operation").Mark();
+			app.getOperationMetrics().mark(
+				pathPaymentFailureComissionDestLowReserve);
 			innerResult().code(PATH_PAYMENT_NO_DESTINATION);
 			return false;
 		}
 
         if (!commissionDestLine->addBalance(curBCommission)){
-            app.getMetrics().NewMeter({"op-path-payment", "failure", "commission-line-full"},
-                                      "operation").Mark();
+            app.getOperationMetrics().mark(
+                pathPaymentFailureCommissionLineFull);
             innerResult().code(PATH_PAYMENT_LINE_FULL);
             return false;
         }
 
-        commissionDestLine->storeChange(delta, db);
+        delta.storeCommission(*commissionDestLine, db);
         destLine->storeChange(delta, db);
     }
 
@@ -281,8 +322,7 @@ PathPaymentOpFrame::doApply(Application& app,
         {
             if (!AccountFrame::loadAccount(delta, getIssuer(curA), db))
             {
-                app.getMetrics().NewMeter({"op-path-payment", "failure", "no-issuer"},
-                                 "operation").Mark();
+                app.getOperationMetrics().mark(pathPaymentFailureNoIssuer);
                 innerResult().code(PATH_PAYMENT_NO_ISSUER);
                 innerResult().noIssuer() = curA;
                 return false;
@@ -292,7 +332,7 @@ PathPaymentOpFrame::doApply(Application& app,
         OfferExchange oe(delta, ledgerManager);
 
         // curA -> curB
-        medida::MetricsRegistry& metrics = app.getMetrics();
+        OperationMetrics& metrics = app.getOperationMetrics();
         OfferExchange::ConvertResult r = oe.convertWithOffers(
             curA, INT64_MAX, curASent, curB, curBNeedToSend, actualCurBReceived,
             [this, &metrics](OfferFrame const& o)
@@ -301,9 +341,7 @@ PathPaymentOpFrame::doApply(Application& app,
                 {
                     // we are crossing our own offer, potentially invalidating
                     // mSourceAccount (balance or numSubEntries)
-                    metrics.NewMeter({"op-path-payment", "failure",
-                                      "offer-cross-self"},
-                                     "operation").Mark();
+                    metrics.mark(pathPaymentFailureOfferCrossSelf);
                     innerResult().code(PATH_PAYMENT_OFFER_CROSS_SELF);
                     return OfferExchange::eStop;
                 }
@@ -320,8 +358,7 @@ PathPaymentOpFrame::doApply(Application& app,
             }
         // fall through
         case OfferExchange::ePartial:
-            app.getMetrics().NewMeter({"op-path-payment", "failure", "too-few-offers"},
-                             "operation").Mark();
+            app.getOperationMetrics().mark(pathPaymentFailureTooFewOffers);
             innerResult().code(PATH_PAYMENT_TOO_FEW_OFFERS);
             return false;
         }
@@ -345,8 +382,7 @@ PathPaymentOpFrame::doApply(Application& app,
 
     if (curBSent > mPathPayment.sendMax)
     { // make sure not over the max
-        app.getMetrics().NewMeter({"op-path-payment", "failure", "over-send-max"},
-                         "operation").Mark();
+        app.getOperationMetrics().mark(pathPaymentFailureOverSendMax);
         innerResult().code(PATH_PAYMENT_OVER_SENDMAX);
         return false;
     }
@@ -357,8 +393,7 @@ PathPaymentOpFrame::doApply(Application& app,
 
         if ((mSourceAccount->getAccount().balance - curBSent) < minBalance)
         { // they don't have enough to send
-            app.getMetrics().NewMeter({"op-path-payment", "failure", "underfunded"},
-                             "operation").Mark();
+            app.getOperationMetrics().mark(pathPaymentFailureUnderfunded);
             innerResult().code(PATH_PAYMENT_UNDERFUNDED);
             return false;
         }
@@ -373,8 +408,7 @@ PathPaymentOpFrame::doApply(Application& app,
         TrustFrame::loadTrustLineIssuer(getSourceID(), curB, db, delta);
         if (!tlI.second)
         {
-            app.getMetrics().NewMeter({"op-path-payment", "failure", "no-issuer"},
-                                      "operation").Mark();
+            app.getOperationMetrics().mark(pathPaymentFailureNoIssuer);
             innerResult().code(PATH_PAYMENT_NO_ISSUER);
             innerResult().noIssuer() = curB;
             return false;
@@ -396,25 +430,21 @@ PathPaymentOpFrame::doApply(Application& app,
 
         if (!sourceLineFrame)
         {
-            app.getMetrics().NewMeter({"op-path-payment", "failure", "src-no-trust"},
-                             "operation").Mark();
+            app.getOperationMetrics().mark(pathPaymentFailureSrcNoTrust);
             innerResult().code(PATH_PAYMENT_SRC_NO_TRUST);
             return false;
         }
 
         if (!sourceLineFrame->isAuthorized())
         {
-            app.getMetrics().NewMeter(
-                        {"op-path-payment", "failure", "src-not-authorized"},
-                        "operation").Mark();
+            app.getOperationMetrics().mark(pathPaymentFailureSrcNotAuthorized);
             innerResult().code(PATH_PAYMENT_SRC_NOT_AUTHORIZED);
             return false;
         }
 
         if (!sourceLineFrame->addBalance(-curBSent))
         {
-            app.getMetrics().NewMeter({"op-path-payment", "failure", "underfunded"},
-                             "operation").Mark();
+            app.getOperationMetrics().mark(pathPaymentFailureUnderfunded);
             innerResult().code(PATH_PAYMENT_UNDERFUNDED);
             return false;
         }
@@ -422,8 +452,7 @@ PathPaymentOpFrame::doApply(Application& app,
         sourceLineFrame->storeChange(delta, db);
     }
 
-    app.getMetrics().NewMeter({"op-path-payment", "success", "apply"}, "operation")
-        .Mark();
+    app.getOperationMetrics().mark(pathPaymentSuccessApply);
 
     return true;
 }
@@ -437,15 +466,13 @@ PathPaymentOpFrame::doCheckValid(Application& app)
 	if (mFee->type() != OperationFeeType::opFEE_NONE) {
 
 		if (!(mFee->fee().asset == mPathPayment.destAsset)) {
-			app.getMetrics().NewMeter({ "op-path-payment", "failure", "fee-invalid-asset" },
-				"operation").Mark();
+			app.getOperationMetrics().mark(pathPaymentFailureFeeInvalidAsset);
 			innerResult().code(PATH_PAYMENT_MALFORMED);
 			return false;
 		}
 
 		if (mFee->fee().amountToCharge < 0) {
-			app.getMetrics().NewMeter({ "op-path-payment", "failure", "fee-invalid-amount" },
-				"operation").Mark();
+			app.getOperationMetrics().mark(pathPaymentFailureFeeInvalidAmount);
 			innerResult().code(PATH_PAYMENT_MALFORMED);
 			return false;
 		}
@@ -454,8 +481,7 @@ PathPaymentOpFrame::doCheckValid(Application& app)
 	}
     if (mPathPayment.destAmount - commission <= 0 || mPathPayment.sendMax <= 0)
     {
-        app.getMetrics().NewMeter({"op-path-payment", "invalid", "malformed-amounts"},
-                         "operation").Mark();
+        app.getOperationMetrics().mark(pathPaymentInvalidMalformedAmounts);
         innerResult().code(PATH_PAYMENT_MALFORMED);
         return false;
     }
@@ -464,16 +490,14 @@ PathPaymentOpFrame::doCheckValid(Application& app)
     if (!isAssetValid(issuer, mPathPayment.sendAsset) ||
         !isAssetValid(issuer, mPathPayment.destAsset))
     {
-        app.getMetrics().NewMeter({"op-path-payment", "invalid", "malformed-currencies"},
-                         "operation").Mark();
+        app.getOperationMetrics().mark(pathPaymentInvalidMalformedCurrencies);
         innerResult().code(PATH_PAYMENT_MALFORMED);
         return false;
     }
     auto const& p = mPathPayment.path;
 	if (!std::all_of(p.begin(), p.end(), [issuer](Asset asset) {return isAssetValid(issuer, asset);}))
     {
-        app.getMetrics().NewMeter({"op-path-payment", "invalid", "malformed-currencies"},
-                         "operation").Mark();
+        app.getOperationMetrics().mark(pathPaymentInvalidMalformedCurrencies);
         innerResult().code(PATH_PAYMENT_MALFORMED);
         return false;
     }
@@ -11,9 +11,8 @@
 #include "ledger/OfferFrame.h"
 #include "database/Database.h"
 #include "OfferExchange.h"
-#include "medida/meter.h"
-#include "medida/metrics_registry.h"
 #include "main/Application.h"
+#include "transactions/OperationMetrics.h"
 #include <algorithm>
 
 namespace stellar
@@ -22,6 +21,34 @@ namespace stellar
 using namespace std;
 using xdr::operator==;
 
+namespace
+{
+OperationMeter const paymentSuccessApply("op-payment", "success", "apply");
+OperationMeter const
+    paymentFailureUnderfunded("op-payment", "failure", "underfunded");
+OperationMeter const paymentFailureSrcNotAuthorized(
+    "op-payment", "failure", "src-not-authorized");
+OperationMeter const
+    paymentFailureSrcNoTrust("op-payment", "failure", "src-no-trust");
+OperationMeter const
+    paymentFailureNoDestination("op-payment", "failure", "no-destination");
+OperationMeter const paymentFailureNoTrust("op-payment", "failure", "no-trust");
+OperationMeter const
+    paymentFailureNotAuthorized("op-payment", "failure", "not-authorized");
+OperationMeter const
+    paymentFailureLineFull("op-payment", "failure", "line-full");
+OperationMeter const
+    paymentFailureNoIssuer("op-payment", "failure", "no-issuer");
+OperationMeter const
+    paymentFailureFeeInvalidAsset("op-payment", "failure", "fee-invalid-asset");
+OperationMeter const paymentFailureFeeInvalidAmount(
+    "op-payment", "failure", "fee-invalid-amount");
+OperationMeter const paymentInvalidMalformedNegativeAmount(
+    "op-payment", "invalid", "malformed-negative-amount");
+OperationMeter const paymentInvalidMalformedInvalidAsset(
+    "op-payment", "invalid", "malformed-invalid-asset");
+}
+
 PaymentOpFrame::PaymentOpFrame(Operation const& op, OperationResult& res, OperationFee* fee,
                                TransactionFrame& parentTx)
     : OperationFrame(op, res, fee, parentTx), mPayment(mOperation.body.paymentOp())
@@ -35,8 +62,7 @@ PaymentOpFrame::doApply(Application& app, LedgerDelta& delta,
     // if sending to self directly, just mark as success
     if (mPayment.destination == getSourceID())
     {
-        app.getMetrics().NewMeter({"op-payment", "success", "apply"}, "operation")
-            .Mark();
+        app.getOperationMetrics().mark(paymentSuccessApply);
         innerResult().code(PAYMENT_SUCCESS);
         return true;
     }
@@ -72,43 +98,35 @@ PaymentOpFrame::doApply(Application& app, LedgerDelta& delta,
         switch (PathPaymentOpFrame::getInnerCode(ppayment.getResult()))
         {
         case PATH_PAYMENT_UNDERFUNDED:
-            app.getMetrics().NewMeter({"op-payment", "failure", "underfunded"},
-                             "operation").Mark();
+            app.getOperationMetrics().mark(paymentFailureUnderfunded);
             res = PAYMENT_UNDERFUNDED;
             break;
         case PATH_PAYMENT_SRC_NOT_AUTHORIZED:
-            app.getMetrics().NewMeter({"op-payment", "failure", "src-not-authorized"},
-                             "operation").Mark();
+            app.getOperationMetrics().mark(paymentFailureSrcNotAuthorized);
             res = PAYMENT_SRC_NOT_AUTHORIZED;
             break;
         case PATH_PAYMENT_SRC_NO_TRUST:
-            app.getMetrics().NewMeter({"op-payment", "failure", "src-no-trust"},
-                             "operation").Mark();
+            app.getOperationMetrics().mark(paymentFailureSrcNoTrust);
             res = PAYMENT_SRC_NO_TRUST;
             break;
         case PATH_PAYMENT_NO_DESTINATION:
-            app.getMetrics().NewMeter({"op-payment", "failure", "no-destination"},
-                             "operation").Mark();
+            app.getOperationMetrics().mark(paymentFailureNoDestination);
             res = PAYMENT_NO_DESTINATION;
             break;
         case PATH_PAYMENT_NO_TRUST:
-            app.getMetrics().NewMeter({"op-payment", "failure", "no-trust"}, "operation")
-                .Mark();
+            app.getOperationMetrics().mark(paymentFailureNoTrust);
             res = PAYMENT_NO_TRUST;
             break;
         case PATH_PAYMENT_NOT_AUTHORIZED:
-            app.getMetrics().NewMeter({"op-payment", "failure", "not-authorized"},
-                             "operation").Mark();
+            app.getOperationMetrics().mark(paymentFailureNotAuthorized);
             res = PAYMENT_NOT_AUTHORIZED;
             break;
         case PATH_PAYMENT_LINE_FULL:
-            app.getMetrics().NewMeter({"op-payment", "failure", "line-full"},
-                             "operation").Mark();
+            app.getOperationMetrics().mark(paymentFailureLineFull);
             res = PAYMENT_LINE_FULL;
             break;
         case PATH_PAYMENT_NO_ISSUER:
-            app.getMetrics().NewMeter({"op-payment", "failure", "no-issuer"},
-                             "operation").Mark();
+            app.getOperationMetrics().mark(paymentFailureNoIssuer);
             res = PAYMENT_NO_ISSUER;
             break;
         default:
@@ -121,7 +139,7 @@ PaymentOpFrame::doApply(Application& app, LedgerDelta& delta,
     assert(PathPaymentOpFrame::getInnerCode(ppayment.getResult()) ==
            PATH_PAYMENT_SUCCESS);
 
-    app.getMetrics().NewMeter({"op-payment", "success", "apply"}, "operation").Mark();
+    app.getOperationMetrics().mark(paymentSuccessApply);
     innerResult().code(PAYMENT_SUCCESS);
 
     return true;
@@ -136,15 +154,13 @@ PaymentOpFrame::doCheckValid(Application& app)
 	if (mFee->type() != OperationFeeType::opFEE_NONE) {
 
 		if (!(mFee->fee().asset == mPayment.asset)) {
-			app.getMetrics().NewMeter({ "op-payment", "failure", "fee-invalid-asset" },
-				"operation").Mark();
+			app.getOperationMetrics().mark(paymentFailureFeeInvalidAsset);
 			innerResult().code(PAYMENT_MALFORMED);
 			return false;
 		}
 
 		if (mFee->fee().amountToCharge < 0) {
-			app.getMetrics().NewMeter({ "op-payment", "failure", "fee-invalid-amount" },
-				"operation").Mark();
+			app.getOperationMetrics().mark(paymentFailureFeeInvalidAmount);
 			innerResult().code(PAYMENT_MALFORMED);
 			return false;
 		}
@@ -154,15 +170,13 @@ PaymentOpFrame::doCheckValid(Application& app)
 
     if (mPayment.amount - commission <= 0)
     {
-        app.getMetrics().NewMeter({"op-payment", "invalid", "malformed-negative-amount"},
-                         "operation").Mark();
+        app.getOperationMetrics().mark(paymentInvalidMalformedNegativeAmount);
         innerResult().code(PAYMENT_MALFORMED);
         return false;
     }
     if (!isAssetValid(app.getIssuer(), mPayment.asset))
     {
-        app.getMetrics().NewMeter({"op-payment", "invalid", "malformed-invalid-asset"},
-                         "operation").Mark();
+        app.getOperationMetrics().mark(paymentInvalidMalformedInvalidAsset);
         innerResult().code(PAYMENT_MALFORMED);
         return false;
     }
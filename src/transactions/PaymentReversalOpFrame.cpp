@@ -9,9 +9,8 @@
 #include "ledger/TrustFrame.h"
 #include "ledger/ReversedPaymentFrame.h"
 #include "database/Database.h"
-#include "medida/meter.h"
-#include "medida/metrics_registry.h"
 #include "main/Application.h"
+#include "transactions/OperationMetrics.h"
 #include <algorithm>
 
 namespace stellar
@@ -20,6 +19,38 @@ namespace stellar
 using namespace std;
 using xdr::operator==;
 
+namespace
+{
+OperationMeter const reversalPaymentFailureNotAllowed(
+    "op-reversal-payment", "failure", "not-allowed");
+OperationMeter const reversalPaymentFailureAlreadyReversed(
+    "op-reversal-payment", "failure", "already-reversed");
+OperationMeter const reversalPaymentFailureComissionDestLowReserve(
+    "op-reversal-payment", "failure", "comission-dest-low-reserve");
+OperationMeter const reversalPaymentFailureNoIssuer(
+    "op-reversal-payment", "failure", "no-issuer");
+OperationMeter const reversalPaymentFailureSrcNoTrust(
+    "op-reversal-payment", "failure", "src-no-trust");
+OperationMeter const reversalPaymentFailureSrcNotAuthorized(
+    "op-reversal-payment", "failure", "src-not-authorized");
+OperationMeter const reversalPaymentFailureUnderfunded(
+    "op-reversal-payment", "failure", "underfunded");
+OperationMeter const reversalPaymentFailureNoPaymentSender(
+    "op-reversal-payment", "failure", "no-payment-sender");
+OperationMeter const reversalPaymentFailureNoPaymentSenderTrust(
+    "op-reversal-payment", "failure", "no-payment-sender-trust");
+OperationMeter const reversalPaymentFailurePaymentSenderNotAuthorized(
+    "op-reversal-payment", "failure", "payment-sender-not-authorized");
+OperationMeter const reversalPaymentFailurePaymentSenderLineFull(
+    "op-reversal-payment", "failure", "payment-sender-line-full");
+OperationMeter const reversalPaymentInvalidMalformedAmount(
+    "op-reversal-payment", "invalid", "malformed-amount");
+OperationMeter const reversalPaymentInvalidMalformedNegativeCommission(
+    "op-reversal-payment", "invalid", "malformed-negative-commission");
+OperationMeter const reversalPaymentInvalidMalformedInvalidAsset(
+    "op-reversal-payment", "invalid", "malformed-invalid-asset");
+}
+
 PaymentReversalOpFrame::PaymentReversalOpFrame(Operation const& op, OperationResult& res, OperationFee* fee,
                                TransactionFrame& parentTx)
     : OperationFrame(op, res, fee, parentTx), mPaymentReversal(mOperation.body.paymentReversalOp())
@@ -51,8 +82,7 @@ PaymentReversalOpFrame::doApply(Application& app, LedgerDelta& delta,
                         LedgerManager& ledgerManager)
 {
 	if (!checkAllowed()) {
-		app.getMetrics().NewMeter({ "op-reversal-payment", "failure", "not-allowed" },
-			"operation").Mark();
+		app.getOperationMetrics().mark(reversalPaymentFailureNotAllowed);
 		innerResult().code(PAYMENT_REVERSAL_NOT_ALLOWED);
 		return false;
 	}
@@ -60,8 +90,7 @@ PaymentReversalOpFrame::doApply(Application& app, LedgerDelta& delta,
 	Database& db = ledgerManager.getDatabase();
 
 	if (!checkAlreadyReversed(delta, db)) {
-		app.getMetrics().NewMeter({ "op-reversal-payment", "failure", "already-reversed" },
-			"operation").Mark();
+		app.getOperationMetrics().mark(reversalPaymentFailureAlreadyReversed);
 		innerResult().code(PAYMENT_REVERSAL_ALREADY_REVERSED);
 		return false;
 	}
@@ -70,8 +99,8 @@ PaymentReversalOpFrame::doApply(Application& app, LedgerDelta& delta,
 
 	auto commissionDestLine = TrustFrame::loadTrustLine(app.getConfig().BANK_COMMISSION_KEY, mPaymentReversal.asset, db, &delta);
 	if (!commissionDestLine || !commissionDestLine->addBalance(-mPaymentReversal.commissionAmount)) {
-		app.getMetrics().NewMeter({ "op-reversal-payment", "failure", "comission-dest-low-reserve" },
-			"operation").Mark();
+		app.getOperationMetrics().mark(
+			reversalPaymentFailureComissionDestLowReserve);
 		innerResult().code(PAYMENT_REVERSAL_COMMISSION_UNDERFUNDED);
 		return false;
 	}
@@ -83,8 +112,7 @@ PaymentReversalOpFrame::doApply(Application& app, LedgerDelta& delta,
 	auto issuerTrustLine = TrustFrame::loadTrustLineIssuer(getSourceID(), mPaymentReversal.asset, db, delta);
 	if (!issuerTrustLine.second)
 	{
-		app.getMetrics().NewMeter({ "op-reversal-payment", "failure", "no-issuer" },
-			"operation").Mark();
+		app.getOperationMetrics().mark(reversalPaymentFailureNoIssuer);
 		innerResult().code(PAYMENT_REVERSAL_NO_ISSUER);
 		return false;
 	}
@@ -106,17 +134,14 @@ PaymentReversalOpFrame::doApply(Application& app, LedgerDelta& delta,
 
 	if (!sourceLineExists)
 	{
-		app.getMetrics().NewMeter({ "op-reversal-payment", "failure", "src-no-trust" },
-			"operation").Mark();
+		app.getOperationMetrics().mark(reversalPaymentFailureSrcNoTrust);
 		innerResult().code(PAYMENT_REVERSAL_SRC_NO_TRUST);
 		return false;
 	}
 
 	if (!sourceLineFrame->isAuthorized())
 	{
-		app.getMetrics().NewMeter(
-		{ "op-reversal-payment", "failure", "src-not-authorized" },
-			"operation").Mark();
+		app.getOperationMetrics().mark(reversalPaymentFailureSrcNotAuthorized);
 		innerResult().code(PAYMENT_REVERSAL_SRC_NOT_AUTHORIZED);
 		return false;
 	}
@@ -125,8 +150,7 @@ PaymentReversalOpFrame::doApply(Application& app, LedgerDelta& delta,
 
 	if (!sourceLineFrame->addBalance(-sourceRecieved))
 	{
-		app.getMetrics().NewMeter({ "op-reversal-payment", "failure", "underfunded" },
-			"operation").Mark();
+		app.getOperationMetrics().mark(reversalPaymentFailureUnderfunded);
 		innerResult().code(PAYMENT_REVERSAL_UNDERFUNDED);
 		return false;
 	}
@@ -139,8 +163,7 @@ PaymentReversalOpFrame::doApply(Application& app, LedgerDelta& delta,
 	auto tlI = TrustFrame::loadTrustLineIssuer(mPaymentReversal.paymentSource, mPaymentReversal.asset, db, delta);
 	if (!tlI.second)
 	{
-		app.getMetrics().NewMeter({ "op-reversal-payment", "failure", "no-issuer" },
-			"operation").Mark();
+		app.getOperationMetrics().mark(reversalPaymentFailureNoIssuer);
 		innerResult().code(PAYMENT_REVERSAL_NO_ISSUER);
 		return false;
 	}
@@ -151,8 +174,8 @@ PaymentReversalOpFrame::doApply(Application& app, LedgerDelta& delta,
 	{
 		auto destination = AccountFrame::loadAccount(delta, mPaymentReversal.paymentSource, db);
 		if (!destination) {
-			app.getMetrics().NewMeter({ "op-reversal-payment", "failure", "no-payment-sender" },
-				"operation").Mark();
+			app.getOperationMetrics().mark(
+				reversalPaymentFailureNoPaymentSender);
 			innerResult().code(PAYMENT_REVERSAL_NO_PAYMENT_SENDER);
 			return false;
 		}
@@ -162,23 +185,24 @@ PaymentReversalOpFrame::doApply(Application& app, LedgerDelta& delta,
 
 	if (!destLine)
 	{
-		app.getMetrics().NewMeter({ "op-reversal-payment", "failure", "no-payment-sender-trust" }, "operation").Mark();
+		app.getOperationMetrics().mark(
+			reversalPaymentFailureNoPaymentSenderTrust);
 		innerResult().code(PAYMENT_REVERSAL_NO_PAYMENT_SENDER_TRUST);
 		return false;
 	}
 
 	if (!destLine->isAuthorized())
 	{
-		app.getMetrics().NewMeter({ "op-reversal-payment", "failure", "payment-sender-not-authorized" },
-			"operation").Mark();
+		app.getOperationMetrics().mark(
+			reversalPaymentFailurePaymentSenderNotAuthorized);
 		innerResult().code(PAYMENT_REVERSAL_PAYMENT_SENDER_NOT_AUTHORIZED);
 		return false;
 	}
 
 	if (!destLine->addBalance(mPaymentReversal.amount))
 	{
-		app.getMetrics().NewMeter({ "op-reversal-payment", "failure", "payment-sender-line-full" },
-			"operation").Mark();
+		app.getOperationMetrics().mark(
+			reversalPaymentFailurePaymentSenderLineFull);
 		innerResult().code(PAYMENT_REVERSAL_PAYMENT_SENDER_LINE_FULL);
 		return false;
 	}
@@ -194,24 +218,23 @@ PaymentReversalOpFrame::doCheckValid(Application& app)
 {
     if (mPaymentReversal.amount <= 0)
     {
-        app.getMetrics().NewMeter({"op-reversal-payment", "invalid", "malformed-amount"},
-                         "operation").Mark();
+        app.getOperationMetrics().mark(reversalPaymentInvalidMalformedAmount);
         innerResult().code(PAYMENT_REVERSAL_MALFORMED);
         return false;
     }
     
 	if (mPaymentReversal.commissionAmount < 0)
 	{
-		app.getMetrics().NewMeter({ "op-reversal-payment", "invalid", "malformed-negative-commission" },
-			"operation").Mark();
+		app.getOperationMetrics().mark(
+			reversalPaymentInvalidMalformedNegativeCommission);
 		innerResult().code(PAYMENT_REVERSAL_MALFORMED);
 		return false;
 	}
 
 	if (!isAssetValid(app.getIssuer(), mPaymentReversal.asset) || mPaymentReversal.asset.type() == ASSET_TYPE_NATIVE)
 	{
-		app.getMetrics().NewMeter({ "op-reversal-payment", "invalid", "malformed-invalid-asset" },
-			"operation").Mark();
+		app.getOperationMetrics().mark(
+			reversalPaymentInvalidMalformedInvalidAsset);
 		innerResult().code(PAYMENT_REVERSAL_MALFORMED);
 		return false;
 	}
@@ -16,9 +16,13 @@
 #include "transactions/PaymentOpFrame.h"
 #include "transactions/ChangeTrustOpFrame.h"
 #include "crypto/SHA.h"
+#include "herder/TxSetFrame.h"
+#include "medida/meter.h"
+#include "medida/metrics_registry.h"
 
 using namespace stellar;
 using namespace stellar::txtest;
+using xdr::operator==;
 
 typedef std::unique_ptr<Application> appPtr;
 
@@ -119,6 +123,18 @@ TEST_CASE("payment", "[tx][payment]")
             line = loadTrustLine(root, idrCur, app);
             REQUIRE(line->getBalance() == -paymentAmount);
             
+        }
+
+        SECTION("metrics")
+        {
+            // operation meters are resolved when the application is created,
+            // under the names they are reported with
+            auto& success = app.getMetrics().NewMeter(
+                {"op-payment", "success", "apply"}, "operation");
+            auto count = success.count();
+            applyCreditPaymentTx(app, root, a1, idrCur, rootSeq++,
+                                 paymentAmount, &sk);
+            REQUIRE(success.count() == count + 1);
         }
         
 		auto b1Seq = getAccountSeqNum(b1, app) + 1;
@@ -623,6 +639,122 @@ TEST_CASE("payment", "[tx][payment]")
 	}
 }
 
+TEST_CASE("deferred commission", "[tx][payment][commission]")
+{
+    Config cfg = getTestConfig();
+    auto commissionSeed = SecretKey::fromSeed(sha256("(V)(^,,,^)(V)"));
+    cfg.BANK_COMMISSION_KEY = commissionSeed.getPublicKey();
+
+    VirtualClock clock;
+    Application::pointer appPtr = Application::create(clock, cfg);
+    Application& app = *appPtr;
+    app.start();
+
+    SecretKey root = getRoot(app.getNetworkID());
+    SecretKey a1 = getAccount("A");
+    SecretKey b1 = getAccount("B");
+    SecretKey sk = getAccount("admin_signer");
+
+    auto signer = Signer(sk.getPublicKey(), 100, SIGNER_ADMIN);
+    SequenceNumber rootSeq = getAccountSeqNum(root, app) + 1;
+    applySetOptions(app, root, rootSeq++, nullptr, nullptr, nullptr, nullptr,
+                    &signer, nullptr);
+    applyCreateAccountTx(app, root, a1, rootSeq++, 0, &sk);
+    applyCreateAccountTx(app, root, b1, rootSeq++, 0, &sk);
+    SequenceNumber a1Seq = getAccountSeqNum(a1, app) + 1;
+    SequenceNumber b1Seq = getAccountSeqNum(b1, app) + 1;
+
+    Asset usdCur = makeAsset(root, "USD");
+    applyChangeTrust(app, a1, root, a1Seq++, "USD", INT64_MAX);
+    applyChangeTrust(app, b1, root, b1Seq++, "USD", INT64_MAX);
+
+    const int64_t paymentAmount = 100;
+    const int nbPayments = 3;
+    applyCreditPaymentTx(app, root, a1, usdCur, rootSeq++,
+                         paymentAmount * nbPayments, &sk);
+
+    OperationFee fee;
+    fee.type(OperationFeeType::opFEE_CHARGED);
+    fee.fee().amountToCharge = paymentAmount / 10;
+    fee.fee().asset = usdCur;
+
+    auto txSet = std::make_shared<TxSetFrame>(
+        app.getLedgerManager().getLastClosedLedgerHeader().hash);
+    for (int i = 0; i < nbPayments; i++)
+    {
+        txSet->add(createCreditPaymentTx(app.getNetworkID(), a1, b1, usdCur,
+                                         a1Seq++, paymentAmount, &fee));
+    }
+    txSet->sortForHash();
+
+    uint32 ledgerSeq = app.getLedgerManager().getLedgerNum();
+    auto r = closeLedgerOn(app, ledgerSeq, 1, 1, 2017, txSet);
+    REQUIRE(r.size() == nbPayments);
+    for (auto const& res : r)
+    {
+        REQUIRE(res.first.result.result.code() == txSUCCESS);
+    }
+
+    auto commissionLine = loadTrustLine(commissionSeed, usdCur, app);
+    REQUIRE(commissionLine->getBalance() ==
+            nbPayments * fee.fee().amountToCharge);
+    REQUIRE(commissionLine->getLastModified() == ledgerSeq);
+    auto b1Line = loadTrustLine(b1, usdCur, app);
+    REQUIRE(b1Line->getBalance() ==
+            nbPayments * (paymentAmount - fee.fee().amountToCharge));
+
+    // each payment loads the commission line with the commission credited
+    // so far, still pending in the entry cache, and its meta shows it
+    auto& db = app.getDatabase();
+    BinaryColumn meta(db, db.getSession());
+    std::vector<uint8_t> raw;
+    auto prep = db.getPreparedStatement(
+        "SELECT txmeta FROM txhistory "
+        "WHERE ledgerseq = :lseq ORDER BY txindex ASC");
+    auto& st = prep.statement();
+    st.exchange(meta.into());
+    st.exchange(soci::use(ledgerSeq));
+    st.define_and_bind();
+    st.execute(true);
+
+    int64_t expected = 0;
+    while (st.got_data())
+    {
+        meta.get(raw);
+        TransactionMeta tm;
+        xdr::xdr_from_opaque(raw, tm);
+
+        expected += fee.fee().amountToCharge;
+        int found = 0;
+        for (auto const& op : tm.operations())
+        {
+            for (auto const& change : op.changes)
+            {
+                // the first payment creates the line
+                LedgerEntry const* entry = nullptr;
+                if (change.type() == LEDGER_ENTRY_CREATED)
+                {
+                    entry = &change.created();
+                }
+                else if (change.type() == LEDGER_ENTRY_UPDATED)
+                {
+                    entry = &change.updated();
+                }
+                if (entry && entry->data.type() == TRUSTLINE &&
+                    entry->data.trustLine().accountID ==
+                        commissionSeed.getPublicKey())
+                {
+                    REQUIRE(entry->data.trustLine().balance == expected);
+                    found++;
+                }
+            }
+        }
+        REQUIRE(found == 1);
+        st.fetch();
+    }
+    REQUIRE(expected == nbPayments * fee.fee().amountToCharge);
+}
+
 TEST_CASE("single create account SQL", "[singlesql][paymentsql][hide]")
 {
     Config::TestDbMode mode = Config::TESTDB_ON_DISK_SQLITE;
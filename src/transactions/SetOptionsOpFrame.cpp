@@ -5,13 +5,36 @@
 #include "transactions/SetOptionsOpFrame.h"
 #include "database/Database.h"
 #include "main/Application.h"
-#include "medida/meter.h"
-#include "medida/metrics_registry.h"
+#include "transactions/OperationMetrics.h"
 
 namespace stellar
 {
 using xdr::operator==;
 
+namespace
+{
+OperationMeter const setOptionsFailureInvalidInflation(
+    "op-set-options", "failure", "invalid-inflation");
+OperationMeter const
+    setOptionsFailureCantChange("op-set-options", "failure", "cant-change");
+OperationMeter const setOptionsInvalidBadSignerType(
+    "op-set-options", "invalid", "bad-signer-type");
+OperationMeter const setOptionsFailureTooManySigners(
+    "op-set-options", "failure", "too-many-signers");
+OperationMeter const
+    setOptionsFailureLowReserve("op-set-options", "failure", "low-reserve");
+OperationMeter const
+    setOptionsSuccessApply("op-set-options", "success", "apply");
+OperationMeter const
+    setOptionsInvalidBadFlags("op-set-options", "invalid", "bad-flags");
+OperationMeter const setOptionsInvalidThresholdOutOfRange(
+    "op-set-options", "invalid", "threshold-out-of-range");
+OperationMeter const
+    setOptionsInvalidBadSigner("op-set-options", "invalid", "bad-signer");
+OperationMeter const setOptionsInvalidInvalidHomeDomain(
+    "op-set-options", "invalid", "invalid-home-domain");
+}
+
 static const uint32 allAccountFlags =
     (AUTH_REQUIRED_FLAG | AUTH_REVOCABLE_FLAG | AUTH_IMMUTABLE_FLAG);
 static const uint32 allAccountAuthFlags =
@@ -50,8 +73,7 @@ SetOptionsOpFrame::doApply(Application& app, LedgerDelta& delta,
         inflationAccount = AccountFrame::loadAccount(delta, inflationID, db);
         if (!inflationAccount)
         {
-            app.getMetrics().NewMeter({"op-set-options", "failure", "invalid-inflation"},
-                             "operation").Mark();
+            app.getOperationMetrics().mark(setOptionsFailureInvalidInflation);
             innerResult().code(SET_OPTIONS_INVALID_INFLATION);
             return false;
         }
@@ -63,8 +85,7 @@ SetOptionsOpFrame::doApply(Application& app, LedgerDelta& delta,
         if ((*mSetOptions.clearFlags & allAccountAuthFlags) &&
             mSourceAccount->isImmutableAuth())
         {
-            app.getMetrics().NewMeter({"op-set-options", "failure", "cant-change"},
-                             "operation").Mark();
+            app.getOperationMetrics().mark(setOptionsFailureCantChange);
             innerResult().code(SET_OPTIONS_CANT_CHANGE);
             return false;
         }
@@ -76,8 +97,7 @@ SetOptionsOpFrame::doApply(Application& app, LedgerDelta& delta,
         if ((*mSetOptions.setFlags & allAccountAuthFlags) &&
             mSourceAccount->isImmutableAuth())
         {
-            app.getMetrics().NewMeter({"op-set-options", "failure", "cant-change"},
-                             "operation").Mark();
+            app.getOperationMetrics().mark(setOptionsFailureCantChange);
             innerResult().code(SET_OPTIONS_CANT_CHANGE);
             return false;
         }
@@ -140,8 +160,7 @@ SetOptionsOpFrame::doApply(Application& app, LedgerDelta& delta,
 			}
 		}
 		default:
-			app.getMetrics().NewMeter({ "op-set-options", "invalid", "bad-signer-type" },
-				"operation").Mark();
+			app.getOperationMetrics().mark(setOptionsInvalidBadSignerType);
 			innerResult().code(SET_OPTIONS_BAD_SIGNER_TYPE);
 			return false;
 		}
@@ -162,17 +181,14 @@ SetOptionsOpFrame::doApply(Application& app, LedgerDelta& delta,
             {
                 if (signers.size() == signers.max_size())
                 {
-                    app.getMetrics().NewMeter({"op-set-options", "failure",
-                                      "too-many-signers"},
-                                     "operation").Mark();
+                    app.getOperationMetrics().mark(
+                        setOptionsFailureTooManySigners);
                     innerResult().code(SET_OPTIONS_TOO_MANY_SIGNERS);
                     return false;
                 }
                 if (!mSourceAccount->addNumEntries(1, ledgerManager))
                 {
-                    app.getMetrics().NewMeter(
-                                {"op-set-options", "failure", "low-reserve"},
-                                "operation").Mark();
+                    app.getOperationMetrics().mark(setOptionsFailureLowReserve);
                     innerResult().code(SET_OPTIONS_LOW_RESERVE);
                     return false;
                 }
@@ -199,8 +215,7 @@ SetOptionsOpFrame::doApply(Application& app, LedgerDelta& delta,
         mSourceAccount->setUpdateSigners();
     }
 
-    app.getMetrics().NewMeter({"op-set-options", "success", "apply"}, "operation")
-        .Mark();
+    app.getOperationMetrics().mark(setOptionsSuccessApply);
     innerResult().code(SET_OPTIONS_SUCCESS);
     mSourceAccount->storeChange(delta, db);
     return true;
@@ -231,8 +246,7 @@ SetOptionsOpFrame::doCheckValid(Application& app)
     {
         if ((*mSetOptions.setFlags & *mSetOptions.clearFlags) != 0)
         {
-            app.getMetrics().NewMeter({"op-set-options", "invalid", "bad-flags"},
-                             "operation").Mark();
+            app.getOperationMetrics().mark(setOptionsInvalidBadFlags);
             innerResult().code(SET_OPTIONS_BAD_FLAGS);
             return false;
         }
@@ -242,9 +256,8 @@ SetOptionsOpFrame::doCheckValid(Application& app)
     {
         if (*mSetOptions.masterWeight > UINT8_MAX)
         {
-            app.getMetrics().NewMeter(
-                        {"op-set-options", "invalid", "threshold-out-of-range"},
-                        "operation").Mark();
+            app.getOperationMetrics().mark(
+                setOptionsInvalidThresholdOutOfRange);
             innerResult().code(SET_OPTIONS_THRESHOLD_OUT_OF_RANGE);
             return false;
         }
@@ -254,9 +267,8 @@ SetOptionsOpFrame::doCheckValid(Application& app)
     {
         if (*mSetOptions.lowThreshold > UINT8_MAX)
         {
-            app.getMetrics().NewMeter(
-                        {"op-set-options", "invalid", "threshold-out-of-range"},
-                        "operation").Mark();
+            app.getOperationMetrics().mark(
+                setOptionsInvalidThresholdOutOfRange);
             innerResult().code(SET_OPTIONS_THRESHOLD_OUT_OF_RANGE);
             return false;
         }
@@ -266,9 +278,8 @@ SetOptionsOpFrame::doCheckValid(Application& app)
     {
         if (*mSetOptions.medThreshold > UINT8_MAX)
         {
-            app.getMetrics().NewMeter(
-                        {"op-set-options", "invalid", "threshold-out-of-range"},
-                        "operation").Mark();
+            app.getOperationMetrics().mark(
+                setOptionsInvalidThresholdOutOfRange);
             innerResult().code(SET_OPTIONS_THRESHOLD_OUT_OF_RANGE);
             return false;
         }
@@ -278,9 +289,8 @@ SetOptionsOpFrame::doCheckValid(Application& app)
     {
         if (*mSetOptions.highThreshold > UINT8_MAX)
         {
-            app.getMetrics().NewMeter(
-                        {"op-set-options", "invalid", "threshold-out-of-range"},
-                        "operation").Mark();
+            app.getOperationMetrics().mark(
+                setOptionsInvalidThresholdOutOfRange);
             innerResult().code(SET_OPTIONS_THRESHOLD_OUT_OF_RANGE);
             return false;
         }
@@ -290,8 +300,7 @@ SetOptionsOpFrame::doCheckValid(Application& app)
     {
         if (mSetOptions.signer->pubKey == getSourceID())
         {
-            app.getMetrics().NewMeter({"op-set-options", "invalid", "bad-signer"},
-                             "operation").Mark();
+            app.getOperationMetrics().mark(setOptionsInvalidBadSigner);
             innerResult().code(SET_OPTIONS_BAD_SIGNER);
             return false;
         }        
@@ -301,9 +310,7 @@ SetOptionsOpFrame::doCheckValid(Application& app)
     {
         if (!isString32Valid(*mSetOptions.homeDomain))
         {
-            app.getMetrics().NewMeter(
-                        {"op-set-options", "invalid", "invalid-home-domain"},
-                        "operation").Mark();
+            app.getOperationMetrics().mark(setOptionsInvalidInvalidHomeDomain);
             innerResult().code(SET_OPTIONS_INVALID_HOME_DOMAIN);
             return false;
         }
@@ -17,10 +17,12 @@
 #include "herder/TxSetFrame.h"
 #include "crypto/Hex.h"
 #include "util/basen.h"
+#include "transactions/OperationMetrics.h"
 
 #include "medida/meter.h"
 #include "medida/metrics_registry.h"
 #include <algorithm>
+#include <atomic>
 
 namespace stellar
 {
@@ -28,6 +30,34 @@ namespace stellar
 using namespace std;
 using xdr::operator==;
 
+namespace
+{
+OperationMeter const transactionInvalidMissingOperation(
+    "transaction", "invalid", "missing-operation", "transaction");
+OperationMeter const transactionInvalidMalformedFees(
+    "transaction", "invalid", "malformed-fees", "transaction");
+OperationMeter const transactionInvalidTooEarly(
+    "transaction", "invalid", "too-early", "transaction");
+OperationMeter const transactionInvalidTooLate(
+    "transaction", "invalid", "too-late", "transaction");
+OperationMeter const transactionInvalidInsufficientFee(
+    "transaction", "invalid", "insufficient-fee", "transaction");
+OperationMeter const transactionInvalidNoAccount(
+    "transaction", "invalid", "no-account", "transaction");
+OperationMeter const transactionInvalidBadSeq(
+    "transaction", "invalid", "bad-seq", "transaction");
+OperationMeter const transactionInvalidBadAuth(
+    "transaction", "invalid", "bad-auth", "transaction");
+OperationMeter const transactionInvalidInsufficientBalance(
+    "transaction", "invalid", "insufficient-balance", "transaction");
+OperationMeter const transactionInvalidInvalidOp(
+    "transaction", "invalid", "invalid-op", "transaction");
+OperationMeter const transactionInvalidBadAuthExtra(
+    "transaction", "invalid", "bad-auth-extra", "transaction");
+
+std::atomic<uint64_t> gVerifiedSignatureHits{0};
+}
+
 TransactionFramePtr
 TransactionFrame::makeTransactionFromWire(Hash const& networkID,
                                           TransactionEnvelope const& msg)
@@ -38,7 +68,7 @@ TransactionFrame::makeTransactionFromWire(Hash const& networkID,
 
 TransactionFrame::TransactionFrame(Hash const& networkID,
                                    TransactionEnvelope const& envelope)
-    : mEnvelope(envelope), mNetworkID(networkID)
+    : mEnvelope(envelope), mSignaturesTrusted(false), mNetworkID(networkID)
 {
 }
 
@@ -69,6 +99,7 @@ TransactionFrame::clearCached()
     Hash zero;
     mContentsHash = zero;
     mFullHash = zero;
+    mVerifiedSignatures.clear();
 }
 
 TransactionResultPair
@@ -148,8 +179,6 @@ TransactionFrame::checkSignature(AccountFrame& account, int32_t neededWeight, ve
 	if (usedSigners != nullptr)
 		usedSigners->clear();
 
-    Hash const& contentsHash = getContentsHash();
-
     // calculate the weight of the signatures
     int totalWeight = 0;
 
@@ -160,8 +189,7 @@ TransactionFrame::checkSignature(AccountFrame& account, int32_t neededWeight, ve
         for (auto it = keyWeights.begin(); it != keyWeights.end(); it++)
         {
             if (PubKeyUtils::hasHint((*it).pubKey, sig.hint) &&
-                PubKeyUtils::verifySig((*it).pubKey, sig.signature,
-                                       contentsHash))
+                verifySignature(i, (*it).pubKey))
             {
 				if (usedSigners != nullptr) {
 					usedSigners->push_back(*it);
@@ -180,6 +208,86 @@ TransactionFrame::checkSignature(AccountFrame& account, int32_t neededWeight, ve
     return false;
 }
 
+bool
+TransactionFrame::verifySignature(size_t index, PublicKey const& signer)
+{
+    if (mSignaturesTrusted)
+    {
+        return true;
+    }
+
+    auto const& signature = mEnvelope.signatures[index].signature;
+    for (auto const& v : mVerifiedSignatures)
+    {
+        if (v.mIndex == index && v.mSigner == signer &&
+            v.mSignature == signature)
+        {
+            ++gVerifiedSignatureHits;
+            return v.mValid;
+        }
+    }
+
+    bool valid =
+        PubKeyUtils::verifySig(signer, signature, getContentsHash());
+    mVerifiedSignatures.push_back(
+        VerifiedSignature{index, signer, signature, valid});
+    return valid;
+}
+
+void
+TransactionFrame::setSignaturesTrusted(bool trusted)
+{
+    mSignaturesTrusted = trusted;
+}
+
+uint64_t
+TransactionFrame::flushVerifiedSignatureHits()
+{
+    return gVerifiedSignatureHits.exchange(0);
+}
+
+void
+TransactionFrame::addSignatureChecks(
+    Database* db, std::vector<PubKeyUtils::SignatureCheck>& checks) const
+{
+    vector<AccountID> accounts{getSourceID()};
+    for (auto const& op : mEnvelope.tx.operations)
+    {
+        if (op.sourceAccount &&
+            std::find(accounts.begin(), accounts.end(), *op.sourceAccount) ==
+                accounts.end())
+        {
+            accounts.push_back(*op.sourceAccount);
+        }
+    }
+
+    Hash const& contentsHash = getContentsHash();
+    for (auto const& id : accounts)
+    {
+        vector<PublicKey> keys{id};
+        auto account = db ? AccountFrame::loadAccount(id, *db) : nullptr;
+        if (account)
+        {
+            for (auto const& signer : account->getAccount().signers)
+            {
+                keys.push_back(signer.pubKey);
+            }
+        }
+
+        for (auto const& sig : mEnvelope.signatures)
+        {
+            for (auto const& k : keys)
+            {
+                if (PubKeyUtils::hasHint(k, sig.hint))
+                {
+                    checks.push_back(PubKeyUtils::SignatureCheck{
+                        k, sig.signature, contentsHash});
+                }
+            }
+        }
+    }
+}
+
 AccountFrame::pointer
 TransactionFrame::loadAccount(LedgerDelta* delta, Database& db,
                               AccountID const& accountID)
@@ -240,20 +348,14 @@ TransactionFrame::commonValid(Application& app, LedgerDelta* delta,
 
     if (mOperations.size() == 0)
     {
-        app.getMetrics()
-            .NewMeter({"transaction", "invalid", "missing-operation"},
-                      "transaction")
-            .Mark();
+        app.getOperationMetrics().mark(transactionInvalidMissingOperation);
         getResult().result.code(txMISSING_OPERATION);
         return false;
     }
 
 	if (mOperations.size() != mEnvelope.operationFees.size())
 	{
-		app.getMetrics()
-			.NewMeter({ "transaction", "invalid", "malformed-fees" },
-				"transaction")
-			.Mark();
+		app.getOperationMetrics().mark(transactionInvalidMalformedFees);
 		getResult().result.code(txINTERNAL_ERROR);
 		return false;
 	}
@@ -264,19 +366,14 @@ TransactionFrame::commonValid(Application& app, LedgerDelta* delta,
         uint64 closeTime = lm.getCurrentLedgerHeader().scpValue.closeTime;
         if (mEnvelope.tx.timeBounds->minTime > closeTime)
         {
-            app.getMetrics()
-                .NewMeter({"transaction", "invalid", "too-early"},
-                          "transaction")
-                .Mark();
+            app.getOperationMetrics().mark(transactionInvalidTooEarly);
             getResult().result.code(txTOO_EARLY);
             return false;
         }
         if (mEnvelope.tx.timeBounds->maxTime &&
             (mEnvelope.tx.timeBounds->maxTime < closeTime))
         {
-            app.getMetrics()
-                .NewMeter({"transaction", "invalid", "too-late"}, "transaction")
-                .Mark();
+            app.getOperationMetrics().mark(transactionInvalidTooLate);
             getResult().result.code(txTOO_LATE);
             return false;
         }
@@ -284,19 +381,14 @@ TransactionFrame::commonValid(Application& app, LedgerDelta* delta,
 
     if (mEnvelope.tx.fee < getMinFee(lm))
     {
-        app.getMetrics()
-            .NewMeter({"transaction", "invalid", "insufficient-fee"},
-                      "transaction")
-            .Mark();
+        app.getOperationMetrics().mark(transactionInvalidInsufficientFee);
         getResult().result.code(txINSUFFICIENT_FEE);
         return false;
     }
 
     if (!loadAccount(delta, app.getDatabase()))
     {
-        app.getMetrics()
-            .NewMeter({"transaction", "invalid", "no-account"}, "transaction")
-            .Mark();
+        app.getOperationMetrics().mark(transactionInvalidNoAccount);
         getResult().result.code(txNO_ACCOUNT);
         return false;
     }
@@ -311,9 +403,7 @@ TransactionFrame::commonValid(Application& app, LedgerDelta* delta,
 
         if (current + 1 != mEnvelope.tx.seqNum)
         {
-            app.getMetrics()
-                .NewMeter({"transaction", "invalid", "bad-seq"}, "transaction")
-                .Mark();
+            app.getOperationMetrics().mark(transactionInvalidBadSeq);
             getResult().result.code(txBAD_SEQ);
             return false;
         }
@@ -321,9 +411,7 @@ TransactionFrame::commonValid(Application& app, LedgerDelta* delta,
 
     if (!checkSignature(*mSigningAccount, mSigningAccount->getLowThreshold(), nullptr))
     {
-        app.getMetrics()
-            .NewMeter({"transaction", "invalid", "bad-auth"}, "transaction")
-            .Mark();
+        app.getOperationMetrics().mark(transactionInvalidBadAuth);
         getResult().result.code(txBAD_AUTH);
         return false;
     }
@@ -332,10 +420,7 @@ TransactionFrame::commonValid(Application& app, LedgerDelta* delta,
     if (mSigningAccount->getAccount().balance - mEnvelope.tx.fee <
         mSigningAccount->getMinimumBalance(app.getLedgerManager()))
     {
-        app.getMetrics()
-            .NewMeter({"transaction", "invalid", "insufficient-balance"},
-                      "transaction")
-            .Mark();
+        app.getOperationMetrics().mark(transactionInvalidInsufficientBalance);
         getResult().result.code(txINSUFFICIENT_BALANCE);
         return false;
     }
@@ -428,10 +513,7 @@ TransactionFrame::checkValid(Application& app, SequenceNumber current)
                 // it's OK to just fast fail here and not try to call
                 // checkValid on all operations as the resulting object
                 // is only used by applications
-                app.getMetrics()
-                    .NewMeter({"transaction", "invalid", "invalid-op"},
-                              "transaction")
-                    .Mark();
+                app.getOperationMetrics().mark(transactionInvalidInvalidOp);
                 markResultFailed();
                 return false;
             }
@@ -439,10 +521,7 @@ TransactionFrame::checkValid(Application& app, SequenceNumber current)
         res = checkAllSignaturesUsed();
         if (!res)
         {
-            app.getMetrics()
-                .NewMeter({"transaction", "invalid", "bad-auth-extra"},
-                          "transaction")
-                .Mark();
+            app.getOperationMetrics().mark(transactionInvalidBadAuthExtra);
         }
     }
     return res;
@@ -495,8 +574,7 @@ TransactionFrame::apply(LedgerDelta& delta, TransactionMeta& meta,
         soci::transaction sqlTx(app.getDatabase().getSession());
         LedgerDelta thisTxDelta(delta);
 
-        auto& opTimer =
-            app.getMetrics().NewTimer({"transaction", "op", "apply"});
+        auto& opTimer = app.getOperationMetrics().getOperationApplyTimer();
 
         for (auto& op : mOperations)
         {
@@ -554,20 +632,18 @@ TransactionFrame::storeTransaction(LedgerManager& ledgerManager,
     resultSet.results.emplace_back(getResultPair());
     auto txResultBytes(xdr::xdr_to_opaque(resultSet.results.back()));
 
-    std::string txBody;
-    txBody = bn::encode_b64(txBytes);
-
-    std::string txResult;
-    txResult = bn::encode_b64(txResultBytes);
-
     xdr::opaque_vec<> txMeta(xdr::xdr_to_opaque(tm));
 
-    std::string meta;
-    meta = bn::encode_b64(txMeta);
-
     string txIDString(binToHex(getContentsHash()));
 
     auto& db = ledgerManager.getDatabase();
+    BinaryColumn txBody(db, db.getSession());
+    BinaryColumn txResult(db, db.getSession());
+    BinaryColumn meta(db, db.getSession());
+    txBody.set(txBytes);
+    txResult.set(txResultBytes);
+    meta.set(txMeta);
+
     auto prep = db.getPreparedStatement(
         "INSERT INTO txhistory "
         "( txid, ledgerseq, txindex,  txbody, txresult, txmeta) VALUES "
@@ -577,9 +653,9 @@ TransactionFrame::storeTransaction(LedgerManager& ledgerManager,
     st.exchange(soci::use(txIDString));
     st.exchange(soci::use(ledgerManager.getCurrentLedgerHeader().ledgerSeq));
     st.exchange(soci::use(txindex));
-    st.exchange(soci::use(txBody));
-    st.exchange(soci::use(txResult));
-    st.exchange(soci::use(meta));
+    st.exchange(txBody.use());
+    st.exchange(txResult.use());
+    st.exchange(meta.use());
     st.define_and_bind();
     {
         auto timer = db.getInsertTimer("txhistory");
@@ -597,14 +673,12 @@ TransactionFrame::storeTransactionFee(LedgerManager& ledgerManager,
                                       LedgerEntryChanges const& changes,
                                       int txindex) const
 {
-    xdr::opaque_vec<> txChanges(xdr::xdr_to_opaque(changes));
-
-    std::string txChanges64;
-    txChanges64 = bn::encode_b64(txChanges);
-
     string txIDString(binToHex(getContentsHash()));
 
     auto& db = ledgerManager.getDatabase();
+    BinaryColumn txChanges(db, db.getSession());
+    txChanges.set(xdr::xdr_to_opaque(changes));
+
     auto prep = db.getPreparedStatement(
         "INSERT INTO txfeehistory "
         "( txid, ledgerseq, txindex,  txchanges) VALUES "
@@ -614,7 +688,7 @@ TransactionFrame::storeTransactionFee(LedgerManager& ledgerManager,
     st.exchange(soci::use(txIDString));
     st.exchange(soci::use(ledgerManager.getCurrentLedgerHeader().ledgerSeq));
     st.exchange(soci::use(txindex));
-    st.exchange(soci::use(txChanges64));
+    st.exchange(txChanges.use());
     st.define_and_bind();
     {
         auto timer = db.getInsertTimer("txfeehistory");
@@ -654,20 +728,20 @@ TransactionResultSet
 TransactionFrame::getTransactionHistoryResults(Database& db, uint32 ledgerSeq)
 {
     TransactionResultSet res;
-    std::string txresult64;
+    BinaryColumn txResult(db, db.getSession());
+    std::vector<uint8_t> result;
     auto prep =
         db.getPreparedStatement("SELECT txresult FROM txhistory "
                                 "WHERE ledgerseq = :lseq ORDER BY txindex ASC");
     auto& st = prep.statement();
 
     st.exchange(soci::use(ledgerSeq));
-    st.exchange(soci::into(txresult64));
+    st.exchange(txResult.into());
     st.define_and_bind();
     st.execute(true);
     while (st.got_data())
     {
-        std::vector<uint8_t> result;
-        bn::decode_b64(txresult64, result);
+        txResult.get(result);
 
         res.results.emplace_back();
         TransactionResultPair& p = res.results.back();
@@ -684,20 +758,20 @@ std::vector<LedgerEntryChanges>
 TransactionFrame::getTransactionFeeMeta(Database& db, uint32 ledgerSeq)
 {
     std::vector<LedgerEntryChanges> res;
-    std::string changes64;
+    BinaryColumn changes(db, db.getSession());
+    std::vector<uint8_t> changesRaw;
     auto prep =
         db.getPreparedStatement("SELECT txchanges FROM txfeehistory "
                                 "WHERE ledgerseq = :lseq ORDER BY txindex ASC");
     auto& st = prep.statement();
 
-    st.exchange(soci::into(changes64));
+    st.exchange(changes.into());
     st.exchange(soci::use(ledgerSeq));
     st.define_and_bind();
     st.execute(true);
     while (st.got_data())
     {
-        std::vector<uint8_t> changesRaw;
-        bn::decode_b64(changes64, changesRaw);
+        changes.get(changesRaw);
 
         xdr::xdr_get g1(&changesRaw.front(), &changesRaw.back() + 1);
         res.emplace_back();
@@ -717,7 +791,8 @@ TransactionFrame::copyTransactionsToStream(Hash const& networkID, Database& db,
                                            XDROutputFileStream& txResultOut)
 {
     auto timer = db.getSelectTimer("txhistory");
-    std::string txBody, txResult, txMeta;
+    BinaryColumn txBody(db, sess), txResult(db, sess);
+    std::vector<uint8_t> body, result;
     uint32_t begin = ledgerSeq, end = ledgerSeq + ledgerCount;
     size_t n = 0;
 
@@ -729,7 +804,7 @@ TransactionFrame::copyTransactionsToStream(Hash const& networkID, Database& db,
         (sess.prepare << "SELECT ledgerseq, txbody, txresult FROM txhistory "
                          "WHERE ledgerseq >= :begin AND ledgerseq < :end ORDER "
                          "BY ledgerseq ASC, txindex ASC",
-         soci::into(curLedgerSeq), soci::into(txBody), soci::into(txResult),
+         soci::into(curLedgerSeq), txBody.into(), txResult.into(),
          soci::use(begin), soci::use(end));
 
     Hash h;
@@ -754,11 +829,8 @@ TransactionFrame::copyTransactionsToStream(Hash const& networkID, Database& db,
             lastLedgerSeq = curLedgerSeq;
         }
 
-        std::vector<uint8_t> body;
-        bn::decode_b64(txBody, body);
-
-        std::vector<uint8_t> result;
-        bn::decode_b64(txResult, result);
+        txBody.get(body);
+        txResult.get(result);
 
         xdr::xdr_get g1(&body.front(), &body.back() + 1);
         xdr_argpack_archive(g1, tx);
@@ -817,6 +889,113 @@ TransactionFrame::dropAll(Database& db)
     db.getSession() << "CREATE INDEX histfeebyseq ON txfeehistory (ledgerseq);";
 }
 
+void
+TransactionFrame::upgradeHistoryToBinary(Database& db)
+{
+    auto& sess = db.getSession();
+    soci::transaction tx(sess);
+
+    if (!db.isSqlite())
+    {
+        sess << "ALTER TABLE txhistory "
+                "ALTER COLUMN txbody TYPE BYTEA "
+                "USING decode(txbody, 'base64'), "
+                "ALTER COLUMN txresult TYPE BYTEA "
+                "USING decode(txresult, 'base64'), "
+                "ALTER COLUMN txmeta TYPE BYTEA "
+                "USING decode(txmeta, 'base64')";
+        sess << "ALTER TABLE txfeehistory "
+                "ALTER COLUMN txchanges TYPE BYTEA "
+                "USING decode(txchanges, 'base64')";
+        tx.commit();
+        return;
+    }
+
+    // SQLite can neither change the type of a column nor decode base64:
+    // copy the rows to new tables, decoding them along the way
+    std::string txID;
+    uint32_t ledgerSeq;
+    int txIndex;
+    std::vector<std::string> text(3);
+    std::vector<uint8_t> raw;
+    BinaryColumn bin0(db, sess), bin1(db, sess), bin2(db, sess);
+    BinaryColumn* bins[] = {&bin0, &bin1, &bin2};
+
+    sess << "CREATE TABLE txhistory_new ("
+            "txid        CHARACTER(64) NOT NULL,"
+            "ledgerseq   INT NOT NULL CHECK (ledgerseq >= 0),"
+            "txindex     INT NOT NULL,"
+            "txbody      BLOB NOT NULL,"
+            "txresult    BLOB NOT NULL,"
+            "txmeta      BLOB NOT NULL,"
+            "PRIMARY KEY (ledgerseq, txindex)"
+            ")";
+    {
+        soci::statement sel =
+            (sess.prepare << "SELECT txid, ledgerseq, txindex, txbody, "
+                             "txresult, txmeta FROM txhistory",
+             soci::into(txID), soci::into(ledgerSeq), soci::into(txIndex),
+             soci::into(text[0]), soci::into(text[1]), soci::into(text[2]));
+        soci::statement ins =
+            (sess.prepare << "INSERT INTO txhistory_new "
+                             "(txid, ledgerseq, txindex, txbody, txresult, "
+                             "txmeta) VALUES "
+                             "(:id, :seq, :txindex, :txb, :txres, :meta)",
+             soci::use(txID), soci::use(ledgerSeq), soci::use(txIndex),
+             bin0.use(), bin1.use(), bin2.use());
+        sel.execute(true);
+        while (sel.got_data())
+        {
+            for (size_t i = 0; i < text.size(); i++)
+            {
+                raw.clear();
+                bn::decode_b64(text[i], raw);
+                bins[i]->set(raw);
+            }
+            ins.execute(true);
+            sel.fetch();
+        }
+    }
+    sess << "DROP TABLE txhistory";
+    sess << "ALTER TABLE txhistory_new RENAME TO txhistory";
+    sess << "CREATE INDEX histbyseq ON txhistory (ledgerseq)";
+
+    sess << "CREATE TABLE txfeehistory_new ("
+            "txid        CHARACTER(64) NOT NULL,"
+            "ledgerseq   INT NOT NULL CHECK (ledgerseq >= 0),"
+            "txindex     INT NOT NULL,"
+            "txchanges   BLOB NOT NULL,"
+            "PRIMARY KEY (ledgerseq, txindex)"
+            ")";
+    {
+        soci::statement sel =
+            (sess.prepare << "SELECT txid, ledgerseq, txindex, txchanges "
+                             "FROM txfeehistory",
+             soci::into(txID), soci::into(ledgerSeq), soci::into(txIndex),
+             soci::into(text[0]));
+        soci::statement ins =
+            (sess.prepare << "INSERT INTO txfeehistory_new "
+                             "(txid, ledgerseq, txindex, txchanges) VALUES "
+                             "(:id, :seq, :txindex, :txchanges)",
+             soci::use(txID), soci::use(ledgerSeq), soci::use(txIndex),
+             bin0.use());
+        sel.execute(true);
+        while (sel.got_data())
+        {
+            raw.clear();
+            bn::decode_b64(text[0], raw);
+            bin0.set(raw);
+            ins.execute(true);
+            sel.fetch();
+        }
+    }
+    sess << "DROP TABLE txfeehistory";
+    sess << "ALTER TABLE txfeehistory_new RENAME TO txfeehistory";
+    sess << "CREATE INDEX histfeebyseq ON txfeehistory (ledgerseq)";
+
+    tx.commit();
+}
+
 void
 TransactionFrame::deleteOldEntries(Database& db, uint32_t ledgerSeq)
 {
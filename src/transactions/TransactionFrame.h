@@ -7,6 +7,7 @@
 #include <memory>
 #include "ledger/LedgerManager.h"
 #include "ledger/AccountFrame.h"
+#include "crypto/SecretKey.h"
 #include "overlay/StellarXDR.h"
 #include "util/types.h"
 
@@ -40,6 +41,24 @@ class TransactionFrame
     AccountFrame::pointer mSigningAccount;
 	std::vector<bool> mUsedSignatures;
 
+    // signatures of the envelope verified so far against a signer, so that
+    // validating the transaction again doesn't verify them again; the
+    // signature is kept in case the envelope is modified
+    struct VerifiedSignature
+    {
+        size_t mIndex;
+        PublicKey mSigner;
+        Signature mSignature;
+        bool mValid;
+    };
+    std::vector<VerifiedSignature> mVerifiedSignatures;
+
+    // see setSignaturesTrusted
+    bool mSignaturesTrusted;
+
+    // verifies signature `index` of the envelope under `signer`
+    bool verifySignature(size_t index, PublicKey const& signer);
+
     void clearCached();
     Hash const& mNetworkID;     // used to change the way we compute signatures
     mutable Hash mContentsHash; // the hash of the contents
@@ -133,6 +152,23 @@ class TransactionFrame
     void addSignature(SecretKey const& secretKey);
 
     bool checkSignature(AccountFrame& account, int32_t neededWeight, std::vector<Signer>* usedSigners);
+
+    // when trusted, the signatures of the envelope are taken for valid under
+    // the signers their hint designates, without verifying them; for the
+    // ledgers of a verified history chain only (see
+    // LedgerCloseData::mFastReplay)
+    void setSignaturesTrusted(bool trusted);
+
+    // number of signatures found already verified by their transaction
+    // since the last call, across the process
+    static uint64_t flushVerifiedSignatureHits();
+
+    // adds to `checks` the signatures of the envelope checkSignature may
+    // verify, given the signers of the accounts involved as found in `db`;
+    // without `db`, only the master keys of these accounts are considered
+    void
+    addSignatureChecks(Database* db,
+                       std::vector<PubKeyUtils::SignatureCheck>& checks) const;
     
     bool checkValid(Application& app, SequenceNumber current);
 
@@ -178,6 +214,10 @@ class TransactionFrame
                                            XDROutputFileStream& txResultOut);
     static void dropAll(Database& db);
 
+    // converts the base64 TEXT columns of txhistory and txfeehistory to
+    // binary (BLOB or BYTEA) columns holding the XDR directly
+    static void upgradeHistoryToBinary(Database& db);
+
     static void deleteOldEntries(Database& db, uint32_t ledgerSeq);
 };
 }
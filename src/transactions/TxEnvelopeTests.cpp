@@ -104,6 +104,24 @@ TEST_CASE("txenvelope", "[tx][envelope]")
 
             REQUIRE(txFrame->getResultCode() == txBAD_AUTH_EXTRA);
         }
+        SECTION("signatures verified once per transaction")
+        {
+            txFrame = createCreateAccountTx(networkID, root, a1, rootSeq,
+                                            paymentAmount);
+            TransactionFrame::flushVerifiedSignatureHits();
+
+            // checked for the transaction, then for its operation
+            REQUIRE(txFrame->checkValid(app, 0));
+            REQUIRE(TransactionFrame::flushVerifiedSignatureHits() == 1);
+            REQUIRE(txFrame->checkValid(app, 0));
+            REQUIRE(TransactionFrame::flushVerifiedSignatureHits() == 2);
+
+            // a replaced signature is verified again
+            txFrame->getEnvelope().signatures[0].signature = Signature(64, 1);
+            REQUIRE(!txFrame->checkValid(app, 0));
+            REQUIRE(TransactionFrame::flushVerifiedSignatureHits() == 0);
+            REQUIRE(txFrame->getResultCode() == txBAD_AUTH);
+        }
     }
 
     SECTION("multisig")
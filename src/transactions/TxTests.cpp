@@ -12,6 +12,8 @@
 #include "transactions/TxTests.h"
 #include "util/types.h"
 #include "transactions/TransactionFrame.h"
+#include "history/HistoryManager.h"
+#include "history/HistoryWriter.h"
 #include "ledger/LedgerDelta.h"
 #include "ledger/DataFrame.h"
 #include "ledger/ReversedPaymentFrame.h"
@@ -185,6 +187,7 @@ closeLedgerOn(Application& app, uint32 ledgerSeq, int day, int month, int year,
                     emptyUpgradeSteps, 0);
     LedgerCloseData ledgerData(ledgerSeq, txSet, sv);
     app.getLedgerManager().closeLedger(ledgerData);
+    app.getHistoryManager().getHistoryWriter().flush();
 
     auto z1 = TransactionFrame::getTransactionHistoryResults(app.getDatabase(),
                                                              ledgerSeq);
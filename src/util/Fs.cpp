@@ -15,6 +15,7 @@
 #endif
 
 #include <cstdio>
+#include <fstream>
 
 namespace stellar
 {
@@ -261,6 +262,50 @@ processExists(long pid)
 
 #endif
 
+bool
+mkpath(std::string const& path)
+{
+    for (size_t i = path.find('/', 1); i != std::string::npos;
+         i = path.find('/', i + 1))
+    {
+        auto parent = path.substr(0, i);
+        if (!exists(parent))
+        {
+            mkdir(parent);
+        }
+    }
+    if (!exists(path))
+    {
+        mkdir(path);
+    }
+    return exists(path);
+}
+
+void
+copyFile(std::string const& from, std::string const& to)
+{
+    std::ifstream in(from, std::ifstream::binary);
+    if (!in)
+    {
+        throw std::runtime_error("failed to open " + from);
+    }
+    std::ofstream out(to, std::ofstream::binary | std::ofstream::trunc);
+    if (!out)
+    {
+        throw std::runtime_error("failed to open " + to);
+    }
+    if (in.peek() != std::ifstream::traits_type::eof())
+    {
+        out << in.rdbuf();
+    }
+    out.close();
+    if (!out || in.bad())
+    {
+        std::remove(to.c_str());
+        throw std::runtime_error("failed to copy " + from + " to " + to);
+    }
+}
+
 std::string
 hexStr(uint32_t checkpointNum)
 {
@@ -37,6 +37,12 @@ void deltree(std::string const& path);
 // Make a single dir; not mkdir-p, i.e. non-recursive
 bool mkdir(std::string const& path);
 
+// Make a dir and any missing parent, like mkdir -p; true if it exists after
+bool mkpath(std::string const& path);
+
+// Copy a file, replacing `to`; throws std::runtime_error on failure
+void copyFile(std::string const& from, std::string const& to);
+
 ////
 // Utility functions for constructing path names
 ////
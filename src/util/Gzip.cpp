@@ -0,0 +1,210 @@
+// Copyright 2017 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "util/Gzip.h"
+#include "crypto/ByteSlice.h"
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+#include <zlib.h>
+
+namespace stellar
+{
+
+namespace
+{
+size_t const CHUNK_SIZE = 0x10000;
+
+// windowBits asking zlib for a gzip header and trailer, see deflateInit2
+int const GZIP_WINDOW_BITS = 15 + 16;
+
+// the streams of a conversion; removes the output unless it completes
+class Files
+{
+    std::string mTo;
+    bool mDone;
+
+  public:
+    std::ifstream mIn;
+    std::ofstream mOut;
+
+    Files(std::string const& from, std::string const& to)
+        : mTo(to), mDone(false), mIn(from, std::ifstream::binary)
+    {
+        if (!mIn)
+        {
+            throw std::runtime_error("failed to open " + from);
+        }
+        mOut.open(to, std::ofstream::binary | std::ofstream::trunc);
+        if (!mOut)
+        {
+            throw std::runtime_error("failed to open " + to);
+        }
+    }
+
+    ~Files()
+    {
+        if (!mDone)
+        {
+            mOut.close();
+            std::remove(mTo.c_str());
+        }
+    }
+
+    // reads up to `size` bytes; false at the end of the input
+    bool
+    read(char* data, size_t size, size_t& got)
+    {
+        mIn.read(data, size);
+        got = static_cast<size_t>(mIn.gcount());
+        if (mIn.bad())
+        {
+            throw std::runtime_error("failed to read");
+        }
+        return got != 0;
+    }
+
+    void
+    write(char const* data, size_t size)
+    {
+        if (!mOut.write(data, size))
+        {
+            throw std::runtime_error("failed to write " + mTo);
+        }
+    }
+
+    void
+    close()
+    {
+        mOut.close();
+        if (!mOut)
+        {
+            throw std::runtime_error("failed to write " + mTo);
+        }
+        mDone = true;
+    }
+};
+}
+
+void
+gzipFile(std::string const& from, std::string const& to)
+{
+    Files files(from, to);
+    std::vector<char> in(CHUNK_SIZE);
+    std::vector<char> out(CHUNK_SIZE);
+
+    z_stream zs{};
+    if (deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, GZIP_WINDOW_BITS,
+                     8, Z_DEFAULT_STRATEGY) != Z_OK)
+    {
+        throw std::runtime_error("deflateInit2 failed");
+    }
+    try
+    {
+        int flush;
+        do
+        {
+            size_t got;
+            flush = files.read(in.data(), in.size(), got) ? Z_NO_FLUSH
+                                                           : Z_FINISH;
+            zs.next_in = reinterpret_cast<Bytef*>(in.data());
+            zs.avail_in = static_cast<uInt>(got);
+            do
+            {
+                zs.next_out = reinterpret_cast<Bytef*>(out.data());
+                zs.avail_out = static_cast<uInt>(out.size());
+                if (deflate(&zs, flush) == Z_STREAM_ERROR)
+                {
+                    throw std::runtime_error("deflate failed");
+                }
+                files.write(out.data(), out.size() - zs.avail_out);
+            } while (zs.avail_out == 0);
+        } while (flush != Z_FINISH);
+        files.close();
+    }
+    catch (...)
+    {
+        deflateEnd(&zs);
+        throw;
+    }
+    deflateEnd(&zs);
+}
+
+void
+gunzipFile(std::string const& from, std::string const& to,
+           std::function<void(ByteSlice const&)> const& consumer)
+{
+    Files files(from, to);
+    std::vector<char> in(CHUNK_SIZE);
+    std::vector<char> out(CHUNK_SIZE);
+
+    z_stream zs{};
+    if (inflateInit2(&zs, GZIP_WINDOW_BITS) != Z_OK)
+    {
+        throw std::runtime_error("inflateInit2 failed");
+    }
+    try
+    {
+        // like gzip -d, accepts several members one after the other
+        bool inMember = false;
+        // inflate may have more output for the input it was given
+        bool outputPending = false;
+        for (;;)
+        {
+            if (zs.avail_in == 0 && !outputPending)
+            {
+                size_t got;
+                if (!files.read(in.data(), in.size(), got))
+                {
+                    break;
+                }
+                zs.next_in = reinterpret_cast<Bytef*>(in.data());
+                zs.avail_in = static_cast<uInt>(got);
+                inMember = true;
+            }
+
+            zs.next_out = reinterpret_cast<Bytef*>(out.data());
+            zs.avail_out = static_cast<uInt>(out.size());
+            int res = inflate(&zs, Z_NO_FLUSH);
+            if (res != Z_OK && res != Z_STREAM_END && res != Z_BUF_ERROR)
+            {
+                throw std::runtime_error("corrupt gzip file " + from);
+            }
+
+            size_t produced = out.size() - zs.avail_out;
+            if (produced != 0)
+            {
+                files.write(out.data(), produced);
+                if (consumer)
+                {
+                    consumer(ByteSlice(out.data(), produced));
+                }
+            }
+            outputPending = zs.avail_out == 0;
+
+            if (res == Z_STREAM_END)
+            {
+                inMember = zs.avail_in != 0;
+                outputPending = false;
+                if (inflateReset(&zs) != Z_OK)
+                {
+                    throw std::runtime_error("inflateReset failed");
+                }
+            }
+        }
+        if (inMember)
+        {
+            throw std::runtime_error("truncated gzip file " + from);
+        }
+        files.close();
+    }
+    catch (...)
+    {
+        inflateEnd(&zs);
+        throw;
+    }
+    inflateEnd(&zs);
+}
+}
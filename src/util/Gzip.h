@@ -0,0 +1,31 @@
+#pragma once
+
+// Copyright 2017 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include <functional>
+#include <string>
+
+namespace stellar
+{
+
+class ByteSlice;
+
+////
+// Streaming gzip compression of files with zlib, in-process and in a single
+// pass over the data, in place of the gzip command. Both throw
+// std::runtime_error when a file can't be read or written, or isn't valid
+// gzip; `to` is then removed.
+////
+
+// Compress `from` into the gzip file `to`.
+void gzipFile(std::string const& from, std::string const& to);
+
+// Decompress the gzip file `from` into `to`, handing every decompressed chunk
+// to `consumer` as well, if any: a hash of the content, for instance, can be
+// computed without reading it again.
+void gunzipFile(std::string const& from, std::string const& to,
+                std::function<void(ByteSlice const&)> const& consumer =
+                    std::function<void(ByteSlice const&)>());
+}